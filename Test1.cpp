@@ -2,8 +2,11 @@
 // Created by scorsi on 23/12/17.
 //
 
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include "api/pp/conf.hpp"
+#include "api/pp/file.hpp"
 #include "api/pp/net.hpp"
 #include "api/pp/http.hpp"
 #include "api/pp/module.hpp"
@@ -26,6 +29,24 @@ public:
     }
 };
 
+// SZA++ Module only reading the request
+class HeaderOnly : public zia::apipp::Module {
+public:
+    bool perform() override {
+        this->response->addHeader("X-Request-Body", std::to_string(this->request->body.size()));
+        return true;
+    }
+};
+
+// SZA++ Module writing the body member directly
+class Overwrite : public zia::apipp::Module {
+public:
+    bool perform() override {
+        this->response->body = "replaced";
+        return true;
+    }
+};
+
 // Basic SZA Module Implementation
 class BasicTest : public zia::api::Module {
 private:
@@ -89,5 +110,37 @@ void test1() {
             std::cout << item.first << "=" << item.second << std::endl;
         }
     }
+    {
+        // SZA++ view of a duplex: the body is borrowed until a module mutates it
+        zia::api::HttpDuplex duplex;
+        duplex.req.body = {std::byte{'h'}, std::byte{'i'}};
+
+        auto request = zia::apipp::Request::viewBasicHttpDuplex(duplex);
+        std::cout << request->bodyView() << " (view: " << std::boolalpha << request->isView() << ")" << std::endl;
+
+        request->mutableBody() += "!";
+        std::cout << request->bodyView() << " (view: " << request->isView() << ")" << std::endl;
+
+        request->applyTo(duplex);
+        std::cout << duplex.req.body.size() << " bytes (view: " << request->isView() << ")" << std::endl;
+    }
+    {
+        // SZA++ Module given a file body: it is only read if the module replaces it
+        const char *path = "/tmp/zia_test1.txt";
+        std::ofstream(path, std::ios::binary) << "from a file";
+        zia::api::HttpDuplex duplex;
+        duplex.req.body = {std::byte{'h'}, std::byte{'i'}};
+        duplex.resp.file = zia::apipp::openFile(path);
+
+        HeaderOnly().exec(duplex);
+        std::cout << "Headers only: file=" << (duplex.resp.file != nullptr) << ", body=" << duplex.resp.body.size()
+                  << " bytes, X-Request-Body=" << duplex.resp.headers["X-Request-Body"] << std::endl;
+
+        Overwrite().exec(duplex);
+        std::cout << "Overwritten: file=" << (duplex.resp.file != nullptr) << ", body="
+                  << std::string(reinterpret_cast<const char *>(duplex.resp.body.data()), duplex.resp.body.size())
+                  << std::endl;
+        std::remove(path);
+    }
     std::cout << std::endl << std::endl;
 }
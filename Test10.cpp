@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "api/pp/json.hpp"
+#include "api/pp/snapshot.hpp"
+
+namespace {
+
+    const char *document = R"({
+        "name": "zia",
+        "port": 8080,
+        "ratio": 0.25,
+        "big": 1e3,
+        "tls": false,
+        "root": null,
+        "escaped": "tab\there \"quoted\" \u00e9\ud83d\ude00 back\\slash",
+        "vhosts": [
+            {"host": "a.example.com", "routes": []},
+            {"host": "b.example.com", "routes": ["/", "/api"]}
+        ],
+        "empty": {}
+    })";
+
+    void tryParse(const char *text) {
+        zia::apipp::ConfElem conf;
+        std::string error;
+        if (zia::apipp::parseJson(text, conf, error))
+            std::cout << "Parsed: " << zia::apipp::toJson(conf) << std::endl;
+        else
+            std::cout << "Error: " << error << std::endl;
+    }
+
+}
+
+void test10() {
+    std::cout << "TEST -- JSON and snapshots" << std::endl;
+
+    auto conf = zia::apipp::parseJson(document);
+    std::cout << std::boolalpha;
+    std::cout << conf["name"].get<std::string>() << " " << conf["port"].get<long long>() << " "
+              << conf["ratio"].get<double>() << " " << conf["big"].get<double>() << " "
+              << conf["tls"].get<bool>() << " " << (conf["root"].getType() == zia::apipp::ConfElem::Empty) << std::endl;
+    std::cout << conf["escaped"].get<std::string>() << std::endl;
+    std::cout << conf["vhosts"][1]["routes"][1].get<std::string>() << std::endl;
+
+    auto compact = zia::apipp::toJson(conf);
+    std::cout << compact << std::endl;
+    std::cout << zia::apipp::toJson(conf["vhosts"], zia::apipp::JsonStyle::Pretty) << std::endl;
+
+    // Both forms and both configuration types read back the same
+    auto basic = zia::apipp::parseJsonConf(zia::apipp::toJson(conf, zia::apipp::JsonStyle::Pretty));
+    std::cout << "Same after round trip: " << (zia::apipp::toJson(basic) == compact) << std::endl;
+
+    tryParse("[1, -0, 12.5e-1, 9223372036854775807, 9223372036854775808]");
+    tryParse("\"\\u0001\\/\"");
+    tryParse("{\"a\": 1,}");
+    tryParse("{\"a\" 1}");
+    tryParse("[1, 2");
+    tryParse("\"\\ud800\"");
+    tryParse("01");
+    tryParse("{} {}");
+    tryParse(std::string(600, '[').c_str());
+
+    try {
+        zia::apipp::parseJsonConf("[]");
+    } catch (zia::apipp::JsonError &e) {
+        std::cout << "Not an object: " << e.what() << std::endl;
+    }
+    try {
+        zia::apipp::loadJson("/nonexistent/zia.json");
+    } catch (zia::apipp::JsonError &e) {
+        std::cout << e.what() << ", line " << e.line() << std::endl;
+    }
+
+    // Binary snapshot, mapped and read in place
+    const std::string jsonPath = "/tmp/zia_test10.json";
+    const std::string snapshotPath = "/tmp/zia_test10.snapshot";
+    std::remove(snapshotPath.c_str());
+    std::ofstream(jsonPath) << document;
+
+    auto compiled = zia::apipp::loadCompiledConf(jsonPath, snapshotPath);
+    std::cout << "First load mapped: " << compiled.mapped() << std::endl;
+    auto mapped = zia::apipp::loadCompiledConf(jsonPath, snapshotPath);
+    std::cout << "Second load mapped: " << mapped.mapped() << ", " << mapped.nodeCount() << " nodes, "
+              << mapped["vhosts"][1]["routes"][1].get<std::string_view>() << " "
+              << mapped["escaped"].get<std::string>() << " " << mapped["port"].get<int>() << " "
+              << mapped["ratio"].get<double>() << std::endl;
+
+    // The JSON file changed: the snapshot is stale
+    std::ofstream(jsonPath) << R"({"port": 9090})";
+    std::cout << "Stale: " << !zia::apipp::CompiledConf::mapSnapshot(snapshotPath, zia::apipp::sourceStamp(jsonPath))
+              << std::endl;
+    auto reloaded = zia::apipp::loadCompiledConf(jsonPath, snapshotPath);
+    std::cout << "Reloaded from JSON: " << !reloaded.mapped() << ", port " << reloaded["port"].get<int>() << std::endl;
+
+    // A damaged snapshot is refused, not read
+    {
+        std::fstream file(snapshotPath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('#');
+    }
+    std::cout << "Damaged: " << !zia::apipp::CompiledConf::mapSnapshot(snapshotPath) << std::endl;
+    std::cout << "Missing: " << !zia::apipp::CompiledConf::mapSnapshot("/nonexistent/zia.snapshot") << std::endl;
+    std::remove(jsonPath.c_str());
+    std::remove(snapshotPath.c_str());
+    std::cout << std::endl;
+}
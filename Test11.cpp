@@ -0,0 +1,55 @@
+#include <iostream>
+#include "api/pp/loader.hpp"
+
+namespace {
+
+    zia::api::ConfValue strings(std::initializer_list<const char *> values) {
+        zia::api::ConfArray array;
+        for (auto value : values) {
+            zia::api::ConfValue item;
+            item.v = std::string(value);
+            array.push_back(item);
+        }
+        zia::api::ConfValue conf;
+        conf.v = array;
+        return conf;
+    }
+
+    zia::api::ConfValue integer(long long value) {
+        zia::api::ConfValue conf;
+        conf.v = value;
+        return conf;
+    }
+
+}
+
+void test11() {
+    std::cout << "TEST -- Module loader" << std::endl;
+    std::cout << std::boolalpha;
+
+    // Modules configured in parallel stay in the order of the list
+    zia::api::Conf conf{
+            {"modules", strings({"zia_test_hello", "zia_test_world", "zia_test_hello", "zia_test_world"})},
+            {"modules_path", strings({"/nonexistent", ZIA_TEST_MODULES})},
+            {"test_config_delay_ms", integer(20)},
+    };
+    zia::apipp::ModuleManager manager(4);
+    std::cout << "Loaded: " << manager.load(conf) << ", modules: " << manager.modules().size() << std::endl;
+    std::cout << "Parallel: " << (manager.elapsed() < std::chrono::milliseconds(60)) << std::endl;
+
+    zia::api::HttpDuplex duplex{};
+    manager.pipeline()->exec(duplex);
+    std::cout << "Order: " << duplex.resp.headers["X-Modules"] << std::endl;
+
+    // Errors are reported per module, the other ones are still loaded
+    conf["modules"] = strings({"zia_test_hello", "missing"});
+    conf.erase("test_config_delay_ms");
+    std::cout << "Loaded: " << manager.load(conf) << ", in pipeline: " << manager.pipeline()->size() << std::endl;
+    for (const auto &module : manager.modules())
+        std::cout << module.name << ": " << (module.error.empty() ? "ok" : module.error) << std::endl;
+
+    conf["test_config_fail"] = integer(1);
+    manager.load(conf);
+    std::cout << manager.modules()[0].name << ": " << manager.modules()[0].error << std::endl;
+    std::cout << std::endl;
+}
@@ -0,0 +1,141 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include "api/pp/scheduler.hpp"
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include "net/epoll.hpp"
+
+#endif
+
+namespace {
+
+#ifdef __linux__
+
+    /**
+     * Time until the response to request, on a connection of its own.
+     */
+    std::chrono::milliseconds timeRequest(std::uint16_t port, const std::string &request, std::string &response) {
+        auto start = std::chrono::steady_clock::now();
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+            ::send(fd, request.data(), request.size(), 0);
+            char buffer[4096];
+            auto got = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (got > 0)
+                response.assign(buffer, static_cast<std::size_t>(got));
+        }
+        ::close(fd);
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    void serveOnWorkers() {
+        zia::api::Conf conf;
+        conf["port"].v = 48082ll;
+        conf["net_threads"].v = 1ll;
+        zia::net::EpollNet net;
+        net.config(conf);
+
+        zia::apipp::Scheduler scheduler(2);
+        auto started = net.run(scheduler.serve(net, [](zia::api::HttpDuplex &duplex) {
+            auto &path = duplex.req.uri;
+            if (path == "/throw")
+                throw std::runtime_error("module error");
+            if (path == "/slow")
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            duplex.resp.status = zia::api::http::common_status::ok;
+            duplex.resp.body.assign(reinterpret_cast<const std::byte *>(path.data()),
+                                    reinterpret_cast<const std::byte *>(path.data()) + path.size());
+            return true;
+        }));
+        std::cout << "Started: " << started << std::endl;
+
+        // A single Net thread, yet the slow request does not hold the fast one.
+        std::string slowResponse;
+        std::thread slow([&slowResponse]() { timeRequest(48082, "GET /slow HTTP/1.1\r\n\r\n", slowResponse); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::string fastResponse;
+        auto fast = timeRequest(48082, "GET /fast HTTP/1.1\r\n\r\n", fastResponse);
+        slow.join();
+        std::cout << "Fast not behind slow: " << (fast < std::chrono::milliseconds(200)) << std::endl;
+        std::cout << "Responses: " << fastResponse.substr(0, fastResponse.find('\r')) << ", "
+                  << slowResponse.substr(0, slowResponse.find('\r')) << std::endl;
+
+        std::string response;
+        timeRequest(48082, "GET /throw HTTP/1.1\r\n\r\n", response);
+        std::cout << "Throwing handler: " << response.substr(0, response.find('\r')) << std::endl;
+
+        net.stop();
+    }
+
+#endif
+
+}
+
+void test12() {
+    std::cout << "TEST -- Work-stealing scheduler" << std::endl;
+    std::cout << std::boolalpha;
+
+    // Owner pops the last pushed, thieves steal the first, the deque grows past its capacity
+    {
+        int items[100];
+        zia::apipp::StealingDeque<int> deque(4);
+        for (int i = 0; i < 100; ++i) {
+            items[i] = i;
+            deque.push(&items[i]);
+        }
+        std::cout << "Size: " << deque.size() << ", pop: " << *deque.pop() << ", steal: " << *deque.steal()
+                  << std::endl;
+        while (deque.pop());
+        std::cout << "Empty: " << (deque.pop() == nullptr && deque.steal() == nullptr) << std::endl;
+    }
+
+    // Every job runs once
+    {
+        std::atomic<int> ran{0};
+        zia::apipp::Scheduler scheduler(4);
+        for (int i = 0; i < 1000; ++i)
+            scheduler.submit([&ran]() { ++ran; });
+        scheduler.stop();
+        std::cout << "Workers: " << scheduler.size() << ", ran: " << ran << std::endl;
+        std::cout << "Submit after stop: " << scheduler.submit([]() {}) << std::endl;
+    }
+
+    // Jobs spawned by a worker which then blocks are taken by the others
+    {
+        std::atomic<int> ran{0};
+        zia::apipp::Scheduler scheduler(3);
+        scheduler.submit([&scheduler, &ran]() {
+            for (int i = 0; i < 20; ++i)
+                scheduler.submit([&ran]() { ++ran; });
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::cout << "Ran while blocked: " << ran << ", stolen: " << (scheduler.steals() > 0) << std::endl;
+    }
+
+    // Worker count from the configuration
+    {
+        zia::api::Conf conf;
+        conf["worker_threads"].v = 2ll;
+        zia::apipp::Scheduler scheduler(conf);
+        std::cout << "Configured workers: " << scheduler.size() << std::endl;
+    }
+
+#ifdef __linux__
+    serveOnWorkers();
+#endif
+    std::cout << std::endl;
+}
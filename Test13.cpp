@@ -0,0 +1,278 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <thread>
+#include "api/pp/async.hpp"
+#include "api/pp/pipeline.hpp"
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "net/epoll.hpp"
+
+#endif
+
+namespace {
+
+    void append(zia::api::HttpDuplex &http, const std::string &name) {
+        auto &chain = http.resp.headers["X-Chain"];
+        chain += (chain.empty() ? "" : ",") + name;
+    }
+
+    class Tag : public zia::api::Module {
+    private:
+        std::string name;
+
+    public:
+        explicit Tag(std::string name) : name{std::move(name)} {}
+
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        bool exec(zia::api::HttpDuplex &http) override {
+            append(http, this->name);
+            return true;
+        }
+    };
+
+    /**
+     * Waits without holding a thread, as on a CGI child.
+     */
+    class Delay : public zia::apipp::AsyncModule {
+    private:
+        zia::apipp::Reactor &reactor;
+        std::chrono::milliseconds delay;
+
+    public:
+        Delay(zia::apipp::Reactor &reactor, std::chrono::milliseconds delay) : reactor{reactor}, delay{delay} {}
+
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        void execAsync(zia::api::HttpDuplex &http, zia::apipp::Resume resume) override {
+            this->reactor.after(this->delay, [&http, resume](bool ready) {
+                append(http, "delay");
+                resume(ready);
+            });
+        }
+    };
+
+    class Fail : public zia::apipp::AsyncModule {
+    public:
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        void execAsync(zia::api::HttpDuplex &, zia::apipp::Resume resume) override {
+            resume(false);
+        }
+    };
+
+    /**
+     * Result of the chain, waited for on this thread.
+     */
+    bool runChain(zia::apipp::AsyncPipeline &pipeline, zia::api::HttpDuplex &http) {
+        std::promise<bool> done;
+        pipeline.execAsync(http, [&done](bool ok) { done.set_value(ok); });
+        return done.get_future().get();
+    }
+
+#ifdef __linux__
+
+    /**
+     * Read side of a pipe, resumed once data arrives.
+     */
+    class PipeRead : public zia::apipp::AsyncModule {
+    private:
+        zia::apipp::Reactor &reactor;
+        int fd;
+
+    public:
+        PipeRead(zia::apipp::Reactor &reactor, int fd) : reactor{reactor}, fd{fd} {}
+
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        void execAsync(zia::api::HttpDuplex &http, zia::apipp::Resume resume) override {
+            auto fd = this->fd;
+            this->reactor.await(fd, zia::apipp::Reactor::Readable, [&http, fd, resume](bool ready) {
+                char buffer[64];
+                auto got = ready ? ::read(fd, buffer, sizeof(buffer)) : -1;
+                if (got > 0)
+                    http.resp.body.assign(reinterpret_cast<std::byte *>(buffer),
+                                          reinterpret_cast<std::byte *>(buffer) + got);
+                resume(got > 0);
+            });
+        }
+    };
+
+    int connectTo(std::uint16_t port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        return fd;
+    }
+
+    /**
+     * Slow requests at once on one Net thread and one worker, answered together.
+     */
+    void serveSuspended(zia::apipp::Scheduler &scheduler, zia::apipp::AsyncPipeline &pipeline) {
+        zia::api::Conf conf;
+        conf["port"].v = 48083ll;
+        conf["net_threads"].v = 1ll;
+        zia::net::EpollNet net;
+        net.config(conf);
+
+        auto started = net.run(scheduler.serveAsync(net, [&pipeline](zia::api::HttpDuplex &http,
+                                                                      zia::apipp::Resume resume) {
+            http.resp.status = zia::api::http::common_status::ok;
+            pipeline.execAsync(http, std::move(resume));
+        }));
+        std::cout << "Started: " << started << std::endl;
+
+        constexpr int clients = 20;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<int> sockets;
+        for (int i = 0; i < clients; ++i) {
+            sockets.push_back(connectTo(48083));
+            std::string request = "GET /slow HTTP/1.1\r\n\r\n";
+            ::send(sockets.back(), request.data(), request.size(), 0);
+        }
+        int answered = 0;
+        for (auto fd : sockets) {
+            char buffer[512];
+            auto got = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (got > 0 && std::string(buffer, static_cast<std::size_t>(got)).find("X-Chain: a,delay,b") !=
+                           std::string::npos)
+                ++answered;
+            ::close(fd);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Answered: " << answered << "/" << clients << ", together: "
+                  << (elapsed < std::chrono::milliseconds(100 * clients / 4)) << std::endl;
+
+        net.stop();
+    }
+
+#endif
+
+}
+
+void test13() {
+    std::cout << "TEST -- Asynchronous modules" << std::endl;
+    std::cout << std::boolalpha;
+
+    zia::apipp::Scheduler scheduler(1);
+    zia::apipp::Reactor reactor(scheduler);
+
+    // Synchronous modules run around the suspended one, in order
+    zia::apipp::AsyncPipeline pipeline;
+    pipeline.add(std::make_shared<Tag>("a"))
+            .add(std::make_shared<Delay>(reactor, std::chrono::milliseconds(100)))
+            .add(std::make_shared<Tag>("b"));
+    {
+        zia::api::HttpDuplex http{};
+        std::cout << "Result: " << runChain(pipeline, http) << ", chain: " << http.resp.headers["X-Chain"]
+                  << std::endl;
+    }
+
+    // Many requests suspended at once on a single worker
+    {
+        constexpr int requests = 1000;
+        std::vector<zia::api::HttpDuplex> duplexes(requests);
+        std::atomic<int> left{requests};
+        std::promise<void> done;
+        auto start = std::chrono::steady_clock::now();
+        for (auto &http : duplexes) {
+            scheduler.submit([&pipeline, &http, &left, &done]() {
+                pipeline.execAsync(http, [&left, &done](bool) {
+                    if (--left == 0)
+                        done.set_value();
+                });
+            });
+        }
+        done.get_future().wait();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Suspended together: " << (elapsed < std::chrono::milliseconds(1000)) << ", chain: "
+                  << duplexes.back().resp.headers["X-Chain"] << std::endl;
+    }
+
+    // Failing inline stops the chain
+    {
+        zia::apipp::AsyncPipeline failing;
+        failing.add(std::make_shared<Tag>("a")).add(std::make_shared<Fail>()).add(std::make_shared<Tag>("b"));
+        zia::api::HttpDuplex http{};
+        std::cout << "Result: " << runChain(failing, http) << ", chain: " << http.resp.headers["X-Chain"]
+                  << std::endl;
+    }
+
+    // In a synchronous chain, an asynchronous module blocks
+    {
+        zia::apipp::Pipeline blocking;
+        blocking.add(std::make_shared<Tag>("a"))
+                .add(std::make_shared<Delay>(reactor, std::chrono::milliseconds(10)))
+                .add(std::make_shared<Tag>("b"));
+        zia::api::HttpDuplex http{};
+        std::cout << "Blocking: " << blocking.exec(http) << ", chain: " << http.resp.headers["X-Chain"] << std::endl;
+    }
+
+    // On a worker it fails at once: the only worker would wait for itself to resume
+    {
+        zia::apipp::Pipeline blocking;
+        blocking.add(std::make_shared<Tag>("a"))
+                .add(std::make_shared<Delay>(reactor, std::chrono::milliseconds(10)))
+                .add(std::make_shared<Tag>("b"));
+        zia::api::HttpDuplex http{};
+        std::promise<bool> done;
+        scheduler.submit([&blocking, &http, &done]() { done.set_value(blocking.exec(http)); });
+        std::cout << "Blocking on a worker: " << done.get_future().get() << ", chain: "
+                  << http.resp.headers["X-Chain"] << std::endl;
+    }
+
+#ifdef __linux__
+    // Resumed on readiness of a descriptor
+    {
+        int fds[2];
+        if (::pipe(fds) == 0) {
+            zia::apipp::AsyncPipeline reading;
+            reading.add(std::make_shared<PipeRead>(reactor, fds[0]));
+            zia::api::HttpDuplex http{};
+            std::promise<bool> done;
+            reading.execAsync(http, [&done](bool ok) { done.set_value(ok); });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            std::cout << "Waiting: " << reactor.waiting() << std::endl;
+            [[maybe_unused]] auto written = ::write(fds[1], "ready", 5);
+            auto ok = done.get_future().get();
+            std::cout << "Read: " << ok << ", "
+                      << std::string(reinterpret_cast<const char *>(http.resp.body.data()), http.resp.body.size())
+                      << std::endl;
+            ::close(fds[0]);
+            ::close(fds[1]);
+        }
+    }
+
+    serveSuspended(scheduler, pipeline);
+#endif
+
+    // Stopping resumes what still waits, as not ready
+    {
+        std::promise<bool> done;
+        reactor.after(std::chrono::seconds(10), [&done](bool ready) { done.set_value(ready); });
+        reactor.stop();
+        std::cout << "Stopped: " << !done.get_future().get() << ", after stop: "
+                  << !reactor.after(std::chrono::milliseconds(1), [](bool) {}) << std::endl;
+    }
+    std::cout << std::endl;
+}
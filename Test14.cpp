@@ -0,0 +1,150 @@
+#include <iostream>
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include "api/pp/scheduler.hpp"
+#include "modules/cgibin.hpp"
+#include "net/epoll.hpp"
+
+namespace {
+
+    zia::api::ConfValue value(long long number) {
+        zia::api::ConfValue conf;
+        conf.v = number;
+        return conf;
+    }
+
+    zia::api::ConfValue value(const std::string &str) {
+        zia::api::ConfValue conf;
+        conf.v = str;
+        return conf;
+    }
+
+    std::string bodyOf(const zia::api::HttpResponse &response) {
+        return std::string(reinterpret_cast<const char *>(response.body.data()), response.body.size());
+    }
+
+    zia::api::HttpDuplex request(zia::api::http::Method method, const std::string &uri, const std::string &body = "") {
+        zia::api::HttpDuplex http{};
+        http.req.version = zia::api::http::Version::http_1_1;
+        http.req.method = method;
+        http.req.uri = uri;
+        http.req.headers["User-Agent"] = "test14";
+        http.req.body.assign(reinterpret_cast<const std::byte *>(body.data()),
+                             reinterpret_cast<const std::byte *>(body.data()) + body.size());
+        return http;
+    }
+
+    void show(const char *title, zia::modules::CgiBin &cgi, zia::api::HttpDuplex http) {
+        auto ok = cgi.exec(http);
+        auto body = bodyOf(http.resp);
+        std::cout << title << ": " << ok << ", " << http.resp.status << " "
+                  << (body.size() > 80 ? std::to_string(body.size()) + " bytes" : body) << std::endl;
+    }
+
+    /**
+     * Upload larger than the Net body window: streamed to the application as it arrives.
+     */
+    void serveUpload(zia::modules::CgiBin &cgi) {
+        zia::api::Conf conf;
+        conf["port"].v = 48084ll;
+        conf["net_threads"].v = 1ll;
+        conf["net_body_window"].v = 64ll * 1024;
+        zia::net::EpollNet net;
+        net.config(conf);
+        zia::apipp::Scheduler scheduler(2);
+        net.run(scheduler.serve(net, [&cgi](zia::api::HttpDuplex &http) { return cgi.exec(http); }));
+
+        std::string upload(1 << 20, 'u');
+        std::string request = "POST /cgi-bin/echo HTTP/1.1\r\nContent-Length: " + std::to_string(upload.size()) +
+                              "\r\nConnection: close\r\n\r\n" + upload;
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(48084);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        std::string received;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+            std::thread writer([fd, &request]() { ::send(fd, request.data(), request.size(), MSG_NOSIGNAL); });
+            char buffer[4096];
+            ssize_t got;
+            while ((got = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+                received.append(buffer, static_cast<std::size_t>(got));
+            writer.join();
+        }
+        ::close(fd);
+        auto body = received.find("\r\n\r\n");
+        std::cout << "Streamed upload: " << (body == std::string::npos ? received : received.substr(body + 4))
+                  << std::endl;
+        net.stop();
+    }
+
+}
+
+#endif
+
+void test14() {
+    std::cout << "TEST -- FastCGI module" << std::endl;
+    std::cout << std::boolalpha;
+
+#ifdef __linux__
+    using zia::api::http::Method;
+
+    zia::api::ConfObject timeouts{{"/cgi-bin/slow", value(100)}};
+    zia::api::ConfValue timeoutsValue;
+    timeoutsValue.v = timeouts;
+    zia::api::Conf conf{
+            {"cgi_command", value(ZIA_TEST_FASTCGI)},
+            {"cgi_socket", value("/tmp/zia_test14.sock")},
+            {"cgi_processes", value(2)},
+            {"cgi_timeouts", timeoutsValue},
+    };
+    zia::modules::CgiBin cgi;
+    std::cout << "Configured: " << cgi.config(conf) << std::endl;
+
+    // Connections are kept: the application counts the requests it served on each one
+    for (int i = 0; i < 3; ++i) {
+        auto http = request(Method::get, "/cgi-bin/echo?x=" + std::to_string(i));
+        cgi.exec(http);
+        std::cout << bodyOf(http.resp) << ", requests on connection: " << http.resp.headers["X-Requests"] << std::endl;
+    }
+    std::cout << "Opened: " << cgi.connectionsOpened() << ", reused: " << cgi.connectionsReused() << std::endl;
+
+    show("POST", cgi, request(Method::post, "/cgi-bin/echo", "hello"));
+    show("Status", cgi, request(Method::get, "/cgi-bin/missing"));
+    show("Large output", cgi, request(Method::get, "/cgi-bin/big"));
+    show("Timeout", cgi, request(Method::get, "/cgi-bin/slow"));
+    show("After timeout", cgi, request(Method::get, "/cgi-bin/echo"));
+    show("Closed by the application", cgi, request(Method::get, "/cgi-bin/close"));
+    show("After close", cgi, request(Method::get, "/cgi-bin/echo"));
+    // Not sent again once written, unless writing it failed: once the application has closed the connection,
+    // its Unix socket refuses the write
+    show("Closed by the application", cgi, request(Method::get, "/cgi-bin/close"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    show("POST after close", cgi, request(Method::post, "/cgi-bin/echo", "once"));
+    show("Dot segments", cgi, request(Method::get, "/cgi-bin/%2e%2e/%2E%2E/etc/passwd"));
+    show("Not a script", cgi, request(Method::get, "/index.html"));
+
+    serveUpload(cgi);
+
+    // Output over the limit: 502, not buffered whole
+    zia::modules::CgiBin capped;
+    zia::api::Conf cappedConf{{"cgi_socket", value("/tmp/zia_test14.sock")}, {"cgi_max_output", value(64 * 1024)}};
+    capped.config(cappedConf);
+    show("Output over cgi_max_output", capped, request(Method::get, "/cgi-bin/big"));
+    show("Output under cgi_max_output", capped, request(Method::get, "/cgi-bin/echo"));
+
+    // Application down: 502
+    zia::modules::CgiBin down;
+    zia::api::Conf downConf{{"cgi_socket", value("/tmp/zia_test14_nothing.sock")}};
+    down.config(downConf);
+    show("Unreachable", down, request(Method::get, "/cgi-bin/echo"));
+#endif
+    std::cout << std::endl;
+}
@@ -0,0 +1,134 @@
+#include <iostream>
+
+#ifdef ZIA_HAS_ZLIB
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <zlib.h>
+#include "api/pp/file.hpp"
+#include "modules/gzip.hpp"
+
+namespace {
+
+    const char *names[] = {"identity", "gzip", "deflate"};
+
+    std::string page(std::size_t size) {
+        std::string text;
+        while (text.size() < size)
+            text += "<li class=\"item\">Item " + std::to_string(text.size() % 97) + "</li>\n";
+        text.resize(size);
+        return text;
+    }
+
+    zia::api::HttpDuplex response(const std::string &type, const std::string &body, const std::string &accept) {
+        zia::api::HttpDuplex http{};
+        http.req.version = zia::api::http::Version::http_1_1;
+        http.req.method = zia::api::http::Method::get;
+        if (!accept.empty())
+            http.req.headers["Accept-Encoding"] = accept;
+        http.resp.version = zia::api::http::Version::http_1_1;
+        http.resp.status = zia::api::http::common_status::ok;
+        http.resp.headers["Content-Type"] = type;
+        http.resp.body.assign(reinterpret_cast<const std::byte *>(body.data()),
+                              reinterpret_cast<const std::byte *>(body.data()) + body.size());
+        return http;
+    }
+
+    // gzip and zlib formats both.
+    std::string inflated(const zia::api::Net::Raw &body) {
+        z_stream stream{};
+        inflateInit2(&stream, 15 + 32);
+        std::string out(1 << 20, '\0');
+        stream.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(body.data()));
+        stream.avail_in = static_cast<uInt>(body.size());
+        stream.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        stream.avail_out = static_cast<uInt>(out.size());
+        inflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        inflateEnd(&stream);
+        return out;
+    }
+
+    void show(const char *title, zia::modules::Gzip &gzip, zia::api::HttpDuplex http) {
+        gzip.exec(http);
+        auto *encoding = http.resp.headers.get(zia::api::http::Header::content_encoding);
+        auto *vary = http.resp.headers.get(zia::api::http::Header::vary);
+        std::cout << title << ": " << (encoding ? *encoding : "none") << ", " << http.resp.body.size()
+                  << " bytes, Vary: " << (vary ? *vary : "none") << std::endl;
+    }
+
+}
+
+#endif
+
+void test15() {
+    std::cout << "TEST -- Gzip module" << std::endl;
+    std::cout << std::boolalpha;
+
+#ifdef ZIA_HAS_ZLIB
+    using Gzip = zia::modules::Gzip;
+
+    for (auto accept : {"gzip, deflate, br", "deflate", "deflate;q=1, gzip;q=0.5", "gzip;q=0, *", "*;q=0",
+                        "identity", "x-gzip", ""})
+        std::cout << "Accept-Encoding \"" << accept << "\": " << names[static_cast<int>(Gzip::negotiate(accept))]
+                  << std::endl;
+
+    zia::api::Conf conf;
+    conf["worker_threads"].v = 8ll;
+    conf["gzip_levels"].v = zia::api::ConfObject{};
+    auto &levels = std::get<zia::api::ConfObject>(conf["gzip_levels"].v);
+    levels["application/json"].v = 9ll;
+    levels["text/"].v = 4ll;
+    levels["image/png"].v = 1ll;
+    levels["text/csv"].v = 0ll;
+    Gzip gzip;
+    gzip.config(conf);
+    for (auto type : {"text/html; charset=utf-8", "text/csv", "application/json", "application/javascript",
+                      "image/png", "image/jpeg", "video/mp4", ""})
+        std::cout << "Level of \"" << type << "\": " << gzip.levelOf(type) << std::endl;
+    std::cout << "Level 9 under load:";
+    for (unsigned count = 1; count <= 9; ++count)
+        std::cout << " " << gzip.levelAt(9, count);
+    std::cout << std::endl;
+
+    auto text = page(64 * 1024);
+    auto http = response("text/html", text, "gzip");
+    http.resp.headers["Content-Length"] = std::to_string(text.size());
+    http.resp.headers["ETag"] = "\"abc\"";
+    gzip.exec(http);
+    std::cout << "gzip: " << http.resp.headers["Content-Encoding"] << ", " << text.size() << " -> "
+              << http.resp.body.size() << " bytes, Content-Length: " << http.resp.headers["Content-Length"]
+              << ", ETag: " << http.resp.headers["ETag"] << ", round trip: " << (inflated(http.resp.body) == text)
+              << std::endl;
+    http = response("application/json", text, "deflate");
+    gzip.exec(http);
+    std::cout << "deflate: " << http.resp.headers["Content-Encoding"]
+              << ", round trip: " << (inflated(http.resp.body) == text) << std::endl;
+
+    show("Small body", gzip, response("text/html", "<p>hi</p>", "gzip"));
+    show("JPEG", gzip, response("image/jpeg", text, "gzip"));
+    show("Not accepted", gzip, response("text/html", text, ""));
+    show("Refused", gzip, response("text/html", text, "gzip;q=0"));
+
+    auto path = "/tmp/zia_test15.html";
+    std::ofstream(path, std::ios::binary) << text;
+    http = response("text/html", "", "gzip");
+    http.resp.file = zia::apipp::openFile(path);
+    gzip.exec(http);
+    std::cout << "File body: " << http.resp.headers["Content-Encoding"] << ", file kept: " << (http.resp.file != nullptr)
+              << ", round trip: " << (inflated(http.resp.body) == text) << std::endl;
+    std::remove(path);
+
+    // The zlib streams of this thread are reset, not created again.
+    auto before = Gzip::streamsCreated();
+    for (int i = 0; i < 100; ++i) {
+        auto again = response("text/html", text, i % 2 ? "gzip" : "deflate");
+        gzip.exec(again);
+    }
+    std::cout << "Streams created for 100 responses: " << Gzip::streamsCreated() - before << std::endl;
+#else
+    std::cout << "zlib not found" << std::endl;
+#endif
+    std::cout << std::endl;
+}
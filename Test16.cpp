@@ -0,0 +1,204 @@
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "api/pp/pipeline.hpp"
+#include "modules/cache.hpp"
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "api/pp/scheduler.hpp"
+#include "net/epoll.hpp"
+
+#endif
+
+namespace {
+
+    /**
+     * Module behind the cache, counting the requests it answers.
+     */
+    class Origin : public zia::api::Module {
+    public:
+        std::atomic<int> calls{0};
+
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        bool exec(zia::api::HttpDuplex &http) override {
+            auto call = ++this->calls;
+            const auto &uri = http.req.uri;
+            auto &headers = http.resp.headers;
+            std::string body = "body of " + uri + " #" + std::to_string(call);
+
+            http.resp.status = zia::api::http::common_status::ok;
+            headers["Content-Type"] = "text/plain";
+            if (uri.compare(0, 7, "/static") == 0) {
+                headers["Cache-Control"] = "public, max-age=60";
+                headers["ETag"] = "\"v1\"";
+                headers["Last-Modified"] = "Sat, 17 Oct 2026 10:00:00 GMT";
+            } else if (uri == "/short") {
+                headers["Cache-Control"] = "max-age=1";
+            } else if (uri == "/vary") {
+                headers["Cache-Control"] = "max-age=60";
+                headers["Vary"] = "Accept-Language";
+                if (auto *language = http.req.headers.get("Accept-Language"))
+                    body += " in " + *language;
+            } else if (uri == "/private") {
+                headers["Cache-Control"] = "private, max-age=60";
+            } else if (uri.compare(0, 4, "/big") == 0) {
+                headers["Cache-Control"] = "max-age=60";
+                body.resize(4096, '.');
+            }
+            http.resp.body.assign(reinterpret_cast<const std::byte *>(body.data()),
+                                  reinterpret_cast<const std::byte *>(body.data()) + body.size());
+            return true;
+        }
+    };
+
+    zia::api::HttpDuplex request(const std::string &uri,
+                                 std::initializer_list<std::pair<std::string, std::string>> headers = {}) {
+        zia::api::HttpDuplex http{};
+        http.req.version = zia::api::http::Version::http_1_1;
+        http.req.method = zia::api::http::Method::get;
+        http.req.uri = uri;
+        for (const auto &header : headers)
+            http.req.headers[header.first] = header.second;
+        http.resp.version = zia::api::http::Version::http_1_1;
+        return http;
+    }
+
+    void show(const char *title, zia::apipp::Pipeline &pipeline, const Origin &origin, zia::api::HttpDuplex http) {
+        pipeline.exec(http);
+        std::cout << title << ": " << http.resp.status << ", origin calls " << origin.calls << ", ";
+        if (!http.resp.wire) {
+            std::cout << "from the chain: " << std::string(reinterpret_cast<const char *>(http.resp.body.data()),
+                                                           http.resp.body.size()) << std::endl;
+            return;
+        }
+        std::string wire(reinterpret_cast<const char *>(http.resp.wire->data()), http.resp.wire->size());
+        auto body = wire.find("\r\n\r\n");
+        std::cout << "from the cache: " << wire.substr(0, wire.find("\r\n")) << ", body \"" << wire.substr(body + 4)
+                  << "\"" << std::endl;
+    }
+
+#ifdef __linux__
+
+    std::string fetch(const std::string &uri) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(48085);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        std::string received;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+            auto request = "GET " + uri + " HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n";
+            ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+            char buffer[4096];
+            ssize_t got;
+            while ((got = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+                received.append(buffer, static_cast<std::size_t>(got));
+        }
+        ::close(fd);
+        return received;
+    }
+
+    /**
+     * Hits sent by the Scheduler from the stored bytes.
+     */
+    void serveHits(zia::apipp::Pipeline &pipeline, const Origin &origin) {
+        zia::api::Conf conf;
+        conf["port"].v = 48085ll;
+        conf["net_threads"].v = 1ll;
+        zia::net::EpollNet net;
+        net.config(conf);
+        zia::apipp::Scheduler scheduler(2);
+        net.run(scheduler.serve(net, [&pipeline](zia::api::HttpDuplex &http) { return pipeline.exec(http); }));
+
+        auto calls = origin.calls.load();
+        auto first = fetch("/static/served");
+        auto second = fetch("/static/served");
+        auto body = [](const std::string &response) { return response.substr(response.find("\r\n\r\n") + 4); };
+        std::cout << "Served: " << first.substr(0, first.find("\r\n")) << " \"" << body(first) << "\", then "
+                  << second.substr(0, second.find("\r\n")) << " \"" << body(second) << "\", origin calls "
+                  << origin.calls - calls << std::endl;
+        net.stop();
+    }
+
+#endif
+
+}
+
+void test16() {
+    std::cout << "TEST -- Response cache module" << std::endl;
+    std::cout << std::boolalpha;
+
+    // The same module first, to answer, and last, to store.
+    auto cache = std::make_shared<zia::modules::ResponseCache>();
+    auto origin = std::make_shared<Origin>();
+    zia::apipp::Pipeline pipeline;
+    pipeline.add(cache).add(origin).add(cache);
+    zia::api::Conf conf;
+    conf["cache_zone"].v = std::string("test16");
+    pipeline.config(conf);
+
+    show("Miss", pipeline, *origin, request("/static"));
+    show("Hit", pipeline, *origin, request("/static"));
+    show("If-None-Match", pipeline, *origin, request("/static", {{"If-None-Match", "W/\"v0\", \"v1\""}}));
+    show("If-Modified-Since", pipeline, *origin,
+         request("/static", {{"If-Modified-Since", "Sat, 17 Oct 2026 10:00:00 GMT"}}));
+    show("Other tag", pipeline, *origin, request("/static", {{"If-None-Match", "\"v2\""}}));
+    show("no-cache", pipeline, *origin, request("/static", {{"Cache-Control", "no-cache"}}));
+    show("After no-cache", pipeline, *origin, request("/static"));
+    show("Query", pipeline, *origin, request("/static?page=2"));
+    show("Host a", pipeline, *origin, request("/static/hosted", {{"Host", "a.test"}}));
+    show("Host b", pipeline, *origin, request("/static/hosted", {{"Host", "b.test"}}));
+    show("Host A again", pipeline, *origin, request("/static/hosted", {{"Host", "A.TEST"}}));
+    show("Without max-age", pipeline, *origin, request("/plain"));
+    show("Without max-age again", pipeline, *origin, request("/plain"));
+    show("Private", pipeline, *origin, request("/private"));
+    show("Private again", pipeline, *origin, request("/private"));
+    show("Vary fr", pipeline, *origin, request("/vary", {{"Accept-Language", "fr"}}));
+    show("Vary en", pipeline, *origin, request("/vary", {{"Accept-Language", "en"}}));
+    show("Vary fr again", pipeline, *origin, request("/vary", {{"Accept-Language", "fr"}}));
+    show("Authorization", pipeline, *origin, request("/static", {{"Authorization", "Basic eDp5"}}));
+
+    show("max-age=1", pipeline, *origin, request("/short"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    show("After 1.1 s", pipeline, *origin, request("/short"));
+
+    // Evicted in least recently used order beyond the size.
+    auto small = std::make_shared<zia::modules::ResponseCache>();
+    zia::apipp::Pipeline smallPipeline;
+    smallPipeline.add(small).add(origin).add(small);
+    zia::api::Conf smallConf;
+    smallConf["cache_zone"].v = std::string("test16_small");
+    smallConf["cache_size"].v = 16ll * 1024;
+    smallConf["cache_shards"].v = 1ll;
+    smallPipeline.config(smallConf);
+    // Three fit: /big/0 used again before /big/3 is stored, /big/1 is the least recent.
+    for (auto uri : {"/big/0", "/big/1", "/big/2", "/big/0", "/big/3"}) {
+        auto http = request(uri);
+        smallPipeline.exec(http);
+    }
+    auto usage = small->responses()->usage();
+    std::cout << "Stored: " << small->stored() << ", kept: " << usage.second << " entries, " << usage.first
+              << " bytes, within 16384: " << (usage.first <= 16 * 1024) << std::endl;
+    // Looked up only, nothing stored.
+    for (auto uri : {"/big/0", "/big/1", "/big/2", "/big/3"}) {
+        auto http = request(uri);
+        small->exec(http);
+        std::cout << uri << " kept: " << (http.resp.wire != nullptr) << std::endl;
+    }
+    std::cout << "Hits: " << cache->hits() << ", misses: " << cache->misses() << std::endl;
+
+#ifdef __linux__
+    serveHits(pipeline, *origin);
+#endif
+    std::cout << std::endl;
+}
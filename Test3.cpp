@@ -2,12 +2,56 @@
 // Created by scorsi on 08/02/18.
 //
 
+#include "api/pp/bind.hpp"
+#include "api/pp/compiled.hpp"
 #include "api/pp/conf.hpp"
+#include "api/pp/path.hpp"
 #include "api/pp/visitor.hpp"
 
 using namespace std::literals::string_literals;
 
 using namespace zia::apipp;
+
+namespace {
+
+    struct Nested {
+        int op = 0;
+
+        static auto confFields() {
+            return std::make_tuple(field("op", &Nested::op));
+        }
+    };
+
+    struct Settings {
+        std::string string;
+        long long integer = 0;
+        float number = 0;
+        Nested nested;
+        std::vector<bool> flags;
+        std::optional<std::string> missing;
+        int port = 8080;
+
+        static auto confFields() {
+            return std::make_tuple(field("string_test", &Settings::string),
+                                   field("integer_test", &Settings::integer),
+                                   field("double_test", &Settings::number),
+                                   field("nested_map_test", &Settings::nested),
+                                   field("array_test", &Settings::flags),
+                                   field("missing_test", &Settings::missing),
+                                   field("port", &Settings::port, orDefault));
+        }
+    };
+
+    struct Wrong {
+        std::vector<std::string> flags;
+
+        static auto confFields() {
+            return std::make_tuple(field("array_test", &Wrong::flags));
+        }
+    };
+
+}
+
 void test3() {
 
     /// Don't need ConfElem explicit constructor call when setting values,
@@ -186,4 +230,91 @@ void test3() {
                 }
             });
     }
+
+    /// Frozen form of a configuration read on each request.
+    {
+        std::cout << "TEST -- Compiled Conf" << std::endl;
+
+        auto compiled = CompiledConf(conf);
+        std::cout << compiled.nodeCount() << " nodes" << std::endl;
+        std::cout << compiled["string_test"].get<std::string>() << std::endl;
+        std::cout << compiled["integer_test"].get<int>() << std::endl;
+        std::cout << compiled["double_test"].get<float>() << std::endl;
+        std::cout << compiled["nested_map_test"]["op"].get<long long>() << std::endl;
+        std::cout << compiled.get_at("array_test").get_at(1).get<bool>() << std::endl;
+        std::cout << compiled.contains("array_test") << compiled.contains("missing") << std::endl;
+
+        try {
+            compiled["string_test"].get<int>();
+        } catch (CompiledConf::InvalidAccess &) {
+            std::cout << "InvalidAccess" << std::endl;
+        }
+
+        /// Same visitors as ConfElem, with views for strings, maps and arrays.
+        CompiledConf(conf.toBasicConfig()).visit(
+            [](auto, std::monostate) { std::cout << "Empty" << std::endl; },
+            [](auto, std::string_view value) { std::cout << "String " << value << std::endl; },
+            [](auto, long long int) { std::cout << "Long" << std::endl; },
+            [](auto, double) { std::cout << "Double" << std::endl; },
+            [](auto, bool) { std::cout << "Bool" << std::endl; },
+            [](auto recurse, CompiledConf::Array const &array) {
+                std::cout << "Array" << std::endl;
+                for (auto v : array) {
+                    recurse(v.getValue());
+                }
+            },
+            [](auto recurse, CompiledConf::Map const &map) {
+                std::cout << "Map" << std::endl;
+                for (auto v : map) {
+                    std::cout << v.first << ": ";
+                    recurse(v.second.getValue());
+                }
+            });
+    }
+
+    /// Typed binding, decoded once instead of looked up on each use.
+    {
+        std::cout << "TEST -- Conf binding" << std::endl;
+
+        auto settings = bindConf<Settings>(conf);
+        std::cout << settings.string << " " << settings.integer << " " << settings.number << " "
+                  << settings.nested.op << " " << settings.flags.size() << " " << settings.missing.has_value()
+                  << " " << settings.port << std::endl;
+
+        auto fromCompiled = bindConf<Settings>(CompiledConf(conf));
+        std::cout << "Same from CompiledConf: " << (fromCompiled.string == settings.string &&
+                                                    fromCompiled.flags == settings.flags) << std::endl;
+
+        Wrong wrong;
+        std::string error;
+        std::cout << bindConf(conf, wrong, error) << " " << error << std::endl;
+        std::cout << bindConf(ConfElem(ConfMap()), settings, error) << " " << error << std::endl;
+    }
+
+    /// Optional keys probed without exceptions.
+    {
+        std::cout << "TEST -- Conf find" << std::endl;
+
+        std::cout << conf.find("string_test")->get<std::string>() << " " << (conf.find("missing") == nullptr)
+                  << " " << (conf.find(0) == nullptr) << std::endl;
+        std::cout << conf["integer_test"].try_get<int>().value_or(-1) << " "
+                  << conf["string_test"].try_get<int>().value_or(-1) << std::endl;
+
+        auto compiled = CompiledConf(conf);
+        std::cout << compiled.find("string_test")->get<std::string>() << " " << compiled.find("missing").has_value()
+                  << " " << compiled["array_test"].find(5).has_value() << std::endl;
+        std::cout << compiled["integer_test"].try_get<int>().value_or(-1) << " "
+                  << compiled["string_test"].try_get<int>().value_or(-1) << std::endl;
+
+        auto path = ConfPath::parse("/array_test/0");
+        std::cout << path->try_get<bool>(conf).value_or(false) << " "
+                  << path->try_get<bool>(compiled).value_or(false) << std::endl;
+        auto nested = ConfPath::parse("/nested_map_test/op");
+        std::cout << nested->try_get<long long>(conf).value_or(-1) << " "
+                  << nested->try_get<long long>(compiled).value_or(-1) << std::endl;
+        std::cout << (ConfPath::parse("/array_test/9")->find(conf) == nullptr) << " "
+                  << ConfPath::parse("/string_test/x")->find(compiled).has_value() << " "
+                  << ConfPath::parse("no_slash").has_value() << " " << ConfPath::parse("/bad~2").has_value()
+                  << std::endl;
+    }
 }
\ No newline at end of file
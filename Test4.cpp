@@ -0,0 +1,125 @@
+
+#include <iostream>
+#include "api/pp/pipeline.hpp"
+#include "api/pp/pool.hpp"
+
+namespace {
+
+    // SZA++ Module
+    class Greeter : public zia::apipp::Module {
+    public:
+        bool perform() override {
+            this->response
+                    ->setStatus(200, "OK")
+                    ->addHeader("Content-Type", "text/plain")
+                    ->setStandardData("hello");
+            return true;
+        }
+    };
+
+    // SZA++ Module
+    class Exclaimer : public zia::apipp::Module {
+    public:
+        bool perform() override {
+            this->response->appendStandardData("!");
+            return true;
+        }
+    };
+
+    // SZA++ reentrant Module, shares data with the next modules through the scratch storage
+    class Counter : public zia::apipp::ReentrantModule {
+    public:
+        bool perform(zia::apipp::Context &ctx) override {
+            auto *count = ctx.scratch.find<int>("count");
+            auto value = ctx.scratch.set("count", count ? *count + 1 : 1);
+            ctx.response->addHeader("X-Count", std::to_string(value));
+            return true;
+        }
+    };
+
+    // SZA++ reentrant Module, adds more headers than a map holds inline
+    class Annotator : public zia::apipp::ReentrantModule {
+    public:
+        bool perform(zia::apipp::Context &ctx) override {
+            for (int i = 0; i < 40; ++i)
+                ctx.response->addHeader("X-Note-" + std::to_string(i), std::string(64, 'a' + i % 26));
+            return true;
+        }
+    };
+
+    // Basic SZA Module
+    class Tagger : public zia::api::Module {
+    public:
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        bool exec(zia::api::HttpDuplex &duplex) override {
+            duplex.resp.headers["X-Tag"] = "basic";
+            duplex.resp.body.push_back(std::byte{'?'});
+            return true;
+        }
+    };
+
+    std::string render(const zia::api::HttpDuplex &duplex) {
+        std::string out = std::to_string(duplex.resp.status);
+        for (const auto &item: duplex.resp.headers)
+            out += item.first + "=" + item.second + ";";
+        for (const auto &item: duplex.resp.body)
+            out += static_cast<char>(item);
+        return out;
+    }
+
+}
+
+void test4() {
+    std::cout << "TEST -- Pipeline" << std::endl;
+
+    zia::apipp::Pipeline pipeline;
+    pipeline.add(std::make_shared<Greeter>())
+            .add(std::make_shared<Counter>())
+            .add(std::make_shared<Exclaimer>())
+            .add(std::make_shared<Tagger>())
+            .add(std::make_shared<Counter>())
+            .add(std::make_shared<Exclaimer>());
+
+    pipeline.config(zia::api::Conf{});
+
+    zia::api::HttpDuplex duplex;
+    duplex.req.uri = "/";
+    std::cout << "Success: " << std::boolalpha << pipeline.exec(duplex) << std::endl;
+
+    std::cout << duplex.resp.status << ": " << duplex.resp.reason << std::endl;
+    for (const auto &item: duplex.resp.headers) {
+        std::cout << item.first << "=" << item.second << std::endl;
+    }
+    for (const auto &item: duplex.resp.body) {
+        std::cout << static_cast<char>(item);
+    }
+    std::cout << std::endl;
+
+    // Same chain with more headers, with the objects of the request in the arena then on the heap
+    pipeline.add(std::make_shared<Annotator>()).add(std::make_shared<Tagger>());
+    zia::api::HttpDuplex inArena;
+    pipeline.useArena(true).exec(inArena);
+    zia::api::HttpDuplex onHeap;
+    pipeline.useArena(false).exec(onHeap);
+    std::cout << "Headers: " << inArena.resp.headers.size()
+              << ", same with and without arena: " << (render(inArena) == render(onHeap)) << std::endl;
+
+    // A recycled duplex comes back empty, with its buffers still allocated
+    auto &pool = zia::apipp::DuplexPool::local();
+    const zia::api::HttpDuplex *first;
+    std::size_t capacity;
+    {
+        auto lease = pool.acquire();
+        pipeline.exec(*lease);
+        first = lease.get();
+        capacity = lease->resp.body.capacity();
+    }
+    auto lease = pool.acquire();
+    std::cout << "Recycled: " << (lease.get() == first) << ", empty: "
+              << (lease->resp.headers.empty() && lease->resp.body.empty() && !lease->resp.status)
+              << ", capacity kept: " << (lease->resp.body.capacity() == capacity && capacity > 0)
+              << std::endl << std::endl;
+}
@@ -0,0 +1,284 @@
+
+#include <iostream>
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "api/pp/body.hpp"
+#include "api/pp/file.hpp"
+#include "api/pp/parser.hpp"
+#include "api/pp/pipeline.hpp"
+#include "net/backend.hpp"
+#include "net/epoll.hpp"
+
+namespace {
+
+    /**
+     * Answers with the size of the whole request body, buffered from the stream of the Net.
+     */
+    class BodyLength : public zia::apipp::ReentrantModule {
+    public:
+        bool perform(zia::apipp::Context &ctx) override {
+            auto complete = ctx.request->bufferBody();
+            ctx.response->setStandardData(std::to_string(ctx.request->bodyView().size()) + " bytes, complete=" +
+                                          (complete ? "true" : "false"));
+            return true;
+        }
+    };
+
+    std::string exchange(std::uint16_t port, const std::string &request, std::size_t responses,
+                         bool *closed = nullptr) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            ::close(fd);
+            return "connect failed";
+        }
+
+        ::send(fd, request.data(), request.size(), 0);
+
+        timeval timeout{2, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        // Every response body is a single line starting with "got ".
+        std::string received;
+        char buffer[4096];
+        auto answered = [&received]() {
+            std::size_t count = 0;
+            for (auto pos = received.find("got "); pos != std::string::npos; pos = received.find("got ", pos + 1))
+                ++count;
+            return received.empty() || received.back() != '\n' ? 0 : count;
+        };
+        while (answered() < responses) {
+            auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (closed)
+                *closed = n == 0;
+            if (n <= 0)
+                break;
+            received.append(buffer, static_cast<std::size_t>(n));
+        }
+        ::close(fd);
+        return received;
+    }
+
+    // Response bodies only, in the order received.
+    std::string bodies(const std::string &received) {
+        std::string result;
+        for (auto pos = received.find("got "); pos != std::string::npos; pos = received.find("got ", pos + 1))
+            result += (result.empty() ? "" : " | ") + received.substr(pos + 4, received.find(' ', pos + 8) - pos - 4);
+        return result;
+    }
+
+    // Response lines (without the "got " prefix) for the requests sent to path.
+    std::string answerTo(const std::string &received, const std::string &path) {
+        std::string result;
+        for (auto pos = received.find("got " + path); pos != std::string::npos; pos = received.find("got " + path, pos + 1))
+            result += (result.empty() ? "" : " | ") + received.substr(pos + 4, received.find('\n', pos) - pos - 4);
+        return result;
+    }
+
+    // Send request, read everything until the server closes the connection.
+    void expectClose(const char *title, std::uint16_t port, const std::string &request) {
+        bool closed = false;
+        auto received = exchange(port, request, static_cast<std::size_t>(-1), &closed);
+        std::cout << title << ": [" << bodies(received) << "] closed=" << std::boolalpha << closed << std::endl;
+    }
+
+    template<typename TNet>
+    void serve(TNet &net, std::uint16_t port, const std::string &backend = "epoll") {
+        zia::api::Conf conf;
+        conf["net_backend"].v = backend;
+        conf["port"].v = static_cast<long long>(port);
+        conf["net_threads"].v = 2ll;
+        conf["net_max_requests"].v = 3ll;
+        conf["net_idle_timeout"].v = 200ll;
+        conf["net_body_window"].v = 64ll * 1024;
+        conf["net_max_pipelined"].v = 2ll;
+        net.config(conf);
+
+        // Served from the file for /file requests, larger than socket buffers.
+        auto path = "/tmp/zia_test5_" + std::to_string(port);
+        auto content = "got file " + std::string(3 << 20, 'f') + "\n";
+        std::ofstream(path, std::ios::binary) << content;
+
+        // Requests handed to the callback and not answered yet, and the most at once.
+        std::atomic<int> inFlight{0};
+        std::atomic<int> mostInFlight{0};
+        auto started = net.run([&net, path, &inFlight, &mostInFlight](zia::api::Net::Raw raw, zia::api::NetInfo info) {
+            auto current = ++inFlight;
+            for (auto most = mostInFlight.load(); current > most && !mostInFlight.compare_exchange_weak(most, current);)
+                continue;
+
+            // Large bodies are not in raw but streamed.
+            auto upload = zia::apipp::bodyStreamOf(info);
+            zia::api::HttpRequest parsed;
+            if (upload)
+                zia::apipp::parseRequestHead(raw, parsed);
+            else
+                zia::apipp::parseRequest(raw, parsed);
+
+            std::string request(reinterpret_cast<const char *>(raw.data()), raw.size());
+            auto line = request.substr(0, request.find('\r'));
+            auto body = "got " + line + std::string(line.find("/big") != std::string::npos ? 1 << 20 : 0, '.');
+            if (!parsed.body.empty())
+                body += " body=" + std::string(reinterpret_cast<const char *>(parsed.body.data()), parsed.body.size());
+
+            auto file = line.find("/file") != std::string::npos ? zia::apipp::openFile(path) : nullptr;
+            auto answer = [&net, &inFlight, sock = info.sock, file](std::string body) {
+                body += "\n";
+                zia::api::HttpResponse response{};
+                response.version = zia::api::http::Version::http_1_1;
+                response.status = zia::api::http::common_status::ok;
+                if (file)
+                    response.file = file;
+                else
+                    response.body.assign(reinterpret_cast<const std::byte *>(body.data()),
+                                         reinterpret_cast<const std::byte *>(body.data()) + body.size());
+
+                zia::apipp::ResponseSerializer serializer;
+                serializer.serialize(response);
+                --inFlight;
+                net.send(sock, serializer);
+            };
+            // Answered after the requests that follow it.
+            if (line.find("/slow") != std::string::npos) {
+                std::thread([answer, body]() {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    answer(body);
+                }).detach();
+            } else if (upload && line.find("/pipeline") != std::string::npos) {
+                // Waits for the rest of the body: not on the Net thread, which receives it.
+                std::thread([answer, body, info, parsed]() {
+                    zia::api::HttpDuplex http{};
+                    http.info = info;
+                    http.req = parsed;
+                    zia::apipp::Pipeline pipeline;
+                    pipeline.add(std::make_shared<BodyLength>());
+                    pipeline.exec(http);
+                    answer(body + " pipeline read " + std::string(reinterpret_cast<const char *>(http.resp.body.data()),
+                                                                  http.resp.body.size()));
+                }).detach();
+            } else if (upload) {
+                // Slow reader: the window fills up and the Net stops reading the socket meanwhile.
+                std::thread([answer, body, upload]() {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    std::size_t size = 0;
+                    zia::api::Net::Raw chunk;
+                    while (upload->read(chunk))
+                        size += chunk.size();
+                    auto bounded = upload->peak() <= upload->window() + 16 * 1024;
+                    answer(body + " streamed " + std::to_string(size) + " bytes, complete=" +
+                           (upload->finished() ? "true" : "false") + ", bounded=" + (bounded ? "true" : "false"));
+                }).detach();
+            } else {
+                answer(body);
+            }
+        });
+        std::cout << "Started: " << std::boolalpha << started << std::endl;
+
+        // Pipelined requests in a single write, one with a body and one with a response larger than socket buffers.
+        auto received = exchange(port,
+                                 "GET /first HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                                 "POST /second HTTP/1.1\r\nHost: localhost\r\nContent-Length: 4\r\n\r\nbody"
+                                 "GET /big HTTP/1.1\r\nHost: localhost\r\n\r\n", 3);
+        std::cout << received.substr(0, received.find("got GET /big")) << std::endl;
+        std::cout << received.size() << " bytes received" << std::endl;
+
+        received = exchange(port, "GET /slow HTTP/1.1\r\n\r\nGET /fast HTTP/1.1\r\n\r\n", 2);
+        std::cout << "Pipelined order: " << bodies(received) << std::endl;
+
+        // Past "net_max_pipelined" requests not answered, the next one waits for responses to drain.
+        std::string slow;
+        for (int i = 0; i < 3; ++i)
+            slow += "GET /slow/" + std::to_string(i) + " HTTP/1.1\r\n\r\n";
+        mostInFlight = 0;
+        received = exchange(port, slow, 3);
+        std::cout << "Pipeline depth: " << bodies(received) << ", most in flight: " << mostInFlight << std::endl;
+
+        // Sent from the file, held behind /slow then written before /fast.
+        received = exchange(port, "GET /slow HTTP/1.1\r\n\r\nGET /file HTTP/1.1\r\n\r\nGET /fast HTTP/1.1\r\n\r\n", 3);
+        auto start = received.find("got file");
+        std::cout << "File body: " << (start == std::string::npos ? "missing" : "intact=") << std::boolalpha
+                  << (start != std::string::npos && received.compare(start, content.size(), content) == 0)
+                  << ", order: " << bodies(received) << std::endl;
+
+        expectClose("Connection: close", port, "GET /a HTTP/1.1\r\nConnection: close\r\n\r\nGET /b HTTP/1.1\r\n\r\n");
+        expectClose("HTTP/1.0", port, "GET /old HTTP/1.0\r\n\r\n");
+        expectClose("HTTP/1.0 keep-alive + max requests", port,
+                    "GET /1 HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"
+                    "GET /2 HTTP/1.1\r\n\r\nGET /3 HTTP/1.1\r\n\r\nGET /4 HTTP/1.1\r\n\r\n");
+        expectClose("Idle", port, "");
+
+        received = exchange(port, "POST /chunked HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                  "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n", 1);
+        std::cout << "Small chunked body: " << answerTo(received, "POST") << std::endl;
+
+        // Uploads larger than the window, followed by a pipelined request on the same connection.
+        std::string upload(4 << 20, 'u');
+        received = exchange(port, "POST /upload HTTP/1.1\r\nContent-Length: " + std::to_string(upload.size()) +
+                                  "\r\n\r\n" + upload + "GET /after HTTP/1.1\r\n\r\n", 2);
+        std::cout << "Content-Length upload: " << answerTo(received, "POST") << " then " << answerTo(received, "GET")
+                  << std::endl;
+
+        received = exchange(port, "POST /pipeline HTTP/1.1\r\nContent-Length: " + std::to_string(upload.size()) +
+                                  "\r\n\r\n" + upload, 1);
+        std::cout << "Pipeline upload: " << answerTo(received, "POST") << std::endl;
+
+        std::string chunked;
+        for (int i = 0; i < 64; ++i)
+            chunked += "10000\r\n" + std::string(0x10000, 'c') + "\r\n";
+        received = exchange(port, "POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n" + chunked +
+                                  "0\r\n\r\nGET /after HTTP/1.1\r\n\r\n", 2);
+        std::cout << "Chunked upload: " << answerTo(received, "POST") << " then " << answerTo(received, "GET")
+                  << std::endl;
+
+        // Wait for the late response of /slow before stopping.
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        net.stop();
+        std::remove(path.c_str());
+    }
+
+}
+
+void test5() {
+    std::cout << "TEST -- Epoll Net" << std::endl;
+    {
+        zia::net::EpollNet net;
+        serve(net, 48080);
+    }
+    std::cout << std::endl;
+
+    std::cout << "TEST -- Net backend selection" << std::endl;
+    {
+        zia::net::BackendNet net;
+        zia::api::Conf conf;
+        conf["net_backend"].v = std::string("io_uring");
+        net.config(conf);
+        std::cout << "Backend: " << net.backend() << std::endl;
+        serve(net, 48081, "io_uring");
+    }
+    std::cout << std::endl;
+}
+
+#else
+
+void test5() {
+    std::cout << "TEST -- Net (skipped, Linux only)" << std::endl << std::endl;
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "api/pp/parser.hpp"
+
+namespace {
+
+    using Parser = zia::apipp::RequestParser;
+
+    const std::vector<std::string> corpus = {
+            "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n",
+            "GET /index.html?q=1 HTTP/1.0\r\n\r\n",
+            "\r\n\r\nHEAD /skip-empty-lines HTTP/1.1\r\nHost: a\r\n\r\n",
+            "POST /form HTTP/1.1\r\nHost: a\r\nContent-Length: 11\r\n\r\nhello world",
+            "PUT /bare-lf HTTP/1.1\nContent-Length: 3\nX-Empty:\n\nabc",
+            "DELETE /multi HTTP/1.1\r\nAccept: text/html\r\naccept:  text/plain \r\nX-Colon: a:b:c\r\n\r\n",
+            "OPTIONS * HTTP/1.1\r\n\r\n",
+            "BREW /pot HTTP/1.1\r\n\r\n",
+            "GET /simple\r\n",
+            "GET /" + std::string(300, 'a') + " HTTP/1.1\r\nX-Long: " + std::string(500, 'b') + "\r\n\r\n",
+            "POST /chunked HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "5\r\nhello\r\n6;name=value\r\n world\r\n0\r\nX-Trailer: t\r\n\r\n",
+            "POST /chunked-lf HTTP/1.1\nTransfer-Encoding: gzip, Chunked\n\na\n0123456789\n0\n\n",
+            "POST /same-length HTTP/1.1\r\nContent-Length: 2\r\ncontent-length: 2\r\n\r\nok",
+            // Invalid
+            "GET\r\n\r\n",
+            " / HTTP/1.1\r\n\r\n",
+            "GET / HTTP/1.1 extra\r\n\r\n",
+            "POST /simple\r\n",
+            "GET / HTTP/1.1\r\nNo colon here\r\n\r\n",
+            "GET / HTTP/1.1\r\nBad name: x\r\n\r\n",
+            "GET / HTTP/1.1\r\n: no name\r\n\r\n",
+            "POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\nab",
+            "POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n",
+            "POST / HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 3\r\n\r\nabc",
+            "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+            "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 5\r\n\r\n0\r\n\r\n",
+            "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+            "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nabc\r\n0\r\n\r\n",
+            // Incomplete
+            "GET / HTTP/1.1\r\nHost: a\r\n",
+            "POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\nshort",
+            "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n",
+    };
+
+    // What a run produced, compared between scanners and split points.
+    struct Outcome {
+        Parser::Result result = Parser::Result::Incomplete;
+        std::size_t length = 0;
+        std::string dump;
+
+        bool operator==(const Outcome &other) const {
+            return result == other.result && length == other.length && dump == other.dump;
+        }
+
+        bool operator!=(const Outcome &other) const {
+            return !(*this == other);
+        }
+    };
+
+    std::string dump(const Parser &parser, const zia::api::Net::Raw &raw) {
+        zia::api::HttpRequest request;
+        parser.fill(raw.data(), request);
+
+        std::string out = std::to_string(static_cast<int>(request.method)) + " " +
+                          std::string(parser.uri().in(raw.data())) + " " +
+                          std::to_string(static_cast<int>(request.version)) + "\n";
+        for (const auto &header : request.headers)
+            out += header.first + "=" + header.second + "\n";
+        out.append(reinterpret_cast<const char *>(request.body.data()), request.body.size());
+        return out;
+    }
+
+    zia::api::Net::Raw toRaw(const std::string &str) {
+        zia::api::Net::Raw raw;
+        for (auto c : str)
+            raw.push_back(std::byte(c));
+        return raw;
+    }
+
+    // Give the request to the parser in two parts, as if received by two reads.
+    Outcome parseSplit(const std::string &str, std::size_t split) {
+        Parser parser(4096);
+        auto raw = toRaw(str);
+        Outcome outcome;
+
+        outcome.result = parser.parse(raw.data(), split);
+        if (outcome.result == Parser::Result::Incomplete && split < raw.size())
+            outcome.result = parser.parse(raw.data(), raw.size());
+        if (outcome.result == Parser::Result::Complete) {
+            outcome.length = parser.length();
+            outcome.dump = dump(parser, raw);
+        }
+        return outcome;
+    }
+
+    const char *nameOf(Parser::Result result) {
+        switch (result) {
+            case Parser::Result::Complete:
+                return "complete";
+            case Parser::Result::Error:
+                return "error";
+            default:
+                return "incomplete";
+        }
+    }
+
+}
+
+void test6() {
+    std::cout << "TEST -- Request parser" << std::endl;
+
+    const Parser::Scanner scanners[] = {Parser::Scanner::Scalar, Parser::Scanner::Sse42, Parser::Scanner::Avx2};
+    std::size_t runs = 0;
+    std::size_t mismatches = 0;
+
+    for (const auto &str : corpus) {
+        Parser::useScanner(Parser::Scanner::Scalar);
+        auto reference = parseSplit(str, str.size());
+        std::cout << nameOf(reference.result) << " <- " << str.substr(0, str.find('\n')) << std::endl;
+
+        for (auto scanner : scanners) {
+            if (!Parser::useScanner(scanner))
+                continue;
+            for (std::size_t split = 0; split <= str.size(); ++split, ++runs) {
+                if (parseSplit(str, split) != reference)
+                    ++mismatches;
+            }
+        }
+    }
+
+    // Mutations must never crash and every scanner must agree on them.
+    std::mt19937 random(42);
+    for (int i = 0; i < 2000; ++i) {
+        auto str = corpus[random() % corpus.size()];
+        for (int n = random() % 4; n >= 0; --n)
+            str[random() % str.size()] = "\r\n: aZ0\t"[random() % 8];
+
+        Parser::useScanner(Parser::Scanner::Scalar);
+        auto reference = parseSplit(str, random() % (str.size() + 1));
+        for (auto scanner : scanners) {
+            if (!Parser::useScanner(scanner))
+                continue;
+            ++runs;
+            if (parseSplit(str, str.size()) != reference)
+                ++mismatches;
+        }
+    }
+    Parser::useScanner(Parser::bestScanner());
+
+    // Pipelined requests in one buffer.
+    auto raw = toRaw(corpus[0] + corpus[3] + corpus[1]);
+    Parser parser;
+    std::size_t offset = 0;
+    int count = 0;
+    while (parser.parse(raw.data() + offset, raw.size() - offset) == Parser::Result::Complete) {
+        offset += parser.length();
+        parser.reset();
+        ++count;
+    }
+    std::cout << "Pipelined: " << count << " requests, " << offset << "/" << raw.size() << " bytes" << std::endl;
+
+    zia::api::HttpRequest request;
+    if (zia::apipp::parseRequest(toRaw(corpus[5]), request))
+        std::cout << "Accept: " << request.headers["Accept"] << " / " << request.headers["accept"] << std::endl;
+
+    if (zia::apipp::parseRequest(toRaw(corpus[10]), request)) {
+        std::cout << "Chunked body: " << std::string(reinterpret_cast<const char *>(request.body.data()),
+                                                     request.body.size()) << std::endl;
+    }
+
+    // Streaming: after the head, the chunks are given one byte at a time, from a new buffer each time.
+    auto chunked = toRaw(corpus[10] + corpus[0]);
+    parser.reset();
+    auto head = parser.parse(chunked.data(), 60);
+    std::string decoded;
+    for (const auto &span : parser.bodyChunks())
+        decoded += span.in(chunked.data());
+    offset = parser.length();
+    for (std::size_t end = offset + 1; head == Parser::Result::Incomplete && end <= chunked.size(); ++end) {
+        zia::api::Net::Raw fragment(chunked.data() + offset, chunked.data() + end);
+        std::size_t used;
+        head = parser.decodeBody(fragment.data(), fragment.size(), used,
+                                 [&decoded](const std::byte *data, std::size_t size) {
+                                     decoded.append(reinterpret_cast<const char *>(data), size);
+                                 });
+        offset += used;
+    }
+    std::cout << "Streamed body: " << decoded << ", next request at " << offset << "/" << chunked.size() << std::endl;
+
+    std::cout << runs << " runs, " << mismatches << " mismatches" << std::endl;
+    std::cout << std::endl;
+}
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "api/pp/file.hpp"
+#include "api/pp/serializer.hpp"
+
+namespace {
+
+    void print(const char *title, const zia::apipp::ResponseSerializer &serializer) {
+        auto raw = serializer.toRaw();
+        std::string text(reinterpret_cast<const char *>(raw.data()), raw.size());
+        for (std::size_t pos = 0; (pos = text.find("\r\n", pos)) != std::string::npos; )
+            text.replace(pos, 2, "\\r\\n\n");
+
+        std::cout << "-- " << title << " (" << serializer.header().size() << " + "
+                  << serializer.content().size() << " bytes)" << std::endl << text << std::endl;
+    }
+
+}
+
+void test7() {
+    std::cout << "TEST -- Response serializer" << std::endl;
+
+    zia::apipp::ResponseSerializer serializer;
+
+    zia::api::HttpResponse response;
+    response.version = zia::api::http::Version::http_1_1;
+    response.status = zia::api::http::common_status::ok;
+    response.headers["Content-Type"] = "text/plain";
+    for (auto c : std::string("hello"))
+        response.body.push_back(std::byte(c));
+    serializer.serialize(response);
+    print("HttpResponse", serializer);
+
+    // The body is referenced, not copied
+    auto iov = serializer.iovecs();
+    std::cout << "Body referenced: " << std::boolalpha
+              << (iov[1].iov_base == response.body.data() && iov[1].iov_len == response.body.size()) << std::endl;
+
+    response.version = zia::api::http::Version::http_1_0;
+    response.status = 299;
+    response.reason = "Custom";
+    response.headers["Content-Length"] = "5";
+    serializer.serialize(response);
+    print("HTTP/1.0 custom status", serializer);
+
+    response.version = zia::api::http::Version::http_0_9;
+    serializer.serialize(response);
+    print("HTTP/0.9", serializer);
+
+    // Neither a body nor its framing for 204, nor the headers and reason able to split the response
+    zia::api::HttpResponse empty{};
+    empty.version = zia::api::http::Version::http_1_1;
+    empty.status = zia::api::http::common_status::no_content;
+    empty.reason = "No\r\nSet-Cookie: injected";
+    empty.headers["Content-Length"] = "4";
+    empty.headers["X-Split"] = "a\r\n\r\nHTTP/1.1 200 OK";
+    empty.headers["X-Safe"] = "kept";
+    for (auto c : std::string("gone"))
+        empty.body.push_back(std::byte(c));
+    serializer.serialize(empty);
+    print("204 with CR/LF", serializer);
+
+    // Nor a body for 304, which keeps the length given for the response it stands for
+    empty.status = zia::api::http::common_status::not_modified;
+    empty.reason.clear();
+    empty.headers.erase("X-Split");
+    serializer.serialize(empty);
+    print("304 with Content-Length", serializer);
+    empty.headers.erase("Content-Length");
+    serializer.serialize(empty);
+    print("304", serializer);
+
+    zia::apipp::Response smart(zia::api::HttpDuplex{});
+    smart.setStatus(404, "Not Found")
+            ->addHeader("Set-Cookie", "a=1")
+            ->addHeader("Set-Cookie", "b=2")
+            ->setStandardData("missing");
+    serializer.serialize(smart);
+    serializer.omitBody();
+    print("apipp::Response, HEAD", serializer);
+    serializer.omitBody(false);
+
+    // File body: not a segment, read only by toRaw() or by a module accessing it
+    const char *path = "/tmp/zia_test7.txt";
+    std::ofstream(path, std::ios::binary) << "from a file";
+    zia::api::HttpResponse fromFile{};
+    fromFile.version = zia::api::http::Version::http_1_1;
+    fromFile.status = zia::api::http::common_status::ok;
+    fromFile.file = zia::apipp::openFile(path);
+    serializer.serialize(fromFile);
+    print("HttpResponse with a file", serializer);
+    std::cout << "File sent separately: " << (serializer.file() == fromFile.file) << ", size " << serializer.size()
+              << std::endl;
+
+    zia::api::HttpDuplex duplex;
+    duplex.resp = fromFile;
+    auto lazy = zia::apipp::Response::viewBasicHttpDuplex(duplex);
+    std::cout << "apipp::Response still a file: " << (lazy->fileBody() != nullptr);
+    std::cout << ", body view: " << lazy->bodyView();
+    lazy->appendStandardData("!");
+    std::cout << ", after append: " << (lazy->fileBody() != nullptr) << " " << lazy->bodyView() << std::endl;
+    lazy->applyTo(duplex);
+    std::cout << "Applied back: file=" << (duplex.resp.file != nullptr) << " body=" << duplex.resp.body.size()
+              << " bytes" << std::endl;
+    std::remove(path);
+
+    std::cout << "Status line 503: " << zia::apipp::ResponseSerializer::statusLine(503).substr(0, 32) << std::endl;
+    std::cout << "Status line 299 known: " << !zia::apipp::ResponseSerializer::statusLine(299).empty() << std::endl;
+    std::cout << std::endl;
+}
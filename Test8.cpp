@@ -0,0 +1,102 @@
+#include <iostream>
+#include <memory_resource>
+#include <stdexcept>
+#include "api/pp/http.hpp"
+
+namespace {
+
+    template<typename TMap>
+    void print(const char *title, const TMap &headers) {
+        std::cout << title << ":";
+        for (const auto &item : headers)
+            std::cout << " [" << item.first << "=" << item.second << "]";
+        std::cout << std::endl;
+    }
+
+}
+
+void test8() {
+    std::cout << "TEST -- Header map" << std::endl;
+
+    using zia::api::http::Header;
+
+    std::cout << std::boolalpha;
+    std::cout << "headerId(content-LENGTH) is content_length: "
+              << (zia::api::http::headerId("content-LENGTH") == Header::content_length) << std::endl;
+    std::cout << "headerId(X-Custom) is unknown: "
+              << (zia::api::http::headerId("X-Custom") == Header::unknown) << std::endl;
+    std::cout << "headerId(Content-Lengtj) is unknown: "
+              << (zia::api::http::headerId("Content-Lengtj") == Header::unknown) << std::endl;
+    static_assert(zia::api::http::headerId("host") == Header::host);
+
+    // Every well-known name is found back, in any case
+    bool allFound = true;
+    for (auto i = 1; i <= static_cast<int>(Header::x_forwarded_for); ++i) {
+        auto id = static_cast<Header>(i);
+        std::string lower(zia::api::http::headerName(id));
+        for (auto &c : lower)
+            c = static_cast<char>(std::tolower(c));
+        allFound = allFound && zia::api::http::headerId(lower) == id;
+    }
+    std::cout << "All well-known headers identified: " << allFound << std::endl;
+
+    zia::api::HeaderMap<std::string> headers{{"Host", "example.com"}, {"X-Custom", "1"}};
+    headers["content-type"] = "text/plain";
+    headers["CONTENT-TYPE"] += "; charset=utf-8";
+    headers["x-custom"] += "2";
+    print("Case-insensitive", headers);
+    std::cout << "find(Header::host): " << headers.find(Header::host)->second << std::endl;
+    std::cout << "get(Content-Length): " << (headers.get("Content-Length") != nullptr) << std::endl;
+    std::cout << "emplace existing: " << headers.emplace("HOST", "other").second << std::endl;
+    std::cout << "insert: " << headers.insert({"Accept", "*/*"}).second << ", at(accept): " << headers.at("accept")
+              << std::endl;
+    try {
+        headers.at(Header::content_length);
+    } catch (const std::out_of_range &) {
+        std::cout << "at(Header::content_length) throws out_of_range" << std::endl;
+    }
+
+    headers.erase("host");
+    headers[Header::content_length] = "0";
+    print("After erase", headers);
+    std::cout << "count(Content-Type): " << headers.count("Content-Type")
+              << ", count(Host): " << headers.count(Header::host) << std::endl;
+
+    // Past the inline capacity, and past the positions a slot can hold
+    zia::api::HeaderMap<std::string, 4> many;
+    for (int i = 0; i < 300; ++i)
+        many["X-" + std::to_string(i)] = std::to_string(i);
+    many["Connection"] = "close";
+    auto copy = many;
+    auto moved = std::move(copy);
+    moved.erase(moved.begin());
+    std::cout << "Large map: " << moved.size() << " headers, x-299=" << moved["x-299"]
+              << ", connection=" << moved[Header::connection] << std::endl;
+
+    // Moved into a map of an arena, the entries are moved into the arena
+    std::pmr::monotonic_buffer_resource arena;
+    zia::api::HeaderMap<std::string, 4> kept(&arena);
+    kept = std::move(moved);
+    std::cout << "Moved into an arena map: " << kept.size() << " headers, resource kept: "
+              << (kept.resource() == &arena) << std::endl;
+
+    // Moved-from maps are empty and reusable, well-known names included
+    auto taken = std::move(kept);
+    std::cout << "Moved-from: " << kept.size() << " headers, host found: " << kept.contains(Header::host)
+              << ", connection found: " << kept.contains(Header::connection);
+    kept[Header::connection] = "keep-alive";
+    std::cout << ", reused: " << kept.size() << " header, connection=" << kept["connection"] << ", taken: "
+              << taken.size() << std::endl;
+
+    // The apipp layer splits and joins the same container
+    zia::api::HttpDuplex duplex;
+    duplex.resp.headers["Set-Cookie"] = "a=1,b=2";
+    duplex.resp.headers["Cache-Control"] = "no-cache";
+    zia::apipp::Response response(duplex);
+    response.addHeader("set-cookie", "c=3");
+    std::cout << "Set-Cookie values: " << response.headers[Header::set_cookie].size() << std::endl;
+    response.removeAllHeadersByName("CACHE-CONTROL");
+    response.applyTo(duplex);
+    print("Joined back", duplex.resp.headers);
+    std::cout << std::endl;
+}
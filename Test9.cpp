@@ -0,0 +1,94 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "api/pp/pipeline.hpp"
+#include "api/pp/reload.hpp"
+
+namespace {
+
+    std::atomic<int> liveModules{0};
+
+    // SZA++ reentrant Module answering with its configured greeting
+    class Greeter : public zia::apipp::ReentrantModule {
+    public:
+        Greeter() {
+            ++liveModules;
+        }
+
+        ~Greeter() override {
+            --liveModules;
+        }
+
+        bool config(const zia::api::Conf &conf) override {
+            if (conf.find("greeting") == conf.end())
+                return false;
+            return ReentrantModule::config(conf);
+        }
+
+        bool perform(zia::apipp::Context &ctx) override {
+            ctx.response->setStatus(200, "OK")->addHeader("X-Greeting", this->conf["greeting"].get<std::string>());
+            return true;
+        }
+    };
+
+    zia::api::Conf greeting(const std::string &text) {
+        zia::api::ConfValue value;
+        value.v = text;
+        return zia::api::Conf{{"greeting", value}};
+    }
+
+}
+
+void test9() {
+    std::cout << "TEST -- Configuration reload" << std::endl;
+
+    zia::apipp::ConfigManager manager([](const zia::api::Conf &) {
+        auto pipeline = std::make_shared<zia::apipp::Pipeline>();
+        pipeline->add(std::make_shared<Greeter>());
+        return pipeline;
+    });
+
+    std::cout << std::boolalpha;
+    std::cout << "Initial version: " << manager.version() << std::endl;
+    std::cout << "Loaded: " << manager.reload(greeting("v1")) << ", version: " << manager.version() << std::endl;
+
+    // Requests keep the snapshot they started with while the configuration changes under them
+    std::atomic<bool> running{true};
+    std::atomic<int> requests{0};
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; ++i) {
+        workers.emplace_back([&]() {
+            while (running || requests < 1000) {
+                auto snapshot = manager.read();
+                zia::api::HttpDuplex duplex{};
+                snapshot->module->exec(duplex);
+                if (duplex.resp.headers["X-Greeting"] != snapshot->compiled["greeting"].get<std::string>())
+                    ++mismatches;
+                ++requests;
+            }
+        });
+    }
+    for (int i = 2; i <= 200; ++i)
+        manager.reload(greeting("v" + std::to_string(i)));
+    running = false;
+    for (auto &worker : workers)
+        worker.join();
+
+    std::cout << "Version after reloads: " << manager.version() << ", mismatches: " << mismatches << std::endl;
+    std::cout << "Replaced snapshots in use: " << manager.reclaim() << ", live modules: " << liveModules << std::endl;
+
+    // A reader started before a reload keeps the old modules alive, until it is done
+    {
+        auto before = manager.read();
+        manager.reload(greeting("v201"));
+        std::cout << "Held version: " << before->version << ", current: " << manager.version()
+                  << ", in use: " << manager.reclaim() << std::endl;
+    }
+    std::cout << "In use once released: " << manager.reclaim() << std::endl;
+
+    std::cout << "Rejected: " << !manager.reload(zia::api::Conf{}) << ", version: " << manager.version()
+              << std::endl;
+    std::cout << std::endl;
+}
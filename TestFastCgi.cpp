@@ -0,0 +1,91 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "modules/fastcgi.hpp"
+
+// Dummy FastCGI responder spawned by the cgibin test: accepts on descriptor 0, as FastCGI applications do.
+
+namespace {
+
+    using namespace zia::modules::fastcgi;
+
+    const auto forever = std::chrono::steady_clock::time_point::max();
+
+    std::string param(const std::string &params, std::string_view name) {
+        std::vector<std::pair<std::string_view, std::string_view>> pairs;
+        parseParams(params, pairs);
+        for (const auto &pair : pairs) {
+            if (pair.first == name)
+                return std::string(pair.second);
+        }
+        return {};
+    }
+
+    /**
+     * Serve the requests of a connection until it is closed.
+     */
+    void serve(Connection &connection) {
+        int served = 0;
+
+        for (;;) {
+            Record record{};
+            std::uint16_t id = 0;
+            bool keep = false;
+            std::string params, input;
+            bool paramsDone = false, inputDone = false;
+            while (!paramsDone || !inputDone) {
+                if (connection.next(record, forever) != Connection::Status::Ok)
+                    return;
+                if (record.type == RecordType::BeginRequest) {
+                    id = record.requestId;
+                    keep = record.content.size() > 2 && (record.content[2] & keepConnection);
+                } else if (record.type == RecordType::Params) {
+                    paramsDone = record.content.empty();
+                    params.append(record.content);
+                } else if (record.type == RecordType::Stdin) {
+                    inputDone = record.content.empty();
+                    input.append(record.content);
+                }
+            }
+            ++served;
+
+            auto script = param(params, "SCRIPT_NAME");
+            std::string out, output;
+            if (script == "/cgi-bin/missing") {
+                output = "Status: 404 Not Found\r\nContent-Type: text/plain\r\n\r\nno such script";
+            } else if (script == "/cgi-bin/big") {
+                output = "Content-Type: text/plain\n\n" + std::string(1 << 20, 'x');
+            } else {
+                if (script == "/cgi-bin/slow")
+                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                output = "Content-Type: text/plain\r\nX-Requests: " + std::to_string(served) + "\r\n\r\n" +
+                         param(params, "REQUEST_METHOD") + " " + script + "?" + param(params, "QUERY_STRING") +
+                         " agent=" + param(params, "HTTP_USER_AGENT") + " length=" +
+                         param(params, "CONTENT_LENGTH") + " body=" + std::to_string(input.size());
+            }
+            // Split, as applications flush their output.
+            for (std::size_t i = 0; i < output.size(); i += 1000)
+                appendRecord(out, RecordType::Stdout, id, std::string_view(output).substr(i, 1000));
+            appendRecord(out, RecordType::Stdout, id, {});
+            appendEndRequest(out, id, 0);
+            if (connection.write(out, forever) != Connection::Status::Ok)
+                return;
+            if (!keep || script == "/cgi-bin/close")
+                return;
+        }
+    }
+
+}
+
+int main() {
+    for (;;) {
+        int fd = ::accept(0, nullptr, nullptr);
+        if (fd < 0)
+            return 1;
+        Connection connection(fd);
+        serve(connection);
+    }
+}
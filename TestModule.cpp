@@ -0,0 +1,33 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include "api/module.h"
+
+namespace {
+
+    // Basic module appending its name to the "X-Modules" response header, to check the order of a pipeline
+    class NamedModule : public zia::api::Module {
+    public:
+        bool config(const zia::api::Conf &conf) override {
+            auto delay = conf.find("test_config_delay_ms");
+            if (delay != conf.end()) {
+                if (auto *ms = std::get_if<long long>(&delay->second.v))
+                    std::this_thread::sleep_for(std::chrono::milliseconds(*ms));
+            }
+            return conf.find("test_config_fail") == conf.end();
+        }
+
+        bool exec(zia::api::HttpDuplex &http) override {
+            auto &modules = http.resp.headers["X-Modules"];
+            if (!modules.empty())
+                modules += ", ";
+            modules += TEST_MODULE_NAME;
+            return true;
+        }
+    };
+
+}
+
+extern "C" zia::api::Module *create() {
+    return new NamedModule();
+}
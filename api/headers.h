@@ -0,0 +1,502 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace zia::api {
+    namespace http {
+        /**
+        * Well-known header names. A name is identified once (see headerId), then compared as an integer.
+        */
+        enum class Header : std::uint8_t {
+            unknown,
+            accept, accept_charset, accept_encoding, accept_language, accept_ranges, age, allow,
+            authorization, cache_control, connection, content_disposition, content_encoding,
+            content_language, content_length, content_location, content_range, content_type, cookie,
+            date, etag, expect, expires, host, if_match, if_modified_since, if_none_match, if_range,
+            if_unmodified_since, keep_alive, last_modified, location, origin, pragma, range, referer,
+            server, set_cookie, te, trailer, transfer_encoding, upgrade, user_agent, vary, via,
+            www_authenticate, x_forwarded_for
+        };
+
+        namespace detail {
+            // Canonical spelling, in Header order.
+            inline constexpr std::string_view headerNames[] = {
+                "",
+                "Accept", "Accept-Charset", "Accept-Encoding", "Accept-Language", "Accept-Ranges", "Age", "Allow",
+                "Authorization", "Cache-Control", "Connection", "Content-Disposition", "Content-Encoding",
+                "Content-Language", "Content-Length", "Content-Location", "Content-Range", "Content-Type", "Cookie",
+                "Date", "ETag", "Expect", "Expires", "Host", "If-Match", "If-Modified-Since", "If-None-Match",
+                "If-Range", "If-Unmodified-Since", "Keep-Alive", "Last-Modified", "Location", "Origin", "Pragma",
+                "Range", "Referer", "Server", "Set-Cookie", "TE", "Trailer", "Transfer-Encoding", "Upgrade",
+                "User-Agent", "Vary", "Via", "WWW-Authenticate", "X-Forwarded-For"
+            };
+
+            inline constexpr std::size_t headerCount = sizeof(headerNames) / sizeof(headerNames[0]);
+            static_assert(static_cast<std::size_t>(Header::x_forwarded_for) + 1 == headerCount);
+
+            inline constexpr std::size_t hashSize = 256;
+
+            // FNV-1a with ASCII letters folded to lower case. Other bytes may collide once folded,
+            // which is fine: the name found in the table is always compared afterwards.
+            constexpr std::size_t hashName(std::string_view name, std::uint32_t seed) noexcept {
+                std::uint32_t hash = 2166136261u ^ seed;
+                for (auto c : name) {
+                    hash ^= static_cast<unsigned char>(c) | 0x20u;
+                    hash *= 16777619u;
+                }
+                return (hash ^ (hash >> 16)) % hashSize;
+            }
+
+            // First seed giving every well-known name its own slot.
+            constexpr std::uint32_t findSeed() {
+                for (std::uint32_t seed = 0;; ++seed) {
+                    bool used[hashSize]{};
+                    bool perfect = true;
+                    for (std::size_t i = 1; i < headerCount && perfect; ++i) {
+                        auto slot = hashName(headerNames[i], seed);
+                        perfect = !used[slot];
+                        used[slot] = true;
+                    }
+                    if (perfect)
+                        return seed;
+                }
+            }
+
+            inline constexpr std::uint32_t headerSeed = findSeed();
+
+            constexpr std::array<std::uint8_t, hashSize> makeHeaderTable() {
+                std::array<std::uint8_t, hashSize> table{};
+                for (std::size_t i = 1; i < headerCount; ++i)
+                    table[hashName(headerNames[i], headerSeed)] = static_cast<std::uint8_t>(i);
+                return table;
+            }
+
+            inline constexpr auto headerTable = makeHeaderTable();
+        }
+
+        /**
+        * ASCII case-insensitive comparison, as header names are compared.
+        */
+        constexpr bool iequals(std::string_view lhs, std::string_view rhs) noexcept {
+            if (lhs.size() != rhs.size())
+                return false;
+            for (std::size_t i = 0; i < lhs.size(); ++i) {
+                auto l = static_cast<unsigned char>(lhs[i]);
+                auto r = static_cast<unsigned char>(rhs[i]);
+                if (l == r)
+                    continue;
+                l |= 0x20u;
+                if (l != (r | 0x20u) || l < 'a' || l > 'z')
+                    return false;
+            }
+            return true;
+        }
+
+        /**
+        * Identify a header name, whatever its case, with one hash and one comparison.
+        */
+        constexpr Header headerId(std::string_view name) noexcept {
+            auto id = detail::headerTable[detail::hashName(name, detail::headerSeed)];
+            return id && iequals(name, detail::headerNames[id]) ? static_cast<Header>(id) : Header::unknown;
+        }
+
+        /**
+        * Canonical spelling of a well-known header ("Content-Length"), empty for Header::unknown.
+        */
+        constexpr std::string_view headerName(Header id) noexcept {
+            return detail::headerNames[static_cast<std::size_t>(id)];
+        }
+    }
+
+    namespace detail {
+        /**
+        * Contiguous vector storing its first N elements inline, without allocating.
+        * Past N, elements are stored in memory from resource. A vector keeps its resource: moving into one
+        * using another resource moves the elements instead of taking over their memory.
+        */
+        template<typename T, std::size_t N>
+        class SmallVector {
+            static_assert(std::is_nothrow_move_constructible_v<T>, "elements are relocated by moving them");
+
+        private:
+            T *items;
+            std::size_t count = 0;
+            std::size_t capacity = N;
+            std::pmr::memory_resource *memory;
+            alignas(T) unsigned char local[N * sizeof(T)];
+
+            T *localItems() noexcept {
+                return reinterpret_cast<T *>(this->local);
+            }
+
+            void release() noexcept {
+                this->clear();
+                if (this->items != this->localItems())
+                    this->memory->deallocate(this->items, this->capacity * sizeof(T), alignof(T));
+                this->items = this->localItems();
+                this->capacity = N;
+            }
+
+            void steal(SmallVector &other) {
+                if (other.items == other.localItems() || !this->memory->is_equal(*other.memory)) {
+                    this->reserve(other.count);
+                    for (auto &item : other)
+                        new(this->items + this->count++) T(std::move(item));
+                    other.clear();
+                    return;
+                }
+                this->items = other.items;
+                this->count = other.count;
+                this->capacity = other.capacity;
+                other.items = other.localItems();
+                other.count = 0;
+                other.capacity = N;
+            }
+
+        public:
+            explicit SmallVector(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) noexcept
+                : items{localItems()}, memory{resource} {}
+
+            SmallVector(const SmallVector &other) : SmallVector() {
+                this->reserve(other.count);
+                for (const auto &item : other)
+                    this->emplace_back(item);
+            }
+
+            SmallVector(SmallVector &&other) noexcept : SmallVector(other.memory) {
+                this->steal(other);
+            }
+
+            SmallVector &operator=(const SmallVector &other) {
+                if (this != &other) {
+                    this->clear();
+                    this->reserve(other.count);
+                    for (const auto &item : other)
+                        this->emplace_back(item);
+                }
+                return *this;
+            }
+
+            SmallVector &operator=(SmallVector &&other) {
+                if (this != &other) {
+                    this->release();
+                    this->steal(other);
+                }
+                return *this;
+            }
+
+            ~SmallVector() {
+                this->release();
+            }
+
+            std::pmr::memory_resource *resource() const noexcept {
+                return this->memory;
+            }
+
+            void reserve(std::size_t size) {
+                if (size <= this->capacity)
+                    return;
+                auto *grown = static_cast<T *>(this->memory->allocate(size * sizeof(T), alignof(T)));
+                for (std::size_t i = 0; i < this->count; ++i) {
+                    new(grown + i) T(std::move(this->items[i]));
+                    this->items[i].~T();
+                }
+                if (this->items != this->localItems())
+                    this->memory->deallocate(this->items, this->capacity * sizeof(T), alignof(T));
+                this->items = grown;
+                this->capacity = size;
+            }
+
+            template<typename... TArgs>
+            T &emplace_back(TArgs &&... args) {
+                if (this->count == this->capacity)
+                    this->reserve(this->capacity ? this->capacity * 2 : 4);
+                auto *item = new(this->items + this->count) T(std::forward<TArgs>(args)...);
+                ++this->count;
+                return *item;
+            }
+
+            T *erase(T *pos) {
+                for (auto *it = pos; it + 1 != this->end(); ++it)
+                    *it = std::move(it[1]);
+                this->items[--this->count].~T();
+                return pos;
+            }
+
+            /**
+            * Keeps the capacity.
+            */
+            void clear() noexcept {
+                for (std::size_t i = 0; i < this->count; ++i)
+                    this->items[i].~T();
+                this->count = 0;
+            }
+
+            std::size_t size() const noexcept { return this->count; }
+
+            bool empty() const noexcept { return this->count == 0; }
+
+            T &operator[](std::size_t index) noexcept { return this->items[index]; }
+
+            const T &operator[](std::size_t index) const noexcept { return this->items[index]; }
+
+            T *begin() noexcept { return this->items; }
+
+            T *end() noexcept { return this->items + this->count; }
+
+            const T *begin() const noexcept { return this->items; }
+
+            const T *end() const noexcept { return this->items + this->count; }
+        };
+    }
+
+    /**
+    * Header container: a flat vector of entries in insertion order, looked up by name without regard
+    * to case ("content-length" finds "Content-Length"). Well-known names are resolved by http::headerId
+    * and indexed, so finding them takes a single hash and no allocation.
+    *
+    * Entries read like std::map ones (first, second), and operator[], at, find, count, emplace, insert and
+    * erase behave the same. The name of an entry must not be modified in place.
+    */
+    template<typename TValue, std::size_t N = 16>
+    class HeaderMap {
+    public:
+        struct Entry {
+            std::string  first;  // Name, as spelled by the first insertion.
+            TValue       second;
+            http::Header id;
+
+            Entry(http::Header id, std::string_view name, TValue value)
+                : first(name), second(std::move(value)), id{id} {}
+        };
+
+        using value_type = Entry;
+        using iterator = Entry *;
+        using const_iterator = const Entry *;
+
+    private:
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+        static constexpr std::uint8_t scan = 0xFF; // Position too far for a slot: look for it.
+
+        detail::SmallVector<Entry, N> entries;
+        std::array<std::uint8_t, http::detail::headerCount> slots{}; // Position + 1 of well-known headers.
+
+        static std::size_t index(http::Header id) noexcept {
+            return static_cast<std::size_t>(id);
+        }
+
+        void record(std::size_t position) noexcept {
+            auto id = this->entries[position].id;
+            if (id != http::Header::unknown)
+                this->slots[index(id)] = position + 1 < scan ? static_cast<std::uint8_t>(position + 1) : scan;
+        }
+
+        // Values able to use the memory resource of the map get it (e.g. std::pmr::vector).
+        TValue emptyValue() const {
+            if constexpr (std::uses_allocator_v<TValue, std::pmr::polymorphic_allocator<std::byte>>)
+                return TValue(std::pmr::polymorphic_allocator<std::byte>(this->entries.resource()));
+            else
+                return TValue{};
+        }
+
+        std::size_t position(http::Header id, std::string_view name) const noexcept {
+            if (id != http::Header::unknown) {
+                auto slot = this->slots[index(id)];
+                if (slot != scan)
+                    return slot == 0 ? npos : slot - 1u;
+            }
+            for (std::size_t i = 0; i < this->entries.size(); ++i) {
+                const auto &entry = this->entries[i];
+                if (entry.id == id && (id != http::Header::unknown || http::iequals(entry.first, name)))
+                    return i;
+            }
+            return npos;
+        }
+
+    public:
+        HeaderMap() = default;
+
+        /**
+        * Entries past the inline capacity, and values which are std::pmr containers, use memory from resource
+        * (e.g. the arena of a request).
+        */
+        explicit HeaderMap(std::pmr::memory_resource *resource) : entries{resource} {}
+
+        HeaderMap(const HeaderMap &) = default;
+
+        HeaderMap &operator=(const HeaderMap &) = default;
+
+        // The slots follow the entries: a moved-from map is empty and can be reused.
+        HeaderMap(HeaderMap &&other) noexcept : entries{std::move(other.entries)}, slots{other.slots} {
+            other.slots.fill(0);
+        }
+
+        HeaderMap &operator=(HeaderMap &&other) {
+            if (this != &other) {
+                this->entries = std::move(other.entries);
+                this->slots = other.slots;
+                other.slots.fill(0);
+            }
+            return *this;
+        }
+
+        HeaderMap(std::initializer_list<std::pair<std::string_view, TValue>> init) {
+            for (const auto &item : init)
+                (*this)[item.first] = item.second;
+        }
+
+        std::pmr::memory_resource *resource() const noexcept { return this->entries.resource(); }
+
+        std::size_t size() const noexcept { return this->entries.size(); }
+
+        bool empty() const noexcept { return this->entries.empty(); }
+
+        iterator begin() noexcept { return this->entries.begin(); }
+
+        iterator end() noexcept { return this->entries.end(); }
+
+        const_iterator begin() const noexcept { return this->entries.begin(); }
+
+        const_iterator end() const noexcept { return this->entries.end(); }
+
+        /**
+        * Keeps the capacity, for the next request on the connection.
+        */
+        void clear() noexcept {
+            this->entries.clear();
+            this->slots.fill(0);
+        }
+
+        iterator find(std::string_view name) noexcept {
+            auto pos = this->position(http::headerId(name), name);
+            return pos == npos ? this->end() : this->begin() + pos;
+        }
+
+        const_iterator find(std::string_view name) const noexcept {
+            auto pos = this->position(http::headerId(name), name);
+            return pos == npos ? this->end() : this->begin() + pos;
+        }
+
+        iterator find(http::Header id) noexcept {
+            auto pos = this->position(id, http::headerName(id));
+            return pos == npos ? this->end() : this->begin() + pos;
+        }
+
+        const_iterator find(http::Header id) const noexcept {
+            auto pos = this->position(id, http::headerName(id));
+            return pos == npos ? this->end() : this->begin() + pos;
+        }
+
+        /**
+        * @return the value, or nullptr when the header is missing.
+        */
+        template<typename TKey>
+        const TValue *get(const TKey &key) const noexcept {
+            auto it = this->find(key);
+            return it == this->end() ? nullptr : &it->second;
+        }
+
+        template<typename TKey>
+        TValue *get(const TKey &key) noexcept {
+            auto it = this->find(key);
+            return it == this->end() ? nullptr : &it->second;
+        }
+
+        template<typename TKey>
+        bool contains(const TKey &key) const noexcept {
+            return this->find(key) != this->end();
+        }
+
+        template<typename TKey>
+        std::size_t count(const TKey &key) const noexcept {
+            return this->contains(key) ? 1 : 0;
+        }
+
+        /**
+        * Value of the header, inserted empty when missing. id must be http::headerId(name): callers
+        * which already identified the name do not hash it again.
+        */
+        TValue &entry(http::Header id, std::string_view name) {
+            auto pos = this->position(id, name);
+            if (pos != npos)
+                return this->entries[pos].second;
+            this->entries.emplace_back(id, name, this->emptyValue());
+            this->record(this->entries.size() - 1);
+            return this->entries[this->entries.size() - 1].second;
+        }
+
+        TValue &operator[](std::string_view name) {
+            return this->entry(http::headerId(name), name);
+        }
+
+        TValue &operator[](http::Header id) {
+            return this->entry(id, http::headerName(id));
+        }
+
+        template<typename TKey>
+        const TValue &at(const TKey &key) const {
+            if (auto *value = this->get(key))
+                return *value;
+            throw std::out_of_range("HeaderMap::at: no such header");
+        }
+
+        template<typename TKey>
+        TValue &at(const TKey &key) {
+            if (auto *value = this->get(key))
+                return *value;
+            throw std::out_of_range("HeaderMap::at: no such header");
+        }
+
+        /**
+        * Insert the header unless it is already there.
+        */
+        std::pair<iterator, bool> emplace(std::string_view name, TValue value) {
+            auto id = http::headerId(name);
+            auto pos = this->position(id, name);
+            if (pos != npos)
+                return {this->begin() + pos, false};
+            this->entries.emplace_back(id, name, std::move(value));
+            this->record(this->entries.size() - 1);
+            return {this->end() - 1, true};
+        }
+
+        std::pair<iterator, bool> insert(std::pair<std::string_view, TValue> value) {
+            return this->emplace(value.first, std::move(value.second));
+        }
+
+        template<typename TIterator>
+        void insert(TIterator first, TIterator last) {
+            for (; first != last; ++first)
+                this->emplace(first->first, first->second);
+        }
+
+        iterator erase(iterator it) {
+            auto pos = static_cast<std::size_t>(it - this->begin());
+            if (it->id != http::Header::unknown)
+                this->slots[index(it->id)] = 0;
+            this->entries.erase(this->begin() + pos);
+            for (auto i = pos; i < this->entries.size(); ++i)
+                this->record(i);
+            return this->begin() + pos;
+        }
+
+        template<typename TKey>
+        std::size_t erase(const TKey &key) {
+            auto it = this->find(key);
+            if (it == this->end())
+                return 0;
+            this->erase(it);
+            return 1;
+        }
+    };
+}
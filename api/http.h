@@ -1,7 +1,9 @@
 #pragma once
 
+#include "headers.h"
 #include "net.h"
-#include <map>
+#include <cstdint>
+#include <memory>
 #include <string>
 
 namespace zia::api {
@@ -68,23 +70,40 @@ namespace zia::api {
     */
     struct HttpRequest {
         http::Version                      version;
-        std::map<std::string, std::string> headers;
+        HeaderMap<std::string>             headers;
         Net::Raw                           body;
 
         http::Method method;
         std::string  uri;
     };
 
+    /**
+    * Body sent from a file instead of memory: length bytes of the descriptor fd, starting at offset.
+    * The descriptor is not copied to user space by the Net (sendfile, splice).
+    * Whoever creates it closes fd once the last reference is dropped (see apipp::openFile).
+    */
+    struct FileBody {
+        int           fd;
+        std::uint64_t offset;
+        std::uint64_t length;
+    };
+
     /**
     * Represent a response.
+    * When file is set, it is the body and body is empty.
+    * When wire is set, it is the whole response, already serialized (e.g. by a cache): it is sent as it is,
+    * the other fields only describe it.
     */
     struct HttpResponse {
         http::Version                      version;
-        std::map<std::string, std::string> headers;
+        HeaderMap<std::string>             headers;
         Net::Raw                           body;
 
         http::Status status;
         std::string  reason;
+
+        std::shared_ptr<const FileBody> file{};
+        std::shared_ptr<const Net::Raw> wire{};
     };
 
     /**
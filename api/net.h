@@ -32,7 +32,7 @@ namespace zia::api {
         NetIp         ip;
         std::uint16_t port;
 
-        ImplSocket* sock;
+        ImplSocket* sock{};
     };
 
     /**
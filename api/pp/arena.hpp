@@ -0,0 +1,47 @@
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace zia::apipp {
+
+    /**
+     * Monotonic memory for the objects of one request (headers, Request, Response), released in one
+     * shot once the response is written back to the duplex.
+     *
+     * The first inlineSize bytes live in the arena itself, so a typical request allocates nothing
+     * from the heap for its headers; bigger requests get further blocks from upstream.
+     * Deallocations are no-ops: memory is only given back by release() or the destructor.
+     */
+    class RequestArena {
+    public:
+        static constexpr std::size_t inlineSize = 16 * 1024;
+
+    private:
+        alignas(std::max_align_t) std::byte buffer[inlineSize];
+        std::pmr::monotonic_buffer_resource resource;
+
+    public:
+        /**
+         * @param upstream where blocks past the inline buffer come from, see recycledMemory().
+         */
+        explicit RequestArena(std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+                : resource{this->buffer, inlineSize, upstream} {}
+
+        RequestArena(const RequestArena &) = delete;
+        RequestArena &operator=(const RequestArena &) = delete;
+
+        std::pmr::memory_resource *memory() {
+            return &this->resource;
+        }
+
+        /**
+         * Give back everything allocated so far. Nothing allocated from memory() may still be in use.
+         */
+        void release() {
+            this->resource.release();
+        }
+    };
+
+}
@@ -0,0 +1,286 @@
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#include "async.hpp"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace zia::apipp {
+
+    namespace {
+        enum Phase {
+            Calling,   // execAsync() has not returned yet.
+            Suspended, // execAsync() returned first: resume continues the chain.
+            Completed, // resume was called first: execAsync()'s caller continues the chain.
+        };
+
+        struct Blocking {
+            std::mutex lock{};
+            std::condition_variable done{};
+            bool resumed = false;
+            bool result = false;
+        };
+    }
+
+    bool AsyncModule::exec(zia::api::HttpDuplex &http) {
+        // The Reactor resumes on a worker: with this one waiting, possibly the only one, nothing would.
+        if (Scheduler::onWorker())
+            return false;
+        // Shared: resume may still be running when the wait is over.
+        auto state = std::make_shared<Blocking>();
+        this->execAsync(http, [state](bool ok) {
+            std::lock_guard<std::mutex> guard(state->lock);
+            state->result = ok;
+            state->resumed = true;
+            state->done.notify_all();
+        });
+
+        std::unique_lock<std::mutex> guard(state->lock);
+        state->done.wait(guard, [&state]() { return state->resumed; });
+        return state->result;
+    }
+
+    Reactor::Reactor(Scheduler &executor) : executor{executor} {
+#ifdef __linux__
+        this->epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        this->wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = this->wakeup;
+        ::epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->wakeup, &event);
+#endif
+        this->thread = std::thread([this]() { this->run(); });
+    }
+
+    Reactor::~Reactor() {
+        this->stop();
+#ifdef __linux__
+        ::close(this->wakeup);
+        ::close(this->epfd);
+#endif
+    }
+
+    void Reactor::interrupt() {
+#ifdef __linux__
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(this->wakeup, &one, sizeof(one));
+#else
+        this->wake.notify_one();
+#endif
+    }
+
+    void Reactor::post(Callback callback, bool ready) {
+        if (!this->executor.submit([callback, ready]() { callback(ready); }))
+            callback(ready);
+    }
+
+    bool Reactor::await(int fd, int events, Callback callback) {
+#ifdef __linux__
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->stopping || this->watches.count(fd))
+            return false;
+
+        epoll_event event{};
+        event.events = EPOLLONESHOT | (events & Readable ? EPOLLIN : 0u) | (events & Writable ? EPOLLOUT : 0u);
+        event.data.fd = fd;
+        // Registered under the lock: the reactor thread cannot look the descriptor up before it is stored.
+        if (::epoll_ctl(this->epfd, EPOLL_CTL_ADD, fd, &event) != 0)
+            return false;
+        this->watches.emplace(fd, std::move(callback));
+        return true;
+#else
+        (void) fd;
+        (void) events;
+        (void) callback;
+        return false;
+#endif
+    }
+
+    bool Reactor::after(std::chrono::milliseconds delay, Callback callback) {
+        bool first;
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (this->stopping)
+                return false;
+            auto it = this->timers.emplace(Clock::now() + delay, std::move(callback));
+            first = it == this->timers.begin();
+        }
+        // The reactor sleeps until the timer which was the first one.
+        if (first)
+            this->interrupt();
+        return true;
+    }
+
+    void Reactor::run() {
+        std::vector<Callback> ready;
+
+        for (;;) {
+#ifdef __linux__
+            int timeout = -1;
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                if (this->stopping)
+                    break;
+                if (!this->timers.empty()) {
+                    auto left = std::chrono::ceil<std::chrono::milliseconds>(this->timers.begin()->first - Clock::now());
+                    timeout = static_cast<int>(std::max<std::chrono::milliseconds::rep>(0, left.count()));
+                }
+            }
+
+            epoll_event events[64];
+            auto count = ::epoll_wait(this->epfd, events, 64, timeout);
+
+            std::unique_lock<std::mutex> guard(this->lock);
+            for (int i = 0; i < count; ++i) {
+                auto fd = events[i].data.fd;
+                if (fd == this->wakeup) {
+                    std::uint64_t value;
+                    [[maybe_unused]] auto read = ::read(this->wakeup, &value, sizeof(value));
+                    continue;
+                }
+                auto found = this->watches.find(fd);
+                if (found == this->watches.end())
+                    continue;
+                ::epoll_ctl(this->epfd, EPOLL_CTL_DEL, fd, nullptr);
+                ready.push_back(std::move(found->second));
+                this->watches.erase(found);
+            }
+#else
+            std::unique_lock<std::mutex> guard(this->lock);
+            if (this->stopping)
+                break;
+            if (this->timers.empty())
+                this->wake.wait(guard);
+            else
+                this->wake.wait_until(guard, this->timers.begin()->first);
+#endif
+            auto now = Clock::now();
+            while (!this->timers.empty() && this->timers.begin()->first <= now) {
+                ready.push_back(std::move(this->timers.begin()->second));
+                this->timers.erase(this->timers.begin());
+            }
+            guard.unlock();
+
+            for (auto &callback : ready)
+                this->post(std::move(callback), true);
+            ready.clear();
+        }
+
+        // Stopped: nothing left will be ready.
+        std::unique_lock<std::mutex> guard(this->lock);
+        for (auto &watch : this->watches) {
+#ifdef __linux__
+            ::epoll_ctl(this->epfd, EPOLL_CTL_DEL, watch.first, nullptr);
+#endif
+            ready.push_back(std::move(watch.second));
+        }
+        for (auto &timer : this->timers)
+            ready.push_back(std::move(timer.second));
+        this->watches.clear();
+        this->timers.clear();
+        guard.unlock();
+
+        for (auto &callback : ready)
+            this->post(std::move(callback), false);
+    }
+
+    void Reactor::stop() {
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->stopping = true;
+        }
+        this->interrupt();
+        if (this->thread.joinable())
+            this->thread.join();
+    }
+
+    std::size_t Reactor::waiting() {
+        std::lock_guard<std::mutex> guard(this->lock);
+        return this->watches.size() + this->timers.size();
+    }
+
+    struct AsyncPipeline::Run {
+        const AsyncPipeline &pipeline;
+        zia::api::HttpDuplex &http;
+        Resume resume;
+        std::size_t next = 0;
+        std::atomic<int> phase{Calling};
+        bool result = true;
+
+        Run(const AsyncPipeline &pipeline, zia::api::HttpDuplex &http, Resume resume)
+                : pipeline{pipeline}, http{http}, resume{std::move(resume)} {}
+    };
+
+    bool AsyncPipeline::config(const zia::api::Conf &conf) {
+        bool ret = true;
+
+        for (auto &stage : this->stages) {
+            ret = stage.module->config(conf) && ret;
+        }
+        return ret;
+    }
+
+    void AsyncPipeline::execAsync(zia::api::HttpDuplex &http, Resume resume) {
+        advance(std::make_shared<Run>(*this, http, std::move(resume)));
+    }
+
+    void AsyncPipeline::advance(const std::shared_ptr<Run> &run) {
+        const auto &stages = run->pipeline.stages;
+
+        while (run->next < stages.size()) {
+            const auto &stage = stages[run->next++];
+            bool ok = false;
+
+            if (!stage.async) {
+                try {
+                    ok = stage.module->exec(run->http);
+                } catch (std::exception &) {
+                    ok = false;
+                }
+            } else {
+                bool thrown = false;
+                run->phase.store(Calling);
+                try {
+                    stage.async->execAsync(run->http, [run](bool resumed) {
+                        run->result = resumed;
+                        if (run->phase.exchange(Completed) != Suspended)
+                            return;
+                        // Suspended: the chain continues on this thread.
+                        if (!resumed) {
+                            auto done = std::move(run->resume);
+                            done(false);
+                        } else {
+                            advance(run);
+                        }
+                    });
+                } catch (std::exception &) {
+                    thrown = true;
+                }
+                if (thrown) {
+                    // Resumed before throwing: its result stands, otherwise it failed and a later resume is ignored.
+                    int calling = Calling;
+                    ok = !run->phase.compare_exchange_strong(calling, Completed) && run->result;
+                } else {
+                    if (run->phase.exchange(Suspended) != Completed)
+                        return;
+                    ok = run->result;
+                }
+            }
+            if (!ok) {
+                auto done = std::move(run->resume);
+                done(false);
+                return;
+            }
+        }
+
+        auto done = std::move(run->resume);
+        done(true);
+    }
+
+}
@@ -0,0 +1,181 @@
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../module.h"
+
+#include "pipeline.hpp"
+#include "scheduler.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Continuation of a suspended request: called once, with what exec() would have returned.
+     */
+    using Resume = std::function<void(bool)>;
+
+    /**
+     * Module which can suspend a request while waiting, e.g. on a CGI child or an upstream socket,
+     * without holding the thread: execAsync() starts the work and returns, then resume is called once
+     * it is over, from any thread (usually a Reactor notification run on the Scheduler).
+     *
+     * The duplex stays alive and untouched by others until resume is called.
+     * In an AsyncPipeline the module is suspended, in any other chain exec() blocks until resume: only off
+     * the Scheduler workers, since resume usually needs one of them (see exec()).
+     */
+    class AsyncModule : public zia::api::Module {
+    public:
+        ~AsyncModule() override = default;
+
+        /**
+         * Start processing the request, resume may be called before returning.
+         */
+        virtual void execAsync(zia::api::HttpDuplex &http, Resume resume) = 0;
+
+        /**
+         * Blocking fallback for chains which are not asynchronous, e.g. a Pipeline run by the caller's thread.
+         * \return false at once on a Scheduler worker, where waiting for resume could hold the worker it needs.
+         */
+        bool exec(zia::api::HttpDuplex &http) override;
+    };
+
+    /**
+     * Readiness notifications of file descriptors and timers, on a thread of their own. Callbacks are not
+     * run on it but submitted to the Scheduler, so a module resumes on a worker.
+     *
+     * Descriptors are watched once (the callback is dropped once called) and by one waiter at a time.
+     * Descriptors are only watched on Linux (epoll): await() returns false on other systems.
+     */
+    class Reactor {
+    public:
+        enum Events {
+            Readable = 1,
+            Writable = 2,
+        };
+
+        /**
+         * @param ready true when the descriptor is ready or the delay is over (errors and hang-ups are
+         * ready too: the next read or write reports them), false when the reactor stopped first.
+         */
+        using Callback = std::function<void(bool ready)>;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        Scheduler &executor;
+        int epfd = -1;
+        int wakeup = -1;
+        std::thread thread{};
+
+        std::mutex lock{};
+        std::condition_variable wake{}; // Without epoll, sleeping until the next timer.
+        std::unordered_map<int, Callback> watches{};
+        std::multimap<Clock::time_point, Callback> timers{};
+        bool stopping = false;
+
+        void run();
+
+        void post(Callback callback, bool ready);
+
+        void interrupt();
+
+    public:
+        explicit Reactor(Scheduler &executor);
+
+        ~Reactor();
+
+        Reactor(const Reactor &) = delete;
+        Reactor &operator=(const Reactor &) = delete;
+
+        /**
+         * Call callback once fd is ready for events (a combination of Events).
+         * \return false if fd is already watched, cannot be watched or the reactor is stopped.
+         */
+        bool await(int fd, int events, Callback callback);
+
+        /**
+         * Call callback after delay.
+         * \return false if the reactor is stopped.
+         */
+        bool after(std::chrono::milliseconds delay, Callback callback);
+
+        /**
+         * Call the waiting callbacks with false, then join the thread.
+         */
+        void stop();
+
+        /**
+         * Watched descriptors and timers.
+         */
+        std::size_t waiting();
+    };
+
+    /**
+     * Ordered chain of modules in which asynchronous modules suspend the request instead of blocking:
+     * the following modules run once they resume, on the thread which resumed them. Consecutive synchronous
+     * modules, basic or SZA++, run in between as one Pipeline: the duplex is converted once for them.
+     *
+     * Stops at the first module failing, like Pipeline. The pipeline keeps no per-request state.
+     */
+    class AsyncPipeline : public AsyncModule {
+    private:
+        struct Stage {
+            std::shared_ptr<zia::api::Module> module;
+            AsyncModule *async; // Same object as module when it is asynchronous, nullptr otherwise.
+            Pipeline *group;    // Same object as module when it holds synchronous modules, nullptr otherwise.
+        };
+
+        struct Run;
+
+        std::vector<Stage> stages;
+        std::size_t count = 0;
+
+        static void advance(const std::shared_ptr<Run> &run);
+
+    public:
+        ~AsyncPipeline() override = default;
+
+        /**
+         * Append a module at the end of the chain.
+         */
+        AsyncPipeline &add(std::shared_ptr<zia::api::Module> module) {
+            ++this->count;
+            if (auto *async = dynamic_cast<AsyncModule *>(module.get())) {
+                this->stages.push_back(Stage{std::move(module), async, nullptr});
+                return *this;
+            }
+            if (this->stages.empty() || !this->stages.back().group) {
+                auto group = std::make_shared<Pipeline>();
+                auto *raw = group.get();
+                this->stages.push_back(Stage{std::move(group), nullptr, raw});
+            }
+            this->stages.back().group->add(std::move(module));
+            return *this;
+        }
+
+        std::size_t size() const {
+            return this->count;
+        }
+
+        /**
+         * Configure every module of the chain.
+         * \return true if all modules succeeded, otherwise false.
+         */
+        bool config(const zia::api::Conf &conf) override;
+
+        /**
+         * Run the chain on http, which must stay alive until resume is called.
+         */
+        void execAsync(zia::api::HttpDuplex &http, Resume resume) override;
+    };
+
+}
@@ -0,0 +1,291 @@
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "compiled.hpp"
+#include "conf.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * A configuration does not match the struct it is bound to.
+     * what() starts with the path of the faulty value, e.g. "routes[2].timeout: expected Double, got String".
+     */
+    class ConfBindError : public std::runtime_error {
+    private:
+        std::string where;
+
+    public:
+        ConfBindError(const std::string &path, const std::string &message)
+                : std::runtime_error(path + ": " + message), where{path} {}
+
+        const std::string &path() const {
+            return this->where;
+        }
+    };
+
+    /**
+     * Tag of a field keeping the value the struct was initialized with when it is absent.
+     */
+    struct OrDefault {
+    };
+
+    inline constexpr OrDefault orDefault{};
+
+    template<typename TStruct, typename TMember>
+    struct ConfField {
+        const char *name;
+        TMember TStruct::*member;
+        bool required;
+    };
+
+    /**
+     * Member bound to the key name of a map. It is required, unless it is a std::optional or orDefault is given.
+     */
+    template<typename TStruct, typename TMember>
+    constexpr ConfField<TStruct, TMember> field(const char *name, TMember TStruct::*member) {
+        return {name, member, true};
+    }
+
+    template<typename TStruct, typename TMember>
+    constexpr ConfField<TStruct, TMember> field(const char *name, TMember TStruct::*member, OrDefault) {
+        return {name, member, false};
+    }
+
+    /**
+     * Description of a struct bound from a configuration map: its fields, as a tuple of field().
+     * Specialize it, or give the struct a static confFields() function:
+     *
+     *     struct Route {
+     *         std::string path;
+     *         std::optional<double> timeout;
+     *
+     *         static auto confFields() {
+     *             return std::make_tuple(zia::apipp::field("path", &Route::path),
+     *                                    zia::apipp::field("timeout", &Route::timeout));
+     *         }
+     *     };
+     */
+    template<typename T, typename = void>
+    struct ConfBinding {
+    };
+
+    template<typename T>
+    struct ConfBinding<T, std::void_t<decltype(T::confFields())>> {
+        static auto fields() {
+            return T::confFields();
+        }
+    };
+
+    namespace detail {
+
+        template<typename T, typename = void>
+        struct IsBound : std::false_type {
+        };
+
+        template<typename T>
+        struct IsBound<T, std::void_t<decltype(ConfBinding<T>::fields())>> : std::true_type {
+        };
+
+        template<typename T>
+        struct IsOptional : std::false_type {
+        };
+
+        template<typename T>
+        struct IsOptional<std::optional<T>> : std::true_type {
+        };
+
+        template<typename T>
+        struct IsVector : std::false_type {
+        };
+
+        template<typename T, typename TAlloc>
+        struct IsVector<std::vector<T, TAlloc>> : std::true_type {
+        };
+
+        template<typename T>
+        struct IsStringMap : std::false_type {
+        };
+
+        template<typename T, typename TCompare, typename TAlloc>
+        struct IsStringMap<std::map<std::string, T, TCompare, TAlloc>> : std::true_type {
+        };
+
+        inline const char *typeName(ConfElem::Type type) {
+            static const char *const names[] = {"Empty", "Map", "Array", "String", "Integer", "Double", "Boolean"};
+            return names[type];
+        }
+
+        // Uniform access to ConfElem and CompiledConf nodes.
+
+        inline const ConfElem *child(const ConfElem &map, const std::string &key) {
+            return map.find(key);
+        }
+
+        inline std::optional<CompiledConf::Node> child(const CompiledConf::Node &map, const std::string &key) {
+            return map.find(key);
+        }
+
+        inline std::size_t arraySize(const ConfElem &array) {
+            return std::get<ConfArray::Sptr>(array.getValue())->elems.size();
+        }
+
+        inline std::size_t arraySize(const CompiledConf::Node &array) {
+            return array.size();
+        }
+
+        inline const ConfElem &element(const ConfElem &array, std::size_t index) {
+            return *std::get<ConfArray::Sptr>(array.getValue())->elems[index];
+        }
+
+        inline CompiledConf::Node element(const CompiledConf::Node &array, std::size_t index) {
+            return array[static_cast<int>(index)];
+        }
+
+        template<typename TFunction>
+        void forEachEntry(const ConfElem &map, TFunction function) {
+            for (const auto &item : std::get<ConfMap::Sptr>(map.getValue())->elems) {
+                if (item.second)
+                    function(item.first, *item.second);
+            }
+        }
+
+        template<typename TFunction>
+        void forEachEntry(const CompiledConf::Node &map, TFunction function) {
+            for (const auto &item : std::get<CompiledConf::Map>(map.getValue()))
+                function(std::string(item.first), item.second);
+        }
+
+        template<typename TNode>
+        void expect(const TNode &node, ConfElem::Type type, const std::string &path) {
+            if (node.getType() != type)
+                throw ConfBindError(path, std::string("expected ") + typeName(type) + ", got " + typeName(node.getType()));
+        }
+
+        template<typename T, typename TNode>
+        void decode(const TNode &node, T &out, const std::string &path);
+
+        template<typename TStruct, typename TNode, typename TMember>
+        void decodeField(const TNode &map, TStruct &out, const ConfField<TStruct, TMember> &field,
+                         const std::string &path) {
+            auto fieldPath = path + "." + field.name;
+            auto value = child(map, field.name);
+
+            if (!value || value->getType() == ConfElem::Empty) {
+                if constexpr (IsOptional<TMember>::value)
+                    (out.*field.member).reset();
+                else if (field.required)
+                    throw ConfBindError(fieldPath, "missing");
+                return;
+            }
+            decode(*value, out.*field.member, fieldPath);
+        }
+
+        template<typename T, typename TNode>
+        void decode(const TNode &node, T &out, const std::string &path) {
+            using ConfType = ConfElem::Type;
+
+            if constexpr (std::is_same_v<T, bool>) {
+                expect(node, ConfType::Boolean, path);
+                out = node.template get<bool>();
+            } else if constexpr (std::is_integral_v<T>) {
+                expect(node, ConfType::Integer, path);
+                auto value = node.template get<long long>();
+                if constexpr (std::is_unsigned_v<T>) {
+                    if (value < 0 || static_cast<unsigned long long>(value) > std::numeric_limits<T>::max())
+                        throw ConfBindError(path, std::to_string(value) + " out of range");
+                } else {
+                    if (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max())
+                        throw ConfBindError(path, std::to_string(value) + " out of range");
+                }
+                out = static_cast<T>(value);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                if (node.getType() == ConfType::Integer)
+                    out = static_cast<T>(node.template get<long long>());
+                else {
+                    expect(node, ConfType::Double, path);
+                    out = static_cast<T>(node.template get<double>());
+                }
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                expect(node, ConfType::String, path);
+                out = node.template get<std::string>();
+            } else if constexpr (IsOptional<T>::value) {
+                out.emplace();
+                decode(node, *out, path);
+            } else if constexpr (IsVector<T>::value) {
+                expect(node, ConfType::Array, path);
+                auto size = arraySize(node);
+                out.clear();
+                out.reserve(size);
+                for (std::size_t i = 0; i < size; ++i) {
+                    typename T::value_type item{};
+                    decode(element(node, i), item, path + "[" + std::to_string(i) + "]");
+                    out.push_back(std::move(item));
+                }
+            } else if constexpr (IsStringMap<T>::value) {
+                expect(node, ConfType::Map, path);
+                out.clear();
+                forEachEntry(node, [&out, &path](const std::string &key, const auto &value) {
+                    decode(value, out[key], path + "." + key);
+                });
+            } else if constexpr (IsBound<T>::value) {
+                expect(node, ConfType::Map, path);
+                std::apply([&](const auto &...fields) {
+                    (decodeField(node, out, fields, path), ...);
+                }, ConfBinding<T>::fields());
+            } else {
+                static_assert(IsBound<T>::value, "no ConfBinding for this type, see zia::apipp::field()");
+            }
+        }
+
+    }
+
+    /**
+     * Decode a configuration into a T described by ConfBinding (see field()), once, e.g. in config():
+     * requests then read plain fields.
+     *
+     * Members can be bool, integers (range checked), floating points (Integer values accepted), std::string,
+     * bound structs, and std::optional, std::vector or std::map<std::string, ...> of them.
+     *
+     * @param conf ConfElem or CompiledConf node.
+     * @param path name of conf in error messages.
+     * @throw ConfBindError on a missing required field or a value of the wrong type.
+     */
+    template<typename T, typename TNode>
+    T bindConf(const TNode &conf, const std::string &path = "conf") {
+        T out{};
+        detail::decode(conf, out, path);
+        return out;
+    }
+
+    template<typename T>
+    T bindConf(const CompiledConf &conf, const std::string &path = "conf") {
+        return bindConf<T>(conf.root(), path);
+    }
+
+    /**
+     * Same as bindConf, reporting the error instead of throwing, for config() functions.
+     * @return false if conf does not match: out is then left unchanged and error is set.
+     */
+    template<typename T, typename TNode>
+    bool bindConf(const TNode &conf, T &out, std::string &error) {
+        try {
+            out = bindConf<T>(conf);
+            return true;
+        } catch (ConfBindError &e) {
+            error = e.what();
+            return false;
+        }
+    }
+
+}
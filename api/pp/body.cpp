@@ -0,0 +1,126 @@
+
+#include <algorithm>
+
+#include "body.hpp"
+#include "net.hpp"
+
+namespace zia::apipp {
+
+    void BodyStream::drained() {
+        if (this->paused && this->buffered <= this->windowSize / 2) {
+            this->paused = false;
+            if (this->resume)
+                this->resume();
+        }
+    }
+
+    bool BodyStream::read(zia::api::Net::Raw &chunk) {
+        std::unique_lock<std::mutex> guard(this->lock);
+
+        this->arrived.wait(guard, [this]() { return !this->chunks.empty() || this->state != State::Open; });
+        if (this->chunks.empty())
+            return false;
+
+        chunk = std::move(this->chunks.front());
+        this->chunks.pop_front();
+        this->buffered -= chunk.size();
+        this->drained();
+        return true;
+    }
+
+    bool BodyStream::readAll(zia::api::Net::Raw &body) {
+        if (this->contentLength)
+            body.reserve(body.size() + *this->contentLength);
+
+        zia::api::Net::Raw chunk;
+        while (this->read(chunk))
+            body.insert(body.end(), chunk.begin(), chunk.end());
+        return !this->failed();
+    }
+
+    void BodyStream::abandon() {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        this->abandoned = true;
+        this->chunks.clear();
+        this->buffered = 0;
+        this->drained();
+    }
+
+    bool BodyStream::failed() const {
+        std::lock_guard<std::mutex> guard(this->lock);
+        return this->state == State::Failed;
+    }
+
+    bool BodyStream::finished() const {
+        std::lock_guard<std::mutex> guard(this->lock);
+        return this->state == State::Finished;
+    }
+
+    std::size_t BodyStream::received() const {
+        std::lock_guard<std::mutex> guard(this->lock);
+        return this->total;
+    }
+
+    std::size_t BodyStream::peak() const {
+        std::lock_guard<std::mutex> guard(this->lock);
+        return this->highest;
+    }
+
+    std::size_t BodyStream::space() const {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        if (this->abandoned)
+            return this->windowSize;
+        return this->windowSize - std::min(this->buffered, this->windowSize);
+    }
+
+    void BodyStream::push(const std::byte *data, std::size_t size) {
+        if (!size)
+            return;
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        this->total += size;
+        if (this->abandoned)
+            return;
+        this->chunks.emplace_back(data, data + size);
+        this->buffered += size;
+        this->highest = std::max(this->highest, this->buffered);
+        this->arrived.notify_one();
+    }
+
+    bool BodyStream::pause() {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        if (this->abandoned || this->buffered < this->windowSize || !this->buffered)
+            return false;
+        this->paused = true;
+        return true;
+    }
+
+    void BodyStream::onResume(std::function<void()> hook) {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->resume = std::move(hook);
+    }
+
+    void BodyStream::finish() {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        if (this->state == State::Open)
+            this->state = State::Finished;
+        this->arrived.notify_all();
+    }
+
+    void BodyStream::fail() {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        if (this->state == State::Open)
+            this->state = State::Failed;
+        this->arrived.notify_all();
+    }
+
+    std::shared_ptr<BodyStream> bodyStreamOf(const zia::api::NetInfo &info) {
+        return info.sock ? info.sock->bodyStream() : nullptr;
+    }
+
+}
@@ -0,0 +1,136 @@
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "../net.h"
+
+namespace zia::apipp {
+
+    /**
+     * Request body delivered in pieces as it arrives from the socket, for requests whose body is larger
+     * than the Net window ("net_body_window") or sent with "Transfer-Encoding: chunked".
+     *
+     * The Net pushes decoded bytes, modules pull them. At most window bytes are queued: the Net stops
+     * reading the socket while the window is full, so an upload of any size uses bounded memory.
+     *
+     * Reading blocks until bytes arrive: it must not be done on the thread running the Net callback,
+     * which is the one feeding the stream.
+     */
+    class BodyStream {
+    private:
+        enum class State {
+            Open, Finished, Failed
+        };
+
+        mutable std::mutex lock{};
+        std::condition_variable arrived{};
+        std::deque<zia::api::Net::Raw> chunks{};
+        const std::size_t windowSize;
+        const std::optional<std::size_t> contentLength;
+        std::size_t buffered = 0;
+        std::size_t total = 0;
+        std::size_t highest = 0;
+        State state = State::Open;
+        bool abandoned = false;
+        bool paused = false;
+        std::function<void()> resume{};
+
+        // Lock must be held. Wake up the producer once the window is half empty.
+        void drained();
+
+    public:
+        /**
+         * @param length Content-Length of the body, none when chunked.
+         */
+        explicit BodyStream(std::size_t window, std::optional<std::size_t> length = std::nullopt)
+                : windowSize{window}, contentLength{length} {}
+
+        BodyStream(const BodyStream &) = delete;
+        BodyStream &operator=(const BodyStream &) = delete;
+
+        /**
+         * Wait for the next piece of the body.
+         * @return false once the body is over, see failed().
+         */
+        bool read(zia::api::Net::Raw &chunk);
+
+        /**
+         * Full buffering, for modules needing a contiguous body: wait for the whole body and append it.
+         * Memory is then as large as the body.
+         * @return false if the body could not be received entirely.
+         */
+        bool readAll(zia::api::Net::Raw &body);
+
+        /**
+         * The rest of the body is not wanted (e.g. an error was answered): it is discarded as it arrives.
+         */
+        void abandon();
+
+        /**
+         * Whether the client stopped before the end of the body, or sent malformed chunks.
+         */
+        bool failed() const;
+
+        /**
+         * Whether the whole body has been received (not necessarily read).
+         */
+        bool finished() const;
+
+        /**
+         * Bytes received so far.
+         */
+        std::size_t received() const;
+
+        /**
+         * Most bytes queued at once, bounded by window() plus one read from the socket.
+         */
+        std::size_t peak() const;
+
+        std::size_t window() const {
+            return this->windowSize;
+        }
+
+        std::optional<std::size_t> length() const {
+            return this->contentLength;
+        }
+
+        // Producer side, used by the Net implementations.
+
+        /**
+         * Bytes that can be pushed before the window is full.
+         */
+        std::size_t space() const;
+
+        void push(const std::byte *data, std::size_t size);
+
+        /**
+         * The window is full and the producer stops reading: hook is called (by the consumer, with the
+         * stream locked) once it can go on.
+         * @return false if there is space again already, the producer must go on by itself.
+         */
+        bool pause();
+
+        /**
+         * Called when paused and space is available again. Must be reset before the producer goes away.
+         */
+        void onResume(std::function<void()> hook);
+
+        void finish();
+
+        void fail();
+    };
+
+    /**
+     * Streamed body of the request given to the Net callback, nullptr when the request holds its whole body.
+     * @param info NetInfo given by the Net implementation.
+     */
+    std::shared_ptr<BodyStream> bodyStreamOf(const zia::api::NetInfo &info);
+
+}
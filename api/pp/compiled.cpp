@@ -0,0 +1,232 @@
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "compiled.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Lays out the source tree breadth-first per parent: the children of a node get consecutive slots,
+     * reserved before any of them is filled. Sources are std::map based, so map children come sorted.
+     */
+    class CompiledConf::Builder {
+    private:
+        Storage &storage;
+        std::unordered_map<std::string, std::uint32_t> interned{};
+
+        std::uint32_t intern(const std::string &text) {
+            auto found = this->interned.find(text);
+            if (found != this->interned.end())
+                return found->second;
+
+            auto id = static_cast<std::uint32_t>(this->storage.builtStrings.size());
+            this->storage.builtStrings.push_back(Span{static_cast<std::uint32_t>(this->storage.builtChars.size()),
+                                                 static_cast<std::uint32_t>(text.size())});
+            this->storage.builtChars += text;
+            this->interned.emplace(text, id);
+            return id;
+        }
+
+        // Reserve count children for the node at index, slots are accessed by index since they move.
+        std::uint32_t children(std::uint32_t index, Type type, std::size_t count) {
+            auto first = static_cast<std::uint32_t>(this->storage.builtNodes.size());
+            this->storage.builtNodes.resize(this->storage.builtNodes.size() + count, Slot{});
+            auto &slot = this->storage.builtNodes[index];
+            slot.type = type;
+            slot.first = first;
+            slot.size = static_cast<std::uint32_t>(count);
+            return first;
+        }
+
+    public:
+        explicit Builder(Storage &into) : storage{into} {
+            this->storage.builtNodes.push_back(Slot{});
+        }
+
+        void fill(std::uint32_t index, const ConfElem *elem) {
+            if (!elem)
+                return;
+
+            auto &slot = this->storage.builtNodes[index];
+            switch (elem->getType()) {
+                case Type::Empty:
+                    break;
+                case Type::Integer:
+                    slot.type = Type::Integer;
+                    slot.integer = elem->get<long long>();
+                    break;
+                case Type::Double:
+                    slot.type = Type::Double;
+                    slot.number = elem->get<double>();
+                    break;
+                case Type::Boolean:
+                    slot.type = Type::Boolean;
+                    slot.boolean = elem->get<bool>();
+                    break;
+                case Type::String:
+                    slot.type = Type::String;
+                    slot.first = this->intern(elem->get<std::string>());
+                    break;
+                case Type::Map: {
+                    const auto &elems = std::get<ConfMap::Sptr>(elem->getValue())->elems;
+                    auto child = this->children(index, Type::Map, elems.size());
+                    for (const auto &item : elems) {
+                        this->storage.builtNodes[child].key = this->intern(item.first);
+                        this->fill(child++, item.second.get());
+                    }
+                    break;
+                }
+                case Type::Array: {
+                    const auto &elems = std::get<ConfArray::Sptr>(elem->getValue())->elems;
+                    auto child = this->children(index, Type::Array, elems.size());
+                    for (const auto &item : elems)
+                        this->fill(child++, item.get());
+                    break;
+                }
+            }
+        }
+
+        void fill(std::uint32_t index, const zia::api::ConfObject &object) {
+            auto child = this->children(index, Type::Map, object.size());
+            for (const auto &item : object) {
+                this->storage.builtNodes[child].key = this->intern(item.first);
+                this->fill(child++, item.second);
+            }
+        }
+
+        void fill(std::uint32_t index, const zia::api::ConfValue &value) {
+            std::visit([this, index](const auto &v) {
+                using T = std::decay_t<decltype(v)>;
+                auto &slot = this->storage.builtNodes[index];
+
+                if constexpr (std::is_same_v<T, long long>) {
+                    slot.type = Type::Integer;
+                    slot.integer = v;
+                } else if constexpr (std::is_same_v<T, double>) {
+                    slot.type = Type::Double;
+                    slot.number = v;
+                } else if constexpr (std::is_same_v<T, bool>) {
+                    slot.type = Type::Boolean;
+                    slot.boolean = v;
+                } else if constexpr (std::is_same_v<T, std::string>) {
+                    slot.type = Type::String;
+                    slot.first = this->intern(v);
+                } else if constexpr (std::is_same_v<T, zia::api::ConfObject>) {
+                    this->fill(index, v);
+                } else if constexpr (std::is_same_v<T, zia::api::ConfArray>) {
+                    auto child = this->children(index, Type::Array, v.size());
+                    for (const auto &item : v)
+                        this->fill(child++, item);
+                }
+            }, value.v);
+        }
+
+        void finish() {
+            this->storage.builtNodes.shrink_to_fit();
+            this->storage.builtStrings.shrink_to_fit();
+            this->storage.builtChars.shrink_to_fit();
+            this->storage.nodes = this->storage.builtNodes.data();
+            this->storage.strings = this->storage.builtStrings.data();
+            this->storage.chars = this->storage.builtChars.data();
+            this->storage.nodeCount = static_cast<std::uint32_t>(this->storage.builtNodes.size());
+            this->storage.stringCount = static_cast<std::uint32_t>(this->storage.builtStrings.size());
+            this->storage.charsSize = this->storage.builtChars.size();
+        }
+    };
+
+    CompiledConf::CompiledConf() {
+        auto storage = std::make_shared<Storage>();
+        Builder(*storage).finish();
+        this->storage = std::move(storage);
+    }
+
+    CompiledConf::CompiledConf(const ConfElem &conf) {
+        auto storage = std::make_shared<Storage>();
+        Builder builder(*storage);
+        builder.fill(0, &conf);
+        builder.finish();
+        this->storage = std::move(storage);
+    }
+
+    CompiledConf::CompiledConf(const zia::api::Conf &conf) {
+        auto storage = std::make_shared<Storage>();
+        Builder builder(*storage);
+        builder.fill(0, conf);
+        builder.finish();
+        this->storage = std::move(storage);
+    }
+
+    std::size_t CompiledConf::memoryUsage() const {
+        return sizeof(Storage) + this->storage->builtNodes.capacity() * sizeof(Slot) +
+               this->storage->builtStrings.capacity() * sizeof(Span) + this->storage->builtChars.capacity() +
+               this->storage->mappingSize;
+    }
+
+    CompiledConf::Node CompiledConf::Node::operator[](int index) const {
+        if (auto found = this->find(index))
+            return *found;
+        throw InvalidAccess();
+    }
+
+    std::optional<CompiledConf::Node> CompiledConf::Node::find(int index) const {
+        const auto &slot = this->slot();
+        if (slot.type != Type::Array || index < 0 || static_cast<std::uint32_t>(index) >= slot.size)
+            return std::nullopt;
+        return Node(this->storage, slot.first + static_cast<std::uint32_t>(index));
+    }
+
+    std::uint32_t CompiledConf::Node::locate(std::string_view key) const {
+        const auto &slot = this->slot();
+        if (slot.type != Type::Map)
+            return this->index;
+
+        auto begin = this->storage->nodes + slot.first;
+        auto end = begin + slot.size;
+        auto found = std::lower_bound(begin, end, key, [this](const Slot &child, std::string_view name) {
+            return this->storage->string(child.key) < name;
+        });
+        if (found == end || this->storage->string(found->key) != key)
+            return this->index;
+        return static_cast<std::uint32_t>(found - this->storage->nodes);
+    }
+
+    CompiledConf::Node CompiledConf::Node::operator[](std::string_view key) const {
+        auto found = this->locate(key);
+        if (found == this->index)
+            throw InvalidAccess();
+        return Node(this->storage, found);
+    }
+
+    std::optional<CompiledConf::Node> CompiledConf::Node::find(std::string_view key) const {
+        auto found = this->locate(key);
+        if (found == this->index)
+            return std::nullopt;
+        return Node(this->storage, found);
+    }
+
+    bool CompiledConf::Node::contains(std::string_view key) const {
+        return this->locate(key) != this->index;
+    }
+
+    CompiledConf::Variant CompiledConf::Node::getValue() const {
+        const auto &slot = this->slot();
+        switch (slot.type) {
+            case Type::Map:
+                return Map(this->storage, slot.first, slot.size);
+            case Type::Array:
+                return Array(this->storage, slot.first, slot.size);
+            case Type::String:
+                return this->storage->string(slot.first);
+            case Type::Integer:
+                return slot.integer;
+            case Type::Double:
+                return slot.number;
+            case Type::Boolean:
+                return slot.boolean;
+            default:
+                return std::monostate();
+        }
+    }
+
+}
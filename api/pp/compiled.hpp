@@ -0,0 +1,432 @@
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "../conf.h"
+#include "conf.hpp"
+#include "visitor.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Frozen configuration, compiled once from a ConfElem or a zia::api::Conf, for configurations
+     * read on every request.
+     *
+     * Every node is a fixed-size slot of one contiguous array, the children of a map or an array being
+     * consecutive slots, map children sorted by key so that lookups are binary searches. Keys and
+     * strings are interned in one character buffer. There is no per-node allocation nor reference
+     * count: a copy of a CompiledConf shares the whole tree.
+     *
+     * Reading works like ConfElem (operator[], get_at, get<T>, getType, visit), through Node handles
+     * which are only valid while a CompiledConf of the tree exists.
+     */
+    class CompiledConf {
+    public:
+        using Type = ConfElem::Type;
+        using InvalidAccess = ConfElem::InvalidAccess;
+
+        class Node;
+        class Map;
+        class Array;
+
+        /**
+         * Alternative given to visitors: strings are views into the interned buffer, maps and arrays
+         * are ranges of children.
+         */
+        using Variant = std::variant<std::monostate, Map, Array, std::string_view, long long, double, bool>;
+
+    private:
+        struct Slot {
+            union {
+                long long integer;
+                double number;
+                bool boolean;
+                std::uint32_t first; // String: interned id, Map and Array: index of the first child.
+            };
+            std::uint32_t key; // Interned id of the key in the parent map.
+            std::uint32_t size; // Map and Array: number of children.
+            Type type;
+        };
+
+        struct Span {
+            std::uint32_t offset;
+            std::uint32_t length;
+        };
+
+        /**
+         * The tree is read through the pointers, into the built vectors or into a mapped snapshot.
+         */
+        struct Storage {
+            const Slot *nodes = nullptr;
+            const Span *strings = nullptr;
+            const char *chars = nullptr;
+            std::uint32_t nodeCount = 0;
+            std::uint32_t stringCount = 0;
+            std::size_t charsSize = 0;
+
+            std::vector<Slot> builtNodes{};
+            std::vector<Span> builtStrings{};
+            std::string builtChars{};
+
+            std::shared_ptr<const void> mapping{}; // Keeps the snapshot mapped, if any.
+            std::size_t mappingSize = 0;
+
+            std::string_view string(std::uint32_t id) const {
+                return {this->chars + this->strings[id].offset, this->strings[id].length};
+            }
+        };
+
+        class Builder;
+        class Snapshot;
+
+        std::shared_ptr<const Storage> storage;
+
+    public:
+        /**
+         * A node of the tree, cheap to copy.
+         */
+        class Node {
+        private:
+            const Storage *storage;
+            std::uint32_t index;
+
+            const Slot &slot() const {
+                return this->storage->nodes[this->index];
+            }
+
+            const Slot &expect(Type type) const {
+                const auto &slot = this->slot();
+                if (slot.type != type)
+                    throw InvalidAccess();
+                return slot;
+            }
+
+            // Index of the child named key, or the index of the node itself if there is none.
+            std::uint32_t locate(std::string_view key) const;
+
+            template<typename T>
+            static constexpr Type typeOf() {
+                if constexpr (std::is_same_v<T, bool>)
+                    return Type::Boolean;
+                else if constexpr (std::is_integral_v<T>)
+                    return Type::Integer;
+                else if constexpr (std::is_floating_point_v<T>)
+                    return Type::Double;
+                else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>)
+                    return Type::String;
+                else
+                    static_assert(std::is_same_v<T, bool>, "CompiledConf holds no such type");
+            }
+
+            friend class CompiledConf;
+
+        public:
+            Node(const Storage *from, std::uint32_t at) : storage{from}, index{at} {}
+
+            Type getType() const {
+                return this->slot().type;
+            }
+
+            /**
+             * Same types as ConfElem::get, plus std::string_view to read a string without copying it.
+             * @throw InvalidAccess if the node does not hold a T.
+             */
+            template<typename T>
+            T get() const {
+                const auto &slot = this->expect(typeOf<T>());
+                if constexpr (std::is_same_v<T, bool>)
+                    return slot.boolean;
+                else if constexpr (std::is_integral_v<T>)
+                    return static_cast<T>(slot.integer);
+                else if constexpr (std::is_floating_point_v<T>)
+                    return static_cast<T>(slot.number);
+                else
+                    return T(this->storage->string(slot.first));
+            }
+
+            /**
+             * Same as get, without throwing.
+             * @return std::nullopt if the node does not hold a T.
+             */
+            template<typename T>
+            std::optional<T> try_get() const {
+                if (this->getType() != typeOf<T>())
+                    return std::nullopt;
+                return this->get<T>();
+            }
+
+            /**
+             * Number of children of a map or an array, 0 otherwise.
+             */
+            std::size_t size() const {
+                const auto &slot = this->slot();
+                return slot.type == Type::Map || slot.type == Type::Array ? slot.size : 0;
+            }
+
+            /**
+             * @throw InvalidAccess if the node is not an array or index is out of range.
+             */
+            Node operator[](int index) const;
+
+            /**
+             * @throw InvalidAccess if the node is not a map or has no such key.
+             */
+            Node operator[](std::string_view key) const;
+
+            Node operator[](const char *key) const {
+                return (*this)[std::string_view(key)];
+            }
+
+            Node get_at(int index) const {
+                return (*this)[index];
+            }
+
+            Node get_at(std::string_view key) const {
+                return (*this)[key];
+            }
+
+            /**
+             * Child at index of an array, without throwing.
+             * @return std::nullopt if the node is not an array or index is out of range.
+             */
+            std::optional<Node> find(int index) const;
+
+            /**
+             * Child at key of a map, without throwing.
+             * @return std::nullopt if the node is not a map or has no such key.
+             */
+            std::optional<Node> find(std::string_view key) const;
+
+            /**
+             * @return false if the node is not a map or has no such key, instead of throwing.
+             */
+            bool contains(std::string_view key) const;
+
+            /**
+             * The value of the node for std::visit.
+             */
+            Variant getValue() const;
+
+            /**
+             * Same as ConfElem::visit: visitors take the recursion function then one of the Variant types.
+             */
+            template<typename TReturn = void, typename ...TVisitors>
+            decltype(auto) visit(TVisitors &&...visitors) const;
+        };
+
+        /**
+         * Children of a map node, as (key, node) pairs sorted by key.
+         */
+        class Map {
+        private:
+            const Storage *storage;
+            std::uint32_t first;
+            std::uint32_t count;
+
+        public:
+            class iterator {
+            private:
+                const Storage *storage;
+                std::uint32_t index;
+
+            public:
+                iterator(const Storage *from, std::uint32_t at) : storage{from}, index{at} {}
+
+                std::pair<std::string_view, Node> operator*() const {
+                    return {this->storage->string(this->storage->nodes[this->index].key), Node(this->storage, this->index)};
+                }
+
+                iterator &operator++() {
+                    ++this->index;
+                    return *this;
+                }
+
+                bool operator!=(const iterator &other) const {
+                    return this->index != other.index;
+                }
+            };
+
+            Map(const Storage *from, std::uint32_t begin, std::uint32_t size)
+                    : storage{from}, first{begin}, count{size} {}
+
+            iterator begin() const {
+                return iterator(this->storage, this->first);
+            }
+
+            iterator end() const {
+                return iterator(this->storage, this->first + this->count);
+            }
+
+            std::size_t size() const {
+                return this->count;
+            }
+        };
+
+        /**
+         * Children of an array node.
+         */
+        class Array {
+        private:
+            const Storage *storage;
+            std::uint32_t first;
+            std::uint32_t count;
+
+        public:
+            class iterator {
+            private:
+                const Storage *storage;
+                std::uint32_t index;
+
+            public:
+                iterator(const Storage *from, std::uint32_t at) : storage{from}, index{at} {}
+
+                Node operator*() const {
+                    return Node(this->storage, this->index);
+                }
+
+                iterator &operator++() {
+                    ++this->index;
+                    return *this;
+                }
+
+                bool operator!=(const iterator &other) const {
+                    return this->index != other.index;
+                }
+            };
+
+            Array(const Storage *from, std::uint32_t begin, std::uint32_t size)
+                    : storage{from}, first{begin}, count{size} {}
+
+            iterator begin() const {
+                return iterator(this->storage, this->first);
+            }
+
+            iterator end() const {
+                return iterator(this->storage, this->first + this->count);
+            }
+
+            std::size_t size() const {
+                return this->count;
+            }
+
+            Node operator[](std::size_t index) const {
+                return Node(this->storage, this->first + static_cast<std::uint32_t>(index));
+            }
+        };
+
+        /**
+         * An empty configuration.
+         */
+        CompiledConf();
+
+        explicit CompiledConf(const ConfElem &conf);
+
+        explicit CompiledConf(const zia::api::Conf &conf);
+
+        Node root() const {
+            return Node(this->storage.get(), 0);
+        }
+
+        Type getType() const {
+            return this->root().getType();
+        }
+
+        template<typename T>
+        T get() const {
+            return this->root().get<T>();
+        }
+
+        Node operator[](int index) const {
+            return this->root()[index];
+        }
+
+        Node operator[](std::string_view key) const {
+            return this->root()[key];
+        }
+
+        Node operator[](const char *key) const {
+            return this->root()[std::string_view(key)];
+        }
+
+        Node get_at(int index) const {
+            return this->root()[index];
+        }
+
+        Node get_at(std::string_view key) const {
+            return this->root()[key];
+        }
+
+        std::optional<Node> find(int index) const {
+            return this->root().find(index);
+        }
+
+        std::optional<Node> find(std::string_view key) const {
+            return this->root().find(key);
+        }
+
+        bool contains(std::string_view key) const {
+            return this->root().contains(key);
+        }
+
+        Variant getValue() const {
+            return this->root().getValue();
+        }
+
+        template<typename TReturn = void, typename ...TVisitors>
+        decltype(auto) visit(TVisitors &&...visitors) const {
+            return this->root().visit<TReturn>(std::forward<TVisitors>(visitors)...);
+        }
+
+        /**
+         * Nodes in the tree, the root included.
+         */
+        std::size_t nodeCount() const {
+            return this->storage->nodeCount;
+        }
+
+        /**
+         * Bytes used by the tree, mapped ones included.
+         */
+        std::size_t memoryUsage() const;
+
+        /**
+         * Write the tree to path as a binary snapshot, which mapSnapshot() reads in place.
+         * The file holds no pointer, only indexes, behind a header with a format version and a checksum.
+         * It is written next to path then renamed, so readers never see it half written.
+         *
+         * @param source Stamp of what the tree was compiled from, e.g. sourceStamp() of a JSON file.
+         * @throw std::runtime_error if the file cannot be written.
+         */
+        void saveSnapshot(const std::string &path, std::uint64_t source = 0) const;
+
+        /**
+         * Map a snapshot written by saveSnapshot, without parsing nor copying it: processes mapping the
+         * same file share its pages.
+         *
+         * @param source If not 0, the snapshot is only used if it was saved with the same stamp.
+         * @return std::nullopt if the file is missing, corrupted, of another format version or stale.
+         */
+        static std::optional<CompiledConf> mapSnapshot(const std::string &path, std::uint64_t source = 0);
+
+        /**
+         * Whether the tree is read from a mapped snapshot.
+         */
+        bool mapped() const {
+            return this->storage->mapping != nullptr;
+        }
+    };
+
+    template<typename TReturn, typename ...TVisitors>
+    decltype(auto) CompiledConf::Node::visit(TVisitors &&...visitors) const {
+        auto recVisit = make_recursive_visitor<TReturn>(std::forward<TVisitors>(visitors)...);
+        return std::visit(recVisit, this->getValue());
+    }
+
+}
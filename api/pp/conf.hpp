@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <memory>
+#include <optional>
 #include "../conf.h"
 #include "visitor.hpp"
 
@@ -172,11 +173,55 @@ namespace zia::apipp {
          */
         template<typename T>
         T get() const {
-            try {
-                return std::get<T>(value);
-            } catch (std::bad_variant_access &) {
-                throw InvalidAccess();
-            }
+            if (auto *stored = std::get_if<T>(&value))
+                return *stored;
+            throw InvalidAccess();
+        }
+
+        /**
+         * Get the value stored in the std::variant, without throwing.
+         *
+         * @tparam T same types as get().
+         * @return std::nullopt if the value is not a T.
+         */
+        template<typename T>
+        std::optional<T> try_get() const {
+            if (auto *stored = std::get_if<T>(&value))
+                return *stored;
+            return std::nullopt;
+        }
+
+        /**
+         * Element at index of a ConfArray, without throwing.
+         *
+         * @return nullptr if the value is not a ConfArray or index is out of range.
+         */
+        const ConfElem *find(const int index) const {
+            auto *array = std::get_if<ConfArray::Sptr>(&value);
+            if (!array || !*array || index < 0 || static_cast<std::size_t>(index) >= (*array)->elems.size())
+                return nullptr;
+            return (*array)->elems[index].get();
+        }
+
+        ConfElem *find(const int index) {
+            return const_cast<ConfElem *>(static_cast<const ConfElem &>(*this).find(index));
+        }
+
+        /**
+         * Element at key of a ConfMap, without throwing.
+         *
+         * @return nullptr if the value is not a ConfMap or has no such key.
+         */
+        const ConfElem *find(const std::string &key) const {
+            auto *map = std::get_if<ConfMap::Sptr>(&value);
+            if (!map || !*map)
+                return nullptr;
+            auto found = (*map)->elems.find(key);
+            return found == (*map)->elems.end() ? nullptr : found->second.get();
+        }
+
+        ConfElem *find(const std::string &key) {
+            return const_cast<ConfElem *>(static_cast<const ConfElem &>(*this).find(key));
         }
 
         ConfElem &get_at(const int index) {
@@ -368,12 +413,9 @@ namespace zia::apipp {
          * @return
          */
         ConfElem &operator[](const int index) {
-            try {
-                return *(std::get<ConfArray::Sptr>(value))->elems.at(index);
-            } catch (std::exception &) {
-//                std::cout << e.what() << std::endl;
-                throw InvalidAccess();
-            }
+            if (auto *elem = find(index))
+                return *elem;
+            throw InvalidAccess();
         }
 
 		/**
@@ -385,12 +427,9 @@ namespace zia::apipp {
 		* @return
 		*/
         const ConfElem &operator[](const int index) const {
-            try {
-                return *(std::get<ConfArray::Sptr>(value))->elems.at(index);
-            } catch (std::exception &) {
-//                std::cout << e.what() << std::endl;
-                throw InvalidAccess();
-            }
+            if (auto *elem = find(index))
+                return *elem;
+            throw InvalidAccess();
         }
 
         /**
@@ -402,12 +441,9 @@ namespace zia::apipp {
          * @return
          */
         ConfElem &operator[](const std::string &index) {
-            try {
-                return *(std::get<ConfMap::Sptr>(value))->elems.at(index);
-            } catch (std::exception &) {
-//                std::cout << e.what() << std::endl;
-                throw InvalidAccess();
-            }
+            if (auto *elem = find(index))
+                return *elem;
+            throw InvalidAccess();
         }
 
 		/**
@@ -419,12 +455,9 @@ namespace zia::apipp {
 		* @return
 		*/
         const ConfElem &operator[](const std::string &index) const {
-            try {
-                return *(std::get<ConfMap::Sptr>(value))->elems.at(index);
-            } catch (std::exception &) {
-//                std::cout << e.what() << std::endl;
-                throw InvalidAccess();
-            }
+            if (auto *elem = find(index))
+                return *elem;
+            throw InvalidAccess();
         }
 
         /**
@@ -510,6 +543,7 @@ namespace zia::apipp {
 
     /**
      * Serialize a SZA++ Configuration for display/testing purposes.
+     * Written as pretty JSON, see writeJson.
      * @param os Output stream
      * @param conf
      * @return
@@ -518,6 +552,7 @@ namespace zia::apipp {
 
     /**
      * Serialize a SZA Configuration for display/testing purposes.
+     * Written as pretty JSON, see writeJson.
      * @param os Output stream
      * @param conf An element of the configuration.
      * @return
@@ -544,5 +579,17 @@ namespace zia::apipp {
         return static_cast<float>(get<double>());
     }
 
+    template<>
+    inline std::optional<int> ConfElem::try_get<int>() const {
+        auto value = try_get<long long>();
+        return value ? std::optional<int>(static_cast<int>(*value)) : std::nullopt;
+    }
+
+    template<>
+    inline std::optional<float> ConfElem::try_get<float>() const {
+        auto value = try_get<double>();
+        return value ? std::optional<float>(static_cast<float>(*value)) : std::nullopt;
+    }
+
     using Conf = ConfElem;
 }
\ No newline at end of file
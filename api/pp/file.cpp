@@ -0,0 +1,107 @@
+#include <cerrno>
+
+#include "file.hpp"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+
+#include <climits>
+#include <mutex>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zia::apipp {
+
+    namespace {
+#ifdef _WIN32
+        // The CRT has no pread: seeking then reading must not be interleaved with another read of the fd.
+        std::mutex seekLock;
+
+        int openRegular(const std::string &path, std::uint64_t &size) {
+            auto fd = ::_open(path.c_str(), _O_RDONLY | _O_BINARY | _O_NOINHERIT);
+            if (fd < 0)
+                return -1;
+
+            struct _stat64 info{};
+            if (::_fstat64(fd, &info) < 0 || !(info.st_mode & _S_IFREG)) {
+                ::_close(fd);
+                return -1;
+            }
+            size = static_cast<std::uint64_t>(info.st_size);
+            return fd;
+        }
+
+        void closeFile(int fd) {
+            ::_close(fd);
+        }
+
+        long long readAt(int fd, std::byte *dest, std::uint64_t count, std::uint64_t offset) {
+            std::lock_guard<std::mutex> guard(seekLock);
+            if (::_lseeki64(fd, static_cast<long long>(offset), SEEK_SET) < 0)
+                return -1;
+            return ::_read(fd, dest, static_cast<unsigned>(count < INT_MAX ? count : INT_MAX));
+        }
+#else
+        int openRegular(const std::string &path, std::uint64_t &size) {
+            auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return -1;
+
+            struct stat info{};
+            if (::fstat(fd, &info) < 0 || !S_ISREG(info.st_mode)) {
+                ::close(fd);
+                return -1;
+            }
+            size = static_cast<std::uint64_t>(info.st_size);
+            return fd;
+        }
+
+        void closeFile(int fd) {
+            ::close(fd);
+        }
+
+        long long readAt(int fd, std::byte *dest, std::uint64_t count, std::uint64_t offset) {
+            return ::pread(fd, dest, count, static_cast<off_t>(offset));
+        }
+#endif
+    }
+
+    std::shared_ptr<const zia::api::FileBody> openFile(const std::string &path) {
+        std::uint64_t size = 0;
+        auto fd = openRegular(path, size);
+        if (fd < 0)
+            return nullptr;
+        return fileBody(fd, 0, size);
+    }
+
+    std::shared_ptr<const zia::api::FileBody> fileBody(int fd, std::uint64_t offset, std::uint64_t length) {
+        return std::shared_ptr<const zia::api::FileBody>(new zia::api::FileBody{fd, offset, length},
+                                                         [](const zia::api::FileBody *file) {
+                                                             closeFile(file->fd);
+                                                             delete file;
+                                                         });
+    }
+
+    bool readFile(const zia::api::FileBody &file, zia::api::Net::Raw &dest) {
+        auto start = dest.size();
+        dest.resize(start + file.length);
+
+        for (std::uint64_t done = 0; done < file.length;) {
+            auto n = readAt(file.fd, dest.data() + start + done, file.length - done, file.offset + done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                dest.resize(start + done);
+                return false;
+            }
+            done += static_cast<std::uint64_t>(n);
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,29 @@
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "../http.h"
+
+namespace zia::apipp {
+
+    /**
+     * Open path as a response body.
+     * @return nullptr if it cannot be opened or is not a regular file.
+     */
+    std::shared_ptr<const zia::api::FileBody> openFile(const std::string &path);
+
+    /**
+     * Body of length bytes of fd from offset. Takes ownership of fd: it is closed with the last reference.
+     */
+    std::shared_ptr<const zia::api::FileBody> fileBody(int fd, std::uint64_t offset, std::uint64_t length);
+
+    /**
+     * Read the bytes of file into memory, appended to dest, for code that needs them.
+     * @return false on read error, or if the file is shorter than the body.
+     */
+    bool readFile(const zia::api::FileBody &file, zia::api::Net::Raw &dest);
+
+}
@@ -2,113 +2,445 @@
 #pragma once
 
 #include <memory>
-#include <sstream>
+#include <memory_resource>
+#include <string_view>
 #include <utility>
 #include <algorithm>
 #include <utility>
 #include "../http.h"
+#include "body.hpp"
+#include "file.hpp"
 
 namespace zia::apipp {
 
-    class Request {
+    /**
+     * Non-owning view over contiguous bytes, used where std::span<const std::byte> would be in C++20.
+     */
+    class ByteView {
     private:
+        const std::byte *ptr = nullptr;
+        std::size_t len = 0;
+
+    public:
+        constexpr ByteView() noexcept = default;
+
+        constexpr ByteView(const std::byte *data, std::size_t size) noexcept : ptr{data}, len{size} {}
+
+        ByteView(const zia::api::Net::Raw &raw) noexcept : ptr{raw.data()}, len{raw.size()} {}
+
+        explicit ByteView(std::string_view str) noexcept
+                : ptr{reinterpret_cast<const std::byte *>(str.data())}, len{str.size()} {}
+
+        constexpr const std::byte *data() const noexcept { return ptr; }
+
+        constexpr std::size_t size() const noexcept { return len; }
+
+        constexpr bool empty() const noexcept { return len == 0; }
+
+        constexpr const std::byte *begin() const noexcept { return ptr; }
+
+        constexpr const std::byte *end() const noexcept { return ptr + len; }
+
+        constexpr const std::byte &operator[](std::size_t index) const noexcept { return ptr[index]; }
+
+        std::string_view toStringView() const noexcept {
+            return {reinterpret_cast<const char *>(ptr), len};
+        }
+
+        zia::api::Net::Raw toRaw() const {
+            return zia::api::Net::Raw(begin(), end());
+        }
+    };
+
+    /**
+     * Tag used to build a Request or a Response as a non-owning view of an HttpDuplex.
+     * The body is borrowed from the duplex and only copied when a module mutates it,
+     * the duplex must therefore outlive the view (or the view must be applied back to it).
+     */
+    struct ViewTag {
+        explicit ViewTag() = default;
+    };
+
+    inline constexpr ViewTag asView{};
+
+    namespace detail {
+        using SplitHeaders = zia::api::HeaderMap<std::pmr::vector<std::string>>;
+        using BasicHeaders = zia::api::HeaderMap<std::string>;
+
+        // Transform basic "a,b" values to one value per element
+        inline SplitHeaders splitHeaders(const BasicHeaders &basicHeaders,
+                                         std::pmr::memory_resource *memory = std::pmr::get_default_resource()) {
+            SplitHeaders headers(memory);
+
+            for (const auto &item : basicHeaders) {
+                std::string_view value = item.second;
+                if (value.empty())
+                    continue;
+                auto &values = headers.entry(item.id, item.first);
+                for (std::size_t pos = 0; pos < value.size();) {
+                    auto comma = std::min(value.find(',', pos), value.size());
+                    values.emplace_back(value.substr(pos, comma - pos));
+                    pos = comma + 1;
+                }
+            }
+            return headers;
+        }
+
+        // Transform one value per element back to basic "a, b" values
+        inline BasicHeaders joinHeaders(const SplitHeaders &headers,
+                                        std::pmr::memory_resource *memory = std::pmr::get_default_resource()) {
+            BasicHeaders basicHeaders(memory);
+
+            for (const auto &item : headers) {
+                auto &joined = basicHeaders.entry(item.id, item.first);
+                for (const auto &value: item.second) {
+                    if (&value != &item.second.front())
+                        joined += ", ";
+                    joined += value;
+                }
+            }
+            return basicHeaders;
+        }
+
+        // Same as above, written over basicHeaders: the values it already has keep their storage
+        inline void joinHeaders(const SplitHeaders &headers, BasicHeaders &basicHeaders) {
+            for (auto it = basicHeaders.begin(); it != basicHeaders.end();) {
+                if (headers.count(it->first))
+                    ++it;
+                else
+                    it = basicHeaders.erase(it);
+            }
+            for (const auto &item : headers) {
+                auto &joined = basicHeaders.entry(item.id, item.first);
+                joined.clear();
+                for (const auto &value: item.second) {
+                    if (&value != &item.second.front())
+                        joined += ", ";
+                    joined += value;
+                }
+            }
+        }
+
+        inline std::string_view asChars(const zia::api::Net::Raw &raw) {
+            return {reinterpret_cast<const char *>(raw.data()), raw.size()};
+        }
+
+        inline void assignBytes(zia::api::Net::Raw &dest, std::string_view src) {
+            auto bytes = ByteView(src);
+            dest.assign(bytes.begin(), bytes.end());
+        }
+    }
+
+    /**
+     * Body storage shared by Request and Response.
+     *
+     * In owning mode the body lives in "body" (std::string) and "rawBody" (Net::Raw).
+     * In view mode both are empty and the bytes are read from the borrowed duplex buffer,
+     * the owned copy is only made by the first mutable access (copy-on-write).
+     *
+     * A file body (see zia::api::FileBody) is borrowed the same way: it is only read into memory
+     * when its bytes are accessed, otherwise the Net sends it straight from the file.
+     */
+    class Body {
+    private:
+        std::shared_ptr<const zia::api::FileBody> file{};
+        mutable zia::api::Net::Raw fileBytes{};
+        mutable bool fileRead = false;
+
+    protected:
         bool useRawBody = false;
+        const zia::api::Net::Raw *borrowedBody = nullptr;
+        bool ownsBody = true;
+        bool ownsRawBody = true;
+
+        Body() = default;
+
+        Body(std::string body, zia::api::Net::Raw rawBody)
+                : body{std::move(body)}, rawBody{std::move(rawBody)} {}
+
+        explicit Body(const zia::api::Net::Raw &borrowed)
+                : borrowedBody{&borrowed}, ownsBody{false}, ownsRawBody{false} {}
+
+        void borrow(const zia::api::Net::Raw &borrowed) {
+            this->body.clear();
+            this->rawBody.clear();
+            this->borrowedBody = &borrowed;
+            this->ownsBody = false;
+            this->ownsRawBody = false;
+            this->file.reset();
+            this->fileBytes.clear();
+            this->fileRead = false;
+        }
+
+        void borrowFile(std::shared_ptr<const zia::api::FileBody> borrowed) {
+            this->borrow(this->fileBytes);
+            this->borrowedBody = nullptr;
+            this->file = std::move(borrowed);
+        }
+
+        // Bytes viewed when the body is not owned, the file is read on first access.
+        const zia::api::Net::Raw &borrowed() const {
+            if (!this->file)
+                return *this->borrowedBody;
+            if (!this->fileRead) {
+                readFile(*this->file, this->fileBytes);
+                this->fileRead = true;
+            }
+            return this->fileBytes;
+        }
+
+        // Write the active body into dest, nothing is copied if dest is the buffer we are viewing.
+        void applyBodyTo(zia::api::Net::Raw &dest) {
+            if (this->useRawBody) {
+                if (this->ownsRawBody)
+                    dest = std::move(this->rawBody);
+                else if (this->borrowedBody != &dest)
+                    dest = this->borrowed();
+            } else {
+                if (this->ownsBody)
+                    detail::assignBytes(dest, this->body);
+                else if (this->borrowedBody != &dest)
+                    dest = this->borrowed();
+            }
+            this->borrow(dest);
+        }
 
     public:
-        const zia::api::http::Version version{};
-        std::map<std::string, std::vector<std::string>> headers;
+        /**
+         * Owned bodies: empty while the body is borrowed (see isView()), bodyView() reads it either way.
+         */
         std::string body{};
         zia::api::Net::Raw rawBody{};
+
+        /**
+         * @return true while the body is still borrowed from a duplex and has not been copied.
+         */
+        bool isView() const {
+            return this->useRawBody ? !this->ownsRawBody : !this->ownsBody;
+        }
+
+        /**
+         * The file the active body is sent from, nullptr if it is in memory (or was modified).
+         */
+        std::shared_ptr<const zia::api::FileBody> fileBody() const {
+            return this->isView() ? this->file : nullptr;
+        }
+
+        /**
+         * Read-only access to the active body (standard or raw) without copying it.
+         */
+        std::string_view bodyView() const {
+            if (this->useRawBody)
+                return this->ownsRawBody ? detail::asChars(this->rawBody) : detail::asChars(this->borrowed());
+            return this->ownsBody ? std::string_view(this->body) : detail::asChars(this->borrowed());
+        }
+
+        /**
+         * Read-only access to the active body as bytes without copying it.
+         */
+        ByteView rawBodyView() const {
+            return ByteView(this->bodyView());
+        }
+
+        /**
+         * Mutable access to the standard body, copies the borrowed bytes on first call.
+         */
+        std::string &mutableBody() {
+            if (!this->ownsBody) {
+                this->body.assign(detail::asChars(this->borrowed()));
+                this->ownsBody = true;
+            }
+            return this->body;
+        }
+
+        /**
+         * Mutable access to the raw body, copies the borrowed bytes on first call.
+         */
+        zia::api::Net::Raw &mutableRawBody() {
+            if (!this->ownsRawBody) {
+                this->rawBody = this->borrowed();
+                this->ownsRawBody = true;
+            }
+            return this->rawBody;
+        }
+
+        /**
+         * Copy the borrowed bytes of the active body into its member (body, or rawBody after useRawData()):
+         * it can then be used directly, as by a Module. The other member is only copied by its mutable
+         * accessor. A file body is not read, it stays borrowed (see fileBody()).
+         */
+        void own() {
+            if (this->file)
+                return;
+            if (this->useRawBody)
+                this->mutableRawBody();
+            else
+                this->mutableBody();
+        }
+
+        /**
+         * Take the members written directly while the body was borrowed (they are empty until then) as
+         * the body, e.g. the body of a Module replacing a file body.
+         */
+        void adoptMembers() {
+            if (!this->ownsBody && !this->body.empty())
+                this->ownsBody = true;
+            if (!this->ownsRawBody && !this->rawBody.empty())
+                this->ownsRawBody = true;
+        }
+    };
+
+    class Request : public Body {
+    private:
+        const zia::api::Net::Raw *borrowedInput = nullptr;
+        std::shared_ptr<BodyStream> stream{};
+
+    public:
+        const zia::api::http::Version version{};
+        detail::SplitHeaders headers;
         const zia::api::http::Method method{};
         const std::string uri;
-        const zia::api::Net::Raw inputRawData{}; // Shouldn't be modified
+        const zia::api::Net::Raw inputRawData{}; // Shouldn't be modified, empty in view mode (see inputRaw())
 
         Request(const zia::api::http::Version version, const zia::api::http::Method method, const std::string &uri)
                 : version{version}, method{method}, uri(uri) {}
 
-        explicit Request(const zia::api::HttpDuplex &duplex)
-                : version{duplex.req.version}, rawBody{duplex.req.body},
+        /**
+         * The body still streamed by the Net for duplex, if any, is attached (see bodyStream()).
+         * @param memory where the headers are allocated, see Context::memory.
+         */
+        explicit Request(const zia::api::HttpDuplex &duplex,
+                         std::pmr::memory_resource *memory = std::pmr::get_default_resource())
+                : Body{std::string(detail::asChars(duplex.req.body)), duplex.req.body},
+                  stream{bodyStreamOf(duplex.info)},
+                  version{duplex.req.version}, headers{detail::splitHeaders(duplex.req.headers, memory)},
                   method{duplex.req.method}, uri{duplex.req.uri},
-                  inputRawData{duplex.raw_req} {
-
-            // Transform raw data to standard data
-            std::transform(duplex.req.body.begin(), duplex.req.body.end(), std::back_inserter(this->body),
-                           [](auto c) { return static_cast<char>(c); });
-
-            // Transform basic map<string, string> to map<string, vector<string>>
-            for (const auto &item : duplex.req.headers) {
-                std::stringstream ss(item.second);
-                std::string res;
-                while (std::getline(ss, res, ',')) {
-                    this->headers[item.first].push_back(res);
-                }
-            }
+                  inputRawData{duplex.raw_req} {}
+
+        Request(const zia::api::HttpDuplex &duplex, ViewTag,
+                std::pmr::memory_resource *memory = std::pmr::get_default_resource())
+                : Body{duplex.req.body}, borrowedInput{&duplex.raw_req}, stream{bodyStreamOf(duplex.info)},
+                  version{duplex.req.version}, headers{detail::splitHeaders(duplex.req.headers, memory)},
+                  method{duplex.req.method}, uri{duplex.req.uri} {}
+
+        /**
+         * @param memory where the request and its headers are allocated, see Context::memory.
+         */
+        static std::shared_ptr<Request> fromBasicHttpDuplex(zia::api::HttpDuplex &duplex,
+                                                            std::pmr::memory_resource *memory =
+                                                                    std::pmr::get_default_resource()) {
+            return std::allocate_shared<Request>(std::pmr::polymorphic_allocator<Request>(memory), duplex, memory);
         }
 
-        static std::shared_ptr<Request> fromBasicHttpDuplex(zia::api::HttpDuplex &duplex) {
-            return std::make_shared<Request>(duplex);
+        /**
+         * Build a Request borrowing the body and raw input of the duplex instead of copying them.
+         */
+        static std::shared_ptr<Request> viewBasicHttpDuplex(const zia::api::HttpDuplex &duplex,
+                                                            std::pmr::memory_resource *memory =
+                                                                    std::pmr::get_default_resource()) {
+            return std::allocate_shared<Request>(std::pmr::polymorphic_allocator<Request>(memory), duplex, asView,
+                                                 memory);
         }
 
-        zia::api::HttpRequest toBasicHttpRequest() const {
-            std::map<std::string, std::string> basicHeaders;
+        /**
+         * Raw input data, whether it is owned or borrowed.
+         */
+        ByteView inputRaw() const {
+            return this->borrowedInput ? ByteView(*this->borrowedInput) : ByteView(this->inputRawData);
+        }
 
-            for (const auto &item : this->headers) {
-                for (const auto &value: item.second) {
-                    basicHeaders[item.first] += value + ", ";
-                }
-                auto &tmp = basicHeaders[item.first];
-                basicHeaders[item.first] = tmp.substr(0, tmp.length() - 2);
-            }
+        /**
+         * Body still arriving from the client, to read piece by piece. nullptr when the request holds
+         * the whole body (it was small enough, or it has been buffered).
+         */
+        const std::shared_ptr<BodyStream> &bodyStream() const {
+            return this->stream;
+        }
 
-            if (this->useRawBody) {
-                return zia::api::HttpRequest{this->version, basicHeaders, this->rawBody, this->method, this->uri};
-            } else {
-                std::vector<std::byte> basicBody;
+        /**
+         * Attach the streamed body given by the Net (see bodyStreamOf()), e.g. to keep the one of a request
+         * rebuilt from a duplex after it was buffered.
+         */
+        void setBodyStream(std::shared_ptr<BodyStream> body) {
+            this->stream = std::move(body);
+        }
 
-                std::transform(this->body.begin(), this->body.end(), std::back_inserter(basicBody),
-                               [](auto c) { return static_cast<std::byte>(c); });
+        /**
+         * Full buffering, for modules needing a contiguous body: wait for the rest of a streamed body
+         * and append it to the active body. Nothing to do when the body is not streamed.
+         * \return false if the body could not be received entirely.
+         */
+        bool bufferBody() {
+            if (!this->stream)
+                return true;
+
+            auto body = std::move(this->stream);
+            if (this->useRawBody)
+                return body->readAll(this->mutableRawBody());
+
+            zia::api::Net::Raw rest;
+            auto ret = body->readAll(rest);
+            this->mutableBody().append(detail::asChars(rest));
+            return ret;
+        }
 
-                return zia::api::HttpRequest{this->version, basicHeaders, basicBody, this->method, this->uri};
-            }
+        zia::api::HttpRequest toBasicHttpRequest(std::pmr::memory_resource *memory =
+                std::pmr::get_default_resource()) const {
+            return zia::api::HttpRequest{this->version, detail::joinHeaders(this->headers, memory),
+                                         this->rawBodyView().toRaw(), this->method, this->uri};
+        }
+
+        /**
+         * Write the request back into duplex.req, moving owned data instead of copying it.
+         * Afterwards, the request is a view of duplex.
+         */
+        void applyTo(zia::api::HttpDuplex &duplex) {
+            duplex.req.version = this->version;
+            detail::joinHeaders(this->headers, duplex.req.headers);
+            duplex.req.method = this->method;
+            duplex.req.uri = this->uri;
+            this->applyBodyTo(duplex.req.body);
         }
     };
 
-    class Response {
+    class Response : public Body {
     private:
-        bool useRawBody = false;
+        const zia::api::Net::Raw *borrowedOutput = nullptr;
 
     public:
         const zia::api::http::Version version{};
-        std::map<std::string, std::vector<std::string>> headers;
-        std::string body{};
-        zia::api::Net::Raw rawBody{};
+        detail::SplitHeaders headers;
         int statusCode{0};
         std::string statusReason{};
-        const zia::api::Net::Raw outputRawData{}; // Shouldn't be modified
-
-        explicit Response(const Request &request) : version{request.version} {}
-
-        explicit Response(const zia::api::HttpDuplex &duplex)
-                : version{duplex.resp.version},
-                  headers{},
-                  body{},
-                  rawBody{duplex.resp.body},
+        const zia::api::Net::Raw outputRawData{}; // Shouldn't be modified, empty in view mode (see outputRaw())
+
+        explicit Response(const Request &request) : version{request.version}, headers{request.headers.resource()} {}
+
+        /**
+         * @param memory where the headers are allocated, see Context::memory.
+         */
+        explicit Response(const zia::api::HttpDuplex &duplex,
+                          std::pmr::memory_resource *memory = std::pmr::get_default_resource())
+                : Body{std::string(detail::asChars(duplex.resp.body)), duplex.resp.body},
+                  version{duplex.resp.version},
+                  headers{detail::splitHeaders(duplex.resp.headers, memory)},
                   statusCode{duplex.resp.status},
                   statusReason{duplex.resp.reason},
                   outputRawData{duplex.raw_resp} {
+            if (duplex.resp.file)
+                this->borrowFile(duplex.resp.file);
+        }
 
-            // Transform raw data to standard data
-            std::transform(duplex.resp.body.begin(), duplex.resp.body.end(), std::back_inserter(this->body),
-                           [](auto c) { return static_cast<char>(c); });
-
-            // Transform basic map<string, string> to map<string, vector<string>>
-            for (const auto &item : duplex.resp.headers) {
-                std::stringstream ss(item.second);
-                std::string res;
-                while (std::getline(ss, res, ',')) {
-                    this->headers[item.first].push_back(res);
-                }
-            }
+        Response(const zia::api::HttpDuplex &duplex, ViewTag,
+                 std::pmr::memory_resource *memory = std::pmr::get_default_resource())
+                : Body{duplex.resp.body},
+                  borrowedOutput{&duplex.raw_resp},
+                  version{duplex.resp.version},
+                  headers{detail::splitHeaders(duplex.resp.headers, memory)},
+                  statusCode{duplex.resp.status},
+                  statusReason{duplex.resp.reason} {
+            if (duplex.resp.file)
+                this->borrowFile(duplex.resp.file);
         }
 
         Response *useRawData() {
@@ -122,17 +454,29 @@ namespace zia::apipp {
         }
 
         Response *setStandardData(const std::string &data) {
+            // The previous content is dropped, so there is nothing to copy from a borrowed body.
             this->body = data;
+            this->ownsBody = true;
+            return this;
+        }
+
+        /**
+         * Send the file as the body (standard and raw), see zia::apipp::openFile().
+         * It is only read if the body is accessed afterwards.
+         */
+        Response *setFileData(std::shared_ptr<const zia::api::FileBody> file) {
+            this->borrowFile(std::move(file));
             return this;
         }
 
         Response *appendStandardData(const std::string &data) {
-            this->body += data;
+            this->mutableBody() += data;
             return this;
         }
 
         Response *prependStandardData(const std::string &data) {
-            this->body = data + this->body;
+            auto &current = this->mutableBody();
+            current = data + current;
             return this;
         }
 
@@ -159,32 +503,58 @@ namespace zia::apipp {
             return this;
         }
 
-        static std::shared_ptr<Response> fromBasicHttpDuplex(zia::api::HttpDuplex &duplex) {
-            return std::make_shared<Response>(duplex);
+        /**
+         * @param memory where the response and its headers are allocated, see Context::memory.
+         */
+        static std::shared_ptr<Response> fromBasicHttpDuplex(zia::api::HttpDuplex &duplex,
+                                                             std::pmr::memory_resource *memory =
+                                                                     std::pmr::get_default_resource()) {
+            return std::allocate_shared<Response>(std::pmr::polymorphic_allocator<Response>(memory), duplex, memory);
         }
 
-        zia::api::HttpResponse toBasicHttpResponse() const {
-            std::map<std::string, std::string> basicHeaders;
-
-            for (const auto &item : this->headers) {
-                for (const auto &value: item.second) {
-                    basicHeaders[item.first] += value + ", ";
-                }
-                auto &tmp = basicHeaders[item.first];
-                basicHeaders[item.first] = tmp.substr(0, tmp.length() - 2);
-            }
+        /**
+         * Build a Response borrowing the body and raw output of the duplex instead of copying them.
+         */
+        static std::shared_ptr<Response> viewBasicHttpDuplex(const zia::api::HttpDuplex &duplex,
+                                                             std::pmr::memory_resource *memory =
+                                                                     std::pmr::get_default_resource()) {
+            return std::allocate_shared<Response>(std::pmr::polymorphic_allocator<Response>(memory), duplex, asView,
+                                                  memory);
+        }
 
-            if (this->useRawBody) {
-                return zia::api::HttpResponse{this->version, basicHeaders, this->rawBody,
-                                              this->statusCode, this->statusReason};
-            } else {
-                std::vector<std::byte> basicBody;
+        /**
+         * Raw output data, whether it is owned or borrowed.
+         */
+        ByteView outputRaw() const {
+            return this->borrowedOutput ? ByteView(*this->borrowedOutput) : ByteView(this->outputRawData);
+        }
 
-                std::transform(this->body.begin(), this->body.end(), std::back_inserter(basicBody),
-                               [](auto c) { return static_cast<std::byte>(c); });
+        /**
+         * A file body stays a file (HttpResponse::file), it is not read.
+         */
+        zia::api::HttpResponse toBasicHttpResponse(std::pmr::memory_resource *memory =
+                std::pmr::get_default_resource()) const {
+            auto file = this->fileBody();
+            return zia::api::HttpResponse{this->version, detail::joinHeaders(this->headers, memory),
+                                          file ? zia::api::Net::Raw{} : this->rawBodyView().toRaw(),
+                                          this->statusCode, this->statusReason, std::move(file)};
+        }
 
-                return zia::api::HttpResponse{this->version, basicHeaders, basicBody,
-                                              this->statusCode, this->statusReason};
+        /**
+         * Write the response back into duplex.resp, moving owned data instead of copying it.
+         * Afterwards, the response is a view of duplex.
+         */
+        void applyTo(zia::api::HttpDuplex &duplex) {
+            duplex.resp.version = this->version;
+            detail::joinHeaders(this->headers, duplex.resp.headers);
+            duplex.resp.status = this->statusCode;
+            duplex.resp.reason = this->statusReason;
+            if (auto file = this->fileBody()) {
+                duplex.resp.body.clear();
+                duplex.resp.file = std::move(file);
+            } else {
+                duplex.resp.file.reset();
+                this->applyBodyTo(duplex.resp.body);
             }
         }
     };
@@ -192,10 +562,20 @@ namespace zia::apipp {
     using ResponsePtr = std::shared_ptr<Response>;
     using RequestPtr = std::shared_ptr<Request>;
 
+    /**
+     * Duplex for modules of the basic API, which may not know about file bodies: a file body is read into resp.body.
+     * @param memory where the headers are allocated: the duplex must not outlive it.
+     */
     static zia::api::HttpDuplex
-    createBasicHttpDuplex(const RequestPtr &request, const ResponsePtr &response, const zia::api::NetInfo &net) {
-        return zia::api::HttpDuplex{net, request->inputRawData, response->outputRawData,
-                                    request->toBasicHttpRequest(), response->toBasicHttpResponse()};
+    createBasicHttpDuplex(const RequestPtr &request, const ResponsePtr &response, const zia::api::NetInfo &net,
+                          std::pmr::memory_resource *memory = std::pmr::get_default_resource()) {
+        auto basicResponse = response->toBasicHttpResponse(memory);
+        if (basicResponse.file) {
+            readFile(*basicResponse.file, basicResponse.body);
+            basicResponse.file.reset();
+        }
+        return zia::api::HttpDuplex{net, request->inputRaw().toRaw(), response->outputRaw().toRaw(),
+                                    request->toBasicHttpRequest(memory), std::move(basicResponse)};
     }
 
 }
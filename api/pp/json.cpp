@@ -0,0 +1,626 @@
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include "json.hpp"
+
+#if defined(__SSE2__)
+#define ZIA_JSON_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace zia::apipp {
+
+    namespace {
+        constexpr int maxDepth = 512;
+
+        bool isSpace(char c) {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        // Bytes ending a plain run of string characters: they are escaped when written, or start an escape when read.
+        bool isSpecial(char c) {
+            return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+        }
+
+#ifdef ZIA_JSON_SSE2
+        // First byte which is not whitespace, end if none.
+        const char *skipSpace(const char *p, const char *end) {
+            if (p < end && !isSpace(*p))
+                return p;
+
+            const auto space = _mm_set1_epi8(' ');
+            const auto newline = _mm_set1_epi8('\n');
+            const auto carriage = _mm_set1_epi8('\r');
+            const auto tab = _mm_set1_epi8('\t');
+            for (; end - p >= 16; p += 16) {
+                auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                auto spaces = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, newline)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(chunk, carriage), _mm_cmpeq_epi8(chunk, tab)));
+                auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(spaces)) & 0xFFFFu;
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            while (p < end && isSpace(*p))
+                ++p;
+            return p;
+        }
+
+        // First special byte, end if none.
+        const char *scanString(const char *p, const char *end) {
+            const auto quote = _mm_set1_epi8('"');
+            const auto backslash = _mm_set1_epi8('\\');
+            const auto control = _mm_set1_epi8(0x1F);
+            for (; end - p >= 16; p += 16) {
+                auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                auto special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+                auto mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            while (p < end && !isSpecial(*p))
+                ++p;
+            return p;
+        }
+#else
+        const char *skipSpace(const char *p, const char *end) {
+            while (p < end && isSpace(*p))
+                ++p;
+            return p;
+        }
+
+        const char *scanString(const char *p, const char *end) {
+            while (p < end && !isSpecial(*p))
+                ++p;
+            return p;
+        }
+#endif
+
+        void appendUtf8(std::string &out, std::uint32_t code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        // Builds ConfElem values.
+        struct ElemBuilder {
+            using Value = ConfElem;
+
+            struct Object {
+                ConfMap map{};
+
+                // Keys usually come sorted, as written from a std::map: the end is tried first.
+                void add(std::string &&key, ConfElem &&value) {
+                    this->map.elems.insert_or_assign(this->map.elems.end(), std::move(key),
+                                                     std::make_shared<ConfElem>(std::move(value)));
+                }
+
+                ConfElem done() {
+                    return ConfElem(std::move(this->map));
+                }
+            };
+
+            struct Array {
+                ConfArray array{};
+
+                void add(ConfElem &&value) {
+                    this->array.elems.push_back(std::make_shared<ConfElem>(std::move(value)));
+                }
+
+                ConfElem done() {
+                    return ConfElem(std::move(this->array));
+                }
+            };
+
+            template<typename T>
+            static ConfElem make(T &&value) {
+                return ConfElem(std::forward<T>(value));
+            }
+
+            static ConfElem null() {
+                return ConfElem();
+            }
+        };
+
+        // Builds the values of the SZA api.
+        struct BasicBuilder {
+            using Value = zia::api::ConfValue;
+
+            struct Object {
+                zia::api::ConfObject map{};
+
+                void add(std::string &&key, zia::api::ConfValue &&value) {
+                    this->map.insert_or_assign(this->map.end(), std::move(key), std::move(value));
+                }
+
+                zia::api::ConfValue done() {
+                    return make(std::move(this->map));
+                }
+            };
+
+            struct Array {
+                zia::api::ConfArray array{};
+
+                void add(zia::api::ConfValue &&value) {
+                    this->array.push_back(std::move(value));
+                }
+
+                zia::api::ConfValue done() {
+                    return make(std::move(this->array));
+                }
+            };
+
+            template<typename T>
+            static zia::api::ConfValue make(T &&value) {
+                zia::api::ConfValue conf;
+                conf.v = std::forward<T>(value);
+                return conf;
+            }
+
+            static zia::api::ConfValue null() {
+                return {};
+            }
+        };
+
+        /**
+         * Recursive descent over the text, one value at a time: nothing is tokenized ahead.
+         */
+        template<typename TBuilder>
+        class Reader {
+        private:
+            using Value = typename TBuilder::Value;
+
+            const char *begin;
+            const char *p;
+            const char *end;
+            std::string scratch{}; // Strings holding escapes, decoded before being copied out.
+            int depth = 0;
+
+            [[noreturn]] void fail(const char *at, const std::string &message) const {
+                std::size_t line = 1;
+                const char *lineStart = this->begin;
+                for (auto c = this->begin; c < at; ++c) {
+                    if (*c == '\n') {
+                        ++line;
+                        lineStart = c + 1;
+                    }
+                }
+                throw JsonError(static_cast<std::size_t>(at - this->begin), line,
+                                static_cast<std::size_t>(at - lineStart) + 1, message);
+            }
+
+            char next() {
+                this->p = skipSpace(this->p, this->end);
+                if (this->p == this->end)
+                    this->fail(this->p, "unexpected end of text");
+                return *this->p;
+            }
+
+            void enter() {
+                if (++this->depth > maxDepth)
+                    this->fail(this->p, "too deeply nested");
+                ++this->p;
+            }
+
+            void literal(std::string_view word) {
+                if (static_cast<std::size_t>(this->end - this->p) < word.size() ||
+                    std::memcmp(this->p, word.data(), word.size()) != 0)
+                    this->fail(this->p, "invalid value");
+                this->p += word.size();
+            }
+
+            std::uint32_t hex4() {
+                if (this->end - this->p < 4)
+                    this->fail(this->p, "invalid \\u escape");
+                std::uint32_t code = 0;
+                auto result = std::from_chars(this->p, this->p + 4, code, 16);
+                if (result.ptr != this->p + 4)
+                    this->fail(this->p, "invalid \\u escape");
+                this->p += 4;
+                return code;
+            }
+
+            void escape() {
+                if (this->p == this->end)
+                    this->fail(this->p, "unterminated string");
+                switch (*this->p++) {
+                    case '"': this->scratch += '"'; break;
+                    case '\\': this->scratch += '\\'; break;
+                    case '/': this->scratch += '/'; break;
+                    case 'b': this->scratch += '\b'; break;
+                    case 'f': this->scratch += '\f'; break;
+                    case 'n': this->scratch += '\n'; break;
+                    case 'r': this->scratch += '\r'; break;
+                    case 't': this->scratch += '\t'; break;
+                    case 'u': {
+                        auto code = this->hex4();
+                        if (code >= 0xDC00 && code <= 0xDFFF)
+                            this->fail(this->p - 6, "unpaired surrogate");
+                        if (code >= 0xD800 && code <= 0xDBFF) {
+                            if (this->end - this->p < 2 || this->p[0] != '\\' || this->p[1] != 'u')
+                                this->fail(this->p - 6, "unpaired surrogate");
+                            this->p += 2;
+                            auto low = this->hex4();
+                            if (low < 0xDC00 || low > 0xDFFF)
+                                this->fail(this->p - 6, "unpaired surrogate");
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(this->scratch, code);
+                        break;
+                    }
+                    default:
+                        this->fail(this->p - 1, "invalid escape");
+                }
+            }
+
+            std::string string() {
+                ++this->p;
+                auto run = scanString(this->p, this->end);
+                if (run != this->end && *run == '"') {
+                    std::string value(this->p, run);
+                    this->p = run + 1;
+                    return value;
+                }
+
+                this->scratch.clear();
+                while (true) {
+                    this->scratch.append(this->p, run);
+                    this->p = run;
+                    if (this->p == this->end)
+                        this->fail(this->p, "unterminated string");
+                    if (*this->p == '"')
+                        break;
+                    if (*this->p != '\\')
+                        this->fail(this->p, "control character in string");
+                    ++this->p;
+                    this->escape();
+                    run = scanString(this->p, this->end);
+                }
+                ++this->p;
+                return this->scratch;
+            }
+
+            bool digits() {
+                auto start = this->p;
+                while (this->p < this->end && *this->p >= '0' && *this->p <= '9')
+                    ++this->p;
+                return this->p != start;
+            }
+
+            Value number() {
+                auto start = this->p;
+                if (*this->p == '-')
+                    ++this->p;
+                if (this->p < this->end && *this->p == '0')
+                    ++this->p;
+                else if (this->p == this->end || *this->p < '1' || *this->p > '9' || !this->digits())
+                    this->fail(start, "invalid value");
+
+                bool integer = true;
+                if (this->p < this->end && *this->p == '.') {
+                    ++this->p;
+                    integer = false;
+                    if (!this->digits())
+                        this->fail(this->p, "expected a digit");
+                }
+                if (this->p < this->end && (*this->p == 'e' || *this->p == 'E')) {
+                    ++this->p;
+                    integer = false;
+                    if (this->p < this->end && (*this->p == '+' || *this->p == '-'))
+                        ++this->p;
+                    if (!this->digits())
+                        this->fail(this->p, "expected a digit");
+                }
+
+                if (integer) {
+                    long long value = 0;
+                    if (std::from_chars(start, this->p, value).ec == std::errc())
+                        return TBuilder::make(value);
+                }
+                double value = 0;
+                if (std::from_chars(start, this->p, value).ec != std::errc())
+                    this->fail(start, "number out of range");
+                return TBuilder::make(value);
+            }
+
+            typename TBuilder::Array array() {
+                typename TBuilder::Array array;
+                this->enter();
+                if (this->next() == ']') {
+                    ++this->p;
+                    --this->depth;
+                    return array;
+                }
+                while (true) {
+                    array.add(this->value());
+                    auto c = this->next();
+                    ++this->p;
+                    if (c == ']')
+                        break;
+                    if (c != ',')
+                        this->fail(this->p - 1, "expected ',' or ']'");
+                }
+                --this->depth;
+                return array;
+            }
+
+        public:
+            explicit Reader(std::string_view text)
+                    : begin{text.data()}, p{text.data()}, end{text.data() + text.size()} {}
+
+            Value value() {
+                switch (this->next()) {
+                    case '{':
+                        return this->object().done();
+                    case '[':
+                        return this->array().done();
+                    case '"':
+                        return TBuilder::make(this->string());
+                    case 't':
+                        this->literal("true");
+                        return TBuilder::make(true);
+                    case 'f':
+                        this->literal("false");
+                        return TBuilder::make(false);
+                    case 'n':
+                        this->literal("null");
+                        return TBuilder::null();
+                    default:
+                        return this->number();
+                }
+            }
+
+            typename TBuilder::Object object() {
+                typename TBuilder::Object object;
+                if (this->next() != '{')
+                    this->fail(this->p, "expected an object");
+                this->enter();
+                if (this->next() == '}') {
+                    ++this->p;
+                    --this->depth;
+                    return object;
+                }
+                while (true) {
+                    if (this->next() != '"')
+                        this->fail(this->p, "expected a string key");
+                    auto key = this->string();
+                    if (this->next() != ':')
+                        this->fail(this->p, "expected ':'");
+                    ++this->p;
+                    object.add(std::move(key), this->value());
+                    auto c = this->next();
+                    ++this->p;
+                    if (c == '}')
+                        break;
+                    if (c != ',')
+                        this->fail(this->p - 1, "expected ',' or '}'");
+                }
+                --this->depth;
+                return object;
+            }
+
+            // Only whitespace may follow the document.
+            void finish() {
+                this->p = skipSpace(this->p, this->end);
+                if (this->p != this->end)
+                    this->fail(this->p, "unexpected data after the value");
+            }
+        };
+
+        class Writer {
+        private:
+            std::string &out;
+            const bool pretty;
+            std::size_t indent = 0;
+
+            void newline() {
+                this->out += '\n';
+                this->out.append(this->indent, ' ');
+            }
+
+            void string(std::string_view value) {
+                static const char hex[] = "0123456789abcdef";
+
+                this->out += '"';
+                auto p = value.data();
+                auto end = p + value.size();
+                while (true) {
+                    auto special = scanString(p, end);
+                    this->out.append(p, special);
+                    if (special == end)
+                        break;
+                    switch (*special) {
+                        case '"': this->out += "\\\""; break;
+                        case '\\': this->out += "\\\\"; break;
+                        case '\b': this->out += "\\b"; break;
+                        case '\f': this->out += "\\f"; break;
+                        case '\n': this->out += "\\n"; break;
+                        case '\r': this->out += "\\r"; break;
+                        case '\t': this->out += "\\t"; break;
+                        default:
+                            this->out += "\\u00";
+                            this->out += hex[static_cast<unsigned char>(*special) >> 4];
+                            this->out += hex[static_cast<unsigned char>(*special) & 0xF];
+                    }
+                    p = special + 1;
+                }
+                this->out += '"';
+            }
+
+            void scalar(std::monostate) {
+                this->out += "null";
+            }
+
+            void scalar(const std::string &value) {
+                this->string(value);
+            }
+
+            void scalar(bool value) {
+                this->out += value ? "true" : "false";
+            }
+
+            void scalar(long long value) {
+                char buffer[24];
+                auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                this->out.append(buffer, result.ptr);
+            }
+
+            void scalar(double value) {
+                if (!std::isfinite(value)) {
+                    this->out += "null";
+                    return;
+                }
+                char buffer[32];
+                auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                this->out.append(buffer, result.ptr);
+                // Keep it a double when read back.
+                if (std::find_if(buffer, result.ptr, [](char c) { return c == '.' || c == 'e'; }) == result.ptr)
+                    this->out += ".0";
+            }
+
+            template<typename TRange, typename TWrite>
+            void sequence(char open, char close, const TRange &range, TWrite write) {
+                this->out += open;
+                if (range.empty()) {
+                    this->out += close;
+                    return;
+                }
+                this->indent += 4;
+                bool first = true;
+                for (const auto &item : range) {
+                    if (!first)
+                        this->out += ',';
+                    first = false;
+                    if (this->pretty)
+                        this->newline();
+                    write(item);
+                }
+                this->indent -= 4;
+                if (this->pretty)
+                    this->newline();
+                this->out += close;
+            }
+
+            template<typename TMap>
+            void object(const TMap &map) {
+                this->sequence('{', '}', map, [this](const auto &entry) {
+                    this->string(entry.first);
+                    this->out += this->pretty ? ": " : ":";
+                    this->value(entry.second);
+                });
+            }
+
+            template<typename TArray>
+            void array(const TArray &array) {
+                this->sequence('[', ']', array, [this](const auto &item) { this->value(item); });
+            }
+
+        public:
+            Writer(std::string &into, JsonStyle style) : out{into}, pretty{style == JsonStyle::Pretty} {}
+
+            void value(const std::shared_ptr<ConfElem> &conf) {
+                if (conf)
+                    this->value(*conf);
+                else
+                    this->out += "null";
+            }
+
+            void value(const ConfElem &conf) {
+                std::visit([this](const auto &value) {
+                    using T = std::decay_t<decltype(value)>;
+                    if constexpr (std::is_same_v<T, ConfMap::Sptr>) {
+                        if (value)
+                            this->object(value->elems);
+                        else
+                            this->out += "{}";
+                    } else if constexpr (std::is_same_v<T, ConfArray::Sptr>) {
+                        if (value)
+                            this->array(value->elems);
+                        else
+                            this->out += "[]";
+                    } else {
+                        this->scalar(value);
+                    }
+                }, conf.getValue());
+            }
+
+            void value(const zia::api::ConfValue &conf) {
+                std::visit([this](const auto &value) {
+                    using T = std::decay_t<decltype(value)>;
+                    if constexpr (std::is_same_v<T, zia::api::ConfObject>)
+                        this->object(value);
+                    else if constexpr (std::is_same_v<T, zia::api::ConfArray>)
+                        this->array(value);
+                    else
+                        this->scalar(value);
+                }, conf.v);
+            }
+
+            void value(const zia::api::Conf &conf) {
+                this->object(conf);
+            }
+        };
+    }
+
+    ConfElem parseJson(std::string_view text) {
+        Reader<ElemBuilder> reader(text);
+        auto conf = reader.value();
+        reader.finish();
+        return conf;
+    }
+
+    bool parseJson(std::string_view text, ConfElem &out, std::string &error) {
+        try {
+            out = parseJson(text);
+            return true;
+        } catch (JsonError &e) {
+            error = e.what();
+            return false;
+        }
+    }
+
+    zia::api::Conf parseJsonConf(std::string_view text) {
+        Reader<BasicBuilder> reader(text);
+        auto conf = reader.object();
+        reader.finish();
+        return std::move(conf.map);
+    }
+
+    ConfElem loadJson(const std::string &path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            throw JsonError("cannot open " + path);
+
+        std::string text(static_cast<std::size_t>(file.tellg()), '\0');
+        file.seekg(0);
+        if (!file.read(text.data(), static_cast<std::streamsize>(text.size())))
+            throw JsonError("cannot read " + path);
+        return parseJson(text);
+    }
+
+    void writeJson(const ConfElem &conf, std::string &out, JsonStyle style) {
+        Writer(out, style).value(conf);
+    }
+
+    void writeJson(const zia::api::Conf &conf, std::string &out, JsonStyle style) {
+        Writer(out, style).value(conf);
+    }
+
+}
@@ -0,0 +1,103 @@
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../conf.h"
+#include "conf.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * A JSON text could not be parsed.
+     * what() starts with the position of the error, e.g. "line 3, column 12: expected ':'".
+     */
+    class JsonError : public std::runtime_error {
+    private:
+        std::size_t at;
+        std::size_t lineNumber;
+        std::size_t columnNumber;
+
+    public:
+        JsonError(std::size_t offset, std::size_t line, std::size_t column, const std::string &message)
+                : std::runtime_error("line " + std::to_string(line) + ", column " + std::to_string(column) + ": " +
+                                     message), at{offset}, lineNumber{line}, columnNumber{column} {}
+
+        /**
+         * Error which is not in the text, e.g. a file which cannot be read: line() is then 0.
+         */
+        explicit JsonError(const std::string &message)
+                : std::runtime_error(message), at{0}, lineNumber{0}, columnNumber{0} {}
+
+        /**
+         * Offset of the error in the text, in bytes.
+         */
+        std::size_t offset() const {
+            return this->at;
+        }
+
+        std::size_t line() const {
+            return this->lineNumber;
+        }
+
+        std::size_t column() const {
+            return this->columnNumber;
+        }
+    };
+
+    enum class JsonStyle {
+        Compact, // No whitespace at all.
+        Pretty   // One value per line, indented by 4 spaces, like operator<<.
+    };
+
+    /**
+     * Parse a JSON text (RFC 8259) in a single pass, building the ConfElem as it goes.
+     *
+     * Whitespace and strings are scanned 16 bytes at a time (SSE2). Integers without fraction or
+     * exponent become long long, other numbers double, and null an Empty element.
+     * When a key appears twice in an object, the last value is kept.
+     *
+     * @throw JsonError if text is not valid JSON or nests deeper than 512 levels.
+     */
+    ConfElem parseJson(std::string_view text);
+
+    /**
+     * Same as parseJson, reporting the error instead of throwing, for config() functions.
+     * @return false if text is not valid JSON: out is then left unchanged and error is set.
+     */
+    bool parseJson(std::string_view text, ConfElem &out, std::string &error);
+
+    /**
+     * Parse a JSON object straight into the basic configuration of the SZA api,
+     * without going through a ConfElem.
+     *
+     * @throw JsonError if text is not valid JSON or its root is not an object.
+     */
+    zia::api::Conf parseJsonConf(std::string_view text);
+
+    /**
+     * Read and parse a JSON configuration file, e.g. at startup.
+     *
+     * @throw JsonError if the file cannot be read or is not valid JSON.
+     */
+    ConfElem loadJson(const std::string &path);
+
+    /**
+     * Append conf as JSON to out. Strings are escaped where needed, doubles written in their
+     * shortest form that reads back the same, Empty elements as null.
+     */
+    void writeJson(const ConfElem &conf, std::string &out, JsonStyle style = JsonStyle::Compact);
+
+    void writeJson(const zia::api::Conf &conf, std::string &out, JsonStyle style = JsonStyle::Compact);
+
+    template<typename TConf>
+    std::string toJson(const TConf &conf, JsonStyle style = JsonStyle::Compact) {
+        std::string out;
+        writeJson(conf, out, style);
+        return out;
+    }
+
+}
@@ -0,0 +1,185 @@
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <thread>
+
+#include "loader.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace zia::apipp {
+
+    namespace {
+        using Create = zia::api::Module *(*)();
+
+#if defined(_WIN32)
+        constexpr const char *libraryPrefix = "";
+        constexpr const char *librarySuffix = ".dll";
+#elif defined(__APPLE__)
+        constexpr const char *libraryPrefix = "lib";
+        constexpr const char *librarySuffix = ".dylib";
+#else
+        constexpr const char *libraryPrefix = "lib";
+        constexpr const char *librarySuffix = ".so";
+#endif
+
+        std::shared_ptr<void> openLibrary(const std::string &path, std::string &error) {
+#ifdef _WIN32
+            auto handle = ::LoadLibraryA(path.c_str());
+            if (!handle) {
+                error = "cannot load " + path;
+                return nullptr;
+            }
+            return std::shared_ptr<void>(handle, [](void *library) { ::FreeLibrary(static_cast<HMODULE>(library)); });
+#else
+            auto handle = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (!handle) {
+                auto *reason = ::dlerror();
+                error = reason ? reason : "cannot load " + path;
+                return nullptr;
+            }
+            return std::shared_ptr<void>(handle, [](void *library) { ::dlclose(library); });
+#endif
+        }
+
+        Create createOf(const std::shared_ptr<void> &library) {
+#ifdef _WIN32
+            return reinterpret_cast<Create>(::GetProcAddress(static_cast<HMODULE>(library.get()), "create"));
+#else
+            return reinterpret_cast<Create>(::dlsym(library.get(), "create"));
+#endif
+        }
+
+        std::vector<std::string> strings(const zia::api::Conf &conf, const std::string &key) {
+            std::vector<std::string> values;
+            auto found = conf.find(key);
+            if (found == conf.end())
+                return values;
+            if (auto *array = std::get_if<zia::api::ConfArray>(&found->second.v)) {
+                for (const auto &item : *array) {
+                    if (auto *value = std::get_if<std::string>(&item.v))
+                        values.push_back(*value);
+                }
+            }
+            return values;
+        }
+    }
+
+    ModuleManager::ModuleManager(unsigned threads) : threads{threads} {
+        if (!this->threads)
+            this->threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::string ModuleManager::resolve(const std::string &name, const std::vector<std::string> &paths) {
+        auto file = libraryPrefix + name + librarySuffix;
+        for (const auto &path : paths) {
+            auto candidate = std::filesystem::path(path) / file;
+            std::error_code error;
+            if (std::filesystem::is_regular_file(candidate, error))
+                return candidate.string();
+        }
+        return {};
+    }
+
+    void ModuleManager::loadOne(LoadedModule &module, const std::vector<std::string> &paths,
+                                const zia::api::Conf &conf) {
+        auto start = std::chrono::steady_clock::now();
+        module.path = resolve(module.name, paths);
+        if (module.path.empty()) {
+            module.error = "not found in modules_path";
+            return;
+        }
+
+        auto library = openLibrary(module.path, module.error);
+        if (!library)
+            return;
+        auto create = createOf(library);
+        if (!create) {
+            module.error = "no create function";
+            return;
+        }
+
+        try {
+            auto *created = create();
+            if (!created) {
+                module.error = "create returned no module";
+                return;
+            }
+            // The module is deleted before its library is closed.
+            module.module = std::shared_ptr<zia::api::Module>(created, [library](zia::api::Module *instance) {
+                delete instance;
+            });
+            auto configStart = std::chrono::steady_clock::now();
+            module.loadTime = configStart - start;
+            if (!module.module->config(conf))
+                module.error = "config failed";
+            module.configTime = std::chrono::steady_clock::now() - configStart;
+        } catch (std::exception &e) {
+            module.error = e.what();
+        }
+    }
+
+    bool ModuleManager::load(const zia::api::Conf &conf) {
+        auto start = std::chrono::steady_clock::now();
+        auto paths = strings(conf, "modules_path");
+        if (conf.find("modules_path") == conf.end())
+            paths.emplace_back(".");
+
+        std::vector<LoadedModule> modules;
+        for (auto &name : strings(conf, "modules"))
+            modules.push_back(LoadedModule{std::move(name)});
+
+        std::atomic<std::size_t> next{0};
+        auto work = [&]() {
+            for (auto i = next++; i < modules.size(); i = next++)
+                loadOne(modules[i], paths, conf);
+        };
+        std::vector<std::thread> workers;
+        auto count = std::min<std::size_t>(this->threads, modules.size());
+        for (std::size_t i = 1; i < count; ++i)
+            workers.emplace_back(work);
+        work();
+        for (auto &worker : workers)
+            worker.join();
+
+        this->loaded = std::move(modules);
+        this->total = std::chrono::steady_clock::now() - start;
+        return std::all_of(this->loaded.begin(), this->loaded.end(),
+                           [](const LoadedModule &module) { return module.error.empty(); });
+    }
+
+    std::shared_ptr<Pipeline> ModuleManager::pipeline() const {
+        auto pipeline = std::make_shared<Pipeline>();
+        for (const auto &module : this->loaded) {
+            if (module.error.empty())
+                pipeline->add(module.module);
+        }
+        return pipeline;
+    }
+
+    void ModuleManager::report(std::ostream &os) const {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        for (const auto &module : this->loaded) {
+            os << std::setw(16) << std::left << module.name << " ";
+            if (!module.error.empty() && !module.module) {
+                os << "error: " << module.error << std::endl;
+                continue;
+            }
+            os << "load " << std::setw(8) << std::right << duration_cast<microseconds>(module.loadTime).count()
+               << "us  config " << std::setw(8) << duration_cast<microseconds>(module.configTime).count() << "us  "
+               << (module.error.empty() ? module.path : "error: " + module.error) << std::endl;
+        }
+        os << this->loaded.size() << " modules in " << duration_cast<microseconds>(this->total).count() << "us"
+           << std::endl;
+    }
+
+}
@@ -0,0 +1,95 @@
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../conf.h"
+#include "../module.h"
+
+#include "pipeline.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Module of the "modules" list, in the order of the list.
+     */
+    struct LoadedModule {
+        using Duration = std::chrono::steady_clock::duration;
+
+        std::string name;
+        std::string path{}; // Library the module was created from, empty if it was not found.
+        /**
+         * Keeps its library loaded, nullptr if loading failed.
+         */
+        std::shared_ptr<zia::api::Module> module{};
+        Duration loadTime{}; // Opening the library and calling create.
+        Duration configTime{};
+        std::string error{}; // Empty when the module was loaded and configured.
+    };
+
+    /**
+     * Loader of the modules listed in a configuration (see zia::api::Conf): each name of "modules" is
+     * looked for in the directories of "modules_path" ("." if absent), as lib<name>.so on Linux,
+     * lib<name>.dylib on macOS and <name>.dll on Windows. The library's "create" function is called, then
+     * config() with the whole configuration.
+     *
+     * Modules are loaded and configured on a pool of threads, each module in one go, so a slow config()
+     * does not wait for the other modules. Results are kept in the order of "modules", which is the order
+     * of the pipeline. config() must then not rely on another module being configured first.
+     */
+    class ModuleManager {
+    private:
+        unsigned threads;
+        std::vector<LoadedModule> loaded{};
+        LoadedModule::Duration total{};
+
+        static void loadOne(LoadedModule &module, const std::vector<std::string> &paths, const zia::api::Conf &conf);
+
+    public:
+        /**
+         * @param threads Modules loaded at once, one per core when 0.
+         */
+        explicit ModuleManager(unsigned threads = 0);
+
+        /**
+         * Load the modules of conf, replacing the ones loaded before.
+         * @return false if a module could not be found, created or configured: see modules() for the errors.
+         */
+        bool load(const zia::api::Conf &conf);
+
+        /**
+         * Loaded modules, failed ones included, in the order of "modules".
+         */
+        const std::vector<LoadedModule> &modules() const {
+            return this->loaded;
+        }
+
+        /**
+         * Chain of the modules which were loaded and configured, in order.
+         */
+        std::shared_ptr<Pipeline> pipeline() const;
+
+        /**
+         * Wall time of the last load(), shorter than the sum of the modules' times when done in parallel.
+         */
+        LoadedModule::Duration elapsed() const {
+            return this->total;
+        }
+
+        /**
+         * Print a line per module with its library, load and config times, or its error.
+         */
+        void report(std::ostream &os) const;
+
+        /**
+         * Library file of a module, the first found in paths.
+         * @return an empty string if there is none.
+         */
+        static std::string resolve(const std::string &name, const std::vector<std::string> &paths);
+    };
+
+}
@@ -1,6 +1,12 @@
 
 #pragma once
 
+#include <any>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "../module.h"
 
 #include "conf.hpp"
@@ -9,7 +15,103 @@
 
 namespace zia::apipp {
 
-    class Module : public zia::api::Module {
+    /**
+     * Per-request storage used by modules to share data along the pipeline.
+     */
+    class Scratch {
+    private:
+        std::vector<std::pair<std::string, std::any>> entries;
+
+    public:
+        /**
+         * @return the value stored under key, or nullptr if there is none or it is not a T.
+         */
+        template<typename T>
+        T *find(const std::string &key) {
+            for (auto &entry : this->entries) {
+                if (entry.first == key)
+                    return std::any_cast<T>(&entry.second);
+            }
+            return nullptr;
+        }
+
+        template<typename T>
+        const T *find(const std::string &key) const {
+            for (const auto &entry : this->entries) {
+                if (entry.first == key)
+                    return std::any_cast<T>(&entry.second);
+            }
+            return nullptr;
+        }
+
+        /**
+         * Store a value under key, replacing the previous one.
+         */
+        template<typename T>
+        std::decay_t<T> &set(const std::string &key, T &&value) {
+            for (auto &entry : this->entries) {
+                if (entry.first == key)
+                    return entry.second.emplace<std::decay_t<T>>(std::forward<T>(value));
+            }
+            auto &slot = this->entries.emplace_back(key, std::any()).second;
+            return slot.emplace<std::decay_t<T>>(std::forward<T>(value));
+        }
+
+        bool erase(const std::string &key) {
+            for (auto it = this->entries.begin(); it != this->entries.end(); ++it) {
+                if (it->first == key) {
+                    this->entries.erase(it);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void clear() {
+            this->entries.clear();
+        }
+    };
+
+    /**
+     * Everything a module needs to process one request.
+     * Owned by the caller for the duration of the request, never stored in the module.
+     */
+    struct Context {
+        RequestPtr request{};
+        ResponsePtr response{};
+        zia::api::NetInfo net{};
+        Scratch scratch{};
+        /**
+         * Where the request and response objects are allocated. It may be the per-request arena of the
+         * Pipeline (see RequestArena): anything allocated from it must not outlive the request.
+         */
+        std::pmr::memory_resource *memory = std::pmr::get_default_resource();
+    };
+
+    /**
+     * Common interface of modules able to work on SZA++ objects directly.
+     */
+    class SmartModule : public zia::api::Module {
+    public:
+        ~SmartModule() override = default;
+
+        /**
+         * Called on HTTP request with already converted SZA++ objects.
+         * \return true on success, otherwise false.
+         */
+        virtual bool smartExec(Context &ctx) = 0;
+    };
+
+    /**
+     * SZA++ module keeping the request in members. Simple to write, but an instance
+     * must not be executed by several threads at once (see ReentrantModule).
+     *
+     * perform() gets objects owning their active body (see Body::own()), whose public member can be used
+     * directly. The other representation is copied by mutableBody() or mutableRawBody() if perform() needs it,
+     * and a file body is not read: it is sent as is unless perform() replaces it (setStandardData(), or
+     * writing the member). The raw data is read with inputRaw() and outputRaw().
+     */
+    class Module : public SmartModule {
     protected:
         Conf conf{};
         ResponsePtr response{};
@@ -34,21 +136,35 @@ namespace zia::apipp {
             this->request = request;
             this->response = response;
             this->net = net;
+            // Views given by a Pipeline: perform() uses the body members.
+            this->request->own();
+            this->response->own();
 
             auto ret = this->perform();
 
+            this->request->adoptMembers();
+            this->response->adoptMembers();
             this->reset(); // Reset pointers.
             return ret;
         }
 
+        bool smartExec(Context &ctx) override {
+            return this->smartExec(ctx.request, ctx.response, ctx.net);
+        }
+
         bool exec(zia::api::HttpDuplex &http) override {
-            this->response = Response::fromBasicHttpDuplex(http);
-            this->request = Request::fromBasicHttpDuplex(http);
+            // Views owning their active body only, as given to smartExec().
+            this->response = Response::viewBasicHttpDuplex(http);
+            this->request = Request::viewBasicHttpDuplex(http);
+            this->request->own();
+            this->response->own();
 
             auto ret = this->perform();
 
-            http.resp = this->response->toBasicHttpResponse();
-            http.req = this->request->toBasicHttpRequest();
+            this->request->adoptMembers();
+            this->response->adoptMembers();
+            this->response->applyTo(http);
+            this->request->applyTo(http);
 
             this->reset(); // Reset pointers.
             return ret;
@@ -57,4 +173,41 @@ namespace zia::apipp {
         virtual bool perform() = 0;
     };
 
+    /**
+     * SZA++ module receiving the request through a Context. It holds no per-request state,
+     * so one instance can be executed concurrently by any number of threads.
+     *
+     * The request and response are views of the duplex: their bodies are read with bodyView() and
+     * written with mutableBody() or the Response setters, the public body members stay empty until then.
+     */
+    class ReentrantModule : public SmartModule {
+    protected:
+        Conf conf{};
+
+    public:
+        ~ReentrantModule() override = default;
+
+        bool config(const zia::api::Conf &conf) override {
+            this->conf = Conf::fromBasicConfig(conf);
+            return true;
+        }
+
+        bool smartExec(Context &ctx) override {
+            return this->perform(ctx);
+        }
+
+        bool exec(zia::api::HttpDuplex &http) override {
+            // Views: bodies are only copied if perform() mutates them.
+            Context ctx{Request::viewBasicHttpDuplex(http), Response::viewBasicHttpDuplex(http), http.info};
+
+            auto ret = this->perform(ctx);
+
+            ctx.response->applyTo(http);
+            ctx.request->applyTo(http);
+            return ret;
+        }
+
+        virtual bool perform(Context &ctx) = 0;
+    };
+
 }
@@ -5,10 +5,31 @@
 
 #include "../net.h"
 
+namespace zia::apipp {
+    class BodyStream;
+
+    class RequestParser;
+}
+
 namespace zia::api {
     struct ImplSocket {
         virtual void sendMessage(std::string &) = 0;
 
         virtual std::string receiveMessage() = 0;
+
+        /**
+         * Body of the request still arriving, nullptr when the request given to the callback holds it all.
+         */
+        virtual std::shared_ptr<zia::apipp::BodyStream> bodyStream() {
+            return nullptr;
+        }
+
+        /**
+         * Parser which found the end of the request given to the callback, its spans are offsets in it:
+         * the request is filled from it instead of being parsed again. nullptr if it was not kept.
+         */
+        virtual const zia::apipp::RequestParser *requestParser() const {
+            return nullptr;
+        }
     };
 }
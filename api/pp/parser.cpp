@@ -0,0 +1,553 @@
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "parser.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ZIA_PARSER_X86
+#include <immintrin.h>
+#endif
+
+namespace zia::apipp {
+
+    namespace {
+        using FindFn = const char *(*)(const char *p, const char *end, char a, char b);
+
+        // First position holding a or b, end if none.
+        const char *findScalar(const char *p, const char *end, char a, char b) {
+            for (; p < end; ++p) {
+                if (*p == a || *p == b)
+                    return p;
+            }
+            return end;
+        }
+
+#ifdef ZIA_PARSER_X86
+        __attribute__((target("sse4.2")))
+        const char *findSse42(const char *p, const char *end, char a, char b) {
+            const __m128i needles = _mm_setr_epi8(a, b, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+            for (; end - p >= 16; p += 16) {
+                auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                auto index = _mm_cmpestri(needles, 2, chunk, 16,
+                                          _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+                if (index != 16)
+                    return p + index;
+            }
+            return findScalar(p, end, a, b);
+        }
+
+        __attribute__((target("avx2")))
+        const char *findAvx2(const char *p, const char *end, char a, char b) {
+            const auto va = _mm256_set1_epi8(a);
+            const auto vb = _mm256_set1_epi8(b);
+
+            for (; end - p >= 32; p += 32) {
+                auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                auto hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb));
+                auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            return findScalar(p, end, a, b);
+        }
+#endif
+
+        bool supports(RequestParser::Scanner scanner) {
+#ifdef ZIA_PARSER_X86
+            __builtin_cpu_init();
+            switch (scanner) {
+                case RequestParser::Scanner::Avx2:
+                    return __builtin_cpu_supports("avx2");
+                case RequestParser::Scanner::Sse42:
+                    return __builtin_cpu_supports("sse4.2");
+                default:
+                    return true;
+            }
+#else
+            return scanner == RequestParser::Scanner::Scalar;
+#endif
+        }
+
+        FindFn finderOf(RequestParser::Scanner scanner) {
+            switch (scanner) {
+#ifdef ZIA_PARSER_X86
+                case RequestParser::Scanner::Avx2:
+                    return findAvx2;
+                case RequestParser::Scanner::Sse42:
+                    return findSse42;
+#endif
+                default:
+                    return findScalar;
+            }
+        }
+
+        std::atomic<FindFn> finder{finderOf(RequestParser::bestScanner())};
+
+        const char *find(const char *p, const char *end, char a, char b) {
+            return finder.load(std::memory_order_relaxed)(p, end, a, b);
+        }
+
+        // Tokens up to 8 bytes as integers, so they are matched by a switch.
+        constexpr std::uint64_t pack(std::string_view token) {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < token.size() && i < 8; ++i)
+                value |= static_cast<std::uint64_t>(static_cast<unsigned char>(token[i])) << (8 * i);
+            return value;
+        }
+
+        bool iequals(std::string_view str, std::string_view lower) noexcept {
+            if (str.size() != lower.size())
+                return false;
+            for (std::size_t i = 0; i < str.size(); ++i) {
+                auto c = str[i];
+                if (c >= 'A' && c <= 'Z')
+                    c = static_cast<char>(c - 'A' + 'a');
+                if (c != lower[i])
+                    return false;
+            }
+            return true;
+        }
+
+        std::string_view trim(std::string_view str) noexcept {
+            while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+                str.remove_prefix(1);
+            while (!str.empty() && (str.back() == ' ' || str.back() == '\t' || str.back() == '\r'))
+                str.remove_suffix(1);
+            return str;
+        }
+
+        constexpr std::size_t maxChunkLine = 4096; // Chunk size and extensions.
+
+        bool parseChunkSize(std::string_view digits, std::size_t &size) noexcept {
+            if (digits.empty())
+                return false;
+            size = 0;
+            for (auto c : digits) {
+                unsigned digit;
+                if (c >= '0' && c <= '9')
+                    digit = static_cast<unsigned>(c - '0');
+                else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+                    digit = static_cast<unsigned>((c | 0x20) - 'a' + 10);
+                else
+                    return false;
+                if (size > (SIZE_MAX >> 4))
+                    return false;
+                size = size << 4 | digit;
+            }
+            return true;
+        }
+
+        RequestParser::Span spanOf(const char *base, std::string_view str) {
+            return {static_cast<std::uint32_t>(str.data() - base), static_cast<std::uint32_t>(str.size())};
+        }
+    }
+
+    RequestParser::RequestParser(std::size_t maxHeaderSize) : maxHeaderSize{maxHeaderSize} {}
+
+    RequestParser::Scanner RequestParser::bestScanner() {
+        if (supports(Scanner::Avx2))
+            return Scanner::Avx2;
+        if (supports(Scanner::Sse42))
+            return Scanner::Sse42;
+        return Scanner::Scalar;
+    }
+
+    bool RequestParser::useScanner(Scanner scanner) {
+        if (!supports(scanner))
+            return false;
+        finder.store(finderOf(scanner), std::memory_order_relaxed);
+        return true;
+    }
+
+    zia::api::http::Method RequestParser::parseMethod(std::string_view token) noexcept {
+        using zia::api::http::Method;
+
+        if (token.size() > 7)
+            return Method::unknown;
+        switch (pack(token)) {
+            case pack("GET"):
+                return Method::get;
+            case pack("POST"):
+                return Method::post;
+            case pack("HEAD"):
+                return Method::head;
+            case pack("PUT"):
+                return Method::put;
+            case pack("DELETE"):
+                return Method::delete_;
+            case pack("OPTIONS"):
+                return Method::options;
+            case pack("TRACE"):
+                return Method::trace;
+            case pack("CONNECT"):
+                return Method::connect;
+            default:
+                return Method::unknown;
+        }
+    }
+
+    zia::api::http::Version RequestParser::parseVersion(std::string_view token) noexcept {
+        using zia::api::http::Version;
+
+        if (token.size() > 8)
+            return Version::unknown;
+        switch (pack(token)) {
+            case pack("HTTP/1.1"):
+                return Version::http_1_1;
+            case pack("HTTP/1.0"):
+                return Version::http_1_0;
+            case pack("HTTP/2.0"):
+            case pack("HTTP/2"):
+                return Version::http_2_0;
+            case pack("HTTP/0.9"):
+                return Version::http_0_9;
+            default:
+                return Version::unknown;
+        }
+    }
+
+    void RequestParser::reset() {
+        this->state = State::RequestLine;
+        this->pos = this->lineStart = this->colon = 0;
+        this->bodyStart = this->bodySize = this->remaining = 0;
+        this->declaredLength.reset();
+        this->chunkedBody = false;
+        this->bodySpans.clear();
+        this->requestMethod = zia::api::http::Method::unknown;
+        this->requestVersion = zia::api::http::Version::unknown;
+        this->requestUri = Span{};
+        this->requestHeaders.clear(); // Keeps the capacity for the next request.
+        this->connectionClose = this->connectionKeepAlive = false;
+    }
+
+    bool RequestParser::keepAlive() const {
+        switch (this->requestVersion) {
+            case zia::api::http::Version::http_1_1:
+            case zia::api::http::Version::http_2_0:
+                return !this->connectionClose;
+            case zia::api::http::Version::http_1_0:
+                return this->connectionKeepAlive && !this->connectionClose;
+            default:
+                return false;
+        }
+    }
+
+    bool RequestParser::hasToken(std::string_view value, std::string_view token) noexcept {
+        while (!value.empty()) {
+            auto comma = value.find(',');
+            if (iequals(trim(value.substr(0, comma)), token))
+                return true;
+            value.remove_prefix(comma == std::string_view::npos ? value.size() : comma + 1);
+        }
+        return false;
+    }
+
+    RequestParser::Result RequestParser::fail() {
+        this->state = State::Failed;
+        return Result::Error;
+    }
+
+    bool RequestParser::parseRequestLine(const std::byte *data, std::size_t end) {
+        auto *base = reinterpret_cast<const char *>(data);
+        auto line = trim(std::string_view(base + this->lineStart, end - this->lineStart));
+
+        auto methodEnd = line.find(' ');
+        if (methodEnd == std::string_view::npos || methodEnd == 0)
+            return false;
+        this->requestMethod = parseMethod(line.substr(0, methodEnd));
+
+        auto rest = line.substr(methodEnd + 1);
+        auto uriEnd = rest.find(' ');
+        auto uri = rest.substr(0, uriEnd);
+        if (uri.empty())
+            return false;
+        this->requestUri = spanOf(base, uri);
+
+        if (uriEnd == std::string_view::npos) {
+            // HTTP/0.9 simple request: no version and no headers.
+            this->requestVersion = zia::api::http::Version::http_0_9;
+            return this->requestMethod == zia::api::http::Method::get;
+        }
+        auto version = rest.substr(uriEnd + 1);
+        if (version.empty() || version.find(' ') != std::string_view::npos)
+            return false;
+        this->requestVersion = parseVersion(version);
+        return true;
+    }
+
+    bool RequestParser::parseHeader(const std::byte *data, std::size_t end) {
+        auto *base = reinterpret_cast<const char *>(data);
+        auto name = std::string_view(base + this->lineStart, this->colon - this->lineStart);
+        auto value = trim(std::string_view(base + this->colon + 1, end - this->colon - 1));
+
+        if (name.empty() || name.find_first_of(" \t\r") != std::string_view::npos)
+            return false;
+
+        auto id = zia::api::http::headerId(name);
+        if (id == zia::api::http::Header::content_length) {
+            std::size_t length = 0;
+            if (value.empty())
+                return false;
+            for (auto c : value) {
+                if (c < '0' || c > '9' || length > (SIZE_MAX - 9) / 10)
+                    return false;
+                length = length * 10 + static_cast<std::size_t>(c - '0');
+            }
+            // Repeated with another value, the body length is ambiguous (RFC 7230 3.3.2).
+            if (this->declaredLength && *this->declaredLength != length)
+                return false;
+            this->declaredLength = length;
+        } else if (id == zia::api::http::Header::connection) {
+            this->connectionClose = this->connectionClose || hasToken(value, "close");
+            this->connectionKeepAlive = this->connectionKeepAlive || hasToken(value, "keep-alive");
+        } else if (id == zia::api::http::Header::transfer_encoding) {
+            // Only chunked is decoded, and it must be the last coding (RFC 7230 3.3.1).
+            auto comma = value.rfind(',');
+            auto last = trim(comma == std::string_view::npos ? value : value.substr(comma + 1));
+            if (!iequals(last, "chunked"))
+                return false;
+            this->chunkedBody = true;
+        }
+
+        this->requestHeaders.push_back(Header{spanOf(base, name), spanOf(base, value), id});
+        return true;
+    }
+
+    bool RequestParser::headersDone() {
+        this->bodyStart = this->pos;
+        // Both framings at once is how requests are smuggled past proxies (RFC 7230 3.3.3).
+        if (this->bodyStart > this->maxHeaderSize || (this->chunkedBody && this->declaredLength))
+            return false;
+
+        this->remaining = this->declaredLength.value_or(0);
+        if (this->chunkedBody)
+            this->state = State::ChunkSize;
+        else
+            this->state = this->remaining ? State::Body : State::Done;
+        return true;
+    }
+
+    std::size_t RequestParser::decodeStep(const std::byte *data, std::size_t size, Span &piece) {
+        auto *base = reinterpret_cast<const char *>(data);
+
+        switch (this->state) {
+            case State::Body:
+            case State::ChunkData: {
+                auto count = std::min(this->remaining, size);
+                piece = Span{0, static_cast<std::uint32_t>(std::min<std::size_t>(count, UINT32_MAX))};
+                count = piece.size;
+                this->remaining -= count;
+                this->bodySize += count;
+                if (!this->remaining)
+                    this->state = this->state == State::Body ? State::Done : State::ChunkEnd;
+                return count;
+            }
+
+            case State::ChunkSize: {
+                auto *nl = find(base, base + size, '\n', '\n');
+                if (nl == base + size) {
+                    if (size > maxChunkLine)
+                        this->state = State::Failed;
+                    return 0;
+                }
+                auto line = std::string_view(base, static_cast<std::size_t>(nl - base));
+                std::size_t chunk = 0;
+                if (!parseChunkSize(trim(line.substr(0, line.find(';'))), chunk)) {
+                    this->state = State::Failed;
+                    return 0;
+                }
+                this->remaining = chunk;
+                this->state = chunk ? State::ChunkData : State::Trailers;
+                return line.size() + 1;
+            }
+
+            case State::ChunkEnd: {
+                // CRLF after the chunk data, or a bare LF.
+                auto length = size && base[0] == '\r' ? 2u : 1u;
+                if (size < length)
+                    return 0;
+                if (base[length - 1] != '\n') {
+                    this->state = State::Failed;
+                    return 0;
+                }
+                this->state = State::ChunkSize;
+                return length;
+            }
+
+            case State::Trailers: {
+                // Trailer fields are skipped, up to the empty line.
+                auto *nl = find(base, base + size, '\n', '\n');
+                if (nl == base + size) {
+                    if (size > this->maxHeaderSize)
+                        this->state = State::Failed;
+                    return 0;
+                }
+                auto length = static_cast<std::size_t>(nl - base);
+                if (length == 0 || (length == 1 && base[0] == '\r'))
+                    this->state = State::Done;
+                return length + 1;
+            }
+
+            default:
+                return 0;
+        }
+    }
+
+    RequestParser::Result RequestParser::bodyResult() const {
+        switch (this->state) {
+            case State::Done:
+                return Result::Complete;
+            case State::Failed:
+                return Result::Error;
+            default:
+                return Result::Incomplete;
+        }
+    }
+
+    RequestParser::Result RequestParser::parse(const std::byte *data, std::size_t size) {
+        auto *base = reinterpret_cast<const char *>(data);
+        auto *end = base + size;
+
+        for (;;) {
+            switch (this->state) {
+                case State::RequestLine: {
+                    // Empty lines before a request are ignored (RFC 7230 3.5).
+                    while (this->pos < size && this->pos == this->lineStart &&
+                           (base[this->pos] == '\r' || base[this->pos] == '\n'))
+                        this->lineStart = ++this->pos;
+
+                    auto *nl = find(base + this->pos, end, '\n', '\n');
+                    if (nl == end)
+                        break;
+                    auto lineEnd = static_cast<std::size_t>(nl - base);
+                    if (!this->parseRequestLine(data, lineEnd))
+                        return this->fail();
+                    this->pos = this->lineStart = lineEnd + 1;
+
+                    if (this->requestVersion == zia::api::http::Version::http_0_9) {
+                        this->bodyStart = this->pos;
+                        this->state = State::Done;
+                    } else {
+                        this->state = State::Headers;
+                    }
+                    continue;
+                }
+
+                case State::Headers: {
+                    if (!this->colon) {
+                        auto *p = find(base + this->pos, end, ':', '\n');
+                        if (p == end)
+                            break;
+
+                        auto at = static_cast<std::size_t>(p - base);
+                        if (*p == '\n') {
+                            // Only the empty line ending the header section has no colon.
+                            auto length = at - this->lineStart;
+                            if (length > 1 || (length == 1 && base[this->lineStart] != '\r'))
+                                return this->fail();
+                            this->pos = at + 1;
+                            if (!this->headersDone())
+                                return this->fail();
+                            continue;
+                        }
+                        this->colon = at;
+                        this->pos = at + 1;
+                    }
+
+                    auto *nl = find(base + this->pos, end, '\n', '\n');
+                    if (nl == end)
+                        break;
+                    auto lineEnd = static_cast<std::size_t>(nl - base);
+                    if (!this->parseHeader(data, lineEnd))
+                        return this->fail();
+                    this->pos = this->lineStart = lineEnd + 1;
+                    this->colon = 0;
+                    continue;
+                }
+
+                case State::Body:
+                case State::ChunkSize:
+                case State::ChunkData:
+                case State::ChunkEnd:
+                case State::Trailers: {
+                    std::size_t used;
+                    auto result = this->decodeBody(data + this->pos, size - this->pos, used,
+                                                   [this, data](const std::byte *piece, std::size_t count) {
+                        auto offset = static_cast<std::uint32_t>(piece - data);
+                        auto &spans = this->bodySpans;
+                        if (!spans.empty() && spans.back().offset + spans.back().size == offset)
+                            spans.back().size += static_cast<std::uint32_t>(count);
+                        else
+                            spans.push_back(Span{offset, static_cast<std::uint32_t>(count)});
+                    });
+                    this->pos += used;
+                    return result;
+                }
+
+                case State::Done:
+                    return Result::Complete;
+
+                case State::Failed:
+                    return Result::Error;
+            }
+
+            // A delimiter is missing: wait for more bytes, without rescanning these ones.
+            this->pos = size;
+            if (size > this->maxHeaderSize)
+                return this->fail();
+            return Result::Incomplete;
+        }
+    }
+
+    void RequestParser::fill(const std::byte *data, zia::api::HttpRequest &request) const {
+        request.method = this->requestMethod;
+        request.version = this->requestVersion;
+        request.uri.assign(this->requestUri.in(data));
+
+        request.headers.clear();
+        for (const auto &header : this->requestHeaders) {
+            auto &value = request.headers.entry(header.id, header.name.in(data));
+            if (!value.empty())
+                value += ", ";
+            value += header.value.in(data);
+        }
+
+        request.body.clear();
+        request.body.reserve(this->bodySize);
+        for (const auto &span : this->bodySpans)
+            request.body.insert(request.body.end(), data + span.offset, data + span.offset + span.size);
+    }
+
+    bool parseRequest(const zia::api::Net::Raw &raw, zia::api::HttpRequest &request) {
+        RequestParser parser(raw.size());
+
+        if (parser.parse(raw) != RequestParser::Result::Complete)
+            return false;
+        parser.fill(raw.data(), request);
+        return true;
+    }
+
+    bool parseRequest(const zia::api::Net::Raw &raw, const zia::api::NetInfo &info, zia::api::HttpRequest &request) {
+        auto *parser = info.sock ? info.sock->requestParser() : nullptr;
+
+        if (!parser)
+            return parseRequest(raw, request);
+        parser->fill(raw.data(), request);
+        return true;
+    }
+
+    bool parseRequestHead(const zia::api::Net::Raw &raw, zia::api::HttpRequest &request) {
+        RequestParser parser(raw.size());
+
+        auto result = parser.parse(raw);
+        if (result == RequestParser::Result::Error || !parser.headComplete())
+            return false;
+        parser.fill(raw.data(), request);
+        request.body.clear();
+        return true;
+    }
+
+}
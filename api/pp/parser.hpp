@@ -0,0 +1,270 @@
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../http.h"
+#include "net.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Incremental HTTP/1.x request parser.
+     *
+     * parse() is called each time bytes are received, with the whole request received so far:
+     * the buffer may grow or move between calls, only the new bytes are scanned. Positions are
+     * kept as offsets in the buffer, nothing is copied until fill() builds the HttpRequest.
+     *
+     * Delimiters are searched 32 (AVX2) or 16 (SSE4.2) bytes at a time when the CPU supports it.
+     *
+     * Bodies are framed by Content-Length or "Transfer-Encoding: chunked", decoded as they arrive. Once the
+     * headers are parsed, the body can also be decoded piece by piece with decodeBody(), without keeping
+     * it in the buffer (see BodyStream).
+     */
+    class RequestParser {
+    public:
+        enum class Result {
+            Incomplete, // Need more bytes.
+            Complete,   // A full request (headers and body) is in the buffer, see length().
+            Error       // Malformed request or header section too large.
+        };
+
+        /**
+         * Implementation used to search delimiters, for tests and benchmarks.
+         */
+        enum class Scanner {
+            Scalar, Sse42, Avx2
+        };
+
+        /**
+         * Part of the buffer.
+         */
+        struct Span {
+            std::uint32_t offset = 0;
+            std::uint32_t size = 0;
+
+            std::string_view in(const std::byte *data) const {
+                return {reinterpret_cast<const char *>(data) + offset, size};
+            }
+        };
+
+        struct Header {
+            Span name;
+            Span value;
+            zia::api::http::Header id; // Well-known name, identified once by the parser.
+        };
+
+    private:
+        enum class State {
+            RequestLine, Headers, Body, ChunkSize, ChunkData, ChunkEnd, Trailers, Done, Failed
+        };
+
+        State state = State::RequestLine;
+        std::size_t maxHeaderSize;
+        std::size_t pos = 0;        // Next byte to scan.
+        std::size_t lineStart = 0;  // Start of the line being scanned.
+        std::size_t colon = 0;      // Colon of the header line being scanned, 0 if not found yet.
+        std::size_t bodyStart = 0;
+        std::size_t bodySize = 0;   // Decoded so far.
+        std::size_t remaining = 0;  // Left in the Content-Length body or in the current chunk.
+        std::optional<std::size_t> declaredLength{};
+        bool chunkedBody = false;
+        std::vector<Span> bodySpans{};
+
+        zia::api::http::Method requestMethod = zia::api::http::Method::unknown;
+        zia::api::http::Version requestVersion = zia::api::http::Version::unknown;
+        Span requestUri{};
+        std::vector<Header> requestHeaders{};
+        bool connectionClose = false;
+        bool connectionKeepAlive = false;
+
+        Result fail();
+
+        bool parseRequestLine(const std::byte *data, std::size_t end);
+
+        bool parseHeader(const std::byte *data, std::size_t end);
+
+        bool headersDone();
+
+        /**
+         * One decoding step on the body bytes at data.
+         * @return bytes consumed, 0 if more are needed or the body is over. piece is the decoded part of them.
+         */
+        std::size_t decodeStep(const std::byte *data, std::size_t size, Span &piece);
+
+        Result bodyResult() const;
+
+    public:
+        explicit RequestParser(std::size_t maxHeaderSize = 64 * 1024);
+
+        /**
+         * Resume parsing with the bytes received so far.
+         * @param data start of the request, with the bytes given by previous calls.
+         */
+        Result parse(const std::byte *data, std::size_t size);
+
+        Result parse(const zia::api::Net::Raw &raw) {
+            return this->parse(raw.data(), raw.size());
+        }
+
+        /**
+         * Forget the current request, to parse the next one.
+         */
+        void reset();
+
+        zia::api::http::Method method() const {
+            return this->requestMethod;
+        }
+
+        zia::api::http::Version version() const {
+            return this->requestVersion;
+        }
+
+        Span uri() const {
+            return this->requestUri;
+        }
+
+        const std::vector<Header> &headers() const {
+            return this->requestHeaders;
+        }
+
+        std::size_t bodyOffset() const {
+            return this->bodyStart;
+        }
+
+        /**
+         * Decoded body size: Content-Length, or the sum of the chunks decoded so far.
+         */
+        std::size_t bodyLength() const {
+            return this->bodySize;
+        }
+
+        /**
+         * Content-Length, none when the body is chunked or absent.
+         */
+        std::optional<std::size_t> contentLength() const {
+            return this->declaredLength;
+        }
+
+        bool chunked() const {
+            return this->chunkedBody;
+        }
+
+        /**
+         * Decoded body, as parts of the buffer (chunked bodies are split by their framing).
+         */
+        const std::vector<Span> &bodyChunks() const {
+            return this->bodySpans;
+        }
+
+        /**
+         * Whether the request line and headers are parsed.
+         */
+        bool headComplete() const {
+            return this->state != State::RequestLine && this->state != State::Headers && this->state != State::Failed;
+        }
+
+        /**
+         * Whether the body, still incomplete in a buffer of size bytes, should rather be streamed: it is
+         * announced larger than window, or more than window bytes of chunks were already received.
+         */
+        bool bodyExceeds(std::size_t window, std::size_t size) const {
+            if (!this->headComplete() || this->state == State::Done)
+                return false;
+            return this->declaredLength ? *this->declaredLength > window : size - this->bodyStart > window;
+        }
+
+        /**
+         * Go on decoding the body from new bytes, which no longer need to follow the previous ones in a buffer.
+         * Used once parse() returned Incomplete with headComplete(): the bytes consumed by parse() so far are
+         * described by bodyChunks(), those after length() are given here.
+         * @param used bytes of data consumed. The others must be given again, followed by the next ones.
+         * @param sink called with each decoded part, as (const std::byte *, std::size_t).
+         * @return Complete once the body is over (the next request starts at data + used).
+         */
+        template<typename TSink>
+        Result decodeBody(const std::byte *data, std::size_t size, std::size_t &used, TSink &&sink) {
+            used = 0;
+            for (;;) {
+                Span piece{};
+                auto count = this->decodeStep(data + used, size - used, piece);
+                if (piece.size)
+                    sink(data + used + piece.offset, static_cast<std::size_t>(piece.size));
+                if (!count)
+                    return this->bodyResult();
+                used += count;
+            }
+        }
+
+        /**
+         * Whether the connection can be reused after this request: always for HTTP/1.1 unless
+         * "Connection: close", only with "Connection: keep-alive" for HTTP/1.0, never for HTTP/0.9.
+         */
+        bool keepAlive() const;
+
+        /**
+         * Size of the request in the buffer, once Complete. The next request (pipelining) starts there.
+         * While the body is incomplete, bytes parsed so far.
+         */
+        std::size_t length() const {
+            return this->pos;
+        }
+
+        /**
+         * Copy the parsed request into the API structure. Repeated headers are joined with ", ".
+         * @param data the buffer given to parse().
+         */
+        void fill(const std::byte *data, zia::api::HttpRequest &request) const;
+
+        /**
+         * Map a method token without comparing strings.
+         */
+        static zia::api::http::Method parseMethod(std::string_view token) noexcept;
+
+        /**
+         * Map a version token ("HTTP/1.1") without comparing strings.
+         */
+        static zia::api::http::Version parseVersion(std::string_view token) noexcept;
+
+        /**
+         * Whether a comma separated header value (e.g. Connection) holds token, case insensitive.
+         * @param token in lower case.
+         */
+        static bool hasToken(std::string_view value, std::string_view token) noexcept;
+
+        /**
+         * Select the delimiter search implementation for every parser.
+         * @return false if the CPU does not support it.
+         */
+        static bool useScanner(Scanner scanner);
+
+        /**
+         * Best implementation supported by the CPU, used by default.
+         */
+        static Scanner bestScanner();
+    };
+
+    /**
+     * Parse a complete raw request (e.g. HttpDuplex::raw_req) into request.
+     * \return true on success, otherwise false.
+     */
+    bool parseRequest(const zia::api::Net::Raw &raw, zia::api::HttpRequest &request);
+
+    /**
+     * Like parseRequest(), for the raw request given to the Net callback with info: filled from the
+     * parsing done by the Net when it kept it (see ImplSocket::requestParser()).
+     * \return true on success, otherwise false.
+     */
+    bool parseRequest(const zia::api::Net::Raw &raw, const zia::api::NetInfo &info, zia::api::HttpRequest &request);
+
+    /**
+     * Parse the request line and headers of raw, which may end before the body: the raw request given
+     * to the Net callback when its body is streamed. The body is left empty.
+     * \return true on success, otherwise false.
+     */
+    bool parseRequestHead(const zia::api::Net::Raw &raw, zia::api::HttpRequest &request);
+
+}
@@ -0,0 +1,117 @@
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "conf.hpp"
+#include "compiled.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Path to a configuration value, written as a JSON pointer (RFC 6901): "/vhosts/3/root".
+     * "~1" stands for a '/' inside a key and "~0" for a '~'; "" is the root itself.
+     *
+     * The pointer is parsed once, typically when a module is configured; find() then walks
+     * the configuration without allocating or throwing, so it can be used on every request.
+     */
+    class ConfPath {
+    private:
+        struct Step {
+            std::string key;
+            int index; // key as an array index, -1 if it is not one
+        };
+
+        std::vector<Step> steps{};
+
+        static int indexOf(const std::string &key) {
+            if (key.empty() || key.size() > 9 || (key.size() > 1 && key[0] == '0'))
+                return -1;
+            int index = 0;
+            for (char c : key) {
+                if (c < '0' || c > '9')
+                    return -1;
+                index = index * 10 + (c - '0');
+            }
+            return index;
+        }
+
+        ConfPath() = default;
+
+    public:
+        /**
+         * @return std::nullopt if pointer is not a valid JSON pointer.
+         */
+        static std::optional<ConfPath> parse(std::string_view pointer) {
+            ConfPath path;
+            if (pointer.empty())
+                return path;
+            if (pointer[0] != '/')
+                return std::nullopt;
+
+            std::string key;
+            for (std::size_t i = 1; i <= pointer.size(); ++i) {
+                if (i == pointer.size() || pointer[i] == '/') {
+                    int index = indexOf(key);
+                    path.steps.push_back({std::move(key), index});
+                    key.clear();
+                } else if (pointer[i] == '~') {
+                    if (i + 1 == pointer.size() || (pointer[i + 1] != '0' && pointer[i + 1] != '1'))
+                        return std::nullopt;
+                    key += pointer[++i] == '0' ? '~' : '/';
+                } else {
+                    key += pointer[i];
+                }
+            }
+            return path;
+        }
+
+        std::size_t size() const {
+            return this->steps.size();
+        }
+
+        /**
+         * @return nullptr if a step is missing or crosses a value which is neither a map nor an array.
+         */
+        const ConfElem *find(const ConfElem &root) const {
+            const ConfElem *elem = &root;
+            for (const auto &step : this->steps) {
+                elem = step.index >= 0 && elem->getType() == ConfElem::Type::Array
+                       ? elem->find(step.index) : elem->find(step.key);
+                if (!elem)
+                    return nullptr;
+            }
+            return elem;
+        }
+
+        std::optional<CompiledConf::Node> find(const CompiledConf::Node &root) const {
+            std::optional<CompiledConf::Node> node = root;
+            for (const auto &step : this->steps) {
+                node = step.index >= 0 && node->getType() == CompiledConf::Type::Array
+                       ? node->find(step.index) : node->find(step.key);
+                if (!node)
+                    return std::nullopt;
+            }
+            return node;
+        }
+
+        std::optional<CompiledConf::Node> find(const CompiledConf &conf) const {
+            return this->find(conf.root());
+        }
+
+        /**
+         * Value at the path, std::nullopt if it is missing or not a T.
+         */
+        template<typename T, typename TConf>
+        std::optional<T> try_get(const TConf &conf) const {
+            auto found = this->find(conf);
+            if (!found)
+                return std::nullopt;
+            return found->template try_get<T>();
+        }
+    };
+
+}
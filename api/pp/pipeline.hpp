@@ -0,0 +1,141 @@
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../module.h"
+
+#include "arena.hpp"
+#include "http.hpp"
+#include "module.hpp"
+#include "pool.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Ordered chain of modules executed on each request.
+     *
+     * The HttpDuplex is converted to SZA++ objects once, then every consecutive SZA++ module
+     * shares the same Context. A conversion only happens at the boundary with a basic
+     * zia::api::Module, and the objects are written back to the duplex once at the end.
+     * The pipeline keeps no per-request state: it is as reentrant as the modules it holds.
+     *
+     * The SZA++ objects of a request are allocated from a RequestArena living on the stack of exec(),
+     * dropped at once when the request is over (see useArena()). Its blocks past the inline buffer are
+     * kept by the thread for the next requests (see recycledMemory()).
+     */
+    class Pipeline : public SmartModule {
+    private:
+        struct Stage {
+            std::shared_ptr<zia::api::Module> module;
+            SmartModule *smart; // Same object as module when it is a SZA++ module, nullptr otherwise.
+        };
+
+        std::vector<Stage> stages;
+        bool arena = true;
+
+    public:
+        ~Pipeline() override = default;
+
+        /**
+         * Append a module at the end of the chain.
+         */
+        Pipeline &add(std::shared_ptr<zia::api::Module> module) {
+            auto *smart = dynamic_cast<SmartModule *>(module.get());
+            this->stages.push_back(Stage{std::move(module), smart});
+            return *this;
+        }
+
+        std::size_t size() const {
+            return this->stages.size();
+        }
+
+        /**
+         * Allocate the objects of each request from a per-request arena (the default), or from the heap.
+         * Modules must then not keep the request, the response or anything from Context::memory
+         * once exec() returns.
+         */
+        Pipeline &useArena(bool enabled) {
+            this->arena = enabled;
+            return *this;
+        }
+
+        /**
+         * Configure every module of the chain.
+         * \return true if all modules succeeded, otherwise false.
+         */
+        bool config(const zia::api::Conf &conf) override {
+            bool ret = true;
+
+            for (auto &stage : this->stages) {
+                ret = stage.module->config(conf) && ret;
+            }
+            return ret;
+        }
+
+        /**
+         * Run the chain on the duplex, stops at the first module returning false.
+         * \return true if all modules succeeded, otherwise false.
+         */
+        bool exec(zia::api::HttpDuplex &http) override {
+            // Declared first so that it is released after the objects of ctx.
+            RequestArena requestArena(recycledMemory());
+            Context ctx{nullptr, nullptr, http.info};
+            bool ret = true;
+
+            if (this->arena)
+                ctx.memory = requestArena.memory();
+            for (auto &stage : this->stages) {
+                if (stage.smart) {
+                    if (!ctx.request) {
+                        ctx.response = Response::viewBasicHttpDuplex(http, ctx.memory);
+                        ctx.request = Request::viewBasicHttpDuplex(http, ctx.memory);
+                    }
+                    ret = stage.smart->smartExec(ctx);
+                } else {
+                    if (ctx.request) {
+                        ctx.response->applyTo(http);
+                        ctx.request->applyTo(http);
+                        ctx.response.reset();
+                        ctx.request.reset();
+                    }
+                    ret = stage.module->exec(http);
+                }
+                if (!ret)
+                    break;
+            }
+
+            if (ctx.request) {
+                ctx.response->applyTo(http);
+                ctx.request->applyTo(http);
+            }
+            return ret;
+        }
+
+        /**
+         * Run the chain on already converted SZA++ objects, so pipelines can be nested.
+         * \return true if all modules succeeded, otherwise false.
+         */
+        bool smartExec(Context &ctx) override {
+            for (auto &stage : this->stages) {
+                bool ret;
+
+                if (stage.smart) {
+                    ret = stage.smart->smartExec(ctx);
+                } else {
+                    auto duplex = createBasicHttpDuplex(ctx.request, ctx.response, ctx.net, ctx.memory);
+                    auto stream = ctx.request->bodyStream();
+                    ret = stage.module->exec(duplex);
+                    ctx.response = Response::fromBasicHttpDuplex(duplex, ctx.memory);
+                    ctx.request = Request::fromBasicHttpDuplex(duplex, ctx.memory);
+                    ctx.request->setBodyStream(std::move(stream));
+                }
+                if (!ret)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+}
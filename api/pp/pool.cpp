@@ -0,0 +1,64 @@
+
+#include "pool.hpp"
+
+namespace zia::apipp {
+
+    namespace {
+        template<typename T>
+        void clearKeeping(std::vector<T> &buffer, std::size_t keep) {
+            if (buffer.capacity() * sizeof(T) > keep)
+                std::vector<T>().swap(buffer);
+            else
+                buffer.clear();
+        }
+    }
+
+    void recycle(zia::api::HttpDuplex &duplex, std::size_t keep) {
+        duplex.info = zia::api::NetInfo{};
+        clearKeeping(duplex.raw_req, keep);
+        clearKeeping(duplex.raw_resp, keep);
+
+        duplex.req.version = zia::api::http::Version{};
+        duplex.req.headers.clear();
+        clearKeeping(duplex.req.body, keep);
+        duplex.req.method = zia::api::http::Method{};
+        duplex.req.uri.clear();
+
+        duplex.resp.version = zia::api::http::Version{};
+        duplex.resp.headers.clear();
+        clearKeeping(duplex.resp.body, keep);
+        duplex.resp.status = 0;
+        duplex.resp.reason.clear();
+        duplex.resp.file.reset();
+        duplex.resp.wire.reset();
+    }
+
+    void DuplexPool::release(zia::api::HttpDuplex *duplex) {
+        std::unique_ptr<zia::api::HttpDuplex> owned(duplex);
+
+        if (this->idle.size() < this->limit) {
+            recycle(*owned);
+            this->idle.push_back(std::move(owned));
+        }
+    }
+
+    DuplexPool::Lease DuplexPool::acquire() {
+        if (this->idle.empty())
+            return Lease(new zia::api::HttpDuplex(), Giveback{this});
+
+        auto *duplex = this->idle.back().release();
+        this->idle.pop_back();
+        return Lease(duplex, Giveback{this});
+    }
+
+    DuplexPool &DuplexPool::local() {
+        thread_local DuplexPool pool;
+        return pool;
+    }
+
+    std::pmr::memory_resource *recycledMemory() {
+        thread_local std::pmr::unsynchronized_pool_resource pool;
+        return &pool;
+    }
+
+}
@@ -0,0 +1,77 @@
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "../http.h"
+
+namespace zia::apipp {
+
+    /**
+     * Reset duplex for a new request, keeping the capacity of its buffers and header maps.
+     * Buffers larger than keep bytes (e.g. after an upload) are freed instead of held forever.
+     */
+    void recycle(zia::api::HttpDuplex &duplex, std::size_t keep = 64 * 1024);
+
+    /**
+     * Idle HttpDuplex objects of one thread, handed out reset but still allocated so that steady-state
+     * requests reuse the buffers of the previous ones instead of allocating.
+     *
+     * Not synchronized: a duplex must be given back on the thread that acquired it (see local()).
+     */
+    class DuplexPool {
+    public:
+        struct Giveback {
+            DuplexPool *pool;
+
+            void operator()(zia::api::HttpDuplex *duplex) const {
+                this->pool->release(duplex);
+            }
+        };
+
+        /**
+         * A duplex of the pool, given back when destroyed.
+         */
+        using Lease = std::unique_ptr<zia::api::HttpDuplex, Giveback>;
+
+    private:
+        std::vector<std::unique_ptr<zia::api::HttpDuplex>> idle{};
+        const std::size_t limit;
+
+        void release(zia::api::HttpDuplex *duplex);
+
+    public:
+        /**
+         * @param capacity most idle duplexes kept, the others are freed when given back.
+         */
+        explicit DuplexPool(std::size_t capacity = 64) : limit{capacity} {}
+
+        DuplexPool(const DuplexPool &) = delete;
+        DuplexPool &operator=(const DuplexPool &) = delete;
+
+        /**
+         * An empty duplex, recycled if one is idle.
+         */
+        Lease acquire();
+
+        std::size_t size() const {
+            return this->idle.size();
+        }
+
+        /**
+         * Pool of the calling thread.
+         */
+        static DuplexPool &local();
+    };
+
+    /**
+     * Memory resource of the calling thread keeping freed blocks for reuse, used as the upstream of the
+     * per-request arena (see RequestArena) so that requests too large for its inline buffer do not hit
+     * the heap either once the blocks exist. Only for memory released on the same thread.
+     */
+    std::pmr::memory_resource *recycledMemory();
+
+}
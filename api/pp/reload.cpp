@@ -0,0 +1,160 @@
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "reload.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Epoch state shared by a manager and the threads which read it. Threads keep it alive, so that
+     * their records stay valid whatever is destroyed first.
+     */
+    struct ConfigManager::Domain {
+        struct Record {
+            std::atomic<std::uint64_t> epoch{0}; // Epoch at which the outermost Reader started, 0 outside.
+            std::atomic<bool> used{true};
+            std::size_t depth = 0; // Only touched by the owning thread.
+            Record *next = nullptr;
+        };
+
+        std::atomic<std::uint64_t> epoch{1};
+        std::atomic<Record *> records{nullptr};
+
+        ~Domain() {
+            for (auto *record = this->records.load(); record;)
+                delete std::exchange(record, record->next);
+        }
+
+        // Records are never removed from the list: a free one is reused, or a new one is pushed.
+        Record *acquire() {
+            for (auto *record = this->records.load(); record; record = record->next) {
+                bool used = false;
+                if (!record->used.load() && record->used.compare_exchange_strong(used, true))
+                    return record;
+            }
+
+            auto *record = new Record();
+            record->next = this->records.load();
+            while (!this->records.compare_exchange_weak(record->next, record));
+            return record;
+        }
+
+        /**
+         * Oldest epoch a thread is reading at, max if there is none.
+         */
+        std::uint64_t oldest() const {
+            auto oldest = std::numeric_limits<std::uint64_t>::max();
+            for (auto *record = this->records.load(); record; record = record->next) {
+                auto epoch = record->epoch.load();
+                if (epoch)
+                    oldest = std::min(oldest, epoch);
+            }
+            return oldest;
+        }
+
+        /**
+         * Record of the calling thread in domain, acquired on its first Reader.
+         */
+        static Record &local(const std::shared_ptr<Domain> &domain) {
+            struct Entry {
+                std::shared_ptr<Domain> domain;
+                Record *record;
+            };
+            struct Cache {
+                std::vector<Entry> entries;
+
+                ~Cache() {
+                    for (auto &entry : this->entries)
+                        entry.record->used.store(false);
+                }
+            };
+            thread_local Cache cache;
+
+            for (auto &entry : cache.entries) {
+                if (entry.domain == domain)
+                    return *entry.record;
+            }
+
+            // Forget the domains of destroyed managers, only kept alive by this cache.
+            cache.entries.erase(std::remove_if(cache.entries.begin(), cache.entries.end(), [](const Entry &entry) {
+                return entry.domain.use_count() == 1;
+            }), cache.entries.end());
+            cache.entries.push_back(Entry{domain, domain->acquire()});
+            return *cache.entries.back().record;
+        }
+    };
+
+    ConfigManager::ConfigManager(Factory build)
+            : domain{std::make_shared<Domain>()}, factory{std::move(build)} {
+        this->current.store(new ConfSnapshot{zia::api::Conf{}, CompiledConf(), nullptr, 0});
+    }
+
+    ConfigManager::~ConfigManager() {
+        delete this->current.load();
+    }
+
+    void ConfigManager::enter() const {
+        auto &record = Domain::local(this->domain);
+        if (record.depth++ == 0)
+            record.epoch.store(this->domain->epoch.load());
+    }
+
+    void ConfigManager::leave() const {
+        auto &record = Domain::local(this->domain);
+        if (--record.depth == 0)
+            record.epoch.store(0);
+    }
+
+    ConfigManager::Reader::Reader(const ConfigManager &from) : manager{&from} {
+        // The epoch is published before the pointer is read: a writer retiring this snapshot sees it.
+        from.enter();
+        this->snapshot = from.current.load();
+    }
+
+    ConfigManager::Reader::~Reader() {
+        this->manager->leave();
+    }
+
+    bool ConfigManager::reload(zia::api::Conf conf) {
+        std::shared_ptr<zia::api::Module> module;
+        if (this->factory) {
+            module = this->factory(conf);
+            if (module && !module->config(conf))
+                return false;
+        }
+        CompiledConf compiled(conf);
+
+        std::lock_guard<std::mutex> guard(this->writer);
+        auto snapshot = std::make_unique<ConfSnapshot>(
+                ConfSnapshot{std::move(conf), std::move(compiled), std::move(module), ++this->versions});
+        std::unique_ptr<const ConfSnapshot> replaced(this->current.exchange(snapshot.release()));
+
+        // Readers which may hold the replaced snapshot started at this epoch or before.
+        auto epoch = this->domain->epoch.fetch_add(1);
+        this->retiredSnapshots.push_back(Retired{std::move(replaced), epoch});
+        this->collect();
+        return true;
+    }
+
+    void ConfigManager::collect() {
+        auto oldest = this->domain->oldest();
+        this->retiredSnapshots.erase(
+                std::remove_if(this->retiredSnapshots.begin(), this->retiredSnapshots.end(),
+                               [oldest](const Retired &retired) { return retired.epoch < oldest; }),
+                this->retiredSnapshots.end());
+    }
+
+    std::size_t ConfigManager::reclaim() {
+        std::lock_guard<std::mutex> guard(this->writer);
+        this->collect();
+        return this->retiredSnapshots.size();
+    }
+
+    std::uint64_t ConfigManager::version() const {
+        Reader reader(*this);
+        return reader->version;
+    }
+
+}
@@ -0,0 +1,134 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../conf.h"
+#include "../module.h"
+
+#include "compiled.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Configuration and the modules configured with it, as seen by the requests started while it was current.
+     */
+    struct ConfSnapshot {
+        zia::api::Conf conf;
+        CompiledConf compiled;
+        /**
+         * Chain executed on requests (e.g. a Pipeline), built for this configuration, nullptr if there is none.
+         */
+        std::shared_ptr<zia::api::Module> module;
+        std::uint64_t version;
+    };
+
+    /**
+     * Hot reload of the configuration while traffic is flowing.
+     *
+     * The current ConfSnapshot sits behind an atomic pointer. reload() builds a new one off the request
+     * path: fresh modules from the factory, each config()-ured against the new Conf, then swaps the
+     * pointer. Requests hold a Reader for their duration: they keep the snapshot they started with, and
+     * taking one is two atomic operations, without any lock.
+     *
+     * Replaced snapshots are reclaimed with epochs: a snapshot retired at epoch E is destroyed once every
+     * thread is either outside a Reader or inside one started after E. This happens in reload() and
+     * reclaim(), never on the request path.
+     */
+    class ConfigManager {
+    public:
+        /**
+         * Fresh modules for a configuration, config() is called on them by the manager.
+         */
+        using Factory = std::function<std::shared_ptr<zia::api::Module>(const zia::api::Conf &)>;
+
+    private:
+        struct Domain;
+
+        std::shared_ptr<Domain> domain;
+        std::atomic<const ConfSnapshot *> current{nullptr};
+        Factory factory;
+
+        std::mutex writer{}; // Serializes reload() and reclaim(), never taken by readers.
+        struct Retired {
+            std::unique_ptr<const ConfSnapshot> snapshot;
+            std::uint64_t epoch;
+        };
+        std::vector<Retired> retiredSnapshots{};
+        std::uint64_t versions = 0;
+
+        void enter() const;
+
+        void leave() const;
+
+        // Writer lock must be held.
+        void collect();
+
+    public:
+        /**
+         * Read access to the current snapshot, which stays valid (and current for its holder) until destroyed.
+         * Must be destroyed on the thread which took it. Readers can be nested.
+         */
+        class Reader {
+        private:
+            const ConfigManager *manager;
+            const ConfSnapshot *snapshot;
+
+        public:
+            explicit Reader(const ConfigManager &from);
+
+            Reader(const Reader &) = delete;
+            Reader &operator=(const Reader &) = delete;
+
+            ~Reader();
+
+            const ConfSnapshot &operator*() const {
+                return *this->snapshot;
+            }
+
+            const ConfSnapshot *operator->() const {
+                return this->snapshot;
+            }
+        };
+
+        /**
+         * @param build modules for each configuration, none if empty.
+         */
+        explicit ConfigManager(Factory build = {});
+
+        ConfigManager(const ConfigManager &) = delete;
+        ConfigManager &operator=(const ConfigManager &) = delete;
+
+        /**
+         * Every Reader must have been destroyed.
+         */
+        ~ConfigManager();
+
+        /**
+         * Build and configure the snapshot of conf, then make it current.
+         * @return false if a module rejected conf: the current snapshot is kept.
+         */
+        bool reload(zia::api::Conf conf);
+
+        Reader read() const {
+            return Reader(*this);
+        }
+
+        /**
+         * Destroy the replaced snapshots no request uses anymore.
+         * @return number of replaced snapshots still in use.
+         */
+        std::size_t reclaim();
+
+        /**
+         * Version of the current snapshot: 0 before the first reload, then incremented by each one.
+         */
+        std::uint64_t version() const;
+    };
+
+}
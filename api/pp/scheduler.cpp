@@ -0,0 +1,285 @@
+
+#include <algorithm>
+#include <utility>
+
+#include "body.hpp"
+#include "parser.hpp"
+#include "scheduler.hpp"
+#include "serializer.hpp"
+
+namespace zia::apipp {
+
+    namespace {
+        constexpr std::size_t maxBatch = 32;
+
+        // Worker of the running thread, so that the jobs it submits go to its own deque.
+        thread_local const Scheduler *currentScheduler = nullptr;
+        thread_local void *currentWorker = nullptr;
+
+        std::uint32_t nextRandom(std::uint32_t &seed) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            return seed;
+        }
+
+        unsigned workersOf(const zia::api::Conf &conf) {
+            auto found = conf.find("worker_threads");
+            if (found == conf.end())
+                return 0;
+            auto *count = std::get_if<long long>(&found->second.v);
+            return count && *count > 0 ? static_cast<unsigned>(*count) : 0;
+        }
+
+        /**
+         * A request being answered, from its parsing to its response.
+         */
+        struct Exchange {
+            zia::api::HttpDuplex duplex{};
+            std::shared_ptr<BodyStream> stream;
+            bool parsed;
+            std::atomic<bool> answered{false};
+
+            Exchange(zia::api::Net::Raw raw, const zia::api::NetInfo &info) : stream{bodyStreamOf(info)} {
+                this->duplex.info = info;
+                this->parsed = this->stream ? parseRequestHead(raw, this->duplex.req)
+                                            : parseRequest(raw, info, this->duplex.req);
+                this->duplex.raw_req = std::move(raw);
+                this->duplex.resp.version = this->parsed && this->duplex.req.version != zia::api::http::Version::unknown
+                                            ? this->duplex.req.version : zia::api::http::Version::http_1_1;
+            }
+
+            /**
+             * Drop what the handler left, the response becomes a 500.
+             */
+            void fail() {
+                auto version = this->duplex.resp.version;
+                this->duplex.resp = zia::api::HttpResponse{};
+                this->duplex.resp.version = version;
+            }
+
+            /**
+             * Send the response, once.
+             */
+            void respond(const Scheduler::Sender &send) {
+                namespace http = zia::api::http;
+
+                if (this->answered.exchange(true))
+                    return;
+                if (!this->duplex.resp.status)
+                    this->duplex.resp.status = this->parsed ? http::common_status::internal_server_error
+                                                            : http::common_status::bad_request;
+                // Whatever the modules did not read is not wanted.
+                if (this->stream)
+                    this->stream->abandon();
+
+                // A response already serialized (wire), e.g. by a cache, is sent from its bytes.
+                ResponseSerializer serializer;
+                serializer.omitBody(this->duplex.req.method == http::Method::head);
+                serializer.serialize(this->duplex.resp);
+                send(this->duplex.info.sock, serializer);
+            }
+        };
+
+        void answer(const Scheduler::Sender &send, const Scheduler::Handler &handler, zia::api::Net::Raw raw,
+                    const zia::api::NetInfo &info) {
+            Exchange exchange(std::move(raw), info);
+
+            if (exchange.parsed) {
+                try {
+                    handler(exchange.duplex);
+                } catch (...) {
+                    exchange.fail();
+                }
+            }
+            exchange.respond(send);
+        }
+
+        void answerAsync(const Scheduler::Sender &send, const Scheduler::AsyncHandler &handler,
+                         zia::api::Net::Raw raw, const zia::api::NetInfo &info) {
+            auto exchange = std::make_shared<Exchange>(std::move(raw), info);
+
+            if (!exchange->parsed)
+                return exchange->respond(send);
+            try {
+                handler(exchange->duplex, [exchange, send](bool) { exchange->respond(send); });
+            } catch (...) {
+                // Only if it threw before resuming, the duplex may be in use otherwise.
+                if (!exchange->answered.load()) {
+                    exchange->fail();
+                    exchange->respond(send);
+                }
+            }
+        }
+
+        void unavailable(const Scheduler::Sender &send, zia::api::ImplSocket *sock) {
+            zia::api::HttpResponse response{};
+            response.version = zia::api::http::Version::http_1_1;
+            response.status = zia::api::http::common_status::service_unavailable;
+            ResponseSerializer serializer;
+            serializer.serialize(response);
+            send(sock, serializer);
+        }
+
+        Scheduler::Sender copying(zia::api::Net &net) {
+            return [&net](zia::api::ImplSocket *sock, const ResponseSerializer &resp) {
+                return net.send(sock, resp.toRaw());
+            };
+        }
+    }
+
+    Scheduler::Scheduler(unsigned count) {
+        if (!count)
+            count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < count; ++i) {
+            this->workers.push_back(std::make_unique<Worker>());
+            this->workers.back()->seed = 2654435761u * (i + 1);
+        }
+        for (auto &worker : this->workers)
+            worker->thread = std::thread([this, &worker]() { this->run(*worker); });
+    }
+
+    Scheduler::Scheduler(const zia::api::Conf &conf) : Scheduler(workersOf(conf)) {}
+
+    Scheduler::~Scheduler() {
+        this->stop();
+    }
+
+    bool Scheduler::onWorker() noexcept {
+        return currentScheduler != nullptr;
+    }
+
+    void Scheduler::notify() {
+        if (this->sleeping.load() > 0) {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->wake.notify_one();
+        }
+    }
+
+    bool Scheduler::submit(Job job) {
+        auto *task = new Task{std::move(job)};
+
+        if (currentScheduler == this) {
+            ++this->pending;
+            static_cast<Worker *>(currentWorker)->deque.push(task);
+        } else {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (this->stopping) {
+                delete task;
+                return false;
+            }
+            ++this->pending;
+            this->injected.push_back(task);
+        }
+        this->notify();
+        return true;
+    }
+
+    Scheduler::Task *Scheduler::find(Worker &self) {
+        if (auto *task = self.deque.pop()) {
+            --this->pending;
+            return task;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (!this->injected.empty()) {
+                auto *task = this->injected.front();
+                this->injected.pop_front();
+                // A share of the rest, which the other workers can steal if this one gets stuck.
+                auto batch = std::min(maxBatch, this->injected.size() / this->workers.size());
+                for (std::size_t i = 0; i < batch; ++i) {
+                    self.deque.push(this->injected.front());
+                    this->injected.pop_front();
+                }
+                --this->pending;
+                return task;
+            }
+        }
+
+        auto count = this->workers.size();
+        auto start = nextRandom(self.seed);
+        for (std::size_t i = 0; i < count; ++i) {
+            auto &victim = *this->workers[(start + i) % count];
+            if (&victim == &self)
+                continue;
+            if (auto *task = victim.deque.steal()) {
+                ++this->stolen;
+                --this->pending;
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void Scheduler::run(Worker &self) {
+        currentScheduler = this;
+        currentWorker = &self;
+
+        for (;;) {
+            if (auto *task = this->find(self)) {
+                task->job();
+                delete task;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> guard(this->lock);
+            // Counted before checking for jobs: a submit either sees it, or is seen by the check.
+            ++this->sleeping;
+            this->wake.wait(guard, [this]() { return this->pending.load() > 0 || this->stopping; });
+            --this->sleeping;
+            if (this->stopping && this->pending.load() == 0)
+                break;
+        }
+
+        currentScheduler = nullptr;
+        currentWorker = nullptr;
+    }
+
+    void Scheduler::stop() {
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (auto &worker : this->workers) {
+            if (worker->thread.joinable())
+                worker->thread.join();
+        }
+    }
+
+    zia::api::Net::Callback Scheduler::serve(Sender send, Handler handler) {
+        auto shared = std::make_shared<const std::pair<Sender, Handler>>(std::move(send), std::move(handler));
+
+        return [this, shared](zia::api::Net::Raw raw, zia::api::NetInfo info) {
+            auto sock = info.sock;
+            auto queued = this->submit([shared, raw = std::move(raw), info]() mutable {
+                answer(shared->first, shared->second, std::move(raw), info);
+            });
+            if (!queued)
+                unavailable(shared->first, sock);
+        };
+    }
+
+    zia::api::Net::Callback Scheduler::serveAsync(Sender send, AsyncHandler handler) {
+        auto shared = std::make_shared<const std::pair<Sender, AsyncHandler>>(std::move(send), std::move(handler));
+
+        return [this, shared](zia::api::Net::Raw raw, zia::api::NetInfo info) {
+            auto sock = info.sock;
+            auto queued = this->submit([shared, raw = std::move(raw), info]() mutable {
+                answerAsync(shared->first, shared->second, std::move(raw), info);
+            });
+            if (!queued)
+                unavailable(shared->first, sock);
+        };
+    }
+
+    zia::api::Net::Callback Scheduler::serve(zia::api::Net &net, Handler handler) {
+        return this->serve(copying(net), std::move(handler));
+    }
+
+    zia::api::Net::Callback Scheduler::serveAsync(zia::api::Net &net, AsyncHandler handler) {
+        return this->serveAsync(copying(net), std::move(handler));
+    }
+
+}
@@ -0,0 +1,280 @@
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../conf.h"
+#include "../http.h"
+#include "../net.h"
+#include "serializer.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Chase-Lev work-stealing deque of pointers: its owner thread pushes and pops at the bottom,
+     * any other thread steals from the top. No lock; the array grows as needed, replaced arrays
+     * are kept until destruction since a thief may still be reading them.
+     */
+    template<typename T>
+    class StealingDeque {
+    private:
+        struct Array {
+            std::int64_t capacity;
+            std::unique_ptr<std::atomic<T *>[]> items;
+
+            explicit Array(std::int64_t size) : capacity{size}, items{new std::atomic<T *>[size]} {}
+
+            T *get(std::int64_t index) const {
+                return this->items[index & (this->capacity - 1)].load(std::memory_order_relaxed);
+            }
+
+            void put(std::int64_t index, T *item) {
+                this->items[index & (this->capacity - 1)].store(item, std::memory_order_relaxed);
+            }
+        };
+
+        alignas(64) std::atomic<std::int64_t> top{0};
+        alignas(64) std::atomic<std::int64_t> bottom{0};
+        std::atomic<Array *> array;
+        std::vector<std::unique_ptr<Array>> arrays{}; // Owner only.
+
+    public:
+        explicit StealingDeque(std::int64_t capacity = 256) {
+            this->arrays.push_back(std::make_unique<Array>(capacity));
+            this->array.store(this->arrays.back().get(), std::memory_order_relaxed);
+        }
+
+        StealingDeque(const StealingDeque &) = delete;
+        StealingDeque &operator=(const StealingDeque &) = delete;
+
+        /**
+         * Owner only.
+         */
+        void push(T *item) {
+            auto b = this->bottom.load(std::memory_order_relaxed);
+            auto t = this->top.load(std::memory_order_acquire);
+            auto *a = this->array.load(std::memory_order_relaxed);
+            if (b - t > a->capacity - 1) {
+                auto bigger = std::make_unique<Array>(a->capacity * 2);
+                for (auto i = t; i < b; ++i)
+                    bigger->put(i, a->get(i));
+                a = bigger.get();
+                this->arrays.push_back(std::move(bigger));
+                this->array.store(a, std::memory_order_release);
+            }
+            a->put(b, item);
+            this->bottom.store(b + 1, std::memory_order_release);
+        }
+
+        /**
+         * Owner only, last pushed first.
+         * @return nullptr if empty.
+         */
+        T *pop() {
+            auto b = this->bottom.load(std::memory_order_relaxed) - 1;
+            auto *a = this->array.load(std::memory_order_relaxed);
+            this->bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t = this->top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            auto *item = a->get(b);
+            if (t == b) {
+                // Last item: race against the thieves for it.
+                if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    item = nullptr;
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        /**
+         * Any thread, first pushed first.
+         * @return nullptr if empty or lost to another thread.
+         */
+        T *steal() {
+            auto t = this->top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto b = this->bottom.load(std::memory_order_acquire);
+            if (t >= b)
+                return nullptr;
+
+            auto *item = this->array.load(std::memory_order_acquire)->get(t);
+            if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return item;
+        }
+
+        /**
+         * Approximate when other threads use the deque.
+         */
+        std::size_t size() const {
+            auto b = this->bottom.load(std::memory_order_relaxed);
+            auto t = this->top.load(std::memory_order_relaxed);
+            return b > t ? static_cast<std::size_t>(b - t) : 0;
+        }
+    };
+
+    /**
+     * Worker threads running the module chain, so that the Net threads only do I/O: a slow request
+     * (e.g. CGI) holds a worker, not the connections of a reactor.
+     *
+     * Jobs submitted from other threads (the Net callbacks) go to a shared queue, from which an idle
+     * worker takes a batch into its own StealingDeque. Jobs submitted by a worker go to its deque.
+     * A worker with nothing to do steals from the others, so jobs queued behind a slow one are taken
+     * by idle workers. Workers with nothing to steal sleep until a job is submitted.
+     */
+    class Scheduler {
+    public:
+        /**
+         * Must not throw.
+         */
+        using Job = std::function<void()>;
+
+        /**
+         * Runs the module chain on a request, e.g. a Pipeline's exec().
+         * \return true on success, otherwise false.
+         */
+        using Handler = std::function<bool(zia::api::HttpDuplex &)>;
+
+        /**
+         * Runs the module chain on a request and calls its last argument once over, from any thread,
+         * e.g. an AsyncPipeline's execAsync().
+         */
+        using AsyncHandler = std::function<void(zia::api::HttpDuplex &, std::function<void(bool)>)>;
+
+        /**
+         * Writes a serialized response to the connection of a request, e.g. a Net's send() overload taking
+         * a ResponseSerializer.
+         * \return true on success, otherwise false.
+         */
+        using Sender = std::function<bool(zia::api::ImplSocket *, const ResponseSerializer &)>;
+
+    private:
+        struct Task {
+            Job job;
+        };
+
+        struct Worker {
+            StealingDeque<Task> deque{};
+            std::thread thread{};
+            std::uint32_t seed;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers{};
+
+        std::mutex lock{};
+        std::condition_variable wake{};
+        std::deque<Task *> injected{}; // Jobs from other threads, guarded by lock.
+        bool stopping = false;         // Guarded by lock.
+
+        std::atomic<std::size_t> pending{0}; // Queued jobs, anywhere.
+        std::atomic<int> sleeping{0};
+        std::atomic<std::uint64_t> stolen{0};
+
+        void run(Worker &self);
+
+        Task *find(Worker &self);
+
+        void notify();
+
+    public:
+        /**
+         * @param count Worker threads, one per core when 0.
+         */
+        explicit Scheduler(unsigned count = 0);
+
+        /**
+         * Workers from the "worker_threads" entry of conf, one per core when it is absent or 0.
+         */
+        explicit Scheduler(const zia::api::Conf &conf);
+
+        ~Scheduler();
+
+        Scheduler(const Scheduler &) = delete;
+        Scheduler &operator=(const Scheduler &) = delete;
+
+        /**
+         * Queue job, from any thread.
+         * \return false once stopped, job is then not run.
+         */
+        bool submit(Job job);
+
+        /**
+         * Run the jobs already queued, then join the workers.
+         */
+        void stop();
+
+        std::size_t size() const {
+            return this->workers.size();
+        }
+
+        /**
+         * Whether the calling thread is a worker, of any Scheduler: it must not wait for other jobs.
+         */
+        static bool onWorker() noexcept;
+
+        /**
+         * Jobs taken from another worker's deque so far.
+         */
+        std::uint64_t steals() const {
+            return this->stolen.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Callback for Net::run: each request is given to handler and serialized on a worker, then the
+         * response is written by send. Requests which cannot be parsed are answered with 400, requests
+         * handler failed without setting a status with 500.
+         */
+        zia::api::Net::Callback serve(Sender send, Handler handler);
+
+        /**
+         * Like serve(), for a handler which can suspend the request: the worker is free as soon as handler
+         * returns, and the response is sent from the thread resuming it.
+         */
+        zia::api::Net::Callback serveAsync(Sender send, AsyncHandler handler);
+
+        /**
+         * Responses given to net.send() as a contiguous copy, for a Net which only takes raw bytes.
+         */
+        zia::api::Net::Callback serve(zia::api::Net &net, Handler handler);
+
+        zia::api::Net::Callback serveAsync(zia::api::Net &net, AsyncHandler handler);
+
+        /**
+         * Responses given to the send() overload of net taking a ResponseSerializer (EpollNet, UringNet,
+         * BackendNet): the segments are written as they are and a file body from its descriptor.
+         */
+        template<typename TNet, typename = decltype(std::declval<TNet &>().send(
+                nullptr, std::declval<const ResponseSerializer &>()))>
+        zia::api::Net::Callback serve(TNet &net, Handler handler) {
+            return this->serve(senderOf(net), std::move(handler));
+        }
+
+        template<typename TNet, typename = decltype(std::declval<TNet &>().send(
+                nullptr, std::declval<const ResponseSerializer &>()))>
+        zia::api::Net::Callback serveAsync(TNet &net, AsyncHandler handler) {
+            return this->serveAsync(senderOf(net), std::move(handler));
+        }
+
+        template<typename TNet>
+        static Sender senderOf(TNet &net) {
+            return [&net](zia::api::ImplSocket *sock, const ResponseSerializer &resp) {
+                return net.send(sock, resp);
+            };
+        }
+    };
+
+}
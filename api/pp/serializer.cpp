@@ -0,0 +1,238 @@
+
+#include <cstdint>
+#include <utility>
+
+#include "parser.hpp"
+#include "serializer.hpp"
+
+namespace zia::apipp {
+
+    namespace {
+        struct Reason {
+            zia::api::http::Status status;
+            const char *text;
+        };
+
+        constexpr Reason reasons[] = {
+                {100, "Continue"},
+                {101, "Switching Protocols"},
+                {200, "OK"},
+                {201, "Created"},
+                {202, "Accepted"},
+                {203, "Non-Authoritative Information"},
+                {204, "No Content"},
+                {205, "Reset Content"},
+                {206, "Partial Content"},
+                {300, "Multiple Choices"},
+                {301, "Moved Permanently"},
+                {302, "Found"},
+                {303, "See Other"},
+                {304, "Not Modified"},
+                {305, "Use Proxy"},
+                {307, "Temporary Redirect"},
+                {400, "Bad Request"},
+                {401, "Unauthorized"},
+                {402, "Payment Required"},
+                {403, "Forbidden"},
+                {404, "Not Found"},
+                {405, "Method Not Allowed"},
+                {406, "Not Acceptable"},
+                {407, "Proxy Authentication Required"},
+                {408, "Request Timeout"},
+                {409, "Conflict"},
+                {410, "Gone"},
+                {411, "Length Required"},
+                {412, "Precondition Failed"},
+                {413, "Request Entity Too Large"},
+                {414, "Request-URI Too Long"},
+                {415, "Unsupported Media Type"},
+                {416, "Requested Range Not Satisfiable"},
+                {417, "Expectation Failed"},
+                {418, "I'm a teapot"},
+                {500, "Internal Server Error"},
+                {501, "Not Implemented"},
+                {502, "Bad Gateway"},
+                {503, "Service Unavailable"},
+                {504, "Gateway Timeout"},
+                {505, "HTTP Version Not Supported"},
+        };
+
+        constexpr std::size_t reasonCount = sizeof(reasons) / sizeof(reasons[0]);
+        constexpr std::size_t versionDigit = 7; // "HTTP/1.1": the minor version.
+        constexpr std::size_t reasonStart = 13; // "HTTP/1.1 200 ".
+
+        struct Line {
+            char text[48];
+            std::size_t size;
+        };
+
+        constexpr Line makeLine(const Reason &reason) {
+            Line line{};
+            auto append = [&line](const char *str) {
+                while (*str)
+                    line.text[line.size++] = *str++;
+            };
+
+            append("HTTP/1.1 ");
+            line.text[line.size++] = static_cast<char>('0' + reason.status / 100);
+            line.text[line.size++] = static_cast<char>('0' + reason.status / 10 % 10);
+            line.text[line.size++] = static_cast<char>('0' + reason.status % 10);
+            line.text[line.size++] = ' ';
+            append(reason.text);
+            append("\r\n");
+            return line;
+        }
+
+        template<std::size_t... I>
+        constexpr std::array<Line, sizeof...(I)> makeLines(std::index_sequence<I...>) {
+            return {{makeLine(reasons[I])...}};
+        }
+
+        constexpr auto lines = makeLines(std::make_index_sequence<reasonCount>{});
+
+        // Status code to position in lines, 0xFF when unknown.
+        constexpr std::size_t maxStatus = 600;
+        constexpr auto makeIndex() {
+            std::array<std::uint8_t, maxStatus> index{};
+            for (auto &slot : index)
+                slot = 0xFF;
+            for (std::size_t i = 0; i < reasonCount; ++i)
+                index[reasons[i].status] = static_cast<std::uint8_t>(i);
+            return index;
+        }
+
+        constexpr auto statusIndex = makeIndex();
+
+        // A CR or LF would end the line early: what follows would be read as another header, or response.
+        bool isSafe(std::string_view text) {
+            return text.find_first_of("\r\n") == std::string_view::npos;
+        }
+
+        // True for headers that already frame the body.
+        bool isFraming(zia::api::http::Header id) {
+            return id == zia::api::http::Header::content_length || id == zia::api::http::Header::transfer_encoding;
+        }
+    }
+
+    std::string_view ResponseSerializer::statusLine(zia::api::http::Status status) noexcept {
+        if (status < 0 || static_cast<std::size_t>(status) >= maxStatus || statusIndex[status] == 0xFF)
+            return {};
+        const auto &line = lines[statusIndex[status]];
+        return {line.text, line.size};
+    }
+
+    void ResponseSerializer::startHead(zia::api::http::Version version, zia::api::http::Status status,
+                                       std::string_view reason) {
+        this->head.clear(); // Keeps the capacity for the next response.
+        this->closing = false;
+        this->whole = false;
+        this->unframed = (status >= 100 && status < 200) || status == zia::api::http::common_status::no_content;
+        this->bodyless = this->unframed || status == zia::api::http::common_status::not_modified;
+
+        if (!isSafe(reason))
+            reason = {};
+        // Precomputed line, unless a custom reason is given.
+        auto line = statusLine(status);
+        if (!line.empty() && (reason.empty() || reason == line.substr(reasonStart, line.size() - reasonStart - 2))) {
+            this->head.append(line);
+        } else {
+            this->head.append("HTTP/1.1 ");
+            this->head.append(std::to_string(status));
+            this->head.push_back(' ');
+            this->head.append(reason);
+            this->head.append("\r\n");
+        }
+        if (version == zia::api::http::Version::http_1_0)
+            this->head[versionDigit] = '0';
+    }
+
+    bool ResponseSerializer::addHeader(zia::api::http::Header id, std::string_view name, std::string_view value) {
+        if (!isSafe(name) || !isSafe(value) || (this->unframed && isFraming(id)))
+            return false;
+        if (id == zia::api::http::Header::connection)
+            this->closing = this->closing || RequestParser::hasToken(value, "close");
+
+        this->head.append(name);
+        this->head.append(": ");
+        this->head.append(value);
+        this->head.append("\r\n");
+        return true;
+    }
+
+    void ResponseSerializer::finishHead(ByteView body, std::shared_ptr<const zia::api::FileBody> file,
+                                        bool hasLength) {
+        if (this->bodyless) {
+            body = {};
+            file.reset();
+        } else if (!hasLength) {
+            this->head.append("Content-Length: ");
+            this->head.append(std::to_string(file ? file->length : body.size()));
+            this->head.append("\r\n");
+        }
+        this->head.append("\r\n");
+        this->body = body;
+        this->bodyFile = std::move(file);
+    }
+
+    void ResponseSerializer::serialize(const zia::api::HttpResponse &response) {
+        if (response.wire) {
+            this->head.clear();
+            this->closing = false;
+            this->whole = true;
+            this->body = ByteView(*response.wire);
+            this->bodyFile.reset();
+            return;
+        }
+        if (response.version == zia::api::http::Version::http_0_9) {
+            this->head.clear();
+            this->closing = true;
+            this->whole = false;
+            this->body = ByteView(response.body);
+            this->bodyFile = response.file;
+            return;
+        }
+
+        bool hasLength = false;
+        this->startHead(response.version, response.status, response.reason);
+        for (const auto &header : response.headers) {
+            if (this->addHeader(header.id, header.first, header.second))
+                hasLength = hasLength || isFraming(header.id);
+        }
+        this->finishHead(ByteView(response.body), response.file, hasLength);
+    }
+
+    void ResponseSerializer::serialize(const Response &response) {
+        if (response.version == zia::api::http::Version::http_0_9) {
+            this->head.clear();
+            this->closing = true;
+            this->whole = false;
+            this->bodyFile = response.fileBody();
+            this->body = this->bodyFile ? ByteView{} : response.rawBodyView();
+            return;
+        }
+
+        bool hasLength = false;
+        this->startHead(response.version, response.statusCode, response.statusReason);
+        for (const auto &header : response.headers) {
+            for (const auto &value : header.second) {
+                if (this->addHeader(header.id, header.first, value))
+                    hasLength = hasLength || isFraming(header.id);
+            }
+        }
+        auto file = response.fileBody();
+        this->finishHead(file ? ByteView{} : response.rawBodyView(), std::move(file), hasLength);
+    }
+
+    void ResponseSerializer::toRaw(zia::api::Net::Raw &raw) const {
+        auto head = this->header();
+        auto body = this->content();
+
+        raw.clear();
+        raw.reserve(this->size());
+        raw.insert(raw.end(), head.begin(), head.end());
+        raw.insert(raw.end(), body.begin(), body.end());
+        if (auto file = this->file())
+            readFile(*file, raw);
+    }
+
+}
@@ -0,0 +1,138 @@
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#define ZIA_HAS_IOVEC
+#endif
+
+#include "http.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Turn a response into wire bytes, as two segments: the status line and headers, written in a
+     * buffer reused from one response to the next, then the body, which is referenced and never copied.
+     *
+     * The segments can be given to writev (see iovecs()), or copied into raw_resp with toRaw(),
+     * in a single allocation.
+     *
+     * A file body (see zia::api::FileBody) is not a segment: it is given by file(), to be sent after them.
+     * A response already serialized (see zia::api::HttpResponse::wire) is the body segment alone.
+     *
+     * The referenced body must outlive the serializer use, until the next serialize() call.
+     */
+    class ResponseSerializer {
+    private:
+        std::string head{};
+        ByteView body{};
+        std::shared_ptr<const zia::api::FileBody> bodyFile{};
+        bool headOnly = false;
+        bool closing = false;
+        bool whole = false; // The body is the whole response.
+        bool bodyless = false;  // 1xx, 204 and 304 responses have no body.
+        bool unframed = false;  // 1xx and 204 ones have no framing headers either.
+
+        void startHead(zia::api::http::Version version, zia::api::http::Status status, std::string_view reason);
+
+        // @return false if the header is dropped.
+        bool addHeader(zia::api::http::Header id, std::string_view name, std::string_view value);
+
+        void finishHead(ByteView body, std::shared_ptr<const zia::api::FileBody> file, bool hasLength);
+
+    public:
+        /**
+         * Status line for common_status values, computed at compile time ("HTTP/1.1 200 OK\r\n").
+         * @return an empty view for other statuses.
+         */
+        static std::string_view statusLine(zia::api::http::Status status) noexcept;
+
+        /**
+         * A Content-Length header is added when the response has none and no Transfer-Encoding, except
+         * for 1xx, 204 and 304 responses, which are sent without a body. A 304 keeps the Content-Length
+         * it is given (the length of the response it stands for), 1xx and 204 drop it.
+         * HTTP/0.9 responses are the body alone.
+         *
+         * Headers whose name or value holds a CR or LF are dropped, and such a reason is replaced by the
+         * standard one: they would let the content split the response.
+         */
+        void serialize(const zia::api::HttpResponse &response);
+
+        /**
+         * Repeated headers are written as separate lines.
+         */
+        void serialize(const Response &response);
+
+        /**
+         * Whether the response has "Connection: close": the connection ends once it is sent.
+         */
+        bool closes() const {
+            return this->closing;
+        }
+
+        /**
+         * Do not send the body (HEAD requests). Content-Length still describes it.
+         */
+        void omitBody(bool omit = true) {
+            this->headOnly = omit;
+        }
+
+        /**
+         * Status line and headers.
+         */
+        ByteView header() const {
+            return ByteView(std::string_view(this->head));
+        }
+
+        ByteView content() const {
+            return this->headOnly && !this->whole ? ByteView{} : this->body;
+        }
+
+        /**
+         * Body to send from a file after the segments, nullptr if the body is in memory.
+         */
+        std::shared_ptr<const zia::api::FileBody> file() const {
+            return this->headOnly ? nullptr : this->bodyFile;
+        }
+
+        std::array<ByteView, 2> segments() const {
+            return {this->header(), this->content()};
+        }
+
+        std::size_t size() const {
+            auto file = this->file();
+            return this->head.size() + this->content().size() + (file ? static_cast<std::size_t>(file->length) : 0);
+        }
+
+#ifdef ZIA_HAS_IOVEC
+
+        /**
+         * Segments for writev/sendmsg, valid until the next serialize() call.
+         */
+        std::array<iovec, 2> iovecs() const {
+            auto head = this->header();
+            auto body = this->content();
+            return {iovec{const_cast<std::byte *>(head.data()), head.size()},
+                    iovec{const_cast<std::byte *>(body.data()), body.size()}};
+        }
+
+#endif
+
+        /**
+         * Contiguous copy of the response, a file body is read.
+         */
+        void toRaw(zia::api::Net::Raw &raw) const;
+
+        zia::api::Net::Raw toRaw() const {
+            zia::api::Net::Raw raw;
+            this->toRaw(raw);
+            return raw;
+        }
+    };
+
+}
@@ -0,0 +1,259 @@
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "json.hpp"
+#include "snapshot.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ZIA_SNAPSHOT_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zia::apipp {
+
+    namespace {
+        constexpr char snapshotMagic[8] = {'Z', 'I', 'A', 'C', 'O', 'N', 'F', '\0'};
+        constexpr std::uint32_t snapshotVersion = 1;
+        constexpr std::uint32_t byteOrderMark = 0x01020304;
+
+        /**
+         * Start of a snapshot file, followed by the nodes, the string spans and the characters,
+         * each section starting on 8 bytes.
+         */
+        struct Header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byteOrder; // Written as byteOrderMark by the host that saved the snapshot.
+            std::uint32_t slotSize;
+            std::uint32_t spanSize;
+            std::uint32_t nodeCount;
+            std::uint32_t stringCount;
+            std::uint64_t charsSize;
+            std::uint64_t source;
+            std::uint64_t checksum; // Of everything after the header.
+        };
+
+        std::size_t align8(std::size_t size) {
+            return (size + 7) & ~static_cast<std::size_t>(7);
+        }
+
+        // FNV-1a over 8 byte words.
+        std::uint64_t checksum(const char *data, std::size_t size) {
+            std::uint64_t hash = 0xcbf29ce484222325ULL;
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, data + i, 8);
+                hash = (hash ^ word) * 0x100000001b3ULL;
+            }
+            for (; i < size; ++i)
+                hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+            return hash;
+        }
+    }
+
+    class CompiledConf::Snapshot {
+    private:
+        struct Layout {
+            std::size_t nodes;
+            std::size_t strings;
+            std::size_t chars;
+            std::size_t size;
+        };
+
+        static Layout layout(std::size_t nodeCount, std::size_t stringCount, std::size_t charsSize) {
+            Layout at{};
+            at.nodes = align8(sizeof(Header));
+            at.strings = align8(at.nodes + nodeCount * sizeof(Slot));
+            at.chars = align8(at.strings + stringCount * sizeof(Span));
+            at.size = at.chars + charsSize;
+            return at;
+        }
+
+        // Everything read in place is checked: a corrupted snapshot must not make lookups read out of it.
+        static bool valid(const char *data, std::size_t size, std::uint64_t source) {
+            if (size < sizeof(Header))
+                return false;
+            Header header;
+            std::memcpy(&header, data, sizeof(header));
+            if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0 ||
+                header.version != snapshotVersion || header.byteOrder != byteOrderMark ||
+                header.slotSize != sizeof(Slot) || header.spanSize != sizeof(Span) || header.nodeCount == 0 ||
+                (source && header.source != source) || header.charsSize > size)
+                return false;
+
+            auto at = layout(header.nodeCount, header.stringCount, header.charsSize);
+            if (at.size != size || checksum(data + sizeof(Header), size - sizeof(Header)) != header.checksum)
+                return false;
+
+            auto nodes = reinterpret_cast<const Slot *>(data + at.nodes);
+            auto strings = reinterpret_cast<const Span *>(data + at.strings);
+            for (std::uint32_t i = 0; i < header.stringCount; ++i) {
+                if (std::uint64_t{strings[i].offset} + strings[i].length > header.charsSize)
+                    return false;
+            }
+            for (std::uint32_t i = 0; i < header.nodeCount; ++i) {
+                const auto &slot = nodes[i];
+                switch (slot.type) {
+                    case Type::String:
+                        if (slot.first >= header.stringCount)
+                            return false;
+                        break;
+                    case Type::Map:
+                    case Type::Array:
+                        // Children always come after their parent, so walking the tree ends.
+                        if (slot.size && (slot.first <= i || std::uint64_t{slot.first} + slot.size > header.nodeCount))
+                            return false;
+                        for (std::uint32_t child = 0; slot.type == Type::Map && child < slot.size; ++child) {
+                            if (nodes[slot.first + child].key >= header.stringCount)
+                                return false;
+                        }
+                        break;
+                    case Type::Empty:
+                    case Type::Integer:
+                    case Type::Double:
+                    case Type::Boolean:
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        static std::shared_ptr<const void> read(const std::string &path, std::size_t &size) {
+#ifdef ZIA_SNAPSHOT_MMAP
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return nullptr;
+            struct stat info{};
+            if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+                ::close(fd);
+                return nullptr;
+            }
+            size = static_cast<std::size_t>(info.st_size);
+            void *data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED)
+                return nullptr;
+            return std::shared_ptr<const void>(data, [size](const void *mapped) {
+                ::munmap(const_cast<void *>(mapped), size);
+            });
+#else
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file)
+                return nullptr;
+            size = static_cast<std::size_t>(file.tellg());
+            std::shared_ptr<std::uint64_t> data(new std::uint64_t[size / 8 + 1], std::default_delete<std::uint64_t[]>());
+            file.seekg(0);
+            if (!file.read(reinterpret_cast<char *>(data.get()), static_cast<std::streamsize>(size)))
+                return nullptr;
+            return data;
+#endif
+        }
+
+    public:
+        static void save(const Storage &storage, const std::string &path, std::uint64_t source) {
+            auto at = layout(storage.nodeCount, storage.stringCount, storage.charsSize);
+            std::string image(at.size, '\0');
+            std::memcpy(image.data() + at.nodes, storage.nodes, storage.nodeCount * sizeof(Slot));
+            if (storage.stringCount)
+                std::memcpy(image.data() + at.strings, storage.strings, storage.stringCount * sizeof(Span));
+            std::memcpy(image.data() + at.chars, storage.chars, storage.charsSize);
+
+            Header header{};
+            std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+            header.version = snapshotVersion;
+            header.byteOrder = byteOrderMark;
+            header.slotSize = sizeof(Slot);
+            header.spanSize = sizeof(Span);
+            header.nodeCount = storage.nodeCount;
+            header.stringCount = storage.stringCount;
+            header.charsSize = storage.charsSize;
+            header.source = source;
+            header.checksum = checksum(image.data() + sizeof(Header), image.size() - sizeof(Header));
+            std::memcpy(image.data(), &header, sizeof(header));
+
+            auto temporary = path + ".tmp";
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                if (!file.write(image.data(), static_cast<std::streamsize>(image.size())) || !file.flush())
+                    throw std::runtime_error("cannot write " + temporary);
+            }
+            std::error_code error;
+            std::filesystem::rename(temporary, path, error);
+            if (error)
+                throw std::runtime_error("cannot write " + path + ": " + error.message());
+        }
+
+        static std::optional<CompiledConf> map(const std::string &path, std::uint64_t source) {
+            std::size_t size = 0;
+            auto mapping = read(path, size);
+            if (!mapping)
+                return std::nullopt;
+            auto data = static_cast<const char *>(mapping.get());
+            if (!valid(data, size, source))
+                return std::nullopt;
+
+            Header header;
+            std::memcpy(&header, data, sizeof(header));
+            auto at = layout(header.nodeCount, header.stringCount, header.charsSize);
+
+            auto storage = std::make_shared<Storage>();
+            storage->nodes = reinterpret_cast<const Slot *>(data + at.nodes);
+            storage->strings = reinterpret_cast<const Span *>(data + at.strings);
+            storage->chars = data + at.chars;
+            storage->nodeCount = header.nodeCount;
+            storage->stringCount = header.stringCount;
+            storage->charsSize = header.charsSize;
+            storage->mapping = std::move(mapping);
+            storage->mappingSize = size;
+
+            CompiledConf conf;
+            conf.storage = std::move(storage);
+            return conf;
+        }
+    };
+
+    void CompiledConf::saveSnapshot(const std::string &path, std::uint64_t source) const {
+        Snapshot::save(*this->storage, path, source);
+    }
+
+    std::optional<CompiledConf> CompiledConf::mapSnapshot(const std::string &path, std::uint64_t source) {
+        return Snapshot::map(path, source);
+    }
+
+    std::uint64_t sourceStamp(const std::string &path) {
+        std::error_code error;
+        auto size = std::filesystem::file_size(path, error);
+        if (error)
+            return 0;
+        auto modified = std::filesystem::last_write_time(path, error);
+        if (error)
+            return 0;
+
+        auto time = static_cast<std::uint64_t>(modified.time_since_epoch().count());
+        return ((time * 0x100000001b3ULL) ^ size) | 1;
+    }
+
+    CompiledConf loadCompiledConf(const std::string &jsonPath, const std::string &snapshotPath) {
+        auto stamp = sourceStamp(jsonPath);
+        if (auto snapshot = CompiledConf::mapSnapshot(snapshotPath, stamp))
+            return *snapshot;
+
+        CompiledConf conf(loadJson(jsonPath));
+        try {
+            conf.saveSnapshot(snapshotPath, stamp);
+        } catch (std::runtime_error &) {
+            // Read-only location: start from the JSON file each time.
+        }
+        return conf;
+    }
+
+}
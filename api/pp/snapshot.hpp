@@ -0,0 +1,29 @@
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "compiled.hpp"
+
+namespace zia::apipp {
+
+    /**
+     * Stamp of a file from its size and modification time, to tell whether a snapshot compiled from
+     * it is stale. 0 if the file does not exist.
+     */
+    std::uint64_t sourceStamp(const std::string &path);
+
+    /**
+     * Configuration at startup or in a new worker: the snapshot at snapshotPath (see
+     * CompiledConf::mapSnapshot) when it was saved from the current JSON file at jsonPath, ready
+     * without parsing. Otherwise the JSON file is parsed and compiled, and saved as the new snapshot
+     * if possible.
+     *
+     * A snapshot without its JSON file is used as it is.
+     *
+     * @throw JsonError if the snapshot cannot be used and the JSON file cannot be read or parsed.
+     */
+    CompiledConf loadCompiledConf(const std::string &jsonPath, const std::string &snapshotPath);
+
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "api/pp/pipeline.hpp"
+#include "api/pp/pool.hpp"
+#include "counting.hpp"
+
+namespace {
+
+    constexpr int rounds = 100000;
+
+    const std::pair<const char *, const char *> browserHeaders[] = {
+            {"Host", "www.example.com"},
+            {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0"},
+            {"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8"},
+            {"Accept-Language", "en-US,en;q=0.5"},
+            {"Accept-Encoding", "gzip, deflate, br"},
+            {"Connection", "keep-alive"},
+            {"Cookie", "session=0123456789abcdef0123456789abcdef"},
+            {"Cache-Control", "max-age=0"},
+    };
+
+    class Router : public zia::apipp::ReentrantModule {
+    public:
+        bool perform(zia::apipp::Context &ctx) override {
+            ctx.response->setStatus(200, "OK")
+                    ->addHeader("Content-Type", "text/html")
+                    ->addHeader("Vary", "Accept-Encoding")
+                    ->setStandardData("<p>hello</p>");
+            return true;
+        }
+    };
+
+    class Tagger : public zia::apipp::ReentrantModule {
+    public:
+        bool perform(zia::apipp::Context &ctx) override {
+            ctx.response->addHeader("Server", "zia")->addHeader("Cache-Control", "no-cache");
+            return true;
+        }
+    };
+
+    // Basic module in the middle of the chain, so the objects are converted back and forth once.
+    class Logger : public zia::api::Module {
+    public:
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        bool exec(zia::api::HttpDuplex &duplex) override {
+            return duplex.req.headers.count(zia::api::http::Header::host) != 0;
+        }
+    };
+
+    // Whole life of a request: duplex creation, filling (as parsing would), pipeline, release.
+    void report(const char *name, zia::apipp::Pipeline &pipeline, bool pooled) {
+        std::vector<double> latencies;
+        latencies.reserve(rounds);
+        zia::api::HttpRequest request;
+        for (const auto &header : browserHeaders)
+            request.headers[header.first] = header.second;
+
+        std::size_t counted = 0;
+        for (int i = 0; i < rounds; ++i) {
+            auto before = counting::allocations();
+            auto start = std::chrono::steady_clock::now();
+            {
+                auto lease = pooled ? zia::apipp::DuplexPool::local().acquire() : nullptr;
+                auto fresh = pooled ? nullptr : std::make_unique<zia::api::HttpDuplex>();
+                auto &duplex = pooled ? *lease : *fresh;
+                duplex.req = request;
+                pipeline.exec(duplex);
+            }
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            counted += counting::allocations() - before;
+            latencies.push_back(elapsed.count());
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::setw(16) << std::left << name << std::fixed << std::setprecision(1)
+                  << static_cast<double>(counted) / rounds << " allocs/req  p50="
+                  << std::setprecision(2) << latencies[rounds / 2] << "us  p99="
+                  << latencies[rounds * 99 / 100] << "us" << std::endl;
+    }
+
+}
+
+/**
+ * Run a typical request through a pipeline, allocating its objects from the heap, then from
+ * the per-request arena, then with the duplex recycled from the thread pool as well.
+ */
+void benchArena() {
+    zia::apipp::Pipeline pipeline;
+    pipeline.add(std::make_shared<Router>())
+            .add(std::make_shared<Logger>())
+            .add(std::make_shared<Tagger>());
+
+    report("heap", pipeline.useArena(false), false);
+    report("arena", pipeline.useArena(true), false);
+    report("arena + pool", pipeline.useArena(true), true);
+}
@@ -0,0 +1,95 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "api/pp/async.hpp"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr unsigned workers = 4;
+    constexpr auto wait = std::chrono::milliseconds(10); // A CGI child or an upstream answering.
+
+    class Sleep : public zia::api::Module {
+    public:
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        bool exec(zia::api::HttpDuplex &) override {
+            std::this_thread::sleep_for(wait);
+            return true;
+        }
+    };
+
+    class Wait : public zia::apipp::AsyncModule {
+    private:
+        zia::apipp::Reactor &reactor;
+
+    public:
+        explicit Wait(zia::apipp::Reactor &reactor) : reactor{reactor} {}
+
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        void execAsync(zia::api::HttpDuplex &, zia::apipp::Resume resume) override {
+            this->reactor.after(wait, [resume](bool ready) { resume(ready); });
+        }
+    };
+
+    /**
+     * Time to answer requests received at once, run on the scheduler.
+     */
+    template<typename TStart>
+    double serve(zia::apipp::Scheduler &scheduler, int requests, TStart start) {
+        std::vector<zia::api::HttpDuplex> duplexes(static_cast<std::size_t>(requests));
+        std::atomic<int> left{requests};
+        std::promise<void> done;
+        auto finish = [&left, &done]() {
+            if (--left == 0)
+                done.set_value();
+        };
+
+        auto begin = Clock::now();
+        for (auto &http : duplexes)
+            scheduler.submit([&start, &http, &finish]() { start(http, finish); });
+        done.get_future().wait();
+        return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    }
+
+    void print(const char *title, int requests, double ms) {
+        std::cout << std::setw(10) << std::left << title << std::right << std::setw(6) << requests << " requests  "
+                  << std::fixed << std::setprecision(1) << std::setw(9) << ms << " ms" << std::endl;
+    }
+
+}
+
+/**
+ * Requests each waiting 10 ms on 4 workers: modules blocking their worker, or suspended while waiting.
+ */
+void benchAsync() {
+    zia::apipp::Scheduler scheduler(workers);
+    zia::apipp::Reactor reactor(scheduler);
+    Sleep sleep;
+    zia::apipp::AsyncPipeline pipeline;
+    pipeline.add(std::make_shared<Wait>(reactor));
+
+    for (int requests : {100, 1000}) {
+        auto ms = serve(scheduler, requests, [&sleep](zia::api::HttpDuplex &http, auto &finish) {
+            sleep.exec(http);
+            finish();
+        });
+        print("blocking", requests, ms);
+    }
+    for (int requests : {100, 1000, 10000, 50000}) {
+        auto ms = serve(scheduler, requests, [&pipeline](zia::api::HttpDuplex &http, auto &finish) {
+            pipeline.execAsync(http, [&finish](bool) { finish(); });
+        });
+        print("async", requests, ms);
+    }
+}
@@ -0,0 +1,117 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "api/pp/pipeline.hpp"
+#include "api/pp/serializer.hpp"
+#include "modules/cache.hpp"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int requests = 20000;
+    constexpr int uris = 256;
+    constexpr int threads = 4;
+
+    /**
+     * What the chain does for a page: a few headers and a 4 KiB body.
+     */
+    class Page : public zia::api::Module {
+    public:
+        bool config(const zia::api::Conf &) override {
+            return true;
+        }
+
+        bool exec(zia::api::HttpDuplex &http) override {
+            http.resp.status = zia::api::http::common_status::ok;
+            http.resp.headers["Content-Type"] = "text/html; charset=utf-8";
+            http.resp.headers["Cache-Control"] = "max-age=600";
+            http.resp.headers["ETag"] = "\"" + std::to_string(http.req.uri.size()) + "\"";
+            http.resp.body.assign(4096, std::byte{'x'});
+            return true;
+        }
+    };
+
+    zia::api::HttpDuplex request(int i) {
+        zia::api::HttpDuplex http{};
+        http.req.version = zia::api::http::Version::http_1_1;
+        http.req.method = zia::api::http::Method::get;
+        http.req.uri = "/pages/" + std::to_string(i % uris);
+        http.req.headers["Host"] = "bench";
+        http.req.headers["Accept-Encoding"] = "gzip";
+        http.resp.version = zia::api::http::Version::http_1_1;
+        return http;
+    }
+
+    void print(const std::string &title, Clock::duration total, int count) {
+        std::cout << std::setw(26) << std::left << title << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(8) << std::chrono::duration<double, std::nano>(total).count() / count
+                  << " ns/request" << std::endl;
+    }
+
+}
+
+/**
+ * A response made by the chain and serialized for each request, against a cache hit sent from its
+ * stored bytes, then hits from several threads on one shard or sixteen.
+ */
+void benchCache() {
+    zia::apipp::Pipeline chain;
+    chain.add(std::make_shared<Page>());
+    auto start = Clock::now();
+    std::size_t bytes = 0;
+    for (int i = 0; i < requests; ++i) {
+        auto http = request(i);
+        chain.exec(http);
+        zia::apipp::ResponseSerializer serializer;
+        serializer.serialize(http.resp);
+        bytes += serializer.toRaw().size();
+    }
+    print("chain and serialization", Clock::now() - start, requests);
+
+    for (long long shards : {1ll, 16ll}) {
+        auto cache = std::make_shared<zia::modules::ResponseCache>();
+        zia::apipp::Pipeline cached;
+        cached.add(cache).add(std::make_shared<Page>()).add(cache);
+        zia::api::Conf conf;
+        conf["cache_shards"].v = shards;
+        conf["cache_zone"].v = "bench" + std::to_string(shards);
+        cached.config(conf);
+        for (int i = 0; i < uris; ++i) {
+            auto http = request(i);
+            cached.exec(http);
+        }
+
+        if (shards == 1) {
+            start = Clock::now();
+            for (int i = 0; i < requests; ++i) {
+                auto http = request(i);
+                cached.exec(http);
+                bytes += http.resp.wire->size();
+            }
+            print("cache hit", Clock::now() - start, requests);
+        }
+
+        start = Clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&cached]() {
+                for (int i = 0; i < requests; ++i) {
+                    auto http = request(i);
+                    cached.exec(http);
+                }
+            });
+        }
+        for (auto &worker : workers)
+            worker.join();
+        print("hits, " + std::to_string(threads) + " threads, " + std::to_string(shards) + " shard" +
+              (shards > 1 ? "s" : ""), Clock::now() - start, requests * threads);
+        std::cout << "hits: " << cache->hits() << ", misses: " << cache->misses() << std::endl;
+    }
+    if (!bytes)
+        std::cout << "nothing sent" << std::endl;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#ifdef ZIA_TEST_FASTCGI
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include "modules/cgibin.hpp"
+
+extern char **environ;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int requests = 500;
+
+    void print(const char *title, Clock::duration total) {
+        std::cout << std::setw(28) << std::left << title << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(8) << std::chrono::duration<double, std::micro>(total).count() / requests
+                  << " us/request" << std::endl;
+    }
+
+    zia::api::HttpDuplex request() {
+        zia::api::HttpDuplex http{};
+        http.req.version = zia::api::http::Version::http_1_1;
+        http.req.method = zia::api::http::Method::get;
+        http.req.uri = "/cgi-bin/echo?bench=1";
+        return http;
+    }
+
+}
+
+/**
+ * A process per request (plain CGI, here only spawning /bin/true), against the cgibin module
+ * opening a FastCGI connection per request, or keeping it.
+ */
+void benchCgi() {
+    auto start = Clock::now();
+    for (int i = 0; i < requests; ++i) {
+        pid_t pid;
+        char program[] = "/bin/true";
+        char *argv[] = {program, nullptr};
+        if (::posix_spawn(&pid, program, nullptr, nullptr, argv, environ) == 0)
+            ::waitpid(pid, nullptr, 0);
+    }
+    print("process per request", Clock::now() - start);
+
+    zia::api::ConfValue command, socket, processes;
+    command.v = std::string(ZIA_TEST_FASTCGI);
+    socket.v = std::string("/tmp/zia_bench_cgi.sock");
+    processes.v = 1ll;
+    zia::api::Conf conf{{"cgi_command", command}, {"cgi_socket", socket}, {"cgi_processes", processes}};
+    zia::modules::CgiBin cgi;
+    if (!cgi.config(conf)) {
+        std::cout << "cannot start " << ZIA_TEST_FASTCGI << std::endl;
+        return;
+    }
+
+    zia::api::ConfValue keep, closingSocket;
+    keep.v = false;
+    closingSocket.v = std::string("/tmp/zia_bench_cgi_closing.sock");
+    auto closing = conf;
+    closing["cgi_keep_connections"] = keep;
+    closing["cgi_socket"] = closingSocket;
+    zia::modules::CgiBin closingCgi;
+    closingCgi.config(closing);
+    start = Clock::now();
+    for (int i = 0; i < requests; ++i) {
+        auto http = request();
+        closingCgi.exec(http);
+    }
+    print("connection per request", Clock::now() - start);
+
+    start = Clock::now();
+    for (int i = 0; i < requests; ++i) {
+        auto http = request();
+        cgi.exec(http);
+    }
+    print("kept FastCGI connection", Clock::now() - start);
+    std::cout << "connections opened: " << cgi.connectionsOpened() << ", reused: " << cgi.connectionsReused()
+              << std::endl;
+}
+
+#else
+
+void benchCgi() {
+    std::cout << "FastCGI responder not built on this system" << std::endl;
+}
+
+#endif
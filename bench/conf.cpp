@@ -0,0 +1,150 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "api/pp/bind.hpp"
+#include "api/pp/compiled.hpp"
+#include "api/pp/path.hpp"
+#include "counting.hpp"
+
+namespace {
+
+    constexpr int vhosts = 1000;
+    constexpr int routes = 8;
+    constexpr int rounds = 20;
+
+    struct Route {
+        std::string path;
+        std::string upstream;
+        double timeout = 0;
+
+        static auto confFields() {
+            return std::make_tuple(zia::apipp::field("path", &Route::path),
+                                   zia::apipp::field("upstream", &Route::upstream),
+                                   zia::apipp::field("timeout", &Route::timeout));
+        }
+    };
+
+    struct Vhost {
+        std::string name;
+        std::string root;
+        int port = 0;
+        bool tls = false;
+        std::vector<Route> routes;
+
+        static auto confFields() {
+            return std::make_tuple(zia::apipp::field("name", &Vhost::name), zia::apipp::field("root", &Vhost::root),
+                                   zia::apipp::field("port", &Vhost::port), zia::apipp::field("tls", &Vhost::tls),
+                                   zia::apipp::field("routes", &Vhost::routes));
+        }
+    };
+
+    struct Routing {
+        std::vector<Vhost> vhosts;
+        int workers = 1;
+
+        static auto confFields() {
+            return std::make_tuple(zia::apipp::field("vhosts", &Routing::vhosts),
+                                   zia::apipp::field("workers", &Routing::workers));
+        }
+    };
+
+    template<typename T>
+    zia::api::ConfValue make(T value) {
+        zia::api::ConfValue conf;
+        conf.v = std::move(value);
+        return conf;
+    }
+
+    // About 40k nodes: vhosts with their routes.
+    zia::api::Conf routingConf() {
+        zia::api::ConfArray hosts;
+        for (int i = 0; i < vhosts; ++i) {
+            zia::api::ConfArray paths;
+            for (int j = 0; j < routes; ++j) {
+                paths.push_back(make(zia::api::ConfObject{
+                        {"path", make("/api/v" + std::to_string(j))},
+                        {"upstream", make("10.0." + std::to_string(i % 256) + "." + std::to_string(j) + ":8080")},
+                        {"timeout", make(30.0)},
+                }));
+            }
+            hosts.push_back(make(zia::api::ConfObject{
+                    {"name", make("host" + std::to_string(i) + ".example.com")},
+                    {"root", make("/var/www/host" + std::to_string(i))},
+                    {"port", make(443LL)},
+                    {"tls", make(true)},
+                    {"routes", make(std::move(paths))},
+            }));
+        }
+        return zia::api::Conf{{"vhosts", make(std::move(hosts))}, {"workers", make(4LL)}};
+    }
+
+    template<typename TBuild>
+    auto measure(const char *name, TBuild build) {
+        auto before = counting::liveBytes();
+        auto start = std::chrono::steady_clock::now();
+        auto conf = build();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::setw(24) << std::left << name << std::fixed << std::setprecision(1)
+                  << (counting::liveBytes() - before) / 1024.0 << " KiB  built in "
+                  << elapsed.count() << "ms" << std::endl;
+        return conf;
+    }
+
+    template<typename TLookup>
+    void lookups(const char *name, TLookup lookup) {
+        std::size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (int i = 0; i < vhosts; ++i)
+                found += lookup(i, (i + round) % routes);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::setw(24) << std::left << name << std::fixed << std::setprecision(1)
+                  << elapsed.count() / (rounds * vhosts) << " ns/lookup  (" << found << ")" << std::endl;
+    }
+
+}
+
+/**
+ * Memory and lookups of a large routing configuration, as a ConfElem tree, compiled, and bound to structs,
+ * then probes of a missing optional key.
+ */
+void benchConf() {
+    auto basic = routingConf();
+
+    auto tree = measure("ConfElem", [&]() { return zia::apipp::ConfElem::fromBasicConfig(basic); });
+    auto compiled = measure("CompiledConf", [&]() { return zia::apipp::CompiledConf(basic); });
+    std::cout << compiled.nodeCount() << " nodes, " << compiled.memoryUsage() / compiled.nodeCount()
+              << " bytes/node compiled" << std::endl;
+
+    lookups("ConfElem lookup", [&](int host, int route) {
+        return tree["vhosts"][host]["routes"][route]["upstream"].get<std::string>().size();
+    });
+    lookups("CompiledConf lookup", [&](int host, int route) {
+        return compiled["vhosts"][host]["routes"][route]["upstream"].get<std::string_view>().size();
+    });
+
+    auto bound = measure("bound struct", [&]() { return zia::apipp::bindConf<Routing>(tree); });
+    lookups("bound struct read", [&](int host, int route) {
+        return bound.vhosts[host].routes[route].upstream.size();
+    });
+
+    lookups("missing, catch", [&](int host, int) {
+        try {
+            return tree["vhosts"][host]["retries"].get<long long>();
+        } catch (zia::apipp::ConfElem::InvalidAccess &) {
+            return 0LL;
+        }
+    });
+    lookups("missing, find", [&](int host, int) {
+        auto *retries = tree["vhosts"][host].find("retries");
+        return retries ? retries->try_get<long long>().value_or(0) : 0;
+    });
+    auto retries = *zia::apipp::ConfPath::parse("/vhosts/3/retries");
+    lookups("missing, ConfPath", [&](int, int) {
+        return retries.try_get<long long>(compiled).value_or(0);
+    });
+}
@@ -0,0 +1,67 @@
+#include <malloc.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "counting.hpp"
+
+namespace {
+
+    thread_local std::size_t allocated = 0;
+    std::atomic<std::size_t> live{0};
+
+    void *track(void *ptr) {
+        if (!ptr)
+            throw std::bad_alloc();
+        ++allocated;
+        live.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+        return ptr;
+    }
+
+    void untrack(void *ptr) {
+        if (ptr)
+            live.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+        std::free(ptr);
+    }
+
+}
+
+namespace counting {
+
+    std::size_t allocations() {
+        return allocated;
+    }
+
+    std::size_t liveBytes() {
+        return live.load(std::memory_order_relaxed);
+    }
+
+}
+
+void *operator new(std::size_t size) {
+    return track(std::malloc(size ? size : 1));
+}
+
+// std::pmr::new_delete_resource() allocates through the aligned overloads.
+void *operator new(std::size_t size, std::align_val_t align) {
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, std::max(static_cast<std::size_t>(align), sizeof(void *)), size ? size : 1) != 0)
+        ptr = nullptr;
+    return track(ptr);
+}
+
+void operator delete(void *ptr) noexcept {
+    untrack(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    untrack(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+    untrack(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+    untrack(ptr);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Heap usage, tracked by the global operator new and delete of the bench.
+ */
+namespace counting {
+
+    /**
+     * Heap allocations made so far by the calling thread.
+     */
+    std::size_t allocations();
+
+    /**
+     * Bytes currently allocated from the heap by the whole program.
+     */
+    std::size_t liveBytes();
+
+}
@@ -0,0 +1,96 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#ifdef ZIA_HAS_ZLIB
+
+#include <zlib.h>
+#include "modules/gzip.hpp"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int responses = 2000;
+
+    std::string page(std::size_t size) {
+        std::string text;
+        while (text.size() < size)
+            text += "<tr><td>Row " + std::to_string(text.size() % 89) + "</td><td class=\"value\">ok</td></tr>\n";
+        text.resize(size);
+        return text;
+    }
+
+    zia::api::HttpDuplex response(const std::string &body) {
+        zia::api::HttpDuplex http{};
+        http.req.headers["Accept-Encoding"] = "gzip";
+        http.resp.version = zia::api::http::Version::http_1_1;
+        http.resp.status = zia::api::http::common_status::ok;
+        http.resp.headers["Content-Type"] = "text/html";
+        http.resp.body.assign(reinterpret_cast<const std::byte *>(body.data()),
+                              reinterpret_cast<const std::byte *>(body.data()) + body.size());
+        return http;
+    }
+
+    void print(const std::string &title, Clock::duration total, std::size_t bytes) {
+        std::cout << std::setw(30) << std::left << title << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(8) << std::chrono::duration<double, std::micro>(total).count() / responses
+                  << " us/response " << std::setw(8) << bytes << " bytes" << std::endl;
+    }
+
+    // What a module without kept state does: a zlib stream set up and freed for each response.
+    std::size_t deflateOnce(const std::string &body, int level) {
+        z_stream stream{};
+        deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        std::string out(deflateBound(&stream, body.size()), '\0');
+        stream.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(body.data()));
+        stream.avail_in = static_cast<uInt>(body.size());
+        stream.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        stream.avail_out = static_cast<uInt>(out.size());
+        deflate(&stream, Z_FINISH);
+        auto size = stream.total_out;
+        deflateEnd(&stream);
+        return size;
+    }
+
+}
+
+/**
+ * Compressing responses with a zlib stream per response, against the gzip module keeping one per
+ * thread, and the cost of each level.
+ */
+void benchGzip() {
+    for (std::size_t size : {4 * 1024, 64 * 1024}) {
+        auto body = page(size);
+        auto suffix = " (" + std::to_string(size / 1024) + " KiB)";
+
+        std::size_t bytes = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < responses; ++i)
+            bytes = deflateOnce(body, 6);
+        print("stream per response" + suffix, Clock::now() - start, bytes);
+
+        for (long long level : {6ll, 1ll}) {
+            zia::api::Conf conf;
+            conf["gzip_level"].v = level;
+            zia::modules::Gzip gzip;
+            gzip.config(conf);
+            start = Clock::now();
+            for (int i = 0; i < responses; ++i) {
+                auto http = response(body);
+                gzip.exec(http);
+                bytes = http.resp.body.size();
+            }
+            print("kept stream, level " + std::to_string(level) + suffix, Clock::now() - start, bytes);
+        }
+    }
+}
+
+#else
+
+void benchGzip() {
+    std::cout << "zlib not found" << std::endl;
+}
+
+#endif
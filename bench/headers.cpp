@@ -0,0 +1,76 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include "api/http.h"
+
+namespace {
+
+    constexpr int rounds = 200000;
+
+    // Header names of a typical browser request, in the case clients send them.
+    const std::pair<const char *, const char *> browserHeaders[] = {
+            {"Host", "www.example.com"},
+            {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0"},
+            {"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8"},
+            {"Accept-Language", "en-US,en;q=0.5"},
+            {"Accept-Encoding", "gzip, deflate, br"},
+            {"Referer", "https://www.example.com/index.html"},
+            {"Connection", "keep-alive"},
+            {"Cookie", "session=0123456789abcdef0123456789abcdef"},
+            {"Upgrade-Insecure-Requests", "1"},
+            {"Cache-Control", "max-age=0"},
+    };
+
+    // Lookups a server does on each request.
+    const char *lookups[] = {"Host", "Content-Length", "Transfer-Encoding", "Connection", "Accept-Encoding"};
+
+    template<typename TRun>
+    void report(const char *name, TRun run) {
+        std::size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+            found += run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::setw(28) << std::left << name << std::fixed << std::setprecision(0)
+                  << rounds / elapsed.count() << " req/s  (" << found / rounds << " found)" << std::endl;
+    }
+
+}
+
+/**
+ * Fill the headers of a request, then look up the ones a server needs, with the former
+ * std::map and with zia::api::HeaderMap.
+ */
+void benchHeaders() {
+    std::map<std::string, std::string> map;
+    report("std::map fill + lookup", [&]() {
+        map.clear();
+        for (const auto &header : browserHeaders)
+            map[header.first] = header.second;
+        std::size_t found = 0;
+        for (auto name : lookups)
+            found += map.count(name);
+        return found;
+    });
+
+    zia::api::HeaderMap<std::string> headers;
+    report("HeaderMap fill + lookup", [&]() {
+        headers.clear();
+        for (const auto &header : browserHeaders)
+            headers[header.first] = header.second;
+        std::size_t found = 0;
+        for (auto name : lookups)
+            found += headers.count(name);
+        return found;
+    });
+
+    report("HeaderMap lookup by id", [&]() {
+        using zia::api::http::Header;
+        return headers.count(Header::host) + headers.count(Header::content_length) +
+               headers.count(Header::transfer_encoding) + headers.count(Header::connection) +
+               headers.count(Header::accept_encoding);
+    });
+}
@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "api/pp/json.hpp"
+#include "api/pp/snapshot.hpp"
+
+namespace {
+
+    constexpr int vhosts = 30000;
+    constexpr int routes = 8;
+
+    // About 20 MB of compact JSON, 50 MB pretty: vhosts with their routes.
+    zia::apipp::ConfElem generatedConf() {
+        using zia::apipp::ConfElem;
+
+        auto hosts = ConfElem(zia::apipp::ConfArray());
+        for (int i = 0; i < vhosts; ++i) {
+            auto paths = ConfElem(zia::apipp::ConfArray());
+            for (int j = 0; j < routes; ++j) {
+                paths.push(ConfElem(zia::apipp::ConfMap())
+                                   .set_at("path", ConfElem("/api/v" + std::to_string(j) + "/items"))
+                                   .set_at("upstream", ConfElem("10.0." + std::to_string(i % 256) + "." +
+                                                                std::to_string(j) + ":8080"))
+                                   .set_at("timeout", ConfElem(30.5))
+                                   .set_at("retries", ConfElem(3)));
+            }
+            hosts.push(ConfElem(zia::apipp::ConfMap())
+                               .set_at("name", ConfElem("host" + std::to_string(i) + ".example.com"))
+                               .set_at("root", ConfElem("C:\\www\\host" + std::to_string(i)))
+                               .set_at("port", ConfElem(443))
+                               .set_at("tls", ConfElem(true))
+                               .set_at("routes", std::move(paths)));
+        }
+        return ConfElem(zia::apipp::ConfMap())
+                .set_at("vhosts", std::move(hosts))
+                .set_at("workers", ConfElem(4));
+    }
+
+    template<typename TRun>
+    void report(const char *name, TRun run) {
+        auto start = std::chrono::steady_clock::now();
+        std::size_t bytes = run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::setw(28) << std::left << name << std::fixed << std::setprecision(0)
+                  << elapsed.count() * 1000 << " ms  " << bytes / elapsed.count() / (1024 * 1024) << " MB/s"
+                  << std::endl;
+    }
+
+}
+
+/**
+ * Write a large generated configuration as JSON, then read it back into a ConfElem and into a zia::api::Conf.
+ * Then start from it as a compiled binary snapshot, compared with parsing and compiling the JSON.
+ */
+void benchJson() {
+    auto conf = generatedConf();
+
+    std::string compact;
+    report("writeJson compact", [&]() {
+        zia::apipp::writeJson(conf, compact);
+        return compact.size();
+    });
+    std::string pretty;
+    report("writeJson pretty", [&]() {
+        zia::apipp::writeJson(conf, pretty, zia::apipp::JsonStyle::Pretty);
+        return pretty.size();
+    });
+    std::cout << compact.size() / (1024 * 1024) << " MB compact, " << pretty.size() / (1024 * 1024)
+              << " MB pretty" << std::endl;
+
+    std::ostringstream stream;
+    report("operator<<", [&]() {
+        stream << conf;
+        return static_cast<std::size_t>(stream.tellp());
+    });
+
+    // Parsed values are kept until the end, so their destruction is not measured.
+    zia::apipp::ConfElem fromCompact;
+    report("parseJson compact", [&]() {
+        fromCompact = zia::apipp::parseJson(compact);
+        return compact.size();
+    });
+    zia::apipp::ConfElem fromPretty;
+    report("parseJson pretty", [&]() {
+        fromPretty = zia::apipp::parseJson(pretty);
+        return pretty.size();
+    });
+    zia::api::Conf basic;
+    report("parseJsonConf compact", [&]() {
+        basic = zia::apipp::parseJsonConf(compact);
+        return compact.size();
+    });
+
+    std::cout << "Same after round trip: " << (zia::apipp::toJson(fromCompact) == compact &&
+                                               zia::apipp::toJson(fromPretty) == compact &&
+                                               zia::apipp::toJson(basic) == compact) << std::endl;
+
+    const std::string snapshotPath = "/tmp/zia_bench.snapshot";
+    report("parseJson + compile", [&]() {
+        zia::apipp::CompiledConf(zia::apipp::parseJson(compact));
+        return compact.size();
+    });
+    zia::apipp::CompiledConf compiled(fromCompact);
+    report("saveSnapshot", [&]() {
+        compiled.saveSnapshot(snapshotPath);
+        return compiled.memoryUsage();
+    });
+    std::optional<zia::apipp::CompiledConf> mapped;
+    report("mapSnapshot", [&]() {
+        mapped = zia::apipp::CompiledConf::mapSnapshot(snapshotPath);
+        return compiled.memoryUsage();
+    });
+    std::cout << "Mapped: " << (mapped && mapped->nodeCount() == compiled.nodeCount()) << ", "
+              << compiled.memoryUsage() / (1024 * 1024) << " MB snapshot" << std::endl;
+    std::remove(snapshotPath.c_str());
+}
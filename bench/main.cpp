@@ -0,0 +1,66 @@
+#include <cstring>
+#include <iostream>
+
+void benchReentrant();
+
+void benchParser();
+
+void benchHeaders();
+
+void benchArena();
+
+void benchConf();
+
+void benchJson();
+
+void benchModules();
+
+void benchScheduler();
+
+void benchAsync();
+
+void benchCgi();
+
+void benchGzip();
+
+void benchCache();
+
+namespace {
+    struct Bench {
+        const char *name;
+        void (*run)();
+    };
+
+    const Bench benches[] = {
+        {"reentrant", benchReentrant},
+        {"parser", benchParser},
+        {"headers", benchHeaders},
+        {"arena", benchArena},
+        {"conf", benchConf},
+        {"json", benchJson},
+        {"modules", benchModules},
+        {"scheduler", benchScheduler},
+        {"async", benchAsync},
+        {"cgi", benchCgi},
+        {"gzip", benchGzip},
+        {"cache", benchCache},
+    };
+}
+
+/**
+ * Run every benchmark, or only the ones named on the command line.
+ */
+int main(int ac, char **av) {
+    for (const auto &bench : benches) {
+        bool selected = ac < 2;
+        for (int i = 1; i < ac; ++i)
+            selected = selected || std::strcmp(av[i], bench.name) == 0;
+
+        if (selected) {
+            std::cout << "BENCH -- " << bench.name << std::endl;
+            bench.run();
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include "api/pp/loader.hpp"
+
+namespace {
+
+    constexpr int modules = 30;
+    constexpr long long configDelay = 5; // ms, a config() reading files or resolving hosts.
+
+    zia::api::Conf modulesConf() {
+        zia::api::ConfArray names;
+        for (int i = 0; i < modules; ++i) {
+            zia::api::ConfValue name;
+            name.v = std::string("zia_test_hello");
+            names.push_back(name);
+        }
+        zia::api::ConfValue list, path, delay;
+        list.v = names;
+        path.v = zia::api::ConfArray{zia::api::ConfValue{std::string(ZIA_TEST_MODULES)}};
+        delay.v = configDelay;
+        return zia::api::Conf{{"modules", list}, {"modules_path", path}, {"test_config_delay_ms", delay}};
+    }
+
+}
+
+/**
+ * Load and configure 30 modules, one at a time then on a pool of threads.
+ */
+void benchModules() {
+    auto conf = modulesConf();
+
+    for (unsigned threads : {1u, 4u, 16u}) {
+        zia::apipp::ModuleManager manager(threads);
+        bool loaded = manager.load(conf);
+        std::cout << std::setw(3) << threads << " threads  " << std::fixed << std::setprecision(1)
+                  << std::chrono::duration<double, std::milli>(manager.elapsed()).count() << " ms"
+                  << (loaded ? "" : "  (failed)") << std::endl;
+    }
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "api/pp/parser.hpp"
+
+namespace {
+
+    using Parser = zia::apipp::RequestParser;
+
+    constexpr int rounds = 200000;
+
+    // A typical browser request, about 500 bytes of headers.
+    const std::string browserRequest =
+            "GET /assets/js/application.js?v=1234 HTTP/1.1\r\n"
+            "Host: www.example.com\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+            "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+            "Accept-Language: en-US,en;q=0.5\r\n"
+            "Accept-Encoding: gzip, deflate, br\r\n"
+            "Referer: https://www.example.com/index.html\r\n"
+            "Connection: keep-alive\r\n"
+            "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; lang=en\r\n"
+            "Upgrade-Insecure-Requests: 1\r\n"
+            "Cache-Control: max-age=0\r\n"
+            "\r\n";
+
+    template<typename TParse>
+    void report(const char *name, const zia::api::Net::Raw &raw, TParse parse) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+            parse();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::setw(24) << std::left << name << std::fixed << std::setprecision(2)
+                  << raw.size() * static_cast<double>(rounds) / elapsed.count() / 1e9 << " GB/s  "
+                  << std::setprecision(0) << rounds / elapsed.count() << " req/s" << std::endl;
+    }
+
+}
+
+/**
+ * Parse the same request with each delimiter search implementation, with and without
+ * the copy into zia::api::HttpRequest.
+ */
+void benchParser() {
+    zia::api::Net::Raw raw;
+    for (auto c : browserRequest)
+        raw.push_back(std::byte(c));
+
+    const std::pair<Parser::Scanner, const char *> scanners[] = {
+            {Parser::Scanner::Scalar, "scalar"},
+            {Parser::Scanner::Sse42,  "sse4.2"},
+            {Parser::Scanner::Avx2,   "avx2"},
+    };
+
+    Parser parser;
+    zia::api::HttpRequest request;
+    for (const auto &scanner : scanners) {
+        if (!Parser::useScanner(scanner.first)) {
+            std::cout << scanner.second << ": not supported by this CPU" << std::endl;
+            continue;
+        }
+
+        report((std::string(scanner.second) + " parse").c_str(), raw, [&]() {
+            parser.reset();
+            parser.parse(raw);
+        });
+        report((std::string(scanner.second) + " parse + fill").c_str(), raw, [&]() {
+            parser.reset();
+            parser.parse(raw);
+            parser.fill(raw.data(), request);
+        });
+    }
+    Parser::useScanner(Parser::bestScanner());
+}
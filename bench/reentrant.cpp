@@ -0,0 +1,98 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "api/pp/module.hpp"
+
+namespace {
+
+    constexpr int requestsPerThread = 200000;
+
+    // Same work in both flavours: hash the borrowed request body and answer with a header.
+    std::string digest(std::string_view body) {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (auto c : body)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        return std::to_string(hash);
+    }
+
+    class MemberModule : public zia::apipp::Module {
+    public:
+        bool perform() override {
+            this->response->setStatus(200, "OK")->addHeader("X-Digest", digest(this->request->bodyView()));
+            return true;
+        }
+    };
+
+    class ContextModule : public zia::apipp::ReentrantModule {
+    public:
+        bool perform(zia::apipp::Context &ctx) override {
+            ctx.response->setStatus(200, "OK")->addHeader("X-Digest", digest(ctx.request->bodyView()));
+            return true;
+        }
+    };
+
+    template<typename TExec>
+    double run(unsigned threads, TExec exec) {
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&exec]() {
+                zia::api::HttpDuplex duplex;
+                duplex.req.body.assign(256, std::byte{'x'});
+                for (int i = 0; i < requestsPerThread; ++i) {
+                    duplex.resp.headers.clear();
+                    exec(duplex);
+                }
+            });
+        }
+        for (auto &worker : workers)
+            worker.join();
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return threads * static_cast<double>(requestsPerThread) / elapsed.count();
+    }
+
+    template<typename TExec>
+    void report(const char *name, unsigned maxThreads, TExec exec) {
+        double single = 0;
+
+        std::vector<unsigned> counts;
+        for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+            counts.push_back(threads);
+        counts.push_back(maxThreads);
+
+        for (auto threads : counts) {
+            auto rate = run(threads, exec);
+            if (threads == 1)
+                single = rate;
+            std::cout << std::setw(28) << std::left << name << " threads=" << std::setw(3) << threads
+                      << std::fixed << std::setprecision(0) << rate << " req/s"
+                      << "  scaling=" << std::setprecision(2) << rate / single << "x" << std::endl;
+        }
+    }
+
+}
+
+/**
+ * One module instance shared by every thread: the member-based module needs a mutex,
+ * the context-based one is executed concurrently as is.
+ */
+void benchReentrant() {
+    auto maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    MemberModule member;
+    std::mutex lock;
+    report("apipp::Module + mutex", maxThreads, [&](zia::api::HttpDuplex &duplex) {
+        std::lock_guard<std::mutex> guard(lock);
+        member.exec(duplex);
+    });
+
+    ContextModule reentrant;
+    report("apipp::ReentrantModule", maxThreads, [&](zia::api::HttpDuplex &duplex) {
+        reentrant.exec(duplex);
+    });
+}
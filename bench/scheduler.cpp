@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "api/pp/scheduler.hpp"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int requests = 400;
+    constexpr int slowEvery = 10;                            // One request in 10 is a CGI-style one.
+    constexpr auto slowTime = std::chrono::milliseconds(5);  // Waiting on a child process.
+
+    void handle(int i) {
+        if (i % slowEvery == 0)
+            std::this_thread::sleep_for(slowTime);
+    }
+
+    void print(const char *title, std::vector<double> latencies, double total) {
+        std::sort(latencies.begin(), latencies.end());
+        auto p50 = latencies[latencies.size() / 2];
+        auto p99 = latencies[latencies.size() * 99 / 100];
+        std::cout << std::setw(22) << std::left << title << std::right << std::fixed << std::setprecision(2)
+                  << "fast p50 " << std::setw(8) << p50 << " ms  p99 " << std::setw(8) << p99 << " ms  total "
+                  << std::setw(8) << total << " ms" << std::endl;
+    }
+
+    double since(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+}
+
+/**
+ * Latency of the fast requests of a burst mixed with slow ones: run on the thread receiving them
+ * (a Net callback running the modules) or handed to the work-stealing scheduler.
+ */
+void benchScheduler() {
+    {
+        std::vector<double> latencies;
+        auto start = Clock::now();
+        for (int i = 0; i < requests; ++i) {
+            handle(i);
+            if (i % slowEvery)
+                latencies.push_back(since(start));
+        }
+        print("inline", latencies, since(start));
+    }
+
+    for (unsigned workers : {2u, 4u, 8u}) {
+        std::vector<double> latencies;
+        std::mutex lock;
+        auto start = Clock::now();
+        {
+            zia::apipp::Scheduler scheduler(workers);
+            for (int i = 0; i < requests; ++i) {
+                scheduler.submit([i, start, &latencies, &lock]() {
+                    handle(i);
+                    if (i % slowEvery) {
+                        std::lock_guard<std::mutex> guard(lock);
+                        latencies.push_back(since(start));
+                    }
+                });
+            }
+        }
+        std::string title = "scheduler, " + std::to_string(workers) + " workers";
+        print(title.c_str(), latencies, since(start));
+    }
+}
@@ -0,0 +1,373 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "../api/pp/file.hpp"
+#include "../api/pp/serializer.hpp"
+
+namespace zia::modules {
+
+    namespace {
+        using zia::api::http::Header;
+        using zia::api::http::iequals;
+
+        constexpr long long maxAgeLimit = 365ll * 24 * 3600; // Seconds, to keep time points in range.
+
+        long long integer(const zia::api::Conf &conf, const std::string &key, long long fallback) {
+            auto it = conf.find(key);
+            if (it == conf.end())
+                return fallback;
+            if (auto *value = std::get_if<long long>(&it->second.v))
+                return *value;
+            return fallback;
+        }
+
+        std::string_view trim(std::string_view str) {
+            while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+                str.remove_prefix(1);
+            while (!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+                str.remove_suffix(1);
+            return str;
+        }
+
+        // Calls each(item) for the items of a comma separated list, trimmed.
+        template<typename Each>
+        void forEachItem(std::string_view list, Each &&each) {
+            while (!list.empty()) {
+                auto comma = list.find(',');
+                auto item = trim(list.substr(0, comma));
+                list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+                if (!item.empty())
+                    each(item);
+            }
+        }
+
+        /**
+         * Cache-Control directive name, and its value without quotes ("" when it has none).
+         */
+        std::optional<std::string_view> directive(const std::string *cacheControl, std::string_view name) {
+            std::optional<std::string_view> found;
+            if (!cacheControl)
+                return found;
+            forEachItem(*cacheControl, [&found, name](std::string_view item) {
+                auto equal = item.find('=');
+                if (found || !iequals(trim(item.substr(0, equal)), name))
+                    return;
+                auto value = equal == std::string_view::npos ? std::string_view() : trim(item.substr(equal + 1));
+                if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                    value = value.substr(1, value.size() - 2);
+                found = value;
+            });
+            return found;
+        }
+
+        // Seconds of a delta-seconds value, -1 if it is not one.
+        long long seconds(std::optional<std::string_view> value) {
+            if (!value || value->empty())
+                return -1;
+            long long result = 0;
+            for (auto c : *value) {
+                if (c < '0' || c > '9')
+                    return -1;
+                result = std::min(result * 10 + (c - '0'), maxAgeLimit);
+            }
+            return result;
+        }
+
+        bool isWeak(std::string_view tag) {
+            return tag.substr(0, 2) == "W/";
+        }
+
+        // Weak comparison (RFC 9110 8.8.3.2), as for If-None-Match.
+        bool sameTag(std::string_view lhs, std::string_view rhs) {
+            return (isWeak(lhs) ? lhs.substr(2) : lhs) == (isWeak(rhs) ? rhs.substr(2) : rhs);
+        }
+
+        /**
+         * Whether the request may be answered from the cache, or its response kept.
+         */
+        bool cacheable(const zia::api::HttpRequest &request) {
+            using zia::api::http::Method;
+
+            return request.version == zia::api::http::Version::http_1_1 &&
+                   (request.method == Method::get || request.method == Method::head) &&
+                   !request.headers.contains(Header::authorization) && !request.headers.contains(Header::range);
+        }
+
+        // Virtual hosts serve different resources under the same path: the host, in lower case, is part of the key.
+        std::string keyOf(const zia::api::HttpRequest &request) {
+            std::string key(request.method == zia::api::http::Method::head ? "HEAD " : "GET ");
+            if (auto *host = request.headers.get(Header::host)) {
+                for (auto c : *host)
+                    key += c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+            }
+            key += ' ';
+            key += request.uri;
+            return key;
+        }
+
+        bool selects(const CacheStore::Entry &entry, const zia::api::HeaderMap<std::string> &headers) {
+            for (const auto &vary : entry.vary) {
+                auto *value = headers.get(std::string_view(vary.first));
+                if (vary.second ? !value || *value != *vary.second : value != nullptr)
+                    return false;
+            }
+            return true;
+        }
+
+        bool storableStatus(zia::api::http::Status status) {
+            switch (status) {
+                case 200: case 203: case 204: case 300: case 301: case 404: case 410:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        CacheStore::Bytes serialized(const zia::api::HttpResponse &response, bool headOnly) {
+            zia::apipp::ResponseSerializer serializer;
+            serializer.omitBody(headOnly);
+            serializer.serialize(response);
+            return std::make_shared<const zia::api::Net::Raw>(serializer.toRaw());
+        }
+
+        /**
+         * Modules of a zone share their store. Held weakly: it goes with the last module using it.
+         */
+        std::shared_ptr<CacheStore> storeOf(const CacheOptions &options) {
+            static std::mutex lock;
+            static std::unordered_map<std::string, std::weak_ptr<CacheStore>> zones;
+
+            std::lock_guard<std::mutex> guard(lock);
+            auto &zone = zones[options.zone];
+            auto store = zone.lock();
+            auto limit = options.size / options.shards * options.shards;
+            if (!store || store->shardCount() != options.shards || store->limit() != limit) {
+                store = std::make_shared<CacheStore>(options.size, options.shards);
+                zone = store;
+            }
+            return store;
+        }
+    }
+
+    CacheOptions CacheOptions::fromConf(const zia::api::Conf &conf) {
+        CacheOptions options;
+
+        options.size = static_cast<std::size_t>(std::max(0ll, integer(conf, "cache_size", options.size)));
+        auto shards = static_cast<std::size_t>(std::max(1ll, integer(conf, "cache_shards", options.shards)));
+        options.shards = 1;
+        while (options.shards < shards)
+            options.shards <<= 1;
+        options.maxEntry = static_cast<std::size_t>(std::max(0ll, integer(conf, "cache_max_entry", options.maxEntry)));
+        auto zone = conf.find("cache_zone");
+        if (zone != conf.end()) {
+            if (auto *name = std::get_if<std::string>(&zone->second.v))
+                options.zone = *name;
+        }
+        return options;
+    }
+
+    CacheStore::CacheStore(std::size_t size, std::size_t shards) : shards(shards), capacity(size / shards) {}
+
+    CacheStore::Shard &CacheStore::shardOf(const std::string &key) {
+        // A power of two: the low bits of the hash select it.
+        return this->shards[std::hash<std::string>{}(key) & (this->shards.size() - 1)];
+    }
+
+    void CacheStore::erase(Shard &shard, Recent::iterator entry) {
+        auto variants = shard.index.find((*entry)->key);
+        auto &list = variants->second;
+        list.erase(std::find(list.begin(), list.end(), entry));
+        if (list.empty())
+            shard.index.erase(variants);
+        shard.bytes -= (*entry)->bytes;
+        shard.recent.erase(entry);
+    }
+
+    std::shared_ptr<const CacheStore::Entry> CacheStore::find(const std::string &key,
+                                                              const zia::api::HeaderMap<std::string> &headers,
+                                                              Clock::time_point now) {
+        auto &shard = this->shardOf(key);
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        auto variants = shard.index.find(key);
+        if (variants == shard.index.end())
+            return nullptr;
+        for (auto entry : variants->second) {
+            if (!selects(**entry, headers))
+                continue;
+            if ((*entry)->expires <= now) {
+                this->erase(shard, entry);
+                return nullptr;
+            }
+            shard.recent.splice(shard.recent.begin(), shard.recent, entry);
+            return *entry;
+        }
+        return nullptr;
+    }
+
+    bool CacheStore::insert(Entry entry) {
+        if (entry.bytes > this->capacity)
+            return false;
+        auto &shard = this->shardOf(entry.key);
+        auto kept = std::make_shared<const Entry>(std::move(entry));
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        auto variants = shard.index.find(kept->key);
+        if (variants != shard.index.end()) {
+            for (auto old : variants->second) {
+                if ((*old)->vary == kept->vary) {
+                    this->erase(shard, old);
+                    break;
+                }
+            }
+        }
+        shard.recent.push_front(kept);
+        shard.index[kept->key].push_back(shard.recent.begin());
+        shard.bytes += kept->bytes;
+        while (shard.bytes > this->capacity)
+            this->erase(shard, std::prev(shard.recent.end()));
+        return true;
+    }
+
+    std::pair<std::size_t, std::size_t> CacheStore::usage() {
+        std::pair<std::size_t, std::size_t> total{0, 0};
+        for (auto &shard : this->shards) {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            total.first += shard.bytes;
+            total.second += shard.recent.size();
+        }
+        return total;
+    }
+
+    bool ResponseCache::config(const zia::api::Conf &conf) {
+        this->options = CacheOptions::fromConf(conf);
+        this->store = storeOf(this->options);
+        return true;
+    }
+
+    bool ResponseCache::exec(zia::api::HttpDuplex &http) {
+        if (!this->store || http.resp.wire)
+            return true;
+        if (!http.resp.status)
+            return this->lookup(http);
+        this->keep(http);
+        return true;
+    }
+
+    bool ResponseCache::lookup(zia::api::HttpDuplex &http) {
+        const auto &request = http.req;
+        if (!cacheable(request))
+            return true;
+        // The client wants the response checked by the origin: the chain runs, its response is kept.
+        auto *cacheControl = request.headers.get(Header::cache_control);
+        auto *pragma = request.headers.get(Header::pragma);
+        if (directive(cacheControl, "no-cache") || directive(cacheControl, "no-store") ||
+            seconds(directive(cacheControl, "max-age")) == 0 || (!cacheControl && pragma && iequals(*pragma, "no-cache")))
+            return true;
+
+        auto entry = this->store->find(keyOf(request), request.headers, CacheStore::Clock::now());
+        if (!entry) {
+            ++this->missCount;
+            return true;
+        }
+        ++this->hitCount;
+
+        bool notModified = false;
+        if (entry->notModified) {
+            if (auto *match = request.headers.get(Header::if_none_match)) {
+                forEachItem(*match, [&notModified, &entry](std::string_view tag) {
+                    notModified = notModified || tag == "*" || (!entry->etag.empty() && sameTag(tag, entry->etag));
+                });
+            } else if (auto *since = request.headers.get(Header::if_modified_since)) {
+                notModified = !entry->lastModified.empty() && *since == entry->lastModified;
+            }
+        }
+        http.resp.status = notModified ? zia::api::http::common_status::not_modified : entry->status;
+        http.resp.wire = notModified ? entry->notModified : entry->wire;
+        return false;
+    }
+
+    void ResponseCache::keep(const zia::api::HttpDuplex &http) {
+        const auto &request = http.req;
+        const auto &response = http.resp;
+        if (!cacheable(request) || !storableStatus(response.status) ||
+            directive(request.headers.get(Header::cache_control), "no-store") ||
+            response.headers.contains(Header::set_cookie) || response.headers.contains(Header::transfer_encoding))
+            return;
+
+        auto *cacheControl = response.headers.get(Header::cache_control);
+        if (directive(cacheControl, "no-store") || directive(cacheControl, "private") ||
+            directive(cacheControl, "no-cache"))
+            return;
+        auto age = seconds(directive(cacheControl, "s-maxage"));
+        if (age < 0)
+            age = seconds(directive(cacheControl, "max-age"));
+        if (age <= 0)
+            return;
+
+        CacheStore::Entry entry{};
+        entry.key = keyOf(request);
+        bool varyAll = false;
+        if (auto *vary = response.headers.get(Header::vary)) {
+            forEachItem(*vary, [&entry, &varyAll, &request](std::string_view name) {
+                varyAll = varyAll || name == "*";
+                auto *value = request.headers.get(name);
+                entry.vary.emplace_back(std::string(name), value ? std::optional<std::string>(*value) : std::nullopt);
+            });
+        }
+        if (varyAll)
+            return;
+        auto size = response.file ? response.file->length : response.body.size();
+        if (size > this->options.maxEntry)
+            return;
+
+        // Sent as it is to any client: without the connection headers of this one.
+        zia::api::HttpResponse kept{};
+        kept.version = zia::api::http::Version::http_1_1;
+        kept.status = response.status;
+        kept.reason = response.reason;
+        for (const auto &header : response.headers) {
+            if (header.id != Header::connection && header.id != Header::keep_alive)
+                kept.headers.emplace(header.first, header.second);
+        }
+        if (response.file) {
+            if (!zia::apipp::readFile(*response.file, kept.body))
+                return;
+        } else {
+            kept.body = response.body;
+        }
+        auto headOnly = request.method == zia::api::http::Method::head;
+        entry.wire = serialized(kept, headOnly);
+
+        if (auto *etag = response.headers.get(Header::etag))
+            entry.etag = *etag;
+        if (auto *lastModified = response.headers.get(Header::last_modified))
+            entry.lastModified = *lastModified;
+        if (response.status == zia::api::http::common_status::ok &&
+            (!entry.etag.empty() || !entry.lastModified.empty())) {
+            zia::api::HttpResponse notModified{};
+            notModified.version = zia::api::http::Version::http_1_1;
+            notModified.status = zia::api::http::common_status::not_modified;
+            for (auto id : {Header::etag, Header::last_modified, Header::cache_control, Header::expires,
+                            Header::vary, Header::content_location}) {
+                if (auto *value = kept.headers.get(id))
+                    notModified.headers[id] = *value;
+            }
+            // The length of the response it stands for, which the serializer keeps (it adds none to a 304).
+            notModified.headers[Header::content_length] = std::to_string(kept.body.size());
+            entry.notModified = serialized(notModified, true);
+        }
+
+        entry.status = response.status;
+        entry.expires = CacheStore::Clock::now() + std::chrono::seconds(age);
+        entry.bytes = sizeof(CacheStore::Entry) + entry.key.size() + entry.wire->size() +
+                      (entry.notModified ? entry.notModified->size() : 0) + entry.etag.size() + entry.lastModified.size();
+        for (const auto &vary : entry.vary)
+            entry.bytes += vary.first.size() + (vary.second ? vary.second->size() : 0);
+        if (this->store->insert(std::move(entry)))
+            ++this->storeCount;
+    }
+
+}
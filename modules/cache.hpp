@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../api/module.h"
+
+namespace zia::modules {
+
+    /**
+     * Settings of the cache module, read from the server Conf.
+     */
+    struct CacheOptions {
+        std::size_t size = 64 << 20;        // "cache_size": bytes of the responses kept, all shards together.
+        std::size_t shards = 16;            // "cache_shards": locked separately, rounded up to a power of two.
+        std::size_t maxEntry = 1 << 20;     // "cache_max_entry": larger responses are not kept.
+        std::string zone = "default";       // "cache_zone": modules of a same zone share their responses.
+
+        static CacheOptions fromConf(const zia::api::Conf &conf);
+    };
+
+    /**
+     * Responses kept by the cache module: a hash table of shards, each one locked on its own, holding the
+     * variants of a method and URI, evicted in least recently used order past its share of the bytes.
+     */
+    class CacheStore {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Bytes = std::shared_ptr<const zia::api::Net::Raw>;
+
+        /**
+         * A response as sent, serialized once when it is stored.
+         */
+        struct Entry {
+            std::string key;                // Method, host and URI.
+            /**
+             * Request headers named by Vary, with the values which selected this response, none if absent.
+             */
+            std::vector<std::pair<std::string, std::optional<std::string>>> vary;
+            Bytes wire;                     // The whole response.
+            Bytes notModified;              // 304 answered to a matching conditional request.
+            zia::api::http::Status status;
+            std::string etag;
+            std::string lastModified;
+            Clock::time_point expires;
+            std::size_t bytes;              // Accounted for the size of the shard.
+        };
+
+    private:
+        using Recent = std::list<std::shared_ptr<const Entry>>;
+
+        struct Shard {
+            std::mutex lock;
+            Recent recent;                  // Most recently used first.
+            std::unordered_map<std::string, std::vector<Recent::iterator>> index; // Variants of a key.
+            std::size_t bytes = 0;
+        };
+
+        std::vector<Shard> shards;
+        std::size_t capacity;               // Of each shard.
+
+        Shard &shardOf(const std::string &key);
+
+        // Shard locked.
+        void erase(Shard &shard, Recent::iterator entry);
+
+    public:
+        CacheStore(std::size_t size, std::size_t shards);
+
+        CacheStore(const CacheStore &) = delete;
+        CacheStore &operator=(const CacheStore &) = delete;
+
+        /**
+         * The fresh response for key selected by the request headers, which becomes the most recent.
+         * @return nullptr if there is none. An expired one is dropped.
+         */
+        std::shared_ptr<const Entry> find(const std::string &key, const zia::api::HeaderMap<std::string> &headers,
+                                          Clock::time_point now);
+
+        /**
+         * Keep entry, replacing the response of the same key and variant, evicting the least recent ones
+         * beyond the size of the shard.
+         * @return false if it is larger than the shard by itself.
+         */
+        bool insert(Entry entry);
+
+        std::size_t shardCount() const {
+            return this->shards.size();
+        }
+
+        /**
+         * Bytes kept at most, all shards together.
+         */
+        std::size_t limit() const {
+            return this->capacity * this->shards.size();
+        }
+
+        /**
+         * Bytes kept and entries, by all the shards.
+         */
+        std::pair<std::size_t, std::size_t> usage();
+    };
+
+    /**
+     * HTTP response cache ("cache" module), to be placed first and last in the chain: the same module,
+     * or two modules of the same "cache_zone".
+     *
+     * First, the response has no status yet: a fresh response stored for the method (GET or HEAD), the
+     * URI and the request headers named by its Vary is given as HttpResponse::wire, so it is sent
+     * from its stored bytes, never serialized or copied again, and exec() returns false so that the
+     * rest of the chain does not run. If-None-Match and If-Modified-Since matching it get a 304, stored
+     * too. Last, a response with a max-age (or s-maxage) is serialized and stored, unless no-store,
+     * private or no-cache, or it sets a cookie.
+     *
+     * Requests in other versions than HTTP/1.1, with Authorization or Range, are not answered from
+     * the cache; "Cache-Control: no-cache" or "max-age=0" in a request goes through the chain and
+     * refreshes the stored response. Stored responses have no Age header: it would need a
+     * serialization per hit.
+     */
+    class ResponseCache : public zia::api::Module {
+    private:
+        CacheOptions options{};
+        std::shared_ptr<CacheStore> store{};
+        std::atomic<std::uint64_t> hitCount{0};
+        std::atomic<std::uint64_t> missCount{0};
+        std::atomic<std::uint64_t> storeCount{0};
+
+        bool lookup(zia::api::HttpDuplex &http);
+
+        void keep(const zia::api::HttpDuplex &http);
+
+    public:
+        ResponseCache() = default;
+
+        ResponseCache(const ResponseCache &) = delete;
+        ResponseCache &operator=(const ResponseCache &) = delete;
+
+        bool config(const zia::api::Conf &conf) override;
+
+        bool exec(zia::api::HttpDuplex &http) override;
+
+        /**
+         * Store shared by the modules of the zone, nullptr before config().
+         */
+        const std::shared_ptr<CacheStore> &responses() const {
+            return this->store;
+        }
+
+        std::uint64_t hits() const {
+            return this->hitCount.load(std::memory_order_relaxed);
+        }
+
+        std::uint64_t misses() const {
+            return this->missCount.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Responses stored so far.
+         */
+        std::uint64_t stored() const {
+            return this->storeCount.load(std::memory_order_relaxed);
+        }
+    };
+
+}
@@ -0,0 +1,554 @@
+#include "cgibin.hpp"
+
+#include <cctype>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../api/pp/body.hpp"
+
+namespace zia::modules {
+
+    namespace {
+        constexpr std::uint16_t requestId = 1; // One request at a time per connection.
+        constexpr std::size_t maxHead = 64 * 1024; // Headers printed by a script.
+
+        long long integer(const zia::api::Conf &conf, const std::string &key, long long fallback) {
+            auto it = conf.find(key);
+            if (it == conf.end())
+                return fallback;
+            if (auto *value = std::get_if<long long>(&it->second.v))
+                return *value;
+            return fallback;
+        }
+
+        std::string string(const zia::api::Conf &conf, const std::string &key, const std::string &fallback) {
+            auto it = conf.find(key);
+            if (it == conf.end())
+                return fallback;
+            if (auto *value = std::get_if<std::string>(&it->second.v))
+                return *value;
+            return fallback;
+        }
+
+        std::string_view methodName(zia::api::http::Method method) {
+            using zia::api::http::Method;
+
+            switch (method) {
+                case Method::options: return "OPTIONS";
+                case Method::get: return "GET";
+                case Method::head: return "HEAD";
+                case Method::post: return "POST";
+                case Method::put: return "PUT";
+                case Method::delete_: return "DELETE";
+                case Method::trace: return "TRACE";
+                case Method::connect: return "CONNECT";
+                default: return "";
+            }
+        }
+
+        std::string_view protocolName(zia::api::http::Version version) {
+            using zia::api::http::Version;
+
+            switch (version) {
+                case Version::http_0_9: return "HTTP/0.9";
+                case Version::http_1_0: return "HTTP/1.0";
+                case Version::http_2_0: return "HTTP/2.0";
+                default: return "HTTP/1.1";
+            }
+        }
+
+        std::string_view trim(std::string_view str) {
+            while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+                str.remove_prefix(1);
+            while (!str.empty() && (str.back() == ' ' || str.back() == '\t' || str.back() == '\r'))
+                str.remove_suffix(1);
+            return str;
+        }
+
+        int hexDigit(char c) {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            c = static_cast<char>(c | 0x20);
+            return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        }
+
+        /**
+         * Percent-decode path into relative segments, dropping the empty and "." ones.
+         * @return false on a malformed escape, a NUL byte or a ".." segment.
+         */
+        bool relativePathOf(std::string_view path, std::string &relative) {
+            std::string decoded;
+            decoded.reserve(path.size());
+            for (std::size_t i = 0; i < path.size(); ++i) {
+                if (path[i] != '%') {
+                    decoded += path[i];
+                    continue;
+                }
+                int high = i + 2 < path.size() ? hexDigit(path[i + 1]) : -1;
+                int low = high < 0 ? -1 : hexDigit(path[i + 2]);
+                if (low < 0 || (high == 0 && low == 0))
+                    return false;
+                decoded += static_cast<char>(high << 4 | low);
+                i += 2;
+            }
+
+            relative.clear();
+            for (std::size_t start = 0; start <= decoded.size();) {
+                auto end = std::min(decoded.find('/', start), decoded.size());
+                auto segment = std::string_view(decoded).substr(start, end - start);
+                if (segment == "..")
+                    return false;
+                if (!segment.empty() && segment != ".")
+                    relative.append(relative.empty() ? "" : "/").append(segment);
+                start = end + 1;
+            }
+            return true;
+        }
+
+        // Both canonical.
+        bool isUnder(const std::filesystem::path &file, const std::filesystem::path &root) {
+            return std::mismatch(root.begin(), root.end(), file.begin(), file.end()).first == root.end();
+        }
+
+        std::string paramsOf(const CgiOptions &options, const zia::api::HttpDuplex &http, std::string_view path,
+                             std::string_view query, const std::string &file, const std::string &contentLength) {
+            std::string params;
+            auto param = [&params](std::string_view name, std::string_view value) {
+                zia::modules::fastcgi::appendParam(params, name, value);
+            };
+
+            param("GATEWAY_INTERFACE", "CGI/1.1");
+            param("SERVER_SOFTWARE", "zia");
+            param("SERVER_PROTOCOL", protocolName(http.req.version));
+            param("REQUEST_METHOD", methodName(http.req.method));
+            param("REQUEST_URI", http.req.uri);
+            param("SCRIPT_NAME", path);
+            param("SCRIPT_FILENAME", file);
+            param("DOCUMENT_ROOT", options.root);
+            param("QUERY_STRING", query);
+            param("REMOTE_ADDR", http.info.ip.str);
+            param("REMOTE_PORT", std::to_string(http.info.port));
+            if (!contentLength.empty())
+                param("CONTENT_LENGTH", contentLength);
+
+            std::string name;
+            for (const auto &header : http.req.headers) {
+                if (header.id == zia::api::http::Header::content_length)
+                    continue;
+                if (header.id == zia::api::http::Header::content_type) {
+                    param("CONTENT_TYPE", header.second);
+                    continue;
+                }
+                name = "HTTP_";
+                for (auto c : header.first)
+                    name += c == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+                // A "Proxy" header must not become the HTTP_PROXY variable of the script (httpoxy).
+                if (name != "HTTP_PROXY")
+                    param(name, header.second);
+            }
+            return params;
+        }
+
+        /**
+         * Turn the headers printed by the script into the response.
+         * @return false if they are malformed.
+         */
+        bool applyHead(std::string_view head, zia::api::HttpResponse &response) {
+            bool hasStatus = false;
+            bool hasLocation = false;
+
+            while (!head.empty()) {
+                auto eol = head.find('\n');
+                auto line = trim(head.substr(0, eol));
+                head.remove_prefix(eol == std::string_view::npos ? head.size() : eol + 1);
+                if (line.empty())
+                    continue;
+
+                auto colon = line.find(':');
+                if (colon == std::string_view::npos || colon == 0)
+                    return false;
+                auto name = line.substr(0, colon);
+                auto value = trim(line.substr(colon + 1));
+
+                if (zia::api::http::iequals(name, "Status")) {
+                    int status = 0;
+                    std::size_t i = 0;
+                    for (; i < value.size() && value[i] >= '0' && value[i] <= '9'; ++i)
+                        status = status * 10 + (value[i] - '0');
+                    if (i != 3)
+                        return false;
+                    response.status = status;
+                    response.reason = std::string(trim(value.substr(i)));
+                    hasStatus = true;
+                    continue;
+                }
+                if (zia::api::http::iequals(name, "Location"))
+                    hasLocation = true;
+                auto added = response.headers.emplace(name, std::string(value));
+                if (!added.second)
+                    added.first->second += ", " + std::string(value);
+            }
+            if (!hasStatus)
+                response.status = hasLocation ? zia::api::http::common_status::found : zia::api::http::common_status::ok;
+            return true;
+        }
+
+        /**
+         * Error answered instead of the script.
+         */
+        bool fail(zia::api::HttpResponse &response, zia::api::http::Status status) {
+            response.status = status;
+            response.reason.clear();
+            response.body.clear();
+            return false;
+        }
+    }
+
+    CgiOptions CgiOptions::fromConf(const zia::api::Conf &conf) {
+        CgiOptions options;
+
+        options.socket = string(conf, "cgi_socket", options.socket);
+        options.command = string(conf, "cgi_command", options.command);
+        options.processes = static_cast<unsigned>(std::max(1ll, integer(conf, "cgi_processes", options.processes)));
+        // Each spawned process serves one connection at a time: more would wait to be accepted.
+        auto connections = options.command.empty() ? options.connections : options.processes;
+        options.connections = static_cast<std::size_t>(
+                std::max(1ll, integer(conf, "cgi_connections", static_cast<long long>(connections))));
+        auto keep = conf.find("cgi_keep_connections");
+        if (keep != conf.end()) {
+            if (auto *value = std::get_if<bool>(&keep->second.v))
+                options.keep = *value;
+        }
+        options.timeout = std::chrono::milliseconds(integer(conf, "cgi_timeout", options.timeout.count()));
+        options.maxOutput = static_cast<std::size_t>(
+                std::max(0ll, integer(conf, "cgi_max_output", static_cast<long long>(options.maxOutput))));
+        options.root = string(conf, "cgi_root", options.root);
+        options.prefix = string(conf, "cgi_prefix", options.prefix);
+
+        auto timeouts = conf.find("cgi_timeouts");
+        if (timeouts != conf.end()) {
+            if (auto *object = std::get_if<zia::api::ConfObject>(&timeouts->second.v)) {
+                for (const auto &entry : *object) {
+                    if (auto *ms = std::get_if<long long>(&entry.second.v))
+                        options.timeouts.emplace_back(entry.first, std::chrono::milliseconds(*ms));
+                }
+            }
+        }
+        auto extensions = conf.find("cgi_extensions");
+        if (extensions != conf.end()) {
+            options.extensions.clear();
+            if (auto *array = std::get_if<zia::api::ConfArray>(&extensions->second.v)) {
+                for (const auto &item : *array) {
+                    if (auto *extension = std::get_if<std::string>(&item.v))
+                        options.extensions.push_back(*extension);
+                }
+            }
+        }
+        return options;
+    }
+
+    CgiBin::~CgiBin() {
+        this->idle.clear();
+        this->stopChildren();
+    }
+
+    bool CgiBin::spawn(std::string &error) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (this->options.socket.size() >= sizeof(addr.sun_path)) {
+            error = "socket path too long";
+            return false;
+        }
+        std::memcpy(addr.sun_path, this->options.socket.c_str(), this->options.socket.size() + 1);
+        ::unlink(this->options.socket.c_str());
+
+        int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listener, 128) != 0) {
+            error = std::string("cannot listen on ") + this->options.socket + ": " + std::strerror(errno);
+            if (listener >= 0)
+                ::close(listener);
+            return false;
+        }
+
+        // Built before forking: the child only makes async-signal-safe calls until exec.
+        auto command = "exec " + this->options.command;
+        for (unsigned i = 0; i < this->options.processes; ++i) {
+            auto pid = ::fork();
+            if (pid == 0) {
+                ::dup2(listener, 0);
+                ::execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+                ::_exit(127);
+            }
+            if (pid < 0) {
+                error = std::string("cannot spawn: ") + std::strerror(errno);
+                break;
+            }
+            this->children.push_back(pid);
+        }
+        ::close(listener);
+        return error.empty();
+    }
+
+    void CgiBin::stopChildren() {
+        for (auto pid : this->children)
+            ::kill(pid, SIGTERM);
+        for (auto pid : this->children)
+            ::waitpid(pid, nullptr, 0);
+        if (!this->children.empty())
+            ::unlink(this->options.socket.c_str());
+        this->children.clear();
+    }
+
+    bool CgiBin::config(const zia::api::Conf &conf) {
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->idle.clear();
+            this->openCount = 0;
+        }
+        this->stopChildren();
+        this->options = CgiOptions::fromConf(conf);
+        this->failure.clear();
+        std::error_code unresolved;
+        this->root = std::filesystem::weakly_canonical(std::filesystem::absolute(this->options.root), unresolved);
+        if (unresolved) {
+            this->failure = "cannot resolve " + this->options.root + ": " + unresolved.message();
+            return false;
+        }
+
+        if (!this->options.command.empty()) {
+            if (this->options.socket.empty())
+                this->options.socket = "/tmp/zia_cgibin_" + std::to_string(::getpid()) + ".sock";
+            if (!this->spawn(this->failure))
+                return false;
+        }
+        if (this->options.socket.empty())
+            this->failure = "no cgi_socket nor cgi_command";
+        return this->failure.empty();
+    }
+
+    std::string CgiBin::scriptError() {
+        std::lock_guard<std::mutex> guard(this->lock);
+        return this->lastScriptError;
+    }
+
+    bool CgiBin::handles(std::string_view path) const {
+        if (!this->options.prefix.empty() && path.substr(0, this->options.prefix.size()) == this->options.prefix)
+            return true;
+        for (const auto &extension : this->options.extensions) {
+            if (path.size() >= extension.size() && path.substr(path.size() - extension.size()) == extension)
+                return true;
+        }
+        return false;
+    }
+
+    std::chrono::milliseconds CgiBin::timeoutOf(std::string_view path) const {
+        for (const auto &timeout : this->options.timeouts) {
+            if (timeout.first == path)
+                return timeout.second;
+        }
+        return this->options.timeout;
+    }
+
+    std::unique_ptr<CgiBin::Connection> CgiBin::acquire(fastcgi::Deadline deadline, bool &reuse, std::string &error) {
+        std::unique_lock<std::mutex> guard(this->lock);
+
+        for (;;) {
+            while (!this->idle.empty()) {
+                auto connection = std::move(this->idle.back());
+                this->idle.pop_back();
+                // Closed by the application meanwhile.
+                if (connection->stale()) {
+                    --this->openCount;
+                    continue;
+                }
+                reuse = true;
+                ++this->reused;
+                return connection;
+            }
+            if (this->openCount < this->options.connections) {
+                ++this->openCount;
+                guard.unlock();
+                auto connection = Connection::open(this->options.socket, error);
+                if (!connection) {
+                    this->release(nullptr);
+                    return nullptr;
+                }
+                reuse = false;
+                ++this->opened;
+                return connection;
+            }
+            if (this->available.wait_until(guard, deadline) == std::cv_status::timeout) {
+                error = "no connection available";
+                return nullptr;
+            }
+        }
+    }
+
+    void CgiBin::release(std::unique_ptr<Connection> connection) {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (connection)
+            this->idle.push_back(std::move(connection));
+        else
+            --this->openCount;
+        this->available.notify_one();
+    }
+
+    bool CgiBin::exec(zia::api::HttpDuplex &http) {
+        using zia::api::http::common_status::bad_gateway;
+        using zia::api::http::common_status::bad_request;
+        using zia::api::http::common_status::forbidden;
+        using zia::api::http::common_status::gateway_timeout;
+        using Status = Connection::Status;
+
+        std::string_view uri = http.req.uri;
+        auto mark = uri.find('?');
+        auto path = uri.substr(0, mark);
+        auto query = mark == std::string_view::npos ? std::string_view() : uri.substr(mark + 1);
+        if (!this->handles(path))
+            return true;
+        // Symbolic links are followed: the script itself must be under the root too.
+        std::string relative;
+        if (!relativePathOf(path, relative))
+            return fail(http.resp, bad_request);
+        std::error_code unresolved;
+        auto file = std::filesystem::weakly_canonical(this->root / relative, unresolved);
+        if (unresolved || !isUnder(file, this->root))
+            return fail(http.resp, forbidden);
+        auto deadline = std::chrono::steady_clock::now() + this->timeoutOf(path);
+
+        auto stream = zia::apipp::bodyStreamOf(http.info);
+        std::string contentLength;
+        if (!stream)
+            contentLength = std::to_string(http.req.body.size());
+        else if (auto *length = http.req.headers.get(zia::api::http::Header::content_length))
+            contentLength = *length;
+
+        std::string out;
+        fastcgi::appendBeginRequest(out, requestId, this->options.keep ? fastcgi::keepConnection : 0);
+        fastcgi::appendRecord(out, fastcgi::RecordType::Params, requestId,
+                              paramsOf(this->options, http, path, query, file.string(), contentLength));
+        fastcgi::appendRecord(out, fastcgi::RecordType::Params, requestId, {});
+        if (!stream) {
+            if (!http.req.body.empty())
+                fastcgi::appendRecord(out, fastcgi::RecordType::Stdin, requestId,
+                                      std::string_view(reinterpret_cast<const char *>(http.req.body.data()),
+                                                       http.req.body.size()));
+            fastcgi::appendRecord(out, fastcgi::RecordType::Stdin, requestId, {});
+        }
+
+        // A kept connection may have been closed by the application since: the request is sent again on
+        // another one if writing it failed. Once written, it may have run already: it is only sent again if
+        // its method is idempotent and its streamed body, if any, was not consumed.
+        auto idempotent = http.req.method != zia::api::http::Method::post &&
+                          http.req.method != zia::api::http::Method::connect &&
+                          http.req.method != zia::api::http::Method::unknown;
+        std::unique_ptr<Connection> connection;
+        std::string error;
+        fastcgi::Record record{};
+        auto status = Status::Closed;
+        for (bool reuse = true; reuse && status == Status::Closed;) {
+            connection = this->acquire(deadline, reuse, error);
+            if (!connection)
+                return fail(http.resp, std::chrono::steady_clock::now() >= deadline ? gateway_timeout : bad_gateway);
+            status = connection->write(out, deadline);
+            if (status == Status::Ok && !idempotent)
+                reuse = false;
+            if (status == Status::Ok && stream) {
+                reuse = false;
+                zia::api::Net::Raw chunk;
+                while (status == Status::Ok && stream->read(chunk)) {
+                    out.clear();
+                    fastcgi::appendRecord(out, fastcgi::RecordType::Stdin, requestId,
+                                          std::string_view(reinterpret_cast<const char *>(chunk.data()), chunk.size()));
+                    status = connection->write(out, deadline);
+                }
+                out.clear();
+                fastcgi::appendRecord(out, fastcgi::RecordType::Stdin, requestId, {});
+                if (stream->failed())
+                    status = Status::Error;
+                else if (status == Status::Ok)
+                    status = connection->write(out, deadline);
+            }
+            if (status == Status::Ok)
+                status = connection->next(record, deadline);
+            if (status != Status::Ok) {
+                connection.reset();
+                this->release(nullptr);
+            }
+        }
+        if (status != Status::Ok) {
+            if (stream && stream->failed())
+                return fail(http.resp, bad_request);
+            return fail(http.resp, status == Status::TimedOut ? gateway_timeout : bad_gateway);
+        }
+
+        auto abort = [this, &connection, &http](zia::api::http::Status code) {
+            connection.reset();
+            this->release(nullptr);
+            return fail(http.resp, code);
+        };
+
+        // The head is gathered until its blank line, the rest of the output goes straight to the body, up to
+        // maxOutput: the response is only sent once the script is done.
+        std::string head;
+        bool headDone = false;
+        auto &body = http.resp.body;
+        body.clear();
+        for (;; status = connection->next(record, deadline)) {
+            if (status != Status::Ok)
+                return abort(status == Status::TimedOut ? gateway_timeout : bad_gateway);
+            if (record.requestId != requestId)
+                continue;
+
+            if (record.type == fastcgi::RecordType::Stdout) {
+                auto content = record.content;
+                if (!headDone) {
+                    auto searchFrom = head.size() < 3 ? 0 : head.size() - 3;
+                    head.append(content);
+                    auto crlf = head.find("\r\n\r\n", searchFrom);
+                    auto lf = head.find("\n\n", searchFrom);
+                    auto end = std::min(crlf == std::string::npos ? crlf : crlf + 4, lf == std::string::npos ? lf : lf + 2);
+                    if (end == std::string::npos) {
+                        if (head.size() > maxHead)
+                            return abort(bad_gateway);
+                        continue;
+                    }
+                    if (!applyHead(std::string_view(head).substr(0, end), http.resp))
+                        return abort(bad_gateway);
+                    headDone = true;
+                    content = std::string_view(head).substr(end);
+                }
+                if (content.size() > this->options.maxOutput - body.size())
+                    return abort(bad_gateway);
+                const auto *bytes = reinterpret_cast<const std::byte *>(content.data());
+                body.insert(body.end(), bytes, bytes + content.size());
+                if (!head.empty() && headDone)
+                    std::string().swap(head);
+            } else if (record.type == fastcgi::RecordType::Stderr) {
+                if (!record.content.empty()) {
+                    std::lock_guard<std::mutex> guard(this->lock);
+                    this->lastScriptError.assign(path).append(": ").append(record.content);
+                }
+            } else if (record.type == fastcgi::RecordType::EndRequest) {
+                if (!headDone)
+                    return abort(bad_gateway);
+                auto complete = record.content.size() >= 5 &&
+                                static_cast<std::uint8_t>(record.content[4]) == fastcgi::requestComplete;
+                if (complete && this->options.keep) {
+                    this->release(std::move(connection));
+                } else {
+                    connection.reset();
+                    this->release(nullptr);
+                }
+                return true;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "../api/module.h"
+#include "fastcgi.hpp"
+
+namespace zia::modules {
+
+    /**
+     * Settings of the cgibin module, read from the server Conf.
+     */
+    struct CgiOptions {
+        std::string socket{};       // "cgi_socket": Unix socket path or "host:port" of the FastCGI application.
+        std::string command{};      // "cgi_command": FastCGI application spawned by the module, none if empty.
+        unsigned processes = 4;     // "cgi_processes": instances of the command.
+        /**
+         * "cgi_connections": connections open at once, kept for the next requests. Requests wait for one
+         * beyond. One per process when the module spawns the application.
+         */
+        std::size_t connections = 16;
+        bool keep = true;           // "cgi_keep_connections": false for applications closing after each request.
+        std::chrono::milliseconds timeout{30000}; // "cgi_timeout": per request, from the start to the end of the response.
+        /**
+         * "cgi_max_output": bytes of body a script may print. The whole output is held in the response until the
+         * script ends, so this bounds the memory of each request running.
+         */
+        std::size_t maxOutput = 64 << 20;
+        /**
+         * "cgi_timeouts": object of script paths to milliseconds, replacing the timeout for them.
+         */
+        std::vector<std::pair<std::string, std::chrono::milliseconds>> timeouts{};
+        std::string root = ".";     // "cgi_root": directory of the scripts, for SCRIPT_FILENAME.
+        std::string prefix = "/cgi-bin/"; // "cgi_prefix": paths handled by the module.
+        std::vector<std::string> extensions{".php"}; // "cgi_extensions": paths handled by the module, too.
+
+        static CgiOptions fromConf(const zia::api::Conf &conf);
+    };
+
+    /**
+     * CGI scripts run by a FastCGI application ("cgibin" module).
+     *
+     * Requests whose path starts with the prefix or ends with one of the extensions are sent to the
+     * application, the other ones go through untouched. Connections are kept open (FCGI_KEEP_CONN) and
+     * reused by the next requests, so there is no process or connection set up per request.
+     * With "cgi_command", the module spawns the application itself, as several processes accepting
+     * on one listening socket (the FastCGI convention: the socket is their descriptor 0), and stops
+     * and reaps them when it is destroyed or configured again. They are not tied to the thread which
+     * spawned them: config() may run on a thread which ends right after (see zia::apipp::ModuleManager).
+     *
+     * A streamed request body (see zia::apipp::bodyStreamOf) is forwarded as it arrives. The output of
+     * the script is not streamed: it is buffered in the response body until the script ends, and a script
+     * printing more than "cgi_max_output" bytes gets 502 and its connection is closed. A script not done
+     * before its timeout gets 504 the same way; an application which cannot be reached gets 502.
+     * SCRIPT_FILENAME is the percent-decoded path under the root: a path with a ".." segment gets 400, a
+     * script resolved out of the root through a symbolic link gets 403.
+     * exec() then returns false, so the rest of the chain does not run.
+     */
+    class CgiBin : public zia::api::Module {
+    private:
+        using Connection = fastcgi::Connection;
+
+        CgiOptions options{};
+        std::filesystem::path root{}; // options.root, canonical: SCRIPT_FILENAME stays under it.
+        std::string failure{};
+        std::vector<pid_t> children{};
+
+        std::mutex lock{};
+        std::condition_variable available{};
+        std::vector<std::unique_ptr<Connection>> idle{};
+        std::size_t openCount = 0; // Idle and in use, at most options.connections.
+        std::atomic<std::uint64_t> opened{0};
+        std::atomic<std::uint64_t> reused{0};
+        std::string lastScriptError{}; // Guarded by lock.
+
+        bool spawn(std::string &error);
+
+        void stopChildren();
+
+        /**
+         * An idle connection, or a new one, waiting for one to be released if there are too many.
+         * @param reuse Set to whether it was kept from a previous request.
+         */
+        std::unique_ptr<Connection> acquire(fastcgi::Deadline deadline, bool &reuse, std::string &error);
+
+        /**
+         * Keep connection for the next requests, or, if nullptr, forget the one which was closed.
+         */
+        void release(std::unique_ptr<Connection> connection);
+
+    public:
+        CgiBin() = default;
+
+        ~CgiBin() override;
+
+        CgiBin(const CgiBin &) = delete;
+        CgiBin &operator=(const CgiBin &) = delete;
+
+        bool config(const zia::api::Conf &conf) override;
+
+        bool exec(zia::api::HttpDuplex &http) override;
+
+        /**
+         * Whether the module runs requests for path.
+         */
+        bool handles(std::string_view path) const;
+
+        std::chrono::milliseconds timeoutOf(std::string_view path) const;
+
+        /**
+         * Connections opened to the application so far.
+         */
+        std::uint64_t connectionsOpened() const {
+            return this->opened.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Requests sent on a connection kept from a previous one.
+         */
+        std::uint64_t connectionsReused() const {
+            return this->reused.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Why the last config() failed, empty if it succeeded.
+         */
+        const std::string &error() const {
+            return this->failure;
+        }
+
+        /**
+         * Last output of a script on its error stream (FCGI_STDERR), after its path.
+         */
+        std::string scriptError();
+    };
+
+}
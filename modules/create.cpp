@@ -0,0 +1,18 @@
+#if defined(ZIA_MODULE_CGIBIN)
+#include "cgibin.hpp"
+using ModuleType = zia::modules::CgiBin;
+#elif defined(ZIA_MODULE_GZIP)
+#include "gzip.hpp"
+using ModuleType = zia::modules::Gzip;
+#elif defined(ZIA_MODULE_CACHE)
+#include "cache.hpp"
+using ModuleType = zia::modules::ResponseCache;
+#endif
+
+/**
+ * Entry point of the dynamic library of a module, see zia::api::Module.
+ * Built once per module, ZIA_MODULE_<NAME> selecting which.
+ */
+extern "C" zia::api::Module *create() {
+    return new ModuleType();
+}
@@ -0,0 +1,252 @@
+#include "fastcgi.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace zia::modules::fastcgi {
+
+    namespace {
+        constexpr std::size_t headerSize = 8;
+
+        void appendHeader(std::string &out, RecordType type, std::uint16_t requestId, std::size_t length,
+                          std::size_t padding) {
+            char header[headerSize] = {
+                    static_cast<char>(version), static_cast<char>(type),
+                    static_cast<char>(requestId >> 8), static_cast<char>(requestId & 0xff),
+                    static_cast<char>(length >> 8), static_cast<char>(length & 0xff),
+                    static_cast<char>(padding), 0};
+            out.append(header, headerSize);
+        }
+
+        void appendLength(std::string &out, std::size_t length) {
+            if (length < 0x80) {
+                out.push_back(static_cast<char>(length));
+                return;
+            }
+            out.push_back(static_cast<char>((length >> 24) | 0x80));
+            out.push_back(static_cast<char>((length >> 16) & 0xff));
+            out.push_back(static_cast<char>((length >> 8) & 0xff));
+            out.push_back(static_cast<char>(length & 0xff));
+        }
+
+        bool parseLength(std::string_view &params, std::size_t &length) {
+            if (params.empty())
+                return false;
+            auto first = static_cast<unsigned char>(params[0]);
+            if (!(first & 0x80)) {
+                length = first;
+                params.remove_prefix(1);
+                return true;
+            }
+            if (params.size() < 4)
+                return false;
+            length = (std::size_t(first & 0x7f) << 24) | (std::size_t(static_cast<unsigned char>(params[1])) << 16) |
+                     (std::size_t(static_cast<unsigned char>(params[2])) << 8) |
+                     std::size_t(static_cast<unsigned char>(params[3]));
+            params.remove_prefix(4);
+            return true;
+        }
+
+        /**
+         * Milliseconds left for poll, at least 0.
+         */
+        int remaining(Deadline deadline) {
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            return static_cast<int>(std::clamp<long long>(left.count(), 0, std::numeric_limits<int>::max()));
+        }
+
+        bool wait(int fd, short events, Deadline deadline) {
+            pollfd poll{fd, events, 0};
+            int ready;
+            do {
+                ready = ::poll(&poll, 1, remaining(deadline));
+            } while (ready < 0 && errno == EINTR);
+            return ready > 0;
+        }
+    }
+
+    void appendRecord(std::string &out, RecordType type, std::uint16_t requestId, std::string_view content) {
+        do {
+            auto length = std::min(content.size(), maxContent);
+            // Contents are padded to 8 bytes, as applications expect.
+            auto padding = (8 - length % 8) % 8;
+            appendHeader(out, type, requestId, length, padding);
+            out.append(content.data(), length);
+            out.append(padding, '\0');
+            content.remove_prefix(length);
+        } while (!content.empty());
+    }
+
+    void appendBeginRequest(std::string &out, std::uint16_t requestId, std::uint8_t flags) {
+        char body[8] = {static_cast<char>(responder >> 8), static_cast<char>(responder & 0xff),
+                        static_cast<char>(flags), 0, 0, 0, 0, 0};
+        appendHeader(out, RecordType::BeginRequest, requestId, sizeof(body), 0);
+        out.append(body, sizeof(body));
+    }
+
+    void appendEndRequest(std::string &out, std::uint16_t requestId, std::uint32_t appStatus) {
+        char body[8] = {static_cast<char>(appStatus >> 24), static_cast<char>((appStatus >> 16) & 0xff),
+                        static_cast<char>((appStatus >> 8) & 0xff), static_cast<char>(appStatus & 0xff),
+                        static_cast<char>(requestComplete), 0, 0, 0};
+        appendHeader(out, RecordType::EndRequest, requestId, sizeof(body), 0);
+        out.append(body, sizeof(body));
+    }
+
+    void appendParam(std::string &out, std::string_view name, std::string_view value) {
+        appendLength(out, name.size());
+        appendLength(out, value.size());
+        out.append(name);
+        out.append(value);
+    }
+
+    bool parseParams(std::string_view params, std::vector<std::pair<std::string_view, std::string_view>> &pairs) {
+        while (!params.empty()) {
+            std::size_t nameLength, valueLength;
+            if (!parseLength(params, nameLength) || !parseLength(params, valueLength) ||
+                params.size() < nameLength + valueLength)
+                return false;
+            pairs.emplace_back(params.substr(0, nameLength), params.substr(nameLength, valueLength));
+            params.remove_prefix(nameLength + valueLength);
+        }
+        return true;
+    }
+
+    Connection::Connection(int fd) : fd{fd}, input(16 * 1024) {}
+
+    Connection::~Connection() {
+        ::close(this->fd);
+    }
+
+    std::unique_ptr<Connection> Connection::open(const std::string &address, std::string &error) {
+        auto colon = address.rfind(':');
+        int fd = -1;
+
+        if (address.empty() || address[0] == '/' || colon == std::string::npos) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            if (address.size() >= sizeof(addr.sun_path)) {
+                error = "socket path too long: " + address;
+                return nullptr;
+            }
+            std::memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+            fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        } else {
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo *found = nullptr;
+            auto host = address.substr(0, colon);
+            auto port = address.substr(colon + 1);
+            if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) {
+                error = "cannot resolve " + address;
+                return nullptr;
+            }
+            for (auto *candidate = found; candidate && fd < 0; candidate = candidate->ai_next) {
+                fd = ::socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol);
+                if (fd >= 0 && ::connect(fd, candidate->ai_addr, candidate->ai_addrlen) != 0) {
+                    ::close(fd);
+                    fd = -1;
+                }
+            }
+            ::freeaddrinfo(found);
+            if (fd >= 0) {
+                int one = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+        }
+
+        if (fd < 0) {
+            error = "cannot connect to " + address + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        return std::make_unique<Connection>(fd);
+    }
+
+    Connection::Status Connection::write(std::string_view data, Deadline deadline) {
+        while (!data.empty()) {
+            auto sent = ::send(this->fd, data.data(), data.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent > 0) {
+                data.remove_prefix(static_cast<std::size_t>(sent));
+            } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!wait(this->fd, POLLOUT, deadline))
+                    return Status::TimedOut;
+            } else if (sent < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return errno == EPIPE || errno == ECONNRESET ? Status::Closed : Status::Error;
+            }
+        }
+        return Status::Ok;
+    }
+
+    Connection::Status Connection::fill(Deadline deadline) {
+        if (this->start > 0) {
+            std::memmove(this->input.data(), this->input.data() + this->start, this->end - this->start);
+            this->end -= this->start;
+            this->start = 0;
+        }
+        if (this->end == this->input.size())
+            this->input.resize(this->input.size() * 2);
+
+        for (;;) {
+            auto got = ::recv(this->fd, this->input.data() + this->end, this->input.size() - this->end, MSG_DONTWAIT);
+            if (got > 0) {
+                this->end += static_cast<std::size_t>(got);
+                return Status::Ok;
+            }
+            // Reset when the application closed the connection without reading what was sent on it.
+            if (got == 0 || errno == ECONNRESET)
+                return Status::Closed;
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return Status::Error;
+            if (!wait(this->fd, POLLIN, deadline))
+                return Status::TimedOut;
+        }
+    }
+
+    Connection::Status Connection::next(Record &record, Deadline deadline) {
+        for (;;) {
+            auto available = this->end - this->start;
+            if (available >= headerSize) {
+                const auto *header = reinterpret_cast<const unsigned char *>(this->input.data() + this->start);
+                std::size_t length = (std::size_t(header[4]) << 8) | header[5];
+                std::size_t total = headerSize + length + header[6];
+                if (header[0] != version)
+                    return Status::Error;
+                if (available >= total) {
+                    record.type = static_cast<RecordType>(header[1]);
+                    record.requestId = static_cast<std::uint16_t>((header[2] << 8) | header[3]);
+                    record.content = std::string_view(this->input.data() + this->start + headerSize, length);
+                    this->start += total;
+                    return Status::Ok;
+                }
+            }
+            auto status = this->fill(deadline);
+            if (status != Status::Ok)
+                return status;
+        }
+    }
+
+    bool Connection::stale() const {
+        if (this->end != this->start)
+            return true;
+        pollfd poll{this->fd, POLLIN, 0};
+        return ::poll(&poll, 1, 0) != 0;
+    }
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zia::modules::fastcgi {
+
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    enum class RecordType : std::uint8_t {
+        BeginRequest = 1,
+        AbortRequest = 2,
+        EndRequest = 3,
+        Params = 4,
+        Stdin = 5,
+        Stdout = 6,
+        Stderr = 7,
+    };
+
+    constexpr std::uint8_t version = 1;
+    constexpr std::uint16_t responder = 1;        // Role of BeginRequest.
+    constexpr std::uint8_t keepConnection = 1;    // Flag of BeginRequest: the application does not close the connection.
+    constexpr std::uint8_t requestComplete = 0;   // Protocol status of EndRequest.
+    constexpr std::size_t maxContent = 0xffff;
+
+    /**
+     * Record received, its content is a view valid until the next Connection::next() call.
+     */
+    struct Record {
+        RecordType type;
+        std::uint16_t requestId;
+        std::string_view content;
+    };
+
+    /**
+     * Append records of type holding content, split in as many records as needed. Empty content
+     * gives one empty record, which ends a stream (Params, Stdin, Stdout).
+     */
+    void appendRecord(std::string &out, RecordType type, std::uint16_t requestId, std::string_view content);
+
+    void appendBeginRequest(std::string &out, std::uint16_t requestId, std::uint8_t flags);
+
+    void appendEndRequest(std::string &out, std::uint16_t requestId, std::uint32_t appStatus);
+
+    /**
+     * Append a name-value pair in the encoding of Params records.
+     */
+    void appendParam(std::string &out, std::string_view name, std::string_view value);
+
+    /**
+     * Read the name-value pairs of params, the whole Params stream.
+     * @return false if it is malformed.
+     */
+    bool parseParams(std::string_view params, std::vector<std::pair<std::string_view, std::string_view>> &pairs);
+
+    /**
+     * Blocking stream socket to a FastCGI application, every operation bounded by a deadline.
+     * Used by one thread at a time.
+     */
+    class Connection {
+    public:
+        enum class Status {
+            Ok,
+            Closed,   // The peer closed the connection.
+            TimedOut,
+            Error,
+        };
+
+    private:
+        int fd;
+        std::vector<char> input;
+        std::size_t start = 0; // Unread bytes of input are [start, end).
+        std::size_t end = 0;
+
+        Status fill(Deadline deadline);
+
+    public:
+        explicit Connection(int fd);
+
+        ~Connection();
+
+        Connection(const Connection &) = delete;
+        Connection &operator=(const Connection &) = delete;
+
+        /**
+         * Connect to a Unix socket path, or to "host:port" over TCP.
+         * @return nullptr on failure, error then tells why.
+         */
+        static std::unique_ptr<Connection> open(const std::string &address, std::string &error);
+
+        Status write(std::string_view data, Deadline deadline);
+
+        /**
+         * Wait for the next record.
+         */
+        Status next(Record &record, Deadline deadline);
+
+        /**
+         * Whether the peer closed or sent something unexpected while the connection was idle.
+         */
+        bool stale() const;
+
+        int descriptor() const {
+            return this->fd;
+        }
+    };
+
+}
@@ -0,0 +1,370 @@
+#include "gzip.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace zia::modules {
+
+    namespace {
+        constexpr std::size_t chunkSize = 64 * 1024; // Input given to zlib at once.
+        constexpr std::size_t minOutput = 16 * 1024; // Room left for zlib output before each call.
+        constexpr std::size_t keptOutput = 1 << 20;  // Largest buffer a thread keeps for the next response.
+
+        std::atomic<std::uint64_t> created{0};
+
+        long long integer(const zia::api::Conf &conf, const std::string &key, long long fallback) {
+            auto it = conf.find(key);
+            if (it == conf.end())
+                return fallback;
+            if (auto *value = std::get_if<long long>(&it->second.v))
+                return *value;
+            return fallback;
+        }
+
+        std::string_view trim(std::string_view str) {
+            while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+                str.remove_prefix(1);
+            while (!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+                str.remove_suffix(1);
+            return str;
+        }
+
+        // Whether the comma separated list value has token, ignoring case.
+        bool hasToken(std::string_view value, std::string_view token) {
+            while (!value.empty()) {
+                auto comma = value.find(',');
+                if (zia::api::http::iequals(trim(value.substr(0, comma)), token))
+                    return true;
+                value.remove_prefix(comma == std::string_view::npos ? value.size() : comma + 1);
+            }
+            return false;
+        }
+
+        // "0", "1", "0.5"... (RFC 9110 qvalue), 1 if malformed.
+        double qValue(std::string_view str) {
+            if (str.empty() || (str[0] != '0' && str[0] != '1'))
+                return 1;
+            double value = str[0] - '0';
+            double unit = 1;
+            for (std::size_t i = 2; i < str.size() && i < 5 && str[1] == '.'; ++i) {
+                if (str[i] < '0' || str[i] > '9')
+                    return 1;
+                unit /= 10;
+                value += (str[i] - '0') * unit;
+            }
+            return std::min(value, 1.0);
+        }
+
+        bool isWholeType(const std::string &entry) {
+            return !entry.empty() && entry.back() == '/';
+        }
+
+        bool matches(std::string_view type, const std::string &entry) {
+            if (isWholeType(entry))
+                return type.size() > entry.size() && zia::api::http::iequals(type.substr(0, entry.size()), entry);
+            return zia::api::http::iequals(type, entry);
+        }
+
+        /**
+         * zlib streams of a thread, one per encoding, initialized on first use then reset for each response.
+         */
+        class Deflaters {
+        private:
+            struct Slot {
+                z_stream stream{};
+                bool ready = false;
+                int level = 0;
+            };
+
+            Slot slots[2];
+
+        public:
+            Deflaters() = default;
+
+            Deflaters(const Deflaters &) = delete;
+            Deflaters &operator=(const Deflaters &) = delete;
+
+            ~Deflaters() {
+                for (auto &slot : this->slots) {
+                    if (slot.ready)
+                        ::deflateEnd(&slot.stream);
+                }
+            }
+
+            /**
+             * @return nullptr if zlib fails, out of memory.
+             */
+            z_stream *get(Gzip::Encoding encoding, int level) {
+                bool gzip = encoding == Gzip::Encoding::gzip;
+                auto &slot = this->slots[gzip ? 0 : 1];
+                if (!slot.ready) {
+                    // "deflate" is the zlib format (RFC 9110 8.4.1.2); 16 more window bits select gzip instead.
+                    if (::deflateInit2(&slot.stream, level, Z_DEFLATED, gzip ? 15 + 16 : 15, 8,
+                                       Z_DEFAULT_STRATEGY) != Z_OK)
+                        return nullptr;
+                    slot.ready = true;
+                    slot.level = level;
+                    ++created;
+                    return &slot.stream;
+                }
+                if (::deflateReset(&slot.stream) != Z_OK)
+                    return nullptr;
+                if (slot.level != level && ::deflateParams(&slot.stream, level, Z_DEFAULT_STRATEGY) != Z_OK)
+                    return nullptr;
+                slot.level = level;
+                return &slot.stream;
+            }
+        };
+
+        thread_local Deflaters deflaters;
+        thread_local zia::api::Net::Raw spare;     // Output buffer, the previous uncompressed body.
+        thread_local std::vector<Bytef> fileChunk; // Read from file bodies.
+
+        /**
+         * Compress the chunks given by next(chunk, last) into out, stopping once it reaches limit bytes.
+         * @return false if next or zlib failed, or the output would not be smaller than limit.
+         */
+        template<typename Next>
+        bool compress(z_stream &stream, Next &&next, zia::api::Net::Raw &out, std::size_t limit) {
+            std::size_t used = 0;
+            bool last = false;
+            do {
+                const Bytef *chunk = nullptr;
+                std::size_t size = 0;
+                if (!next(chunk, size, last))
+                    return false;
+                stream.next_in = const_cast<Bytef *>(chunk);
+                stream.avail_in = static_cast<uInt>(size);
+                int result;
+                do {
+                    if (out.size() - used < minOutput)
+                        out.resize(std::max(out.size() * 2, used + minOutput));
+                    auto room = std::min<std::size_t>(out.size() - used, 1u << 30);
+                    stream.next_out = reinterpret_cast<Bytef *>(out.data() + used);
+                    stream.avail_out = static_cast<uInt>(room);
+                    result = ::deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+                    if (result == Z_STREAM_ERROR)
+                        return false;
+                    used += room - stream.avail_out;
+                    if (used >= limit)
+                        return false;
+                    // Room left means zlib took all the input and has nothing more to write until the next call.
+                } while (stream.avail_out == 0 || (last && result != Z_STREAM_END));
+            } while (!last);
+            out.resize(used);
+            return true;
+        }
+
+        // Compressions running at once, for the duration of one.
+        class Running {
+        private:
+            std::atomic<unsigned> &count;
+
+        public:
+            unsigned value;
+
+            explicit Running(std::atomic<unsigned> &count) : count(count), value(++count) {}
+
+            ~Running() {
+                --this->count;
+            }
+        };
+    }
+
+    GzipOptions GzipOptions::fromConf(const zia::api::Conf &conf) {
+        GzipOptions options;
+
+        options.minSize = static_cast<std::size_t>(std::max(0ll, integer(conf, "gzip_min_size", options.minSize)));
+        options.maxSize = static_cast<std::size_t>(std::max(0ll, integer(conf, "gzip_max_size", options.maxSize)));
+        options.level = static_cast<int>(std::clamp(integer(conf, "gzip_level", options.level), 1ll, 9ll));
+        options.minLevel = static_cast<int>(
+                std::clamp(integer(conf, "gzip_min_level", options.minLevel), 1ll, static_cast<long long>(options.level)));
+        options.workers = static_cast<unsigned>(std::max(0ll, integer(conf, "worker_threads", 0)));
+        if (!options.workers)
+            options.workers = std::max(1u, std::thread::hardware_concurrency());
+
+        auto levels = conf.find("gzip_levels");
+        if (levels != conf.end()) {
+            if (auto *object = std::get_if<zia::api::ConfObject>(&levels->second.v)) {
+                for (const auto &entry : *object) {
+                    if (auto *level = std::get_if<long long>(&entry.second.v))
+                        options.levels.emplace_back(entry.first, static_cast<int>(std::clamp(*level, 0ll, 9ll)));
+                }
+            }
+        }
+        auto skipped = conf.find("gzip_skip_types");
+        if (skipped != conf.end()) {
+            options.skipped.clear();
+            if (auto *array = std::get_if<zia::api::ConfArray>(&skipped->second.v)) {
+                for (const auto &item : *array) {
+                    if (auto *type = std::get_if<std::string>(&item.v))
+                        options.skipped.push_back(*type);
+                }
+            }
+        }
+        return options;
+    }
+
+    bool Gzip::config(const zia::api::Conf &conf) {
+        this->options = GzipOptions::fromConf(conf);
+        return true;
+    }
+
+    Gzip::Encoding Gzip::negotiate(std::string_view acceptEncoding) {
+        double gzip = -1, deflate = -1, any = -1;
+
+        while (!acceptEncoding.empty()) {
+            auto comma = acceptEncoding.find(',');
+            auto item = acceptEncoding.substr(0, comma);
+            acceptEncoding.remove_prefix(comma == std::string_view::npos ? acceptEncoding.size() : comma + 1);
+
+            auto semicolon = item.find(';');
+            auto coding = trim(item.substr(0, semicolon));
+            double q = 1;
+            while (semicolon != std::string_view::npos) {
+                item.remove_prefix(semicolon + 1);
+                semicolon = item.find(';');
+                auto param = trim(item.substr(0, semicolon));
+                if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+                    q = qValue(param.substr(2));
+            }
+
+            if (zia::api::http::iequals(coding, "gzip") || zia::api::http::iequals(coding, "x-gzip"))
+                gzip = std::max(gzip, q);
+            else if (zia::api::http::iequals(coding, "deflate"))
+                deflate = std::max(deflate, q);
+            else if (coding == "*")
+                any = std::max(any, q);
+        }
+        if (gzip < 0)
+            gzip = any;
+        if (deflate < 0)
+            deflate = any;
+        if (gzip <= 0 && deflate <= 0)
+            return Encoding::identity;
+        return gzip >= deflate ? Encoding::gzip : Encoding::deflate;
+    }
+
+    int Gzip::levelOf(std::string_view contentType) const {
+        auto type = trim(contentType.substr(0, contentType.find(';')));
+        if (type.empty())
+            return 0;
+
+        for (const auto &level : this->options.levels) {
+            if (!isWholeType(level.first) && matches(type, level.first))
+                return level.second;
+        }
+        for (const auto &skipped : this->options.skipped) {
+            if (matches(type, skipped))
+                return 0;
+        }
+        for (const auto &level : this->options.levels) {
+            if (isWholeType(level.first) && matches(type, level.first))
+                return level.second;
+        }
+        return this->options.level;
+    }
+
+    int Gzip::levelAt(int level, unsigned count) const {
+        auto start = std::max(1u, this->options.workers / 2);
+        if (count <= start || level <= this->options.minLevel)
+            return level;
+        // From the level past half the workers, to the minimum once all of them compress.
+        auto span = std::max(1u, this->options.workers - start);
+        auto over = static_cast<int>(std::min(count - start, span));
+        auto range = level - this->options.minLevel;
+        return level - (over * range + static_cast<int>(span) - 1) / static_cast<int>(span);
+    }
+
+    std::uint64_t Gzip::streamsCreated() {
+        return created.load(std::memory_order_relaxed);
+    }
+
+    bool Gzip::exec(zia::api::HttpDuplex &http) {
+        using zia::api::http::Header;
+
+        auto &response = http.resp;
+        auto status = response.status;
+        if (status < 200 || status == 204 || status == 206 || status == 304 ||
+            http.req.method == zia::api::http::Method::head || response.version == zia::api::http::Version::http_0_9)
+            return true;
+        if (response.headers.find(Header::content_encoding) != response.headers.end())
+            return true;
+        if (auto *cacheControl = response.headers.get(Header::cache_control)) {
+            if (hasToken(*cacheControl, "no-transform"))
+                return true;
+        }
+
+        auto size = response.file ? response.file->length : response.body.size();
+        if (size < this->options.minSize || size > this->options.maxSize)
+            return true;
+        auto *type = response.headers.get(Header::content_type);
+        auto level = type ? this->levelOf(*type) : 0;
+        if (!level)
+            return true;
+
+        // The response depends on Accept-Encoding from now on, whether it is compressed or not.
+        if (auto *vary = response.headers.get(Header::vary)) {
+            if (!hasToken(*vary, "Accept-Encoding") && !hasToken(*vary, "*"))
+                *vary += ", Accept-Encoding";
+        } else {
+            response.headers[Header::vary] = "Accept-Encoding";
+        }
+
+        auto *accept = http.req.headers.get(Header::accept_encoding);
+        auto encoding = accept ? negotiate(*accept) : Encoding::identity;
+        if (encoding == Encoding::identity)
+            return true;
+
+        Running running(this->active);
+        auto *stream = deflaters.get(encoding, this->levelAt(level, running.value));
+        if (!stream)
+            return true;
+
+        std::size_t done = 0;
+        bool compressed;
+        auto &out = spare;
+        out.resize(std::min(out.capacity(), size / 2 + minOutput));
+        if (response.file) {
+            const auto &file = *response.file;
+            fileChunk.resize(chunkSize);
+            compressed = compress(*stream, [&file, &done, size](const Bytef *&chunk, std::size_t &length, bool &last) {
+                length = std::min(chunkSize, size - done);
+                auto got = ::pread(file.fd, fileChunk.data(), length, static_cast<off_t>(file.offset + done));
+                if (got != static_cast<ssize_t>(length))
+                    return false;
+                chunk = fileChunk.data();
+                done += length;
+                last = done == size;
+                return true;
+            }, out, size);
+        } else {
+            const auto *body = reinterpret_cast<const Bytef *>(response.body.data());
+            compressed = compress(*stream, [body, &done, size](const Bytef *&chunk, std::size_t &length, bool &last) {
+                length = std::min(chunkSize, size - done);
+                chunk = body + done;
+                done += length;
+                last = done == size;
+                return true;
+            }, out, size);
+        }
+        if (!compressed)
+            return true;
+
+        response.body.swap(out);
+        response.file.reset();
+        if (out.capacity() > keptOutput)
+            zia::api::Net::Raw().swap(out);
+        response.headers[Header::content_encoding] = encoding == Encoding::gzip ? "gzip" : "deflate";
+        if (auto *length = response.headers.get(Header::content_length))
+            *length = std::to_string(response.body.size());
+        if (auto *etag = response.headers.get(Header::etag)) {
+            if (etag->compare(0, 2, "W/") != 0)
+                etag->insert(0, "W/");
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../api/module.h"
+
+namespace zia::modules {
+
+    /**
+     * Settings of the gzip module, read from the server Conf.
+     * Content types are matched without their parameters; an entry ending with '/' matches a whole type ("video/").
+     */
+    struct GzipOptions {
+        std::size_t minSize = 1024;         // "gzip_min_size": smaller bodies are sent as they are.
+        std::size_t maxSize = 16 << 20;     // "gzip_max_size": larger ones too, not to hold a worker too long.
+        int level = 6;                      // "gzip_level": zlib level, 1 (fastest) to 9 (smallest).
+        int minLevel = 1;                   // "gzip_min_level": lowest level when the workers are saturated.
+        unsigned workers = 0;               // "worker_threads": as the Scheduler, one per core if 0.
+        /**
+         * "gzip_levels": object of content types to levels, replacing the level for them. An exact type found
+         * there is compressed even if it is in the skipped types; 0 never compresses it.
+         */
+        std::vector<std::pair<std::string, int>> levels{};
+        /**
+         * "gzip_skip_types": content types already compressed. Responses without a content type are not
+         * compressed either.
+         */
+        std::vector<std::string> skipped{
+                "image/png", "image/jpeg", "image/gif", "image/webp", "image/avif", "video/", "audio/",
+                "font/woff", "font/woff2", "application/zip", "application/gzip", "application/x-gzip",
+                "application/x-bzip2", "application/x-xz", "application/zstd", "application/x-7z-compressed",
+                "application/pdf", "application/octet-stream"};
+
+        static GzipOptions fromConf(const zia::api::Conf &conf);
+    };
+
+    /**
+     * Response compression ("gzip" module), as the last module of the chain.
+     *
+     * The encoding is negotiated from Accept-Encoding: gzip, or deflate, whichever has the highest
+     * q-value, gzip first on a tie. The body, in memory or a file (see zia::api::FileBody), is compressed
+     * by chunks with a zlib stream kept by each thread and reset for the next response, never
+     * initialized per request. Content-Encoding and Vary are set, Content-Length updated if present,
+     * and a strong ETag made weak; bodies which do not get smaller are left as they are.
+     *
+     * Under load the level steps down: beyond half the workers compressing at once, each one more lowers
+     * it, down to the minimum level once all of them are (see levelAt()).
+     */
+    class Gzip : public zia::api::Module {
+    private:
+        GzipOptions options{};
+        std::atomic<unsigned> active{0};
+
+    public:
+        enum class Encoding {
+            identity, gzip, deflate
+        };
+
+        Gzip() = default;
+
+        Gzip(const Gzip &) = delete;
+        Gzip &operator=(const Gzip &) = delete;
+
+        bool config(const zia::api::Conf &conf) override;
+
+        bool exec(zia::api::HttpDuplex &http) override;
+
+        /**
+         * Preferred encoding of an Accept-Encoding value. identity when neither is acceptable.
+         */
+        static Encoding negotiate(std::string_view acceptEncoding);
+
+        /**
+         * Level for a content type (parameters ignored), 0 if it is not compressed.
+         */
+        int levelOf(std::string_view contentType) const;
+
+        /**
+         * level, stepped down for count compressions running at once.
+         */
+        int levelAt(int level, unsigned count) const;
+
+        /**
+         * zlib streams initialized so far, by all the threads: one per thread and encoding once warm.
+         */
+        static std::uint64_t streamsCreated();
+    };
+
+}
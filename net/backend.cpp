@@ -0,0 +1,67 @@
+
+#include "backend.hpp"
+#include "epoll.hpp"
+#include "uring.hpp"
+
+namespace zia::net {
+
+    BackendNet::~BackendNet() = default;
+
+    void BackendNet::select(const std::string &backend) {
+        auto wanted = backend == "io_uring" && UringNet::supported() ? backend : std::string("epoll");
+
+        if (this->impl && wanted == this->name)
+            return;
+        if (wanted == "io_uring")
+            this->impl = std::make_unique<UringNet>();
+        else
+            this->impl = std::make_unique<EpollNet>();
+        this->name = wanted;
+    }
+
+    bool BackendNet::config(const zia::api::Conf &conf) {
+        this->conf = conf;
+
+        if (!this->running) {
+            auto it = conf.find("net_backend");
+            auto *backend = it != conf.end() ? std::get_if<std::string>(&it->second.v) : nullptr;
+            this->select(backend ? *backend : "epoll");
+        }
+        return this->impl->config(conf);
+    }
+
+    bool BackendNet::run(Callback cb) {
+        if (!this->impl)
+            this->config(this->conf);
+
+        this->running = this->impl->run(cb);
+        if (!this->running && this->name != "epoll") {
+            // io_uring may still be refused at run time (memory limits, seccomp...).
+            this->select("epoll");
+            this->running = this->impl->config(this->conf) && this->impl->run(std::move(cb));
+        }
+        return this->running;
+    }
+
+    bool BackendNet::send(zia::api::ImplSocket *sock, const Raw &resp) {
+        return this->impl->send(sock, resp);
+    }
+
+    bool BackendNet::send(zia::api::ImplSocket *sock, const zia::apipp::ResponseSerializer &resp) {
+        if (this->name == "io_uring")
+            return static_cast<UringNet &>(*this->impl).send(sock, resp);
+        return static_cast<EpollNet &>(*this->impl).send(sock, resp);
+    }
+
+    std::string BackendNet::error() const {
+        if (this->name == "io_uring")
+            return static_cast<const UringNet &>(*this->impl).error();
+        return {};
+    }
+
+    bool BackendNet::stop() {
+        this->running = false;
+        return !this->impl || this->impl->stop();
+    }
+
+}
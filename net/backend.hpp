@@ -0,0 +1,57 @@
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "../api/net.h"
+#include "../api/pp/serializer.hpp"
+
+namespace zia::net {
+
+    /**
+     * Net forwarding to the implementation named by "net_backend" in the Conf:
+     * "epoll" (default) or "io_uring". EpollNet is used whenever io_uring is not available.
+     */
+    class BackendNet : public zia::api::Net {
+    private:
+        std::unique_ptr<zia::api::Net> impl{};
+        std::string name{};
+        zia::api::Conf conf{};
+        bool running = false;
+
+        void select(const std::string &backend);
+
+    public:
+        ~BackendNet() override;
+
+        /**
+         * Name of the implementation in use.
+         */
+        const std::string &backend() const {
+            return this->name;
+        }
+
+        /**
+         * The backend can only change while the server is stopped.
+         */
+        bool config(const zia::api::Conf &conf) override;
+
+        bool run(Callback cb) override;
+
+        bool send(zia::api::ImplSocket *sock, const Raw &resp) override;
+
+        /**
+         * Send a serialized response, a file body is sent from its descriptor.
+         */
+        bool send(zia::api::ImplSocket *sock, const zia::apipp::ResponseSerializer &resp);
+
+        /**
+         * Error which stopped part of the implementation while running (see UringNet::error()), empty if none.
+         */
+        std::string error() const;
+
+        bool stop() override;
+    };
+
+}
@@ -0,0 +1,9 @@
+
+#include "backend.hpp"
+
+/**
+ * Entry point of the dynamic library, see zia::api::Net.
+ */
+extern "C" zia::api::Net *create() {
+    return new zia::net::BackendNet();
+}
@@ -0,0 +1,703 @@
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "epoll.hpp"
+#include "exchange.hpp"
+#include "socket.hpp"
+#include "../api/pp/net.hpp"
+#include "../api/pp/parser.hpp"
+
+namespace zia::net {
+
+    namespace {
+        constexpr std::size_t readChunk = 16 * 1024;
+        constexpr std::uint64_t maxSendfile = 0x7ffff000; // Linux transfers at most this much per call.
+        constexpr int maxEvents = 256;
+        constexpr std::uint32_t connectionEvents = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    }
+
+    class EpollConnection;
+
+    using EpollExchange = Exchange<EpollConnection>;
+
+    /**
+     * Client connection. Owned by its reactor and by every request not answered yet.
+     */
+    class EpollConnection final : public zia::api::ImplSocket {
+    private:
+        std::mutex lock;
+        int fd;
+        const int epfd;
+        std::deque<Outbound> output{};
+        std::size_t outputOffset = 0; // In the data of the front.
+        Sequencer sequencer{};
+        bool peerClosed = false;
+        bool lastDispatched = false; // Keep-alive is over: no request will be dispatched anymore.
+        bool halfClosed = false;
+        bool draining = false; // Too many requests were waiting for their response: report the next one written.
+        std::chrono::steady_clock::time_point lastActivity = std::chrono::steady_clock::now();
+        std::atomic<int> refs{1};
+
+        // Lock must be held. Returns false on socket error, the iovecs are advanced past what was sent.
+        bool writeSome(iovec *iov, std::size_t count) {
+            for (;;) {
+                while (count && !iov->iov_len) {
+                    ++iov;
+                    --count;
+                }
+                if (!count)
+                    return true;
+
+                msghdr message{};
+                message.msg_iov = iov;
+                message.msg_iovlen = count;
+                auto n = ::sendmsg(this->fd, &message, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+
+                for (auto sent = static_cast<std::size_t>(n); sent; ) {
+                    auto part = std::min(sent, iov->iov_len);
+                    iov->iov_base = static_cast<std::byte *>(iov->iov_base) + part;
+                    iov->iov_len -= part;
+                    sent -= part;
+                    if (!iov->iov_len) {
+                        ++iov;
+                        --count;
+                    }
+                }
+            }
+        }
+
+        // Lock must be held. Send the file of out with sendfile until the socket is full. Returns false on error.
+        bool sendFile(Outbound &out) {
+            while (out.fileSent < out.file->length) {
+                auto offset = static_cast<off_t>(out.file->offset + out.fileSent);
+                auto count = std::min(out.file->length - out.fileSent, maxSendfile);
+                auto n = ::sendfile(this->fd, out.file->fd, &offset, static_cast<std::size_t>(count));
+                if (n > 0) {
+                    out.fileSent += static_cast<std::uint64_t>(n);
+                    continue;
+                }
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    return true;
+                // Not a descriptor sendfile can read from: copied instead.
+                if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+                    return out.readRest();
+                return false; // The file is shorter than its body.
+            }
+            return true;
+        }
+
+        // Lock must be held. Write the queued output until the socket is full. Returns false on error.
+        bool writeQueued() {
+            while (!this->output.empty()) {
+                auto &front = this->output.front();
+                iovec iov{front.data.data() + this->outputOffset, front.data.size() - this->outputOffset};
+                if (!this->writeSome(&iov, 1))
+                    return false;
+                this->outputOffset = front.data.size() - iov.iov_len;
+                if (iov.iov_len)
+                    return true;
+
+                if (front.file) {
+                    if (!this->sendFile(front))
+                        return false;
+                    if (!front.file) {
+                        this->outputOffset = 0; // Its data is now the rest of the file.
+                        continue;
+                    }
+                    if (front.fileSent < front.file->length)
+                        return true;
+                }
+                this->output.pop_front();
+                this->outputOffset = 0;
+            }
+            return true;
+        }
+
+        // Lock must be held. Queue out after the previous output, and write what the socket accepts.
+        bool enqueue(Outbound out) {
+            auto waiting = !this->output.empty();
+            this->output.push_back(std::move(out));
+            return waiting || this->writeQueued();
+        }
+
+        // Lock must be held. Write buffers then file in order, queuing what the socket does not accept yet.
+        bool writeOrQueue(iovec *iov, std::size_t count, std::shared_ptr<const zia::api::FileBody> file = nullptr) {
+            if (this->output.empty() && !this->writeSome(iov, count))
+                return false;
+
+            Outbound out;
+            for (std::size_t i = 0; i < count; ++i) {
+                auto *data = static_cast<const std::byte *>(iov[i].iov_base);
+                out.data.insert(out.data.end(), data, data + iov[i].iov_len);
+            }
+            out.file = std::move(file);
+            if (out.data.empty() && !out.file)
+                return true;
+            return this->enqueue(std::move(out));
+        }
+
+        // Lock must be held.
+        bool idle() const {
+            return this->sequencer.pending() == 0 && this->output.empty();
+        }
+
+        // Lock must be held. Modifying an edge-triggered registration signals the data already waiting.
+        void reportAgain() {
+            if (this->fd >= 0) {
+                epoll_event event{};
+                event.events = connectionEvents;
+                event.data.ptr = this;
+                ::epoll_ctl(this->epfd, EPOLL_CTL_MOD, this->fd, &event);
+            }
+        }
+
+        // Lock must be held. Once the last response is written, finish the connection.
+        void shutdownIfDone() {
+            if ((this->peerClosed || this->lastDispatched) && !this->halfClosed && this->idle()) {
+                ::shutdown(this->fd, SHUT_WR);
+                this->halfClosed = true;
+            }
+        }
+
+    public:
+        const zia::api::NetInfo info;
+        zia::api::Net::Raw input{};
+        std::size_t inputOffset = 0;
+        zia::apipp::RequestParser parser{};
+        std::size_t requests = 0; // Dispatched on this connection, reactor thread only.
+        std::shared_ptr<zia::apipp::BodyStream> upload{}; // Body being streamed, reactor thread only.
+        bool stalled = false; // Left unread until responses drain, reactor thread only.
+
+        EpollConnection(int fd, int epfd, zia::api::NetInfo info) : fd{fd}, epfd{epfd}, info{std::move(info)} {}
+
+        void sendMessage(std::string &message) override {
+            std::lock_guard<std::mutex> guard(this->lock);
+
+            iovec iov{message.data(), message.size()};
+            if (this->fd >= 0)
+                this->writeOrQueue(&iov, 1);
+        }
+
+        std::string receiveMessage() override {
+            // Requests are delivered through the Net callback.
+            return {};
+        }
+
+        void acquire() {
+            this->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void release() {
+            if (this->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        /**
+         * EpollReactor thread: a request is handed to the callback.
+         * @param last no request will follow on this connection.
+         */
+        EpollExchange *dispatched(bool last, std::shared_ptr<zia::apipp::BodyStream> body,
+                                  std::optional<zia::apipp::RequestParser> parsed) {
+            std::lock_guard<std::mutex> guard(this->lock);
+
+            this->acquire();
+            this->lastDispatched = this->lastDispatched || last;
+            return new EpollExchange(this, this->sequencer.take(), std::move(body), std::move(parsed));
+        }
+
+        // EpollReactor thread: whether requests can still be dispatched.
+        bool reusable() {
+            std::lock_guard<std::mutex> guard(this->lock);
+            return !this->lastDispatched;
+        }
+
+        /**
+         * EpollReactor thread: whether too many requests wait for their response to dispatch another one.
+         * If so, the connection is reported again once a response is written (see rearm()).
+         */
+        bool pipelineFull(const Options &options) {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->draining = options.pipelineFull(this->sequencer.pending());
+            return this->draining;
+        }
+
+        /**
+         * Write the response of a dispatched request, after the previous responses. Any thread.
+         * @param close the connection ends after this response.
+         * @param file body sent after the buffers, from its descriptor.
+         */
+        bool respond(std::uint64_t sequence, iovec *iov, std::size_t count, bool close,
+                     std::shared_ptr<const zia::api::FileBody> file) {
+            std::lock_guard<std::mutex> guard(this->lock);
+
+            this->lastDispatched = this->lastDispatched || close;
+            if (this->fd < 0)
+                return false;
+
+            if (!this->sequencer.ready(sequence)) {
+                Outbound held;
+                for (std::size_t i = 0; i < count; ++i) {
+                    auto *base = static_cast<const std::byte *>(iov[i].iov_base);
+                    held.data.insert(held.data.end(), base, base + iov[i].iov_len);
+                }
+                held.file = std::move(file);
+                this->sequencer.hold(sequence, std::move(held));
+                return true;
+            }
+
+            bool ok = this->writeOrQueue(iov, count, std::move(file));
+            this->sequencer.next([this, &ok](Outbound &held) {
+                ok = ok && this->enqueue(std::move(held));
+            });
+            if (this->draining) {
+                this->draining = false;
+                this->reportAgain();
+            }
+            this->lastActivity = std::chrono::steady_clock::now();
+            this->shutdownIfDone();
+            return ok;
+        }
+
+        /**
+         * Any thread: the socket was left unread while the upload window was full, report it again.
+         */
+        void rearm() {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->reportAgain();
+        }
+
+        // EpollReactor thread: bytes were received.
+        void touch() {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->lastActivity = std::chrono::steady_clock::now();
+        }
+
+        // EpollReactor thread: the socket became writable.
+        bool flush() {
+            std::lock_guard<std::mutex> guard(this->lock);
+
+            if (this->fd < 0 || !this->writeQueued())
+                return false;
+            this->shutdownIfDone();
+            return true;
+        }
+
+        // EpollReactor thread: the peer will not send anything more.
+        // Returns true if the connection can be closed right away.
+        bool peerFinished() {
+            std::lock_guard<std::mutex> guard(this->lock);
+
+            this->peerClosed = true;
+            return this->idle();
+        }
+
+        // EpollReactor thread: nothing to answer or to write since limit.
+        bool idleSince(std::chrono::steady_clock::time_point limit) {
+            std::lock_guard<std::mutex> guard(this->lock);
+            return this->idle() && this->lastActivity < limit;
+        }
+
+        // EpollReactor thread.
+        void close() {
+            std::lock_guard<std::mutex> guard(this->lock);
+
+            if (this->fd >= 0) {
+                ::close(this->fd);
+                this->fd = -1;
+            }
+        }
+
+        int socket() const {
+            return this->fd;
+        }
+    };
+
+    /**
+     * One event loop, with its own listener and epoll instance.
+     */
+    class EpollReactor {
+    private:
+        zia::api::Net::Callback callback;
+        const Options options;
+        int epfd = -1;
+        int listener = -1;
+        int wakeup = -1;
+        int timer = -1;
+        std::thread thread{};
+        std::unordered_set<EpollConnection *> connections{};
+        // Closed during a batch of events, which may still point to them: released once it is handled.
+        std::vector<EpollConnection *> closed{};
+
+        void loop() {
+            epoll_event events[maxEvents];
+
+            for (;;) {
+                auto count = ::epoll_wait(this->epfd, events, maxEvents, -1);
+                if (count < 0 && errno != EINTR)
+                    return;
+
+                for (int i = 0; i < count; ++i) {
+                    auto *ptr = events[i].data.ptr;
+                    auto ev = events[i].events;
+
+                    if (ptr == &this->wakeup)
+                        return;
+                    if (ptr == &this->listener) {
+                        this->accept();
+                        continue;
+                    }
+                    if (ptr == &this->timer) {
+                        this->sweep();
+                        continue;
+                    }
+
+                    auto *conn = static_cast<EpollConnection *>(ptr);
+                    if (conn->socket() < 0)
+                        continue; // Closed by an earlier event of the batch, a sweep.
+                    if (ev & EPOLLERR) {
+                        this->close(conn);
+                        continue;
+                    }
+                    if ((ev & EPOLLOUT) && !conn->flush()) {
+                        this->close(conn);
+                        continue;
+                    }
+                    // A resumed upload, or a connection whose responses drained, may have input left to decode.
+                    if ((ev & (EPOLLIN | EPOLLRDHUP)) || conn->upload || conn->stalled) {
+                        if (!this->read(conn))
+                            continue;
+                    }
+                    if (ev & EPOLLHUP)
+                        this->close(conn);
+                }
+
+                for (auto *conn : this->closed)
+                    conn->release();
+                this->closed.clear();
+            }
+        }
+
+        void accept() {
+            for (;;) {
+                sockaddr_in addr{};
+                socklen_t len = sizeof(addr);
+                auto fd = ::accept4(this->listener, reinterpret_cast<sockaddr *>(&addr), &len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+                    return; // EAGAIN, or out of descriptors: retried on next readiness.
+                }
+
+                socket::tune(fd);
+
+                auto *conn = new EpollConnection(fd, this->epfd, socket::peerInfo(addr));
+                epoll_event event{};
+                event.events = connectionEvents;
+                event.data.ptr = conn;
+                if (::epoll_ctl(this->epfd, EPOLL_CTL_ADD, fd, &event) < 0) {
+                    conn->close();
+                    conn->release();
+                    continue;
+                }
+                this->connections.insert(conn);
+            }
+        }
+
+        // Close the keep-alive connections idle for too long.
+        void sweep() {
+            std::uint64_t expirations;
+            (void) ::read(this->timer, &expirations, sizeof(expirations));
+
+            auto limit = std::chrono::steady_clock::now() - this->options.idleTimeout;
+            std::vector<EpollConnection *> expired;
+            for (auto *conn : this->connections) {
+                if (conn->idleSince(limit))
+                    expired.push_back(conn);
+            }
+            for (auto *conn : expired)
+                this->close(conn);
+        }
+
+        // Returns false if the connection has been closed.
+        bool read(EpollConnection *conn) {
+            auto &input = conn->input;
+            bool eof = false;
+
+            // Input left over when the window or the pipeline filled up goes first.
+            if (((conn->upload && !input.empty()) || conn->stalled) && !this->dispatch(conn)) {
+                this->close(conn);
+                return false;
+            }
+
+            // While a streamed body fills its window, or too many requests wait for their response, the socket
+            // is left unread until the modules catch up.
+            while (!conn->stalled && (!conn->upload || !conn->upload->pause())) {
+                auto size = input.size();
+                input.resize(size + readChunk);
+                auto n = ::read(conn->socket(), input.data() + size, readChunk);
+                input.resize(size + static_cast<std::size_t>(std::max<ssize_t>(n, 0)));
+
+                if (n > 0) {
+                    if (!this->dispatch(conn)) {
+                        this->close(conn);
+                        return false;
+                    }
+                    continue;
+                }
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    this->close(conn);
+                    return false;
+                }
+                eof = n == 0;
+                break;
+            }
+
+            conn->touch();
+            if (eof) {
+                if (conn->upload)
+                    this->endUpload(conn, flushUpload(conn->parser, *conn->upload, input));
+                if (conn->peerFinished()) {
+                    this->close(conn);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Hand every complete request to the callback, and the input to the body being streamed.
+        // Returns false on a malformed request.
+        bool dispatch(EpollConnection *conn) {
+            auto &input = conn->input;
+
+            conn->stalled = false;
+            while (conn->upload || conn->reusable()) {
+                auto *begin = input.data() + conn->inputOffset;
+                auto size = input.size() - conn->inputOffset;
+
+                if (conn->upload) {
+                    std::size_t used;
+                    auto result = feedUpload(conn->parser, *conn->upload, begin, size, used);
+                    conn->inputOffset += used;
+                    if (result == zia::apipp::RequestParser::Result::Error)
+                        return false;
+                    if (result == zia::apipp::RequestParser::Result::Incomplete)
+                        break;
+                    this->endUpload(conn, true);
+                    continue;
+                }
+                if (conn->pipelineFull(this->options)) {
+                    conn->stalled = true;
+                    break;
+                }
+
+                auto result = conn->parser.parse(begin, size);
+                if (result == zia::apipp::RequestParser::Result::Error)
+                    return false;
+                if (result == zia::apipp::RequestParser::Result::Incomplete &&
+                    !conn->parser.bodyExceeds(this->options.bodyWindow, size))
+                    break;
+
+                auto length = conn->parser.length();
+                auto last = !conn->parser.keepAlive() || !this->options.acceptsMore(++conn->requests);
+                zia::api::Net::Raw request;
+                std::shared_ptr<zia::apipp::BodyStream> body;
+                std::optional<zia::apipp::RequestParser> parsed;
+                if (result == zia::apipp::RequestParser::Result::Complete) {
+                    request.assign(begin, begin + length);
+                    // Handed over with the request, which is filled from it instead of being parsed again.
+                    parsed.emplace(std::move(conn->parser));
+                    conn->parser.reset();
+                } else {
+                    body = startUpload(conn->parser, begin, this->options.bodyWindow, request);
+                    body->onResume([conn]() { conn->rearm(); });
+                    conn->upload = body;
+                }
+                conn->inputOffset += length;
+
+                auto info = conn->info;
+                info.time = std::chrono::system_clock::now();
+                info.start = std::chrono::steady_clock::now();
+                info.sock = conn->dispatched(last, std::move(body), std::move(parsed));
+                this->callback(std::move(request), std::move(info));
+            }
+
+            // Whatever follows the last request of the connection is ignored.
+            if (!conn->upload && !conn->reusable()) {
+                input.clear();
+            } else {
+                input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(conn->inputOffset));
+            }
+            conn->inputOffset = 0;
+            return true;
+        }
+
+        // The streamed body is over, or will never be.
+        void endUpload(EpollConnection *conn, bool complete) {
+            // Waits for a resume hook running on another thread: conn may be freed afterwards.
+            conn->upload->onResume(nullptr);
+            if (complete) {
+                conn->upload->finish();
+                conn->parser.reset();
+            } else {
+                conn->upload->fail();
+            }
+            conn->upload.reset();
+        }
+
+        void close(EpollConnection *conn) {
+            if (conn->upload)
+                this->endUpload(conn, false);
+            this->connections.erase(conn);
+            conn->close();
+            this->closed.push_back(conn);
+        }
+
+    public:
+        EpollReactor(zia::api::Net::Callback callback, const Options &options)
+                : callback{std::move(callback)}, options{options} {}
+
+        ~EpollReactor() {
+            this->stop();
+            for (auto *conn : this->connections) {
+                if (conn->upload)
+                    this->endUpload(conn, false);
+                conn->close();
+                conn->release();
+            }
+            for (auto *conn : this->closed)
+                conn->release();
+            for (auto fd : {this->listener, this->wakeup, this->timer, this->epfd}) {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+        }
+
+        bool listen(std::uint16_t port) {
+            this->epfd = ::epoll_create1(EPOLL_CLOEXEC);
+            this->wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            this->listener = socket::listen(port);
+            if (this->epfd < 0 || this->wakeup < 0 || this->listener < 0)
+                return false;
+
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLET;
+            event.data.ptr = &this->listener;
+            if (::epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->listener, &event) < 0)
+                return false;
+
+            event.events = EPOLLIN;
+            event.data.ptr = &this->wakeup;
+            if (::epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->wakeup, &event) < 0)
+                return false;
+
+            if (this->options.idleTimeout.count() <= 0)
+                return true;
+            this->timer = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(this->options.sweepInterval());
+            itimerspec spec{};
+            spec.it_interval.tv_sec = static_cast<time_t>(interval.count() / 1000000000);
+            spec.it_interval.tv_nsec = static_cast<long>(interval.count() % 1000000000);
+            spec.it_value = spec.it_interval;
+            if (this->timer < 0 || ::timerfd_settime(this->timer, 0, &spec, nullptr) < 0)
+                return false;
+
+            event.events = EPOLLIN;
+            event.data.ptr = &this->timer;
+            return ::epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->timer, &event) == 0;
+        }
+
+        void start() {
+            this->thread = std::thread([this]() { this->loop(); });
+        }
+
+        void stop() {
+            if (this->thread.joinable()) {
+                std::uint64_t one = 1;
+                (void) ::write(this->wakeup, &one, sizeof(one));
+                this->thread.join();
+            }
+        }
+    };
+
+    namespace {
+        bool respond(zia::api::ImplSocket *sock, iovec *iov, std::size_t count, bool close,
+                     std::shared_ptr<const zia::api::FileBody> file = nullptr) {
+            auto *exchange = static_cast<EpollExchange *>(sock);
+            auto *conn = exchange->connection;
+            exchange->answered();
+            auto ret = conn->respond(exchange->sequence, iov, count, close, std::move(file));
+            delete exchange;
+            conn->release();
+            return ret;
+        }
+    }
+
+    EpollNet::EpollNet() = default;
+
+    EpollNet::~EpollNet() {
+        this->stop();
+    }
+
+    bool EpollNet::config(const zia::api::Conf &conf) {
+        this->options = Options::fromConf(conf);
+        return true;
+    }
+
+    bool EpollNet::run(Callback cb) {
+        if (!this->reactors.empty())
+            return false;
+
+        for (unsigned i = 0; i < this->options.threadCount(); ++i) {
+            auto reactor = std::make_unique<EpollReactor>(cb, this->options);
+            if (!reactor->listen(this->options.port)) {
+                this->reactors.clear();
+                return false;
+            }
+            this->reactors.push_back(std::move(reactor));
+        }
+        for (auto &reactor : this->reactors)
+            reactor->start();
+        return true;
+    }
+
+    bool EpollNet::send(zia::api::ImplSocket *sock, const Raw &resp) {
+        iovec iov{const_cast<std::byte *>(resp.data()), resp.size()};
+        return respond(sock, &iov, 1, false);
+    }
+
+    bool EpollNet::send(zia::api::ImplSocket *sock, const zia::apipp::ResponseSerializer &resp) {
+        auto iov = resp.iovecs();
+        return respond(sock, iov.data(), iov.size(), resp.closes(), resp.file());
+    }
+
+    bool EpollNet::stop() {
+        for (auto &reactor : this->reactors)
+            reactor->stop();
+        this->reactors.clear();
+        return true;
+    }
+
+}
@@ -0,0 +1,68 @@
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../api/net.h"
+#include "../api/pp/serializer.hpp"
+#include "options.hpp"
+
+namespace zia::net {
+
+    class EpollReactor;
+
+    /**
+     * Linux implementation of zia::api::Net.
+     *
+     * Runs one edge-triggered epoll reactor per thread, each with its own SO_REUSEPORT listener,
+     * so the kernel spreads the connections across reactors. Sockets are non-blocking and accepted
+     * with accept4. The callback is called on the reactor thread for each complete request.
+     *
+     * Configuration keys:
+     *  - "port": listening port (default 8080)
+     *  - "net_threads": number of reactors (default: one per core)
+     *  - "net_max_requests": requests served on a connection before closing it (default 1000, 0: no limit)
+     *  - "net_idle_timeout": milliseconds before closing a connection with nothing to do (default 60000, 0: never)
+     *  - "net_body_window": request body bytes held in memory (default 1 MiB), see below
+     *
+     * Connections are kept alive according to the request version and Connection header. Pipelined
+     * requests are all given to the callback, each with its own NetInfo::sock, and their responses are
+     * written in request order whatever the order send() is called in.
+     *
+     * A request whose body is larger than the window, or chunked and not received yet, is given to the
+     * callback as soon as its head is: raw only holds the head, and zia::apipp::bodyStreamOf(info) gives
+     * the body, decoded as it arrives. The socket is not read while the window is full.
+     *
+     * send() can be called from any thread, exactly once per request given to the callback.
+     */
+    class EpollNet : public zia::api::Net {
+    private:
+        Options options{};
+        std::vector<std::unique_ptr<EpollReactor>> reactors;
+
+    public:
+        EpollNet();
+
+        // Put in the .cpp file to allow proper destructor call.
+        ~EpollNet() override;
+
+        /**
+         * Read the configuration keys listed above, applied on next run().
+         */
+        bool config(const zia::api::Conf &conf) override;
+
+        bool run(Callback cb) override;
+
+        bool send(zia::api::ImplSocket *sock, const Raw &resp) override;
+
+        /**
+         * Send a serialized response. The header and body buffers are written with one sendmsg, without being joined,
+         * a file body is then written with sendfile.
+         */
+        bool send(zia::api::ImplSocket *sock, const zia::apipp::ResponseSerializer &resp);
+
+        bool stop() override;
+    };
+
+}
@@ -0,0 +1,191 @@
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "../api/net.h"
+#include "../api/pp/body.hpp"
+#include "../api/pp/file.hpp"
+#include "../api/pp/net.hpp"
+#include "../api/pp/parser.hpp"
+
+namespace zia::net {
+
+    /**
+     * Bytes waiting to be written on a connection, followed by a file body sent from the descriptor.
+     */
+    struct Outbound {
+        zia::api::Net::Raw data{};
+        std::shared_ptr<const zia::api::FileBody> file{};
+        std::uint64_t fileSent = 0;
+
+        /**
+         * Once data is written, if the file cannot be sent from its descriptor: replace data with
+         * what is left of the file.
+         * @return false if it cannot be read either.
+         */
+        bool readRest() {
+            auto file = std::move(this->file);
+            auto rest = zia::api::FileBody{file->fd, file->offset + this->fileSent, file->length - this->fileSent};
+            this->data.clear();
+            this->fileSent = 0;
+            return zia::apipp::readFile(rest, this->data);
+        }
+    };
+
+    /**
+     * Puts the responses of a connection back in request order (HTTP/1.1 pipelining):
+     * requests are numbered when dispatched, a response answered early is held until
+     * every previous one has been written.
+     */
+    class Sequencer {
+    private:
+        std::uint64_t dispatched = 0; // Number of the next request.
+        std::uint64_t written = 0;    // Number of the next response to write.
+        std::map<std::uint64_t, Outbound> early{};
+
+    public:
+        std::uint64_t take() {
+            return this->dispatched++;
+        }
+
+        /**
+         * Requests not answered yet.
+         */
+        std::size_t pending() const {
+            return static_cast<std::size_t>(this->dispatched - this->written);
+        }
+
+        /**
+         * Whether the response of request number sequence can be written now.
+         */
+        bool ready(std::uint64_t sequence) const {
+            return sequence == this->written;
+        }
+
+        void hold(std::uint64_t sequence, Outbound data) {
+            this->early.emplace(sequence, std::move(data));
+        }
+
+        /**
+         * The ready response has been written: write the held ones that follow it.
+         */
+        template<typename TWrite>
+        void next(TWrite &&write) {
+            ++this->written;
+            for (auto it = this->early.begin(); it != this->early.end() && it->first == this->written;) {
+                write(it->second);
+                it = this->early.erase(it);
+                ++this->written;
+            }
+        }
+    };
+
+    /**
+     * Handle given to modules as NetInfo::sock: one per dispatched request, so send() knows
+     * which response it receives. Owns a reference on the connection, freed by send().
+     */
+    template<typename TConnection>
+    struct Exchange final : public zia::api::ImplSocket {
+        TConnection *const connection;
+        const std::uint64_t sequence;
+        const std::shared_ptr<zia::apipp::BodyStream> body;
+        const std::optional<zia::apipp::RequestParser> parser; // Of a request received whole.
+
+        Exchange(TConnection *connection, std::uint64_t sequence, std::shared_ptr<zia::apipp::BodyStream> body,
+                 std::optional<zia::apipp::RequestParser> parser)
+                : connection{connection}, sequence{sequence}, body{std::move(body)}, parser{std::move(parser)} {}
+
+        /**
+         * Once answered, the rest of a streamed body is discarded.
+         */
+        void answered() {
+            if (this->body)
+                this->body->abandon();
+        }
+
+        std::shared_ptr<zia::apipp::BodyStream> bodyStream() override {
+            return this->body;
+        }
+
+        const zia::apipp::RequestParser *requestParser() const override {
+            return this->parser ? &*this->parser : nullptr;
+        }
+
+        /**
+         * Written right away, out of the response sequence (e.g. "100 Continue").
+         */
+        void sendMessage(std::string &message) override {
+            this->connection->sendMessage(message);
+        }
+
+        std::string receiveMessage() override {
+            return this->connection->receiveMessage();
+        }
+    };
+
+    /**
+     * The parser stopped in the body of a request too large to buffer (RequestParser::bodyExceeds):
+     * give the head to the callback and stream the body.
+     * @param begin the buffer given to the parser.
+     * @param head set to the request line and headers.
+     * @return the stream, holding the body parsed so far.
+     */
+    inline std::shared_ptr<zia::apipp::BodyStream> startUpload(const zia::apipp::RequestParser &parser,
+                                                               const std::byte *begin, std::size_t window,
+                                                               zia::api::Net::Raw &head) {
+        auto body = std::make_shared<zia::apipp::BodyStream>(window, parser.contentLength());
+        for (const auto &span : parser.bodyChunks())
+            body->push(begin + span.offset, span.size);
+        head.assign(begin, begin + parser.bodyOffset());
+        return body;
+    }
+
+    /**
+     * Decode received bytes into the streamed body, as long as its window has space: the rest is left
+     * in the input (used tells how much was taken) until the module reads the body. The socket is not
+     * read meanwhile, except for what the kernel already received on behalf of the connection.
+     * @param bounded false to decode everything whatever the window, once the peer is gone.
+     */
+    inline zia::apipp::RequestParser::Result feedUpload(zia::apipp::RequestParser &parser,
+                                                        zia::apipp::BodyStream &body, const std::byte *data,
+                                                        std::size_t size, std::size_t &used, bool bounded = true) {
+        // Enough to always get past the framing of the next chunk.
+        constexpr std::size_t framing = 4096 + 4;
+
+        auto result = zia::apipp::RequestParser::Result::Incomplete;
+        used = 0;
+        while (result == zia::apipp::RequestParser::Result::Incomplete && used < size) {
+            auto room = bounded ? body.space() : size;
+            if (!room)
+                break;
+
+            std::size_t step;
+            result = parser.decodeBody(data + used, std::min(size - used, room + framing), step,
+                                       [&body](const std::byte *piece, std::size_t count) {
+                                           body.push(piece, count);
+                                       });
+            used += step;
+            if (!step)
+                break;
+        }
+        return result;
+    }
+
+    /**
+     * The peer closed the connection: decode the input left over.
+     * @return whether the body is complete.
+     */
+    inline bool flushUpload(zia::apipp::RequestParser &parser, zia::apipp::BodyStream &body,
+                            const zia::api::Net::Raw &input) {
+        std::size_t used;
+        return feedUpload(parser, body, input.data(), input.size(), used, false) ==
+               zia::apipp::RequestParser::Result::Complete;
+    }
+
+}
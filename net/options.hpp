@@ -0,0 +1,85 @@
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <variant>
+
+#include "../api/conf.h"
+
+namespace zia::net {
+
+    /**
+     * Settings shared by the Net implementations, read from the server Conf.
+     */
+    struct Options {
+        std::uint16_t port = 8080;
+        unsigned threads = 0; // One per core when 0.
+        std::size_t maxRequests = 1000; // Requests served on a connection before closing it, no limit when 0.
+        std::chrono::milliseconds idleTimeout{60000}; // Keep-alive connections with nothing to do, no limit when 0.
+        std::size_t bodyWindow = 1 << 20; // Request body bytes buffered, larger bodies are streamed.
+        /**
+         * Requests dispatched on a connection and not answered yet: past it, the connection is not read until
+         * responses drain. No limit when 0.
+         */
+        std::size_t maxPipelined = 32;
+
+        static long long integer(const zia::api::Conf &conf, const std::string &key, long long fallback) {
+            auto it = conf.find(key);
+            if (it == conf.end())
+                return fallback;
+            if (auto *value = std::get_if<long long>(&it->second.v))
+                return *value;
+            return fallback;
+        }
+
+        static Options fromConf(const zia::api::Conf &conf) {
+            Options options;
+
+            options.port = static_cast<std::uint16_t>(integer(conf, "port", options.port));
+            options.threads = static_cast<unsigned>(integer(conf, "net_threads", options.threads));
+            options.maxRequests = static_cast<std::size_t>(
+                    integer(conf, "net_max_requests", static_cast<long long>(options.maxRequests)));
+            options.idleTimeout = std::chrono::milliseconds(
+                    integer(conf, "net_idle_timeout", options.idleTimeout.count()));
+            options.bodyWindow = static_cast<std::size_t>(
+                    integer(conf, "net_body_window", static_cast<long long>(options.bodyWindow)));
+            options.maxPipelined = static_cast<std::size_t>(
+                    integer(conf, "net_max_pipelined", static_cast<long long>(options.maxPipelined)));
+            return options;
+        }
+
+        /**
+         * Whether a connection that served count requests can take another one.
+         */
+        bool acceptsMore(std::size_t count) const {
+            return !this->maxRequests || count < this->maxRequests;
+        }
+
+        /**
+         * Whether a connection with pending requests dispatched and not answered must stop taking more.
+         */
+        bool pipelineFull(std::size_t pending) const {
+            return this->maxPipelined && pending >= this->maxPipelined;
+        }
+
+        /**
+         * Period of the idle connections check.
+         */
+        std::chrono::milliseconds sweepInterval() const {
+            return std::clamp(this->idleTimeout / 4, std::chrono::milliseconds(10), std::chrono::milliseconds(1000));
+        }
+
+        unsigned threadCount() const {
+            if (this->threads)
+                return this->threads;
+            auto cores = std::thread::hardware_concurrency();
+            return cores ? cores : 1;
+        }
+    };
+
+}
@@ -0,0 +1,67 @@
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../api/net.h"
+
+/**
+ * Socket helpers shared by the Net backends.
+ */
+namespace zia::net::socket {
+
+    /**
+     * Non-blocking IPv4 listener with SO_REUSEPORT, so every reactor can own one on the same port.
+     * @return the descriptor, or -1 on failure.
+     */
+    inline int listen(std::uint16_t port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0 ||
+            ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+            ::listen(fd, SOMAXCONN) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * Settings applied to every accepted client socket.
+     */
+    inline void tune(int fd) {
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    /**
+     * Client part of NetInfo, the per-request fields are filled on dispatch.
+     */
+    inline zia::api::NetInfo peerInfo(const sockaddr_in &addr) {
+        char ip[INET_ADDRSTRLEN] = {};
+        ::inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+
+        zia::api::NetInfo info{};
+        info.ip.i = ntohl(addr.sin_addr.s_addr);
+        info.ip.str = ip;
+        info.port = ntohs(addr.sin_port);
+        return info;
+    }
+
+}
@@ -0,0 +1,1210 @@
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+
+#include "uring.hpp"
+#include "exchange.hpp"
+#include "socket.hpp"
+#include "../api/pp/net.hpp"
+#include "../api/pp/parser.hpp"
+
+namespace zia::net {
+
+    namespace {
+        constexpr unsigned ringEntries = 1024;
+        constexpr unsigned bufferCount = 1024; // Must be a power of 2.
+        constexpr unsigned bufferSize = 4096;
+        constexpr unsigned maxChain = 16;
+        constexpr int pipeSize = 1 << 20; // Asked for the pipe file bodies are spliced through.
+        constexpr std::uint16_t bufferGroup = 0;
+
+        // Operation kind, stored in the low bits of user_data.
+        enum Op : std::uint64_t {
+            Accept = 0, Recv = 1, Send = 2, Wakeup = 3, Timeout = 4, Cancel = 5, SpliceIn = 6, SpliceOut = 7
+        };
+        constexpr std::uint64_t opMask = 7;
+
+        std::uint64_t tag(const void *ptr, Op op) {
+            return reinterpret_cast<std::uint64_t>(ptr) | op;
+        }
+
+        /**
+         * Submission and completion queues of one io_uring instance, mapped by hand.
+         */
+        class Ring {
+        private:
+            int fd = -1;
+            void *sqMap = MAP_FAILED;
+            std::size_t sqMapSize = 0;
+            void *cqMap = MAP_FAILED;
+            std::size_t cqMapSize = 0;
+            io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+            std::size_t sqesSize = 0;
+
+            unsigned *sqHead = nullptr;
+            unsigned *sqTail = nullptr;
+            unsigned *sqArray = nullptr;
+            unsigned sqMask = 0;
+            unsigned sqEntries = 0;
+            unsigned *cqHead = nullptr;
+            unsigned *cqTail = nullptr;
+            unsigned cqMask = 0;
+            io_uring_cqe *cqes = nullptr;
+
+            unsigned localTail = 0;
+            unsigned submitted = 0;
+            std::uint64_t inflight = 0; // SQEs handed out whose last completion was not reaped.
+            int failure = 0;
+
+        public:
+            Ring() = default;
+            Ring(const Ring &) = delete;
+            Ring &operator=(const Ring &) = delete;
+
+            ~Ring() {
+                if (this->sqes != MAP_FAILED)
+                    ::munmap(this->sqes, this->sqesSize);
+                if (this->cqMap != MAP_FAILED && this->cqMap != this->sqMap)
+                    ::munmap(this->cqMap, this->cqMapSize);
+                if (this->sqMap != MAP_FAILED)
+                    ::munmap(this->sqMap, this->sqMapSize);
+                if (this->fd >= 0)
+                    ::close(this->fd);
+            }
+
+            bool init(unsigned entries) {
+                io_uring_params params{};
+                params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+                this->fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                if (this->fd < 0 && errno == EINVAL) {
+                    params = io_uring_params{};
+                    this->fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                }
+                if (this->fd < 0 || !(params.features & IORING_FEAT_NODROP))
+                    return false;
+
+                this->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                this->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+                if (single)
+                    this->sqMapSize = this->cqMapSize = std::max(this->sqMapSize, this->cqMapSize);
+
+                this->sqMap = ::mmap(nullptr, this->sqMapSize, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQ_RING);
+                if (this->sqMap == MAP_FAILED)
+                    return false;
+                this->cqMap = single ? this->sqMap
+                                     : ::mmap(nullptr, this->cqMapSize, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_CQ_RING);
+                if (this->cqMap == MAP_FAILED)
+                    return false;
+                this->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                this->sqes = static_cast<io_uring_sqe *>(::mmap(nullptr, this->sqesSize, PROT_READ | PROT_WRITE,
+                                                                MAP_SHARED | MAP_POPULATE, this->fd,
+                                                                IORING_OFF_SQES));
+                if (this->sqes == MAP_FAILED)
+                    return false;
+
+                auto *sq = static_cast<char *>(this->sqMap);
+                auto *cq = static_cast<char *>(this->cqMap);
+                this->sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+                this->sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+                this->sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+                this->sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+                this->sqEntries = params.sq_entries;
+                this->cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+                this->cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+                this->cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+                this->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+                this->localTail = this->submitted = *this->sqTail;
+                return true;
+            }
+
+            unsigned space() const {
+                return this->sqEntries - (this->localTail - __atomic_load_n(this->sqHead, __ATOMIC_ACQUIRE));
+            }
+
+            /**
+             * Make room for count SQEs, pending SQEs are submitted first if needed.
+             * @return false if there is still no room.
+             */
+            bool reserve(unsigned count) {
+                if (this->space() < count)
+                    this->submit(0);
+                return this->space() >= count;
+            }
+
+            /**
+             * errno of the call the kernel refused for good, 0 if none was.
+             */
+            int error() const {
+                return this->failure;
+            }
+
+            std::uint64_t pending() const {
+                return this->inflight;
+            }
+
+            int registerBuffers(io_uring_buf_reg &reg) {
+                return static_cast<int>(::syscall(__NR_io_uring_register, this->fd,
+                                                  IORING_REGISTER_PBUF_RING, &reg, 1));
+            }
+
+            /**
+             * Next free SQE, already zeroed. Pending SQEs are submitted first if the queue is full.
+             * @return nullptr if there is still no room.
+             */
+            io_uring_sqe *sqe() {
+                if (!this->reserve(1))
+                    return nullptr;
+
+                auto index = this->localTail & this->sqMask;
+                auto *sqe = &this->sqes[index];
+                std::memset(sqe, 0, sizeof(*sqe));
+                this->sqArray[index] = index;
+                ++this->localTail;
+                ++this->inflight;
+                return sqe;
+            }
+
+            /**
+             * Give every queued SQE to the kernel in one call, optionally waiting for completions.
+             * When the kernel is short of resources (EAGAIN, EBUSY), the SQEs stay queued for the next
+             * call, once completions are reaped.
+             * @return false if the kernel refused them for good, see error().
+             */
+            bool submit(unsigned wait) {
+                __atomic_store_n(this->sqTail, this->localTail, __ATOMIC_RELEASE);
+                auto count = this->localTail - this->submitted;
+
+                for (;;) {
+                    auto ret = ::syscall(__NR_io_uring_enter, this->fd, count, wait,
+                                         wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+                    if (ret >= 0) {
+                        this->submitted += static_cast<unsigned>(ret);
+                        return true;
+                    }
+                    if (errno == EINTR && !wait)
+                        continue;
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                        return true;
+                    this->failure = errno;
+                    return false;
+                }
+            }
+
+            template<typename TFunc>
+            void completions(TFunc &&func) {
+                auto head = *this->cqHead;
+                auto tail = __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE);
+
+                for (; head != tail; ++head) {
+                    auto cqe = this->cqes[head & this->cqMask];
+                    __atomic_store_n(this->cqHead, head + 1, __ATOMIC_RELEASE);
+                    if (!(cqe.flags & IORING_CQE_F_MORE))
+                        --this->inflight;
+                    func(cqe);
+                }
+            }
+        };
+
+        /**
+         * Provided buffer ring: the kernel picks a buffer for each recv, we give it back once copied.
+         */
+        class BufferRing {
+        private:
+            io_uring_buf_ring *ring = static_cast<io_uring_buf_ring *>(MAP_FAILED);
+            std::vector<std::byte> memory{};
+            std::uint16_t tail = 0;
+
+        public:
+            BufferRing() = default;
+            BufferRing(const BufferRing &) = delete;
+            BufferRing &operator=(const BufferRing &) = delete;
+
+            ~BufferRing() {
+                if (this->ring != MAP_FAILED)
+                    ::munmap(this->ring, bufferCount * sizeof(io_uring_buf));
+            }
+
+            bool init(Ring &uring) {
+                this->ring = static_cast<io_uring_buf_ring *>(
+                        ::mmap(nullptr, bufferCount * sizeof(io_uring_buf), PROT_READ | PROT_WRITE,
+                               MAP_ANONYMOUS | MAP_PRIVATE, -1, 0));
+                if (this->ring == MAP_FAILED)
+                    return false;
+                this->memory.resize(static_cast<std::size_t>(bufferCount) * bufferSize);
+
+                io_uring_buf_reg reg{};
+                reg.ring_addr = reinterpret_cast<std::uint64_t>(this->ring);
+                reg.ring_entries = bufferCount;
+                reg.bgid = bufferGroup;
+                if (uring.registerBuffers(reg) < 0)
+                    return false;
+
+                for (unsigned bid = 0; bid < bufferCount; ++bid)
+                    this->recycle(static_cast<std::uint16_t>(bid));
+                return true;
+            }
+
+            const std::byte *data(std::uint16_t bid) const {
+                return this->memory.data() + static_cast<std::size_t>(bid) * bufferSize;
+            }
+
+            void recycle(std::uint16_t bid) {
+                // Not ring->bufs: in C++ the header's flexible array member is shifted past an empty struct.
+                auto &buf = reinterpret_cast<io_uring_buf *>(this->ring)[this->tail & (bufferCount - 1)];
+                buf.addr = reinterpret_cast<std::uint64_t>(this->data(bid));
+                buf.len = bufferSize;
+                buf.bid = bid;
+                ++this->tail;
+                __atomic_store_n(&this->ring->tail, this->tail, __ATOMIC_RELEASE);
+            }
+        };
+
+        thread_local UringReactor *currentReactor = nullptr;
+    }
+
+    class UringConnection;
+
+    using UringExchange = Exchange<UringConnection>;
+
+    /**
+     * Client connection. Everything but the lock-protected part is only touched by the reactor thread.
+     */
+    class UringConnection final : public zia::api::ImplSocket {
+    private:
+        std::atomic<int> refs{1};
+
+    public:
+        const int fd;
+        const zia::api::NetInfo info;
+        UringReactor &reactor;
+
+        zia::api::Net::Raw input{};
+        std::size_t inputOffset = 0;
+        zia::apipp::RequestParser parser{};
+        std::deque<Outbound> pending{}; // Responses in order, front is being sent.
+        std::size_t sentOffset = 0; // In the data of the front.
+        int pipe[2] = {-1, -1}; // File bodies are spliced through it, created on first use.
+        std::size_t pipeCapacity = 0;
+        std::size_t piped = 0; // Bytes of the front file in the pipe.
+        unsigned chain = 0; // Sends in flight.
+        unsigned ops = 0; // SQEs in flight.
+        Sequencer sequencer{};
+        std::size_t requests = 0; // Dispatched on this connection.
+        std::shared_ptr<zia::apipp::BodyStream> upload{}; // Body being streamed.
+        bool lastDispatched = false; // Keep-alive is over: no request will be dispatched anymore.
+        bool peerClosed = false;
+        bool halfClosed = false;
+        bool closed = false;
+        bool multishot = true;
+        bool receiving = false; // A recv is armed.
+        bool paused = false; // Not receiving while the upload window or the pipeline is full.
+        std::chrono::steady_clock::time_point lastActivity = std::chrono::steady_clock::now();
+
+        // Set once the reactor no longer accepts responses for this connection.
+        std::mutex lock;
+        bool detached = false;
+
+        UringConnection(int fd, zia::api::NetInfo info, UringReactor &reactor)
+                : fd{fd}, info{std::move(info)}, reactor{reactor} {}
+
+        ~UringConnection() {
+            for (auto end : this->pipe) {
+                if (end >= 0)
+                    ::close(end);
+            }
+        }
+
+        void sendMessage(std::string &message) override;
+
+        std::string receiveMessage() override {
+            // Requests are delivered through the Net callback.
+            return {};
+        }
+
+        void acquire() {
+            this->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void release() {
+            if (this->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+    };
+
+    /**
+     * One ring, its listener and the connections it accepted.
+     */
+    class UringReactor {
+    public:
+        struct Outgoing {
+            enum class Kind {
+                Message, // Out of the response sequence, owns a reference on conn.
+                Answer,  // Response of a request, owns a reference on conn.
+                Resume   // The upload window has space again, owns a reference on conn.
+            };
+
+            UringConnection *conn;
+            Kind kind;
+            zia::api::Net::Raw data{};
+            std::uint64_t sequence = 0;
+            bool close = false;
+            std::shared_ptr<const zia::api::FileBody> file{};
+        };
+
+    private:
+        zia::api::Net::Callback callback;
+        const Options options;
+        __kernel_timespec sweepPeriod{};
+        __kernel_timespec drainPeriod{1, 0}; // Longest wait for the operations cancelled on destruction.
+        Ring ring{};
+        BufferRing buffers{};
+        int listener = -1;
+        int wakeup = -1;
+        std::uint64_t wakeupValue = 0;
+        std::atomic<bool> stopping{false};
+        std::thread thread{};
+        std::unordered_set<UringConnection *> connections{};
+
+        std::deque<io_uring_sqe> backlog{}; // SQEs waiting for room in the ring, in order.
+
+        std::mutex queueLock{};
+        std::vector<Outgoing> queue{};
+        std::vector<Outgoing> draining{};
+
+        mutable std::mutex failureLock{};
+        std::string failure{};
+
+        /**
+         * Next SQE, chain counting it and the SQEs linked after it, which are kept in the same submission.
+         * When the ring has no room, SQEs wait in the backlog and go to the ring once completions are reaped.
+         * @return nullptr if the kernel refused the SQEs for good: the reactor then stops.
+         */
+        io_uring_sqe *sqe(unsigned chain = 1) {
+            if (this->backlog.empty() && this->ring.reserve(chain))
+                return this->ring.sqe();
+            if (this->ring.error()) {
+                this->fail("io_uring_enter", this->ring.error());
+                return nullptr;
+            }
+            return &this->backlog.emplace_back();
+        }
+
+        // Move the backlog to the ring, whole chains only.
+        void flush() {
+            while (!this->backlog.empty()) {
+                std::size_t chain = 1;
+                while (chain < this->backlog.size() && (this->backlog[chain - 1].flags & IOSQE_IO_LINK))
+                    ++chain;
+                if (!this->ring.reserve(static_cast<unsigned>(chain)))
+                    return;
+                for (std::size_t i = 0; i < chain; ++i) {
+                    *this->ring.sqe() = this->backlog.front();
+                    this->backlog.pop_front();
+                }
+            }
+        }
+
+        /**
+         * Stop the reactor on an error it cannot recover from. The listener is closed, so that the kernel
+         * gives new connections to the other rings instead of this one, which no longer accepts them.
+         */
+        void fail(const char *call, int code) {
+            {
+                std::lock_guard<std::mutex> guard(this->failureLock);
+                if (this->failure.empty())
+                    this->failure = std::string(call) + ": " + std::system_category().message(code);
+            }
+            this->stopping = true;
+            if (this->listener >= 0) {
+                // The multishot accept holds the socket open: shutdown takes it out of the group at once.
+                ::shutdown(this->listener, SHUT_RDWR);
+                ::close(this->listener);
+                this->listener = -1;
+            }
+        }
+
+        void armAccept() {
+            auto *sqe = this->sqe();
+            if (!sqe)
+                return;
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->fd = this->listener;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_CLOEXEC;
+            sqe->user_data = tag(this, Accept);
+        }
+
+        void armWakeup() {
+            auto *sqe = this->sqe();
+            if (!sqe)
+                return;
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = this->wakeup;
+            sqe->addr = reinterpret_cast<std::uint64_t>(&this->wakeupValue);
+            sqe->len = sizeof(this->wakeupValue);
+            sqe->user_data = tag(this, Wakeup);
+        }
+
+        void armTimeout() {
+            auto *sqe = this->sqe();
+            if (!sqe)
+                return;
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<std::uint64_t>(&this->sweepPeriod);
+            sqe->len = 1;
+            sqe->user_data = tag(this, Timeout);
+        }
+
+        void armRecv(UringConnection *conn) {
+            auto *sqe = this->sqe();
+            if (!sqe)
+                return;
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = conn->fd;
+            sqe->ioprio = conn->multishot ? IORING_RECV_MULTISHOT : 0;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = bufferGroup;
+            sqe->user_data = tag(conn, Recv);
+            ++conn->ops;
+            conn->receiving = true;
+        }
+
+        // Stop receiving until the module reads the upload: the armed multishot recv is cancelled.
+        void pauseRecv(UringConnection *conn, bool armed) {
+            conn->paused = true;
+            if (!armed)
+                return;
+            auto *sqe = this->sqe();
+            if (!sqe)
+                return;
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = tag(conn, Recv);
+            sqe->user_data = tag(conn, Cancel);
+            ++conn->ops;
+        }
+
+        void resume(UringConnection *conn) {
+            if (!conn->paused || conn->closed)
+                return;
+            conn->paused = false;
+
+            // Input received before the recv was cancelled goes first.
+            if (!this->dispatch(conn)) {
+                this->close(conn);
+                return;
+            }
+            if (this->full(conn))
+                this->pauseRecv(conn, conn->receiving && conn->multishot);
+            else if (!conn->receiving)
+                this->armRecv(conn);
+        }
+
+        // Whether to stop receiving: the streamed body fills its window, or too many requests wait for their response.
+        bool full(UringConnection *conn) const {
+            return (conn->upload && conn->upload->pause()) || this->options.pipelineFull(conn->sequencer.pending());
+        }
+
+        // The streamed body is over, or will never be.
+        void endUpload(UringConnection *conn, bool complete) {
+            // Waits for a resume hook running on another thread.
+            conn->upload->onResume(nullptr);
+            if (complete) {
+                conn->upload->finish();
+                conn->parser.reset();
+            } else {
+                conn->upload->fail();
+            }
+            conn->upload.reset();
+        }
+
+        // Submit the queued responses of conn as one chain of linked sends, up to the first file body.
+        void armSends(UringConnection *conn) {
+            if (conn->chain || conn->closed || conn->pending.empty())
+                return;
+
+            auto &front = conn->pending.front();
+            if (front.file && conn->sentOffset == front.data.size()) {
+                this->armSplice(conn);
+                return;
+            }
+
+            auto limit = std::min<std::size_t>(conn->pending.size(), maxChain);
+            std::size_t count = 0;
+            while (count < limit && (count == 0 || !conn->pending[count].data.empty())) {
+                if (conn->pending[count++].file)
+                    break;
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                auto &data = conn->pending[i].data;
+                auto offset = i == 0 ? conn->sentOffset : 0;
+
+                auto *sqe = this->sqe(static_cast<unsigned>(count - i));
+                if (!sqe)
+                    return;
+                sqe->opcode = IORING_OP_SEND;
+                sqe->fd = conn->fd;
+                sqe->addr = reinterpret_cast<std::uint64_t>(data.data() + offset);
+                sqe->len = static_cast<std::uint32_t>(data.size() - offset);
+                sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+                sqe->flags = i + 1 < count ? IOSQE_IO_LINK : 0;
+                sqe->user_data = tag(conn, Send);
+                ++conn->ops;
+                ++conn->chain;
+            }
+        }
+
+        /**
+         * Send the file of the front response without copying it: spliced from the file into the
+         * connection pipe, then from the pipe into the socket, one pipe capacity at a time.
+         */
+        void armSplice(UringConnection *conn) {
+            auto &out = conn->pending.front();
+
+            if (conn->pipe[0] < 0) {
+                if (::pipe2(conn->pipe, O_CLOEXEC) < 0) {
+                    this->spliceFailed(conn);
+                    return;
+                }
+                auto capacity = ::fcntl(conn->pipe[1], F_SETPIPE_SZ, pipeSize);
+                if (capacity < 0)
+                    capacity = ::fcntl(conn->pipe[1], F_GETPIPE_SZ);
+                conn->pipeCapacity = static_cast<std::size_t>(std::max(capacity, 4096));
+            }
+
+            auto *sqe = this->sqe();
+            if (!sqe)
+                return;
+            sqe->opcode = IORING_OP_SPLICE;
+            sqe->off = static_cast<std::uint64_t>(-1);
+            sqe->splice_flags = SPLICE_F_MOVE;
+            if (conn->piped) {
+                sqe->splice_fd_in = conn->pipe[0];
+                sqe->splice_off_in = static_cast<std::uint64_t>(-1);
+                sqe->fd = conn->fd;
+                sqe->len = static_cast<std::uint32_t>(conn->piped);
+                sqe->user_data = tag(conn, SpliceOut);
+            } else {
+                sqe->splice_fd_in = out.file->fd;
+                sqe->splice_off_in = out.file->offset + out.fileSent;
+                sqe->fd = conn->pipe[1];
+                sqe->len = static_cast<std::uint32_t>(
+                        std::min<std::uint64_t>(out.file->length - out.fileSent, conn->pipeCapacity));
+                sqe->user_data = tag(conn, SpliceIn);
+            }
+            ++conn->ops;
+            ++conn->chain;
+        }
+
+        // The front file cannot be spliced: what is left of it is read and sent from memory.
+        void spliceFailed(UringConnection *conn) {
+            if (conn->piped || !conn->pending.front().readRest()) {
+                this->close(conn);
+                return;
+            }
+            conn->sentOffset = 0;
+            this->armSends(conn);
+        }
+
+        void close(UringConnection *conn) {
+            if (conn->closed)
+                return;
+            conn->closed = true;
+            if (conn->upload)
+                this->endUpload(conn, false);
+            {
+                std::lock_guard<std::mutex> guard(conn->lock);
+                conn->detached = true;
+            }
+            // Completes the armed recv and sends, the descriptor is released once they are done.
+            // Callers end with collect(), which may free conn.
+            ::shutdown(conn->fd, SHUT_RDWR);
+        }
+
+        // Free the reactor's reference once a closed connection has no SQE left in the ring.
+        void collect(UringConnection *conn) {
+            if (conn->closed && conn->ops == 0 && this->connections.erase(conn)) {
+                ::close(conn->fd);
+                conn->release();
+            }
+        }
+
+        static bool idle(const UringConnection *conn) {
+            return conn->sequencer.pending() == 0 && conn->pending.empty();
+        }
+
+        // Once the last response is written, finish the connection.
+        void closeIfDone(UringConnection *conn) {
+            if (conn->closed || !idle(conn))
+                return;
+            if (conn->peerClosed) {
+                this->close(conn);
+            } else if (conn->lastDispatched && !conn->halfClosed) {
+                ::shutdown(conn->fd, SHUT_WR);
+                conn->halfClosed = true;
+            }
+        }
+
+        // Close the keep-alive connections idle for too long.
+        void sweep() {
+            auto limit = std::chrono::steady_clock::now() - this->options.idleTimeout;
+            std::vector<UringConnection *> expired;
+            for (auto *conn : this->connections) {
+                if (!conn->closed && idle(conn) && conn->lastActivity < limit)
+                    expired.push_back(conn);
+            }
+            for (auto *conn : expired) {
+                this->close(conn);
+                this->collect(conn);
+            }
+        }
+
+        void onAccept(const io_uring_cqe &cqe) {
+            if (!(cqe.flags & IORING_CQE_F_MORE) && !this->stopping)
+                this->armAccept();
+            if (cqe.res < 0)
+                return;
+
+            sockaddr_in addr{};
+            socklen_t len = sizeof(addr);
+            ::getpeername(cqe.res, reinterpret_cast<sockaddr *>(&addr), &len);
+            socket::tune(cqe.res);
+
+            auto *conn = new UringConnection(cqe.res, socket::peerInfo(addr), *this);
+            this->connections.insert(conn);
+            this->armRecv(conn);
+        }
+
+        void onRecv(UringConnection *conn, const io_uring_cqe &cqe) {
+            bool more = cqe.flags & IORING_CQE_F_MORE;
+
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                auto bid = static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                if (cqe.res > 0) {
+                    auto *data = this->buffers.data(bid);
+                    conn->input.insert(conn->input.end(), data, data + cqe.res);
+                }
+                this->buffers.recycle(bid);
+            }
+            if (!more) {
+                --conn->ops;
+                conn->receiving = false;
+            }
+            conn->lastActivity = std::chrono::steady_clock::now();
+
+            if (cqe.res > 0) {
+                if (!conn->closed && !this->dispatch(conn))
+                    this->close(conn);
+                // While a streamed body fills its window, or too many requests wait for their response, the socket
+                // is left unread until the modules catch up.
+                if (!conn->closed && !conn->paused && this->full(conn))
+                    this->pauseRecv(conn, more);
+                if (!more && !conn->closed && !conn->paused)
+                    this->armRecv(conn);
+            } else if (cqe.res == 0) {
+                conn->peerClosed = true;
+                if (conn->upload)
+                    this->endUpload(conn, flushUpload(conn->parser, *conn->upload, conn->input));
+                this->closeIfDone(conn);
+            } else if ((cqe.res == -ENOBUFS || cqe.res == -ECANCELED) && !conn->closed) {
+                if (!conn->paused)
+                    this->armRecv(conn);
+            } else if (cqe.res == -EINVAL && conn->multishot && !conn->closed) {
+                conn->multishot = false; // Kernel older than 6.0: one recv at a time.
+                this->armRecv(conn);
+            } else {
+                this->close(conn);
+            }
+            this->collect(conn);
+        }
+
+        void onSplice(UringConnection *conn, const io_uring_cqe &cqe, bool in) {
+            --conn->ops;
+            --conn->chain;
+
+            if (conn->closed) {
+                this->collect(conn);
+                return;
+            }
+            auto &front = conn->pending.front();
+            if (cqe.res > 0 && in) {
+                conn->piped = static_cast<std::size_t>(cqe.res);
+                this->armSplice(conn);
+            } else if (cqe.res > 0) {
+                conn->piped -= static_cast<std::size_t>(cqe.res);
+                front.fileSent += static_cast<std::uint64_t>(cqe.res);
+                conn->lastActivity = std::chrono::steady_clock::now();
+                if (!conn->piped && front.fileSent == front.file->length) {
+                    conn->pending.pop_front();
+                    conn->sentOffset = 0;
+                }
+                this->armSends(conn);
+                this->closeIfDone(conn);
+            } else if (in && cqe.res == -EINVAL) {
+                this->spliceFailed(conn);
+            } else {
+                this->close(conn); // Includes a file shorter than its body.
+            }
+            this->collect(conn);
+        }
+
+        void onCancel(UringConnection *conn) {
+            --conn->ops;
+            this->collect(conn);
+        }
+
+        void onSend(UringConnection *conn, const io_uring_cqe &cqe) {
+            --conn->ops;
+            --conn->chain;
+
+            if (cqe.res >= 0 && !conn->pending.empty()) {
+                auto &front = conn->pending.front();
+                conn->sentOffset += static_cast<std::size_t>(cqe.res);
+                conn->lastActivity = std::chrono::steady_clock::now();
+                if (conn->sentOffset == front.data.size() && !front.file) {
+                    conn->pending.pop_front();
+                    conn->sentOffset = 0;
+                }
+            } else if (cqe.res != -ECANCELED) {
+                this->close(conn);
+            }
+
+            // A short send cancels the rest of the chain, it is resubmitted from where it stopped.
+            if (!conn->chain) {
+                this->armSends(conn);
+                this->closeIfDone(conn);
+            }
+            this->collect(conn);
+        }
+
+        // Hand every complete request to the callback, and the input to the body being streamed.
+        // Returns false on a malformed request.
+        bool dispatch(UringConnection *conn) {
+            auto &input = conn->input;
+
+            while (conn->upload || !conn->lastDispatched) {
+                auto *begin = input.data() + conn->inputOffset;
+                auto size = input.size() - conn->inputOffset;
+
+                if (conn->upload) {
+                    std::size_t used;
+                    auto result = feedUpload(conn->parser, *conn->upload, begin, size, used);
+                    conn->inputOffset += used;
+                    if (result == zia::apipp::RequestParser::Result::Error)
+                        return false;
+                    if (result == zia::apipp::RequestParser::Result::Incomplete)
+                        break;
+                    this->endUpload(conn, true);
+                    continue;
+                }
+                if (this->options.pipelineFull(conn->sequencer.pending()))
+                    break;
+
+                auto result = conn->parser.parse(begin, size);
+                if (result == zia::apipp::RequestParser::Result::Error)
+                    return false;
+                if (result == zia::apipp::RequestParser::Result::Incomplete &&
+                    !conn->parser.bodyExceeds(this->options.bodyWindow, size))
+                    break;
+
+                auto length = conn->parser.length();
+                auto last = !conn->parser.keepAlive() || !this->options.acceptsMore(++conn->requests);
+                zia::api::Net::Raw request;
+                std::shared_ptr<zia::apipp::BodyStream> body;
+                std::optional<zia::apipp::RequestParser> parsed;
+                if (result == zia::apipp::RequestParser::Result::Complete) {
+                    request.assign(begin, begin + length);
+                    // Handed over with the request, which is filled from it instead of being parsed again.
+                    parsed.emplace(std::move(conn->parser));
+                    conn->parser.reset();
+                } else {
+                    body = startUpload(conn->parser, begin, this->options.bodyWindow, request);
+                    body->onResume([this, conn]() {
+                        // Called with the upload locked: conn is alive until endUpload() resets the hook.
+                        std::lock_guard<std::mutex> guard(conn->lock);
+                        if (!conn->detached) {
+                            conn->acquire();
+                            this->post({conn, Outgoing::Kind::Resume});
+                        }
+                    });
+                    conn->upload = body;
+                }
+                conn->inputOffset += length;
+
+                auto info = conn->info;
+                info.time = std::chrono::system_clock::now();
+                info.start = std::chrono::steady_clock::now();
+                info.sock = new UringExchange(conn, conn->sequencer.take(), std::move(body), std::move(parsed));
+
+                conn->lastDispatched = last;
+                conn->acquire();
+                this->callback(std::move(request), std::move(info));
+            }
+
+            // Whatever follows the last request of the connection is ignored.
+            if (!conn->upload && conn->lastDispatched)
+                input.clear();
+            else
+                input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(conn->inputOffset));
+            conn->inputOffset = 0;
+            return true;
+        }
+
+        void drain() {
+            {
+                std::lock_guard<std::mutex> guard(this->queueLock);
+                std::swap(this->queue, this->draining);
+            }
+            for (auto &out : this->draining) {
+                switch (out.kind) {
+                    case Outgoing::Kind::Message:
+                        this->deliver(out.conn, std::move(out.data));
+                        this->collect(out.conn);
+                        out.conn->release();
+                        break;
+                    case Outgoing::Kind::Answer:
+                        this->answer(out.conn, out.sequence, {std::move(out.data), std::move(out.file)}, out.close);
+                        break;
+                    case Outgoing::Kind::Resume:
+                        this->resume(out.conn);
+                        this->collect(out.conn);
+                        out.conn->release();
+                        break;
+                }
+            }
+            this->draining.clear();
+        }
+
+        void loop() {
+            currentReactor = this;
+            this->armAccept();
+            this->armWakeup();
+            if (this->options.idleTimeout.count() > 0)
+                this->armTimeout();
+
+            while (!this->stopping) {
+                this->flush();
+                if (!this->ring.submit(1)) {
+                    this->fail("io_uring_enter", this->ring.error());
+                    break;
+                }
+                this->ring.completions([this](const io_uring_cqe &cqe) {
+                    auto op = static_cast<Op>(cqe.user_data & opMask);
+                    auto *ptr = reinterpret_cast<void *>(cqe.user_data & ~opMask);
+
+                    switch (op) {
+                        case Accept:
+                            this->onAccept(cqe);
+                            break;
+                        case Recv:
+                            this->onRecv(static_cast<UringConnection *>(ptr), cqe);
+                            break;
+                        case Send:
+                            this->onSend(static_cast<UringConnection *>(ptr), cqe);
+                            break;
+                        case Wakeup:
+                            this->drain();
+                            this->armWakeup();
+                            break;
+                        case Timeout:
+                            this->sweep();
+                            this->armTimeout();
+                            break;
+                        case Cancel:
+                            this->onCancel(static_cast<UringConnection *>(ptr));
+                            break;
+                        case SpliceIn:
+                        case SpliceOut:
+                            this->onSplice(static_cast<UringConnection *>(ptr), cqe, op == SpliceIn);
+                            break;
+                    }
+                });
+            }
+            currentReactor = nullptr;
+        }
+
+    public:
+        UringReactor(zia::api::Net::Callback callback, const Options &options)
+                : callback{std::move(callback)}, options{options} {
+            auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(options.sweepInterval()).count();
+            this->sweepPeriod.tv_sec = period / 1000000000;
+            this->sweepPeriod.tv_nsec = period % 1000000000;
+        }
+
+        /**
+         * Once the thread is stopped, cancel every operation still in the kernel and reap them, so that
+         * no send, splice or recv runs on the buffers and descriptors of the connections once released.
+         * Their sockets are shut down first, which ends the operations waiting on them.
+         */
+        void cancelAll() {
+            if (!this->ring.pending())
+                return;
+            this->backlog.clear();
+            for (auto *conn : this->connections)
+                ::shutdown(conn->fd, SHUT_RDWR);
+
+            auto *cancel = this->ring.sqe();
+            if (!cancel)
+                return;
+            cancel->opcode = IORING_OP_ASYNC_CANCEL;
+            cancel->fd = -1;
+            cancel->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+            cancel->user_data = tag(this, Cancel);
+            // Bounds the wait, should an operation not be cancellable.
+            auto *timeout = this->ring.sqe();
+            if (!timeout)
+                return;
+            timeout->opcode = IORING_OP_TIMEOUT;
+            timeout->fd = -1;
+            timeout->addr = reinterpret_cast<std::uint64_t>(&this->drainPeriod);
+            timeout->len = 1;
+            timeout->user_data = tag(&this->drainPeriod, Timeout);
+
+            bool expired = false;
+            while (!expired && this->ring.pending() > 1 && this->ring.submit(1)) {
+                this->ring.completions([this, &expired](const io_uring_cqe &cqe) {
+                    expired = expired || cqe.user_data == tag(&this->drainPeriod, Timeout);
+                });
+            }
+        }
+
+        ~UringReactor() {
+            this->stop();
+            this->cancelAll();
+
+            for (auto *conn : this->connections) {
+                if (conn->upload)
+                    this->endUpload(conn, false);
+                {
+                    std::lock_guard<std::mutex> guard(conn->lock);
+                    conn->detached = true;
+                }
+                ::close(conn->fd);
+                conn->release();
+            }
+            for (auto &out : this->queue)
+                out.conn->release();
+            for (auto fd : {this->listener, this->wakeup}) {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+        }
+
+        bool listen(std::uint16_t port) {
+            if (!this->ring.init(ringEntries) || !this->buffers.init(this->ring))
+                return false;
+
+            this->wakeup = ::eventfd(0, EFD_CLOEXEC);
+            this->listener = socket::listen(port);
+            if (this->wakeup < 0 || this->listener < 0)
+                return false;
+            // Completions replace readiness: the listener does not need to be non-blocking.
+            ::fcntl(this->listener, F_SETFL, ::fcntl(this->listener, F_GETFL) & ~O_NONBLOCK);
+            return true;
+        }
+
+        void start() {
+            this->thread = std::thread([this]() { this->loop(); });
+        }
+
+        /**
+         * Why the reactor stopped by itself, empty if it did not.
+         */
+        std::string error() const {
+            std::lock_guard<std::mutex> guard(this->failureLock);
+            return this->failure;
+        }
+
+        void stop() {
+            if (this->thread.joinable()) {
+                this->stopping = true;
+                std::uint64_t one = 1;
+                (void) ::write(this->wakeup, &one, sizeof(one));
+                this->thread.join();
+            }
+        }
+
+        // Reactor thread: queue data on conn and submit it.
+        void deliver(UringConnection *conn, zia::api::Net::Raw data) {
+            if (!conn->closed) {
+                conn->pending.push_back({std::move(data)});
+                this->armSends(conn);
+            }
+        }
+
+        // Reactor thread: queue the response of a dispatched request, after the previous responses.
+        void answer(UringConnection *conn, std::uint64_t sequence, Outbound data, bool close) {
+            conn->lastDispatched = conn->lastDispatched || close;
+            if (!conn->sequencer.ready(sequence)) {
+                conn->sequencer.hold(sequence, std::move(data));
+            } else if (!conn->closed) {
+                conn->pending.push_back(std::move(data));
+                conn->sequencer.next([conn](Outbound &held) {
+                    conn->pending.push_back(std::move(held));
+                });
+                this->armSends(conn);
+                // Requests received while the pipeline was full go on, once the dispatch which may be running
+                // (the callback can answer right away) is over.
+                if (conn->paused) {
+                    std::lock_guard<std::mutex> guard(conn->lock);
+                    if (!conn->detached) {
+                        conn->acquire();
+                        this->post({conn, Outgoing::Kind::Resume});
+                    }
+                }
+                this->closeIfDone(conn);
+                this->collect(conn);
+            } else {
+                conn->sequencer.next([](Outbound &) {});
+            }
+            conn->release();
+        }
+
+        bool isCurrent() const {
+            return currentReactor == this;
+        }
+
+        /**
+         * Hand data to the reactor owning conn from another thread, conn lock must be held.
+         */
+        void post(Outgoing out) {
+            bool wasEmpty;
+            {
+                std::lock_guard<std::mutex> guard(this->queueLock);
+                wasEmpty = this->queue.empty();
+                this->queue.push_back(std::move(out));
+            }
+            if (wasEmpty) {
+                std::uint64_t one = 1;
+                (void) ::write(this->wakeup, &one, sizeof(one));
+            }
+        }
+    };
+
+    void UringConnection::sendMessage(std::string &message) {
+        auto *data = reinterpret_cast<const std::byte *>(message.data());
+        zia::api::Net::Raw raw(data, data + message.size());
+
+        if (this->reactor.isCurrent()) {
+            this->reactor.deliver(this, std::move(raw));
+            return;
+        }
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (!this->detached) {
+            this->acquire();
+            this->reactor.post({this, UringReactor::Outgoing::Kind::Message, std::move(raw)});
+        }
+    }
+
+    UringNet::UringNet() = default;
+
+    UringNet::~UringNet() {
+        this->stop();
+    }
+
+    bool UringNet::supported() {
+        Ring ring;
+        BufferRing buffers;
+
+        return ring.init(8) && buffers.init(ring);
+    }
+
+    bool UringNet::config(const zia::api::Conf &conf) {
+        this->options = Options::fromConf(conf);
+        return true;
+    }
+
+    bool UringNet::run(Callback cb) {
+        if (!this->reactors.empty())
+            return false;
+
+        for (unsigned i = 0; i < this->options.threadCount(); ++i) {
+            auto reactor = std::make_unique<UringReactor>(cb, this->options);
+            if (!reactor->listen(this->options.port)) {
+                this->reactors.clear();
+                return false;
+            }
+            this->reactors.push_back(std::move(reactor));
+        }
+        for (auto &reactor : this->reactors)
+            reactor->start();
+        return true;
+    }
+
+    namespace {
+        bool respond(zia::api::ImplSocket *sock, zia::api::Net::Raw resp, bool close,
+                     std::shared_ptr<const zia::api::FileBody> file = nullptr) {
+            auto *exchange = static_cast<UringExchange *>(sock);
+            auto *conn = exchange->connection;
+            auto sequence = exchange->sequence;
+            exchange->answered();
+            delete exchange;
+
+            // From the callback: the reactor is running, no need to lock.
+            if (conn->reactor.isCurrent()) {
+                conn->reactor.answer(conn, sequence, {std::move(resp), std::move(file)}, close);
+                return true;
+            }
+
+            std::unique_lock<std::mutex> guard(conn->lock);
+
+            if (conn->detached) {
+                guard.unlock();
+                conn->release();
+                return false;
+            }
+            conn->reactor.post({conn, UringReactor::Outgoing::Kind::Answer, std::move(resp), sequence, close,
+                                std::move(file)});
+            return true;
+        }
+    }
+
+    bool UringNet::send(zia::api::ImplSocket *sock, const Raw &resp) {
+        return respond(sock, resp, false);
+    }
+
+    bool UringNet::send(zia::api::ImplSocket *sock, const zia::apipp::ResponseSerializer &resp) {
+        // A file body stays out of the copy, it is spliced.
+        auto head = resp.header();
+        auto body = resp.content();
+        Raw data;
+        data.reserve(head.size() + body.size());
+        data.insert(data.end(), head.begin(), head.end());
+        data.insert(data.end(), body.begin(), body.end());
+        return respond(sock, std::move(data), resp.closes(), resp.file());
+    }
+
+    std::string UringNet::error() const {
+        for (const auto &reactor : this->reactors) {
+            auto failure = reactor->error();
+            if (!failure.empty())
+                return failure;
+        }
+        return {};
+    }
+
+    bool UringNet::stop() {
+        for (auto &reactor : this->reactors)
+            reactor->stop();
+        this->reactors.clear();
+        return true;
+    }
+
+}
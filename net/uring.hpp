@@ -0,0 +1,67 @@
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../api/net.h"
+#include "../api/pp/serializer.hpp"
+#include "options.hpp"
+
+namespace zia::net {
+
+    class UringReactor;
+
+    /**
+     * Linux implementation of zia::api::Net on io_uring, without liburing.
+     *
+     * Each thread owns a ring and a SO_REUSEPORT listener. Connections are accepted with a multishot
+     * accept and read with multishot recv into a provided buffer ring. Responses of a connection are
+     * submitted as a chain of linked sends, and all the SQEs produced by one loop iteration (every
+     * connection of the ring) go to the kernel in a single io_uring_enter.
+     *
+     * Same configuration keys and keep-alive behaviour as EpollNet. Needs Linux 5.19 or newer (see supported()).
+     * send() can be called from any thread, exactly once per request given to the callback.
+     */
+    class UringNet : public zia::api::Net {
+    private:
+        Options options{};
+        std::vector<std::unique_ptr<UringReactor>> reactors;
+
+    public:
+        UringNet();
+
+        // Put in the .cpp file to allow proper destructor call.
+        ~UringNet() override;
+
+        /**
+         * @return true if the running kernel provides every io_uring feature used.
+         */
+        static bool supported();
+
+        /**
+         * Read the configuration keys listed in EpollNet, applied on next run().
+         */
+        bool config(const zia::api::Conf &conf) override;
+
+        bool run(Callback cb) override;
+
+        bool send(zia::api::ImplSocket *sock, const Raw &resp) override;
+
+        /**
+         * Send a serialized response. The segments are copied into one buffer, which must live until the send completes;
+         * a file body is spliced from its descriptor to the socket through a pipe.
+         */
+        bool send(zia::api::ImplSocket *sock, const zia::apipp::ResponseSerializer &resp);
+
+        /**
+         * Why a thread stopped serving by itself (its ring refused submissions), empty while all of them serve.
+         * Its listener is closed, the other threads keep accepting connections.
+         */
+        std::string error() const;
+
+        bool stop() override;
+    };
+
+}